@@ -0,0 +1,179 @@
+/**
+ * Microbenchmarks of Bvh build, refit and queries over random scenes of boxes,
+ * with the flat cull_boxes frustum test as a reference.
+ *
+ * The scenes keep the same density of boxes at every size, so a query
+ * touches about the same part of the world as the scenes grow.
+ */
+#include "Bvh.hpp"
+#include "FrustumCull.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <format>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+struct Scene
+{
+	std::vector<BvhBox> boxes;
+	float size;
+};
+
+auto random_scene(std::mt19937& random, uint32_t count)
+	-> Scene
+{
+	// NOTE about one box in every 64 cubic units
+	const float size = std::cbrt(static_cast<float>(count) * 64.0f);
+	std::uniform_real_distribution<float> position(-size * 0.5f, size * 0.5f);
+	std::uniform_real_distribution<float> extent(0.25f, 1.0f);
+
+	Scene scene{{}, size};
+	scene.boxes.reserve(count);
+	for (uint32_t i = 0; i < count; i++) {
+		const glm::vec3 center(position(random), position(random), position(random));
+		const glm::vec3 half(extent(random), extent(random), extent(random));
+		scene.boxes.push_back(BvhBox{center - half, center + half});
+	}
+	return scene;
+}
+
+void move_boxes(std::mt19937& random, std::vector<BvhBox>& boxes)
+{
+	std::uniform_real_distribution<float> offset(-0.5f, 0.5f);
+	for (BvhBox& box: boxes) {
+		const glm::vec3 move(offset(random), offset(random), offset(random));
+		box.min = box.min + move;
+		box.max = box.max + move;
+	}
+}
+
+template<typename Function>
+auto milliseconds(uint32_t runs, Function function)
+	-> double
+{
+	const auto start = std::chrono::steady_clock::now();
+	for (uint32_t run = 0; run < runs; run++)
+		function();
+	const auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::milli>(end - start).count() / runs;
+}
+
+auto camera_frustum(float scene_size)
+	-> Frustum
+{
+	// NOTE at the edge of the scene looking at its center, seeing a few percent of it
+	const glm::vec3 eye(0.0f, 0.0f, scene_size * 0.5f);
+	const glm::mat4 view = glm::lookAt(eye, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	const glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, scene_size * 0.5f);
+	return frustum_from_view_projection(projection * view);
+}
+
+void benchmark(std::mt19937& random, uint32_t count)
+{
+	Scene scene = random_scene(random, count);
+	const uint32_t runs = std::max(1u, 1000000u / count);
+
+	Bvh bvh{};
+	const double build = milliseconds(runs, [&] { bvh.build(scene.boxes); });
+
+	move_boxes(random, scene.boxes);
+	const double refit = milliseconds(runs, [&] { bvh.refit(scene.boxes); });
+
+	const Frustum frustum = camera_frustum(scene.size);
+	std::vector<uint32_t> visible{};
+	visible.reserve(count);
+	const double frustum_query = milliseconds(runs, [&] {
+		visible.clear();
+		bvh.query_frustum(frustum, visible);
+	});
+
+	CullBoxes cull_boxes_scene{};
+	cull_boxes_scene.reserve(count);
+	for (BvhBox const& box: scene.boxes) {
+		const glm::vec3 center = (box.min + box.max) * 0.5f;
+		const glm::vec3 extent = (box.max - box.min) * 0.5f;
+		cull_boxes_scene.center_x.push_back(center.x);
+		cull_boxes_scene.center_y.push_back(center.y);
+		cull_boxes_scene.center_z.push_back(center.z);
+		cull_boxes_scene.extent_x.push_back(extent.x);
+		cull_boxes_scene.extent_y.push_back(extent.y);
+		cull_boxes_scene.extent_z.push_back(extent.z);
+	}
+	std::vector<uint32_t> flat_visible{};
+	flat_visible.reserve(count);
+	const double flat_query = milliseconds(runs, [&] {
+		flat_visible.clear();
+		cull_boxes(frustum, cull_boxes_scene, flat_visible);
+	});
+
+	std::sort(visible.begin(), visible.end());
+	if (visible != flat_visible) {
+		std::cout << std::format("{} objects: bvh found {} visible, cull_boxes found {}",
+								 count, visible.size(), flat_visible.size())
+				  << std::endl;
+		std::exit(EXIT_FAILURE);
+	}
+
+	/* Rays from random points at the edge of the scene through its center region,
+	 * and random points inside it.
+	 */
+	uint32_t constexpr query_count = 10000;
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::vector<glm::vec3> origins{};
+	std::vector<glm::vec3> directions{};
+	std::vector<glm::vec3> points{};
+	for (uint32_t i = 0; i < query_count; i++) {
+		const glm::vec3 origin = glm::normalize(glm::vec3(unit(random), unit(random), unit(random)))
+			* scene.size;
+		const glm::vec3 target = glm::vec3(unit(random), unit(random), unit(random)) * (scene.size * 0.25f);
+		origins.push_back(origin);
+		directions.push_back(glm::normalize(target - origin));
+		points.push_back(glm::vec3(unit(random), unit(random), unit(random)) * (scene.size * 0.5f));
+	}
+
+	uint32_t ray_hits = 0;
+	const double raycast = milliseconds(1, [&] {
+		for (uint32_t i = 0; i < query_count; i++)
+			ray_hits += bvh.raycast(origins[i], directions[i], scene.size * 4.0f).has_value();
+	});
+
+	std::vector<uint32_t> point_hits{};
+	const double point_query = milliseconds(1, [&] {
+		for (uint32_t i = 0; i < query_count; i++)
+			bvh.query_point(points[i], point_hits);
+	});
+
+	std::cout << std::format("{} objects, {} nodes\n", count, bvh.nodes().size())
+			  << std::format("  build:         {:10.3f} ms\n", build)
+			  << std::format("  refit:         {:10.3f} ms\n", refit)
+			  << std::format("  frustum:       {:10.3f} ms, {} visible\n", frustum_query, visible.size())
+			  << std::format("  cull_boxes:    {:10.3f} ms\n", flat_query)
+			  << std::format("  {} rays:    {:10.3f} ms, {} hit\n", query_count, raycast, ray_hits)
+			  << std::format("  {} points:  {:10.3f} ms, {} inside\n", query_count, point_query, point_hits.size())
+			  << std::endl;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<uint32_t> counts{10000, 100000, 1000000};
+	if (argc > 1) {
+		counts.clear();
+		for (int i = 1; i < argc; i++)
+			counts.push_back(static_cast<uint32_t>(std::stoul(argv[i])));
+	}
+
+	std::mt19937 random(1234);
+	for (uint32_t count: counts)
+		benchmark(random, count);
+	return EXIT_SUCCESS;
+}
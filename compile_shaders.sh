@@ -13,9 +13,38 @@ function compile_vert_frag ()
   echo "compiled ${SHADER_SOURCE_DIR}/""$1"".frag to ${RESOURCES_DIR}/""$1"".frag.spv"
 }
 
+# compile a vertex shader without a fragment shader, for depth only pipelines
+function compile_vert ()
+{
+  glslc ${SHADER_SOURCE_DIR}/"$1".vert -o ${RESOURCES_DIR}/"$1".vert.spv
+  echo "compiled ${SHADER_SOURCE_DIR}/""$1"".vert to ${RESOURCES_DIR}/""$1"".vert.spv"
+}
+
+function compile_comp ()
+{
+  glslc ${SHADER_SOURCE_DIR}/"$1".comp -o ${RESOURCES_DIR}/"$1".comp.spv
+  echo "compiled ${SHADER_SOURCE_DIR}/""$1"".comp to ${RESOURCES_DIR}/""$1"".comp.spv"
+}
+
+# compile a fragment shader again with one or more defines, as a variant of the same shader
+function compile_frag_variant ()
+{
+  local defines=()
+  for define in "${@:3}"; do
+    defines+=(-D"$define")
+  done
+  glslc "${defines[@]}" ${SHADER_SOURCE_DIR}/"$1".frag -o ${RESOURCES_DIR}/"$2".frag.spv
+  echo "compiled ${SHADER_SOURCE_DIR}/""$1"".frag with ${*:3} to ${RESOURCES_DIR}/""$2"".frag.spv"
+}
+
 compile_vert_frag "NormColor"
 compile_vert_frag "Wireframe"
 compile_vert_frag "Diffuse"
 compile_vert_frag "Material"
-compile_vert_frag "OrthographicDepth"
-compile_vert_frag "PerspectiveDepth"
+compile_vert "ShadowDepth"
+compile_vert "DepthPrepass"
+compile_frag_variant "Diffuse" "DiffuseBindless" "BINDLESS"
+compile_frag_variant "Material" "MaterialBindless" "BINDLESS"
+compile_frag_variant "Material" "MaterialClustered" "CLUSTERED"
+compile_frag_variant "Material" "MaterialBindlessClustered" "BINDLESS" "CLUSTERED"
+compile_comp "FrustumCull"
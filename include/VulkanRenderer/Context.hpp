@@ -43,6 +43,31 @@ struct WindowConfig
 	std::optional<std::int32_t> fps;
 };
 
+/**
+ * Identifies a batch of gpu uploads (textures, buffers) recorded on the Context.
+ * Uploads are not submitted one by one, they are collected and submitted together,
+ * either explicitly through flush_uploads() or implicitly by the Presenter before
+ * every frame.
+ */
+struct UploadTicket
+{
+	uint64_t value{0};
+};
+
+/**
+ * Device memory usage as seen by the Context allocator.
+ * reserved_bytes is what has been allocated from the driver,
+ * used_bytes is what resources actually occupy of it.
+ */
+struct MemoryStats
+{
+	uint64_t reserved_bytes{0};
+	uint64_t used_bytes{0};
+	uint32_t block_count{0};
+	uint32_t dedicated_count{0};
+	uint32_t allocation_count{0};
+};
+
 struct RenderConfig
 {
 	std::optional<std::string> window_name{ std::nullopt };
@@ -74,6 +99,12 @@ public:
 	U32Extent window_resize_event_triggered() noexcept;
 	void wait_until_idle() noexcept;
 
+	UploadTicket flush_uploads();
+	bool is_upload_complete(UploadTicket ticket);
+	void wait_for_upload(UploadTicket ticket);
+
+	MemoryStats memory_stats();
+
 	class Impl;
 	std::unique_ptr<Impl> impl;
 };
@@ -8,6 +8,7 @@
 struct DescriptorPoolCreateInfo
 {
 	std::optional<uint32_t> uniform_buffer_count{std::nullopt};
+	std::optional<uint32_t> uniform_buffer_dynamic_count{std::nullopt};
 	std::optional<uint32_t> combined_image_sampler_count{std::nullopt};
 };
 
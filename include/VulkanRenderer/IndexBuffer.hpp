@@ -0,0 +1,38 @@
+#pragma once
+
+#include "Context.hpp"
+
+#include <vector>
+
+/**
+ * 32 bit triangle list indices into a VertexBuffer.
+ * The indices are uploaded once into device local memory.
+ */
+struct IndexBuffer
+{
+	IndexBuffer(Render::Context& context,
+				const uint32_t* indices,
+				size_t indices_length);
+	
+	static IndexBuffer create(Render::Context& context,
+							  const std::vector<uint32_t>& indices)
+	{
+		return IndexBuffer(context,
+						   indices.data(),
+						   indices.size());
+	}
+
+	// @note the indices are uploaded asynchronously,
+	//       the ticket can be polled or waited on through the Context.
+	auto upload_ticket()
+		const noexcept -> UploadTicket;
+	
+	// NOTE not explicit, so meshes can be aggregate initialized without indices.
+	IndexBuffer();
+	~IndexBuffer();
+	IndexBuffer(IndexBuffer&& rhs);
+	IndexBuffer& operator=(IndexBuffer&& rhs);
+
+	class Impl;
+	std::unique_ptr<Impl> impl{ nullptr };
+};
@@ -4,6 +4,8 @@
 
 #include <variant>
 #include <algorithm>
+#include <cmath>
+#include <limits>
 
 struct DirectionalLight
 {
@@ -19,11 +21,23 @@ struct Attenuation
 	float linear;
 	float quadratic;
 
-	constexpr auto approximate_distance(float intensity)
+	/**
+	 * Distance at which the light has fallen off to intensity of its full strength,
+	 * solving 1 / (constant + linear * d + quadratic * d^2) = intensity for d.
+	 * A light without any falloff reaches infinitely far.
+	 */
+	auto approximate_distance(float intensity)
 		const noexcept -> float
 	{
-		float F = std::clamp(intensity, 0.0f, 1.0f);
-		return ((-constant * F) - (4 * F * quadratic) + 1) / F * linear;
+		const float F = std::clamp(intensity, 1.0e-6f, 1.0f);
+		const float c = constant - 1.0f / F;
+		if (c >= 0.0f)
+			return 0.0f;
+		if (quadratic > 0.0f)
+			return (-linear + std::sqrt(linear * linear - 4.0f * quadratic * c)) / (2.0f * quadratic);
+		if (linear > 0.0f)
+			return -c / linear;
+		return std::numeric_limits<float>::infinity();
 	}
 };
 
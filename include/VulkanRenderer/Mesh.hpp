@@ -3,11 +3,17 @@
 #include <filesystem>
 #include <variant>
 #include "VertexBuffer.hpp"
+#include "IndexBuffer.hpp"
 
 struct Mesh
 {
 	//VertexBuffer<VertexPosNormColor> vertexbuffer;
 	VertexBuffer vertexbuffer;
+	// NOTE optional, meshes without indices are drawn as a plain triangle list.
+	IndexBuffer indexbuffer;
+
+	// Object space bounds, computed when the vertices are created
+	std::optional<MeshBounds> bounds() const noexcept { return vertexbuffer.bounds; }
 };
 
 struct MeshWithWarning
@@ -20,6 +26,11 @@ struct TexturedMesh
 {
 	//VertexBuffer<VertexPosNormColorUV> vertexbuffer;
 	VertexBuffer vertexbuffer;
+	// NOTE optional, meshes without indices are drawn as a plain triangle list.
+	IndexBuffer indexbuffer;
+
+	// Object space bounds, computed when the vertices are created
+	std::optional<MeshBounds> bounds() const noexcept { return vertexbuffer.bounds; }
 };
 
 struct TexturedMeshWithWarning
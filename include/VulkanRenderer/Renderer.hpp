@@ -3,12 +3,16 @@
 #include "Renderable.hpp"
 #include "Light.hpp"
 #include "ShadowCaster.hpp"
+#include "Scene.hpp"
 #include "Context.hpp"
 #include "Presenter.hpp"
 #include "DescriptorPool.hpp"
 
 #include <algorithm>
 #include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
 
 
 
@@ -19,6 +23,89 @@ struct WorldRenderInfo
 	glm::vec3 camera_position;
 };
 
+struct RendererCreateInfo
+{
+	/* Directory the pipeline cache is loaded from and saved to,
+	 * without it compiled pipelines are only cached for the lifetime of the renderer.
+	 */
+	std::optional<std::filesystem::path> pipeline_cache_directory{std::nullopt};
+
+	/* Worker threads used to build pipelines and record command buffers,
+	 * defaults to one less than the available hardware threads.
+	 */
+	std::optional<uint32_t> worker_count{std::nullopt};
+
+	/* Draw the material and base texture pipelines with all textures in a single
+	 * descriptor array indexed from the shaders, instead of a descriptor set per texture.
+	 * Needs VK_EXT_descriptor_indexing, without it the renderer falls back to descriptor sets.
+	 */
+	bool bindless_textures{false};
+
+	/* Sort draws front to back before sorting them by material and mesh,
+	 * trading some rebinds for earlier depth rejection of opaque geometry.
+	 */
+	bool front_to_back{false};
+
+	/* Cull the material draws and shadow casters with a compute pre-pass that writes
+	 * the indirect draws of every pass, instead of culling them on the cpu.
+	 * The culling statistics of these passes are then read back a few frames late.
+	 */
+	bool gpu_culling{false};
+
+	/* Shade the material pipeline with only the point and spot lights reaching the
+	 * view space cluster of each fragment, binned on the cpu every frame, instead of
+	 * every light for every fragment.
+	 */
+	bool clustered_lighting{false};
+
+	/* Draw the depth of the material pipeline in a position only pre-pass, so the material
+	 * shader only runs once for every pixel it covers instead of for every overlapping draw.
+	 * Costs a second pass over the material geometry, compare the gpu timings per scene.
+	 */
+	bool depth_prepass{false};
+
+	/* Width and height of the shadow atlas every shadow caster is rendered into,
+	 * has to be a power of two. Casters are given smaller tiles when they do not all fit.
+	 */
+	uint32_t shadow_atlas_size{2048};
+};
+
+/**
+ * Wall time spent on one render pass or pipeline,
+ * either creating it or recording its draws for a frame,
+ * or the gpu time spent executing a pass of a frame.
+ */
+struct RendererTiming
+{
+	std::string name;
+	double milliseconds;
+};
+
+/**
+ * Material and mesh buffer binds the draws of one pipeline needed during the last render,
+ * in submission order and in the sorted order they were recorded in.
+ * The draws of a Scene are sorted when it changes, their submission order is not known
+ * by then, so they only have the binds of the recorded order.
+ */
+struct RendererDrawStatistics
+{
+	std::string name;
+	uint32_t draws;
+	std::optional<uint32_t> unsorted_binds;
+	uint32_t sorted_binds;
+};
+
+/**
+ * Renderables of one pass inside and outside its frustum during the last render,
+ * the camera for the geometry pipelines and the light for the shadow passes.
+ */
+struct RendererCullStatistics
+{
+	std::string name;
+	uint32_t visible;
+	uint32_t culled;
+};
+
 class Renderer
 {
 public:
@@ -26,10 +113,38 @@ public:
 			 Presenter& presenter,
 			 Logger logger,
 			 DescriptorPool& descriptor_pool,
-			 const std::filesystem::path shaders_root);
+			 const std::filesystem::path shaders_root,
+			 RendererCreateInfo const& create_info = RendererCreateInfo{});
 
 	~Renderer();
+
+	// Time spent creating each pass and pipeline, including reading the shaders
+	[[nodiscard]]
+	auto startup_timings() const
+		-> std::vector<RendererTiming> const&;
+
+	// Time spent recording each pass during the last render
+	[[nodiscard]]
+	auto recording_timings() const
+		-> std::vector<RendererTiming> const&;
+
+	/* Gpu time spent by the depth pre-pass and the geometry pass, read back from the
+	 * last time the flight frame was rendered, so a few frames late.
+	 * Empty when the graphics queue can not write timestamps.
+	 */
+	[[nodiscard]]
+	auto gpu_timings() const
+		-> std::vector<RendererTiming> const&;
+
+	[[nodiscard]]
+	auto draw_statistics() const
+		-> std::vector<RendererDrawStatistics> const&;
+
+	[[nodiscard]]
+	auto cull_statistics() const
+		-> std::vector<RendererCullStatistics> const&;
 	
+	// Draw renderables and lights given for this frame only
 	auto render(const uint32_t current_frame_in_flight,
 				const uint64_t total_frames,
 				const WorldRenderInfo& world_info,
@@ -38,6 +153,20 @@ public:
 				ShadowCasters& shadowcasters)
 		-> Texture2D::Impl*;
 
+	// Draw the retained scene of the renderer
+	auto render(const uint32_t current_frame_in_flight,
+				const uint64_t total_frames,
+				const WorldRenderInfo& world_info)
+		-> Texture2D::Impl*;
+
+	/**
+	 * The scene drawn by render without renderables, kept between frames.
+	 * Only what changed in it since the last render is processed again.
+	 */
+	[[nodiscard]]
+	auto scene()
+		-> Scene&;
+
 	class Impl;
 	std::unique_ptr<Impl> impl;
 }; 
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "Renderable.hpp"
+#include "Light.hpp"
+#include "ShadowCaster.hpp"
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+
+/**
+ * Refers to an object in a Scene. The generation is bumped every time a slot
+ * is freed, so a handle to a removed object never refers to whatever reuses its slot.
+ */
+template<typename Tag>
+struct SceneHandle
+{
+	uint32_t index{std::numeric_limits<uint32_t>::max()};
+	uint32_t generation{0};
+
+	bool operator==(SceneHandle const& rhs) const = default;
+};
+
+using RenderableHandle = SceneHandle<struct RenderableHandleTag>;
+using LightHandle = SceneHandle<struct LightHandleTag>;
+
+/**
+ * The renderables, lights and shadow casters a Renderer draws every frame,
+ * retained between frames so only what changed is processed again.
+ *
+ * Changing the model of a renderable only updates its transform, changing its mesh,
+ * textures or type sorts the draws of the scene again on the next render.
+ * Shadows of casters that never moved are cached, a caster is drawn into the
+ * shadows every frame from the first time its model changes.
+ * Calls with a handle to a removed object do nothing and return false.
+ */
+class Scene
+{
+public:
+	Scene();
+	~Scene();
+
+	Scene(Scene&) = delete;
+	Scene& operator=(Scene&) = delete;
+
+	auto add(Renderable const& renderable)
+		-> RenderableHandle;
+
+	auto update(RenderableHandle handle,
+				Renderable const& renderable)
+		-> bool;
+
+	auto set_model(RenderableHandle handle,
+				   glm::mat4 const& model)
+		-> bool;
+
+	auto remove(RenderableHandle handle)
+		-> bool;
+
+	[[nodiscard]]
+	auto contains(RenderableHandle handle) const
+		-> bool;
+
+	auto add(Light const& light)
+		-> LightHandle;
+
+	auto update(LightHandle handle,
+				Light const& light)
+		-> bool;
+
+	auto remove(LightHandle handle)
+		-> bool;
+
+	[[nodiscard]]
+	auto contains(LightHandle handle) const
+		-> bool;
+
+	void set_shadowcasters(ShadowCasters const& shadowcasters);
+
+	[[nodiscard]]
+	auto shadowcasters() const
+		-> ShadowCasters const&;
+
+	// NOTE removes every object, all handles to them become invalid
+	void clear();
+
+	[[nodiscard]]
+	auto renderable_count() const
+		-> size_t;
+
+	[[nodiscard]]
+	auto light_count() const
+		-> size_t;
+
+	class Impl;
+	std::unique_ptr<Impl> impl;
+};
@@ -20,6 +20,10 @@ struct TextureSamplerReadOnly
 	TextureSamplerReadOnly& operator=(const TextureSamplerReadOnly&) = delete;
 	TextureSamplerReadOnly(TextureSamplerReadOnly&& texture) noexcept;
 	TextureSamplerReadOnly& operator=(TextureSamplerReadOnly&& texture) noexcept;
+
+	// @note covers both the pixel upload and the transition to the shader readable layout.
+	auto upload_ticket()
+		const noexcept -> UploadTicket;
 };
 
 auto make_shader_readonly(Render::Context* context,
@@ -4,6 +4,7 @@
 #include "StrongType.hpp"
 #include "Light.hpp"
 
+#include <cstdint>
 #include <optional>
 #include <vector>
 
@@ -12,6 +13,25 @@ using PerspectiveProjection = StrongType<glm::mat4, struct PerspectiveProjection
 using PositionVector = StrongType<glm::vec3, struct PositionVectorTag>;
 using UpVector = StrongType<glm::vec3, struct UpVectorTag>;
 
+uint32_t constexpr max_shadow_cascades = 4;
+
+/**
+ * Splits the view of the camera into cascades, each rendered into its own tile of the
+ * shadow atlas with an orthographic projection fitted around its slice of the view.
+ * The near cascades cover less of the view, so their shadows are sharper.
+ */
+struct ShadowCascades
+{
+	// NOTE clamped to [2, max_shadow_cascades]
+	uint32_t count{4};
+	// NOTE the view depth the last cascade ends at, nothing beyond it is shadowed
+	float distance{50.0f};
+	// NOTE blends uniform (0) and logarithmic (1) split depths
+	float split_lambda{0.75f};
+	// NOTE how far towards the light objects outside a cascade still cast shadows into it
+	float caster_reach{50.0f};
+};
+
 struct DirectionalShadowCaster
 {
 	DirectionalShadowCaster(OrthographicProjection projection,
@@ -19,16 +39,25 @@ struct DirectionalShadowCaster
 							PositionVector position,
 							UpVector up) noexcept;
 
+	/* A cascaded caster follows the camera, its cascades are fitted around the view
+	 * every frame, so it has no position or projection of its own.
+	 */
+	DirectionalShadowCaster(DirectionalLight light,
+							ShadowCascades cascades,
+							UpVector up) noexcept;
+
 	glm::mat4 view() const noexcept;
 	glm::mat4 model() const noexcept;
 	OrthographicProjection projection() const noexcept;
 	DirectionalLight light() const noexcept;
+	std::optional<ShadowCascades> cascades() const noexcept;
 
 private:
-	OrthographicProjection m_projection;
+	OrthographicProjection m_projection{glm::mat4(1.0f)};
 	DirectionalLight m_light{};
 	PositionVector m_position{glm::vec3(0.0f, 5.0f, 0.0f)};
 	UpVector m_up{glm::vec3(0.0f, 1.0f, 0.0f)};
+	std::optional<ShadowCascades> m_cascades{std::nullopt};
 };
 
 struct SpotShadowCaster
@@ -48,8 +77,12 @@ private:
 	UpVector m_up;
 };
 
+/**
+ * Every caster is rendered into a tile of the shared shadow atlas,
+ * sized by how much of the view it lights, a cascaded caster into a tile per cascade.
+ */
 struct ShadowCasters
 {
-	std::optional<DirectionalShadowCaster> directional_caster;
-	std::optional<SpotShadowCaster> spot_caster;
+	std::vector<DirectionalShadowCaster> directional_casters;
+	std::vector<SpotShadowCaster> spot_casters;
 };
@@ -53,6 +53,11 @@ struct Texture2D
 	auto format()
 		const noexcept -> TextureFormat;
 
+	// @note the texture contents are uploaded asynchronously,
+	//       the ticket can be polled or waited on through the Context.
+	auto upload_ticket()
+		const noexcept -> UploadTicket;
+
 	struct Impl;
 	std::unique_ptr<Impl> impl {nullptr};
 	
@@ -1,31 +1,113 @@
 #pragma once
 
 #include "Context.hpp"
+#include "glm.hpp"
+
+#include <algorithm>
+#include <optional>
+#include <vector>
 
 //TODO MAKE THIS TYPESAFE SO VERTEXBUFFERS CAN BE SPECIFIED FROM VERTEX TYPE
 
+/**
+ * Where the vertices of a VertexBuffer live.
+ * DeviceLocal vertices are uploaded once through a staging copy, and are the
+ * fastest to draw from.
+ * HostVisible vertices are read by the gpu across the bus, but can be rewritten
+ * directly with VertexBuffer::update, use it for meshes that change every frame.
+ */
+enum class VertexBufferMemory
+{
+	DeviceLocal,
+	HostVisible,
+};
+
+/**
+ * Object space bounds of a set of vertices, an axis aligned box
+ * and a sphere around the center of the box.
+ */
+struct MeshBounds
+{
+	glm::vec3 min{0.0f};
+	glm::vec3 max{0.0f};
+	glm::vec3 center{0.0f};
+	float radius{0.0f};
+};
+
+template<typename Vertex>
+auto compute_bounds(const std::vector<Vertex>& vertices)
+	-> MeshBounds
+{
+	MeshBounds bounds{};
+	if (vertices.empty())
+		return bounds;
+
+	bounds.min = vertices[0].pos;
+	bounds.max = vertices[0].pos;
+	for (const Vertex& vertex: vertices) {
+		bounds.min = glm::min(bounds.min, vertex.pos);
+		bounds.max = glm::max(bounds.max, vertex.pos);
+	}
+
+	// NOTE the furthest vertex from the box center, tighter than half the box diagonal
+	bounds.center = (bounds.min + bounds.max) * 0.5f;
+	for (const Vertex& vertex: vertices)
+		bounds.radius = std::max(bounds.radius, glm::distance(bounds.center, vertex.pos));
+	return bounds;
+}
+
 struct VertexBuffer
 {
 	VertexBuffer(Render::Context& context,
 				 const void* vertices,
 				 size_t vertices_length,
-				 size_t vertex_memory_size);
+				 size_t vertex_memory_size,
+				 VertexBufferMemory memory = VertexBufferMemory::DeviceLocal);
 	
 	template<typename Vertex>
 	static VertexBuffer create(Render::Context& context,
-							   const std::vector<Vertex>& vertices)
+							   const std::vector<Vertex>& vertices,
+							   VertexBufferMemory memory = VertexBufferMemory::DeviceLocal)
 	{
-		return VertexBuffer(context,
+		VertexBuffer buffer(context,
 							vertices.data(),
 							vertices.size(),
-							sizeof(vertices[0]));
+							sizeof(vertices[0]),
+							memory);
+		buffer.bounds = compute_bounds(vertices);
+		return buffer;
 	}
+
+	/**
+	 * Overwrite the vertices of a HostVisible VertexBuffer.
+	 * @note the caller is responsible for not rewriting vertices that a frame
+	 *       in flight is still drawing from.
+	 */
+	void update(const void* vertices,
+				size_t vertices_length,
+				size_t vertex_memory_size);
+
+	template<typename Vertex>
+	void update(const std::vector<Vertex>& vertices)
+	{
+		update(vertices.data(), vertices.size(), sizeof(vertices[0]));
+		bounds = compute_bounds(vertices);
+	}
+
+	// @note DeviceLocal vertices are uploaded asynchronously,
+	//       the ticket can be polled or waited on through the Context.
+	auto upload_ticket()
+		const noexcept -> UploadTicket;
 	
 	explicit VertexBuffer();
 	~VertexBuffer();
 	VertexBuffer(VertexBuffer&& rhs);
 	VertexBuffer& operator=(VertexBuffer&& rhs);
 
+	// NOTE only known for buffers created or updated from typed vertices,
+	//      buffers without bounds are never culled.
+	std::optional<MeshBounds> bounds{std::nullopt};
+
 	class Impl;
 	std::unique_ptr<Impl> impl{ nullptr };
 };
@@ -5,10 +5,11 @@ layout(location = 1) in vec3 inNormal;
 layout(location = 2) in vec3 inColor;
 layout(location = 3) in vec2 inTexcoord;
 
-layout( push_constant ) uniform constants
-{
-	mat4 model;
-} push;
+layout(location = 4) in mat4 instance_model;
+
+// NOTE the material pass tests its depth for equality against this one,
+//      so both have to transform their positions exactly the same way.
+invariant gl_Position;
 
 layout (set = 0, binding = 0) uniform Camera
 {
@@ -18,6 +19,6 @@ layout (set = 0, binding = 0) uniform Camera
 
 void main()
 {
-	mat4 transform = camera.proj * camera.view * push.model;
+	mat4 transform = camera.proj * camera.view * instance_model;
 	gl_Position = transform * vec4(inPosition, 1.0);
 }
@@ -1,9 +1,24 @@
 #version 450
 
+#ifdef BINDLESS
+#extension GL_EXT_nonuniform_qualifier : require
+#endif
+
 layout(location = 0) in vec3 inColor;
 layout(location = 1) in vec2 texcoord;
 
+#ifdef BINDLESS
+layout( push_constant )
+uniform constants
+{
+	layout(offset = 64) uint texture_index;
+} push;
+
+layout(set = 1, binding = 0) uniform sampler2D textures[];
+#define tex1 textures[push.texture_index]
+#else
 layout(set = 1, binding = 0) uniform sampler2D tex1;
+#endif
 
 layout(location = 0) out vec4 outColor;
 
@@ -1,74 +1,161 @@
 #version 450
 
+#ifdef BINDLESS
+#extension GL_EXT_nonuniform_qualifier : require
+#endif
+
 #include "Material.shared"
 
 layout(location = 0) in vec2 in_texcoord;
 layout(location = 1) in vec3 in_vertex_normal;
 layout(location = 2) in vec3 in_frag_position;
 layout(location = 3) in vec3 in_view_position;
-layout(location = 4) in vec4 in_dirshadowcaster_lightspace_fragpos;
-layout(location = 5) in vec4 in_spotshadowcaster_lightspace_fragpos;
 
 layout(location = 0) out vec4 final_color;
 
-layout (set = 0, binding = 1)
-uniform PointLightUniform { PointLight pointlight[MAX_POINTLIGHTS]; };
-
-layout (set = 0, binding = 2)
-uniform SpotLightUniform { SpotLight spotlight[MAX_SPOTLIGHTS]; };
-
-layout (set = 0, binding = 3)
-uniform DirectionalLightUniform { DirectionalLight directionallight[MAX_DIRECTIONALLIGHTS]; };
+layout (set = 0, binding = 0)
+uniform GlobalBindings
+{
+	mat4 view;
+	mat4 proj;
+	vec4 camera_position;
+} global;
 
-layout (set = 0, binding = 4)
+layout (set = 0, binding = 1)
 uniform LightLengthsUniform { 
 	ivec3 light_length;
 	// light_length.x = pointlight length
 	// light_length.y = spotlight length
 	// light_length.z = directionallight length
+	ivec2 shadowcaster_length;
+	// shadowcaster_length.x = directional shadowcaster length
+	// shadowcaster_length.y = spot shadowcaster length
 };
 
-layout (set = 0, binding = 5)
-uniform DirectionalShadowCasterUniform 
-{
-	DirectionalLight light;
-	mat4 viewproj_matrix;
-	bool exists;
-} directional_shadowcaster;
 
-layout (set = 0, binding = 6)
-uniform SpotShadowCasterUniform 
+#ifdef BINDLESS
+// NOTE indices of the ambient, diffuse, specular and normal textures
+layout( push_constant )
+uniform constants
 {
-	SpotLight light;
-	mat4 viewproj_matrix;
-	bool exists;
-} spot_shadowcaster;
+	uvec4 textures;
+} push;
 
+layout(set = 1, binding = 0) 
+uniform sampler2D textures[];
 
+vec4 sample_ambient(vec2 uv) { return texture(textures[push.textures.x], uv); }
+vec4 sample_diffuse(vec2 uv) { return texture(textures[push.textures.y], uv); }
+vec4 sample_specular(vec2 uv) { return texture(textures[push.textures.z], uv); }
+vec4 sample_normal(vec2 uv) { return texture(textures[push.textures.w], uv); }
+#else
 layout(set = 1, binding = 0) 
 uniform sampler2D ambient;
 
-layout(set = 2, binding = 0) 
+layout(set = 1, binding = 1) 
 uniform sampler2D diffuse;
 
-layout(set = 3, binding = 0) 
+layout(set = 1, binding = 2) 
 uniform sampler2D specular;
 
-layout(set = 4, binding = 0) 
+layout(set = 1, binding = 3) 
 uniform sampler2D normal;
 
-layout(set = 5, binding = 0)
-uniform sampler2D directional_shadowmap;
+vec4 sample_ambient(vec2 uv) { return texture(ambient, uv); }
+vec4 sample_diffuse(vec2 uv) { return texture(diffuse, uv); }
+vec4 sample_specular(vec2 uv) { return texture(specular, uv); }
+vec4 sample_normal(vec2 uv) { return texture(normal, uv); }
+#endif
 
-layout(set = 6, binding = 0)
-uniform sampler2D spot_shadowmap;
+// NOTE every shadow caster is rendered into its own tile of the atlas,
+//      which is sampled with a depth comparison filtering the 2x2 nearest results
+layout(set = 2, binding = 0)
+uniform sampler2DShadow shadow_atlas;
+
+// atlas_rect.xy = offset of the tile in the atlas
+// atlas_rect.zw = scale of the tile, zero when the caster has no tile
+// every cascade of a directional caster has its own tile, and ends at cascade_far_depth
+struct ShadowedDirectionalLight
+{
+	DirectionalLight light;
+	mat4 viewproj_matrix[MAX_SHADOW_CASCADES];
+	vec4 atlas_rect[MAX_SHADOW_CASCADES];
+	float cascade_far_depth[MAX_SHADOW_CASCADES];
+	int cascade_count;
+};
+
+struct ShadowedSpotLight
+{
+	SpotLight light;
+	mat4 viewproj_matrix;
+	vec4 atlas_rect;
+};
+
+// NOTE every light, with clustered lighting the clusters only refer to the ones reaching them
+layout(std430, set = 3, binding = 0) readonly buffer PointLights
+{
+	PointLight pointlight[];
+};
+
+layout(std430, set = 3, binding = 1) readonly buffer SpotLights
+{
+	SpotLight spotlight[];
+};
+
+layout(std430, set = 3, binding = 2) readonly buffer DirectionalLights
+{
+	DirectionalLight directionallight[];
+};
+
+layout(std430, set = 3, binding = 3) readonly buffer DirectionalShadowCasters
+{
+	ShadowedDirectionalLight directional_shadowcaster[];
+};
+
+layout(std430, set = 3, binding = 4) readonly buffer SpotShadowCasters
+{
+	ShadowedSpotLight spot_shadowcaster[];
+};
+
+#ifdef CLUSTERED
+layout(std430, set = 3, binding = 5) readonly buffer Clusters
+{
+	uvec4 grid;
+	vec4 view_z;
+	vec2 extent_inverse;
+	float slice_scale;
+	float slice_bias;
+	// range.x = offset into the light indices
+	// range.y = point light count
+	// range.z = spot light count
+	uvec4 range[];
+} clusters;
+
+layout(std430, set = 3, binding = 6) readonly buffer ClusterLightIndices
+{
+	uint cluster_light_index[];
+};
+
+// the cluster of the screen tile and exponential depth slice the fragment is in
+uint cluster_of(vec2 frag_coord, vec3 frag_position)
+{
+	uvec3 grid = clusters.grid.xyz;
+	uvec2 tile = uvec2(frag_coord * clusters.extent_inverse * vec2(grid.xy));
+	tile = min(tile, grid.xy - 1u);
+
+	float depth = -dot(clusters.view_z, vec4(frag_position, 1.0));
+	float slice = floor(log(max(depth, 0.0001)) * clusters.slice_scale + clusters.slice_bias);
+	uint z = uint(clamp(slice, 0.0, float(grid.z - 1u)));
+
+	return tile.x + grid.x * (tile.y + grid.y * z);
+}
+#endif
 
 
 vec3 calculate_point_light(PointLight light);
 vec3 calculate_directional_light(DirectionalLight light);
 vec3 calculate_spot_light(SpotLight light);
-bool is_in_directional_shadow(vec4 fragpos_lightspace);
-bool is_in_spot_shadow(vec4 fragpos_lightspace);
+float light_visibility(mat4 viewproj_matrix, vec4 atlas_rect);
 
 void main() 
 {
@@ -78,70 +165,81 @@ void main()
 
 	vec3 total_lighting = vec3(0.0);
 
+#ifdef CLUSTERED
+	uvec4 range = clusters.range[cluster_of(gl_FragCoord.xy, in_frag_position)];
+	uint first_spotlight = range.x + range.y;
+
+	for (uint i = range.x; i < first_spotlight; i++)
+		total_lighting += calculate_point_light(pointlight[cluster_light_index[i]]);
+
+	for (uint i = first_spotlight; i < first_spotlight + range.z; i++)
+		total_lighting += calculate_spot_light(spotlight[cluster_light_index[i]]);
+#else
 	for (int i = 0; i < pointlight_length; i++)
 		total_lighting += calculate_point_light(pointlight[i]);
 
 	for (int i = 0; i < spotlight_length; i++)
 		total_lighting += calculate_spot_light(spotlight[i]);
+#endif
 
 	for (int i = 0; i < directionallight_length; i++) {
 		total_lighting += calculate_directional_light(directionallight[i]);
 	}
 
-	vec3 in_light = vec3(1.0, 1.0, 1.0);
-	vec3 in_shadow = vec3(0.0, 0.0, 0.0);
-	if (directional_shadowcaster.exists) {
-#if 0
-	   if (!is_in_directional_shadow(in_dirshadowcaster_lightspace_fragpos)) {
-	   		final_color = vec4(in_light, 1.0);
-	   }
-	   else {
-	   		final_color = vec4(in_shadow, 1.0);
-	   }
-
-#else		
-	   if (!is_in_directional_shadow(in_dirshadowcaster_lightspace_fragpos)) {
-		  total_lighting += calculate_directional_light(directional_shadowcaster.light);
-	   }
+	float view_depth = -(global.view * vec4(in_frag_position, 1.0)).z;
+	for (int i = 0; i < shadowcaster_length.x; i++) {
+		int cascade_count = directional_shadowcaster[i].cascade_count;
+		int cascade = 0;
+		while (cascade < cascade_count
+			   && view_depth > directional_shadowcaster[i].cascade_far_depth[cascade])
+			cascade++;
+
+		// beyond the last cascade the light has no shadow
+		float visibility = cascade < cascade_count
+			? light_visibility(directional_shadowcaster[i].viewproj_matrix[cascade],
+							   directional_shadowcaster[i].atlas_rect[cascade])
+			: 1.0;
+		if (visibility > 0.0)
+			total_lighting += visibility * calculate_directional_light(directional_shadowcaster[i].light);
 	}
-	
-	if (spot_shadowcaster.exists) {
-	   if (!is_in_spot_shadow(in_spotshadowcaster_lightspace_fragpos)) {
-		  total_lighting += calculate_spot_light(spot_shadowcaster.light);
-	   }
+
+	for (int i = 0; i < shadowcaster_length.y; i++) {
+		ShadowedSpotLight caster = spot_shadowcaster[i];
+		float visibility = light_visibility(caster.viewproj_matrix, caster.atlas_rect);
+		if (visibility > 0.0)
+			total_lighting += visibility * calculate_spot_light(caster.light);
 	}
 
 	final_color = vec4(total_lighting, 1.0);
-#endif
 }
 
 #define SHADOW_BIAS 0.005 
 #define SHININESS 32
 
-bool is_in_directional_shadow(vec4 fragpos_lightspace)
+// how much of the light reaches the fragment, from 0 in shadow to 1 when lit
+float light_visibility(mat4 viewproj_matrix, vec4 atlas_rect)
 {
-	vec3 projection_coords = fragpos_lightspace.xyz / fragpos_lightspace.w;
-	if (projection_coords.z > 1.0)
-	   return false;
+	// a caster left out of the atlas lights without a shadow
+	if (atlas_rect.z <= 0.0)
+	   return 1.0;
 
-    // in vulkan only xy needs to be converted as z is already in [0,1]
-	vec2 tex_coords = projection_coords.xy * 0.5 + 0.5;
-	float closest_depth = texture(directional_shadowmap, tex_coords).r;
-	float current_depth = projection_coords.z;
-	return (current_depth - SHADOW_BIAS) > closest_depth;
-}
-
-bool is_in_spot_shadow(vec4 fragpos_lightspace)
-{
+	vec4 fragpos_lightspace = viewproj_matrix * vec4(in_frag_position, 1.0);
 	vec3 projection_coords = fragpos_lightspace.xyz / fragpos_lightspace.w;
 	if (projection_coords.z > 1.0)
-	   return false;
+	   return 1.0;
 
     // in vulkan only xy needs to be converted as z is already in [0,1]
-	vec2 tex_coords = projection_coords.xy * 0.5 + 0.5;
-	float closest_depth = texture(spot_shadowmap, tex_coords).r;
+	vec2 tile_coords = projection_coords.xy * 0.5 + 0.5;
+	if (any(lessThan(tile_coords, vec2(0.0))) || any(greaterThan(tile_coords, vec2(1.0))))
+	   return 1.0;
+
+	// the filtered taps are kept half a texel inside the tile, away from its neighbours
+	vec2 half_texel = 0.5 / vec2(textureSize(shadow_atlas, 0));
+	vec2 tex_coords = clamp(atlas_rect.xy + tile_coords * atlas_rect.zw,
+							atlas_rect.xy + half_texel,
+							atlas_rect.xy + atlas_rect.zw - half_texel);
 	float current_depth = projection_coords.z;
-	return (current_depth - SHADOW_BIAS) > closest_depth;
+	return texture(shadow_atlas, vec3(tex_coords, current_depth - SHADOW_BIAS));
 }
 
 vec3 calculate_point_light(PointLight light)
@@ -165,9 +263,9 @@ vec3 calculate_point_light(PointLight light)
     float attenuation = 1.0 / (constant + linear * distance + quadratic * (distance * distance));    
 
     // combine results
-    vec3 ambient = light.ambient * vec3(texture(diffuse, in_texcoord));
-    vec3 diffuse = light.diffuse * diff * vec3(texture(diffuse, in_texcoord));
-    vec3 specular = light.specular * spec * vec3(texture(specular, in_texcoord));
+    vec3 ambient = light.ambient * vec3(sample_diffuse(in_texcoord));
+    vec3 diffuse = light.diffuse * diff * vec3(sample_diffuse(in_texcoord));
+    vec3 specular = light.specular * spec * vec3(sample_specular(in_texcoord));
     ambient *= attenuation;
     diffuse *= attenuation;
     specular *= attenuation;
@@ -193,9 +291,9 @@ vec3 calculate_directional_light(DirectionalLight light)
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), SHININESS);
 
     // combine results
-    vec3 ambient = light.ambient * vec3(texture(diffuse, in_texcoord));
-    vec3 diffuse = light.diffuse * diff * vec3(texture(diffuse, in_texcoord));
-    vec3 specular = light.specular * spec * vec3(texture(specular, in_texcoord));
+    vec3 ambient = light.ambient * vec3(sample_diffuse(in_texcoord));
+    vec3 diffuse = light.diffuse * diff * vec3(sample_diffuse(in_texcoord));
+    vec3 specular = light.specular * spec * vec3(sample_specular(in_texcoord));
 	
 
 	float normal_dot_length = dot(normal, lightDir);
@@ -233,9 +331,9 @@ vec3 calculate_spot_light(SpotLight light)
     float intensity = clamp((theta - outer_cutoff) / epsilon, 0.0, 1.0);
 
     // combine results
-    vec3 ambient = light.ambient * vec3(texture(diffuse, in_texcoord));
-    vec3 diffuse = light.diffuse * diff * vec3(texture(diffuse, in_texcoord));
-    vec3 specular = light.specular * spec * vec3(texture(specular, in_texcoord));
+    vec3 ambient = light.ambient * vec3(sample_diffuse(in_texcoord));
+    vec3 diffuse = light.diffuse * diff * vec3(sample_diffuse(in_texcoord));
+    vec3 specular = light.specular * spec * vec3(sample_specular(in_texcoord));
     ambient *= attenuation * intensity;
     diffuse *= attenuation * intensity;
     specular *= attenuation * intensity;
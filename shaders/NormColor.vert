@@ -6,10 +6,7 @@ layout(location = 2) in vec3 inColor;
 
 layout(location = 0) out vec3 fragColor;
 
-layout( push_constant ) uniform constants
-{
-	mat4 model;
-} push;
+layout(location = 4) in mat4 instance_model;
 
 layout (set = 0, binding = 0) uniform Camera
 {
@@ -19,9 +16,9 @@ layout (set = 0, binding = 0) uniform Camera
 
 
 void main() {
-    mat4 transform = camera.proj * camera.view * push.model;
+    mat4 transform = camera.proj * camera.view * instance_model;
     gl_Position = transform * vec4(inPosition, 1.0);
     //fragColor = inColor;
 	// convert to world space instead of model space
-	fragColor = mat3(transpose(inverse(push.model))) * inNormal;   
+	fragColor = mat3(transpose(inverse(instance_model))) * inNormal;   
 }
@@ -3,6 +3,9 @@
 #include <filesystem>
 
 #include "VertexImpl.hpp"
+#include "IndexBufferImpl.hpp"
+#include "PipelineCache.hpp"
+#include "BindlessTextures.hpp"
 #include "VertexBuffer.hpp"
 #include "Mesh.hpp"
 #include "Texture.hpp"
@@ -37,8 +40,8 @@ struct BaseTexturePipeline
 
 	struct {
 		vk::UniqueDescriptorSetLayout layout;
-		std::vector<AllocatedMemory> memories;
-		std::vector<vk::UniqueDescriptorSet> sets;
+		vk::UniqueDescriptorSet set;
+		UniformRing* uniforms{nullptr};
 	} camera_descriptor;
 	
 	TextureSamplerReadOnly base_texture;
@@ -51,6 +54,14 @@ struct BaseTexturePipeline
 	{
 		glm::mat4 model;
 	};
+
+	// NOTE replaces the texture sets when set, the shader then indexes the texture
+	BindlessTextures* bindless_textures{nullptr};
+	struct BindlessPushConstants
+	{
+		glm::mat4 model;
+		uint32_t texture_index;
+	};
 };
 
 struct BaseTextureRenderInfo
@@ -64,6 +75,8 @@ create_base_texture_pipeline(Logger& logger,
 							 Render::Context::Impl* context,
 							 Presenter::Impl* presenter,
 							 DescriptorPool::Impl* descriptor_pool,
+							 PipelineCache* pipeline_cache,
+							 BindlessTextures* bindless_textures,
 							 vk::RenderPass& renderpass,
 							 uint32_t frames_in_flight,
 							 const vk::Extent2D render_extent,
@@ -72,7 +85,9 @@ create_base_texture_pipeline(Logger& logger,
 {
 	const std::string pipeline_name = "BaseTexture";
 	const std::filesystem::path vertexshader_name = "Diffuse.vert.spv";
-	const std::filesystem::path fragmentshader_name = "Diffuse.frag.spv";
+	const std::filesystem::path fragmentshader_name = bindless_textures
+		? "DiffuseBindless.frag.spv"
+		: "Diffuse.frag.spv";
 	logger.info(std::source_location::current(),
 				std::format("Creating Pipeline {}",
 							pipeline_name));
@@ -84,6 +99,7 @@ create_base_texture_pipeline(Logger& logger,
 							fragmentshader_name.string()));
 
 	BaseTexturePipeline pipeline;
+	pipeline.bindless_textures = bindless_textures;
 	const auto vert =
 		read_binary_file((shader_root_path / vertexshader_name).string().c_str());
 	if (!vert) {
@@ -209,16 +225,22 @@ create_base_texture_pipeline(Logger& logger,
 		.setAttachments(pipelineColorBlendAttachmentState)
 		.setBlendConstants({ 1.0f, 1.0f, 1.0f, 1.0f });
 	
-	const auto push_constant_range = vk::PushConstantRange{}
-		.setOffset(0)
-		.setSize(sizeof(BaseTexturePipeline::PushConstants))
-		.setStageFlags(vk::ShaderStageFlagBits::eVertex);
+	const auto push_constant_range = bindless_textures
+		? vk::PushConstantRange{}
+		  .setOffset(0)
+		  .setSize(sizeof(BaseTexturePipeline::BindlessPushConstants))
+		  .setStageFlags(vk::ShaderStageFlagBits::eVertex
+						 | vk::ShaderStageFlagBits::eFragment)
+		: vk::PushConstantRange{}
+		  .setOffset(0)
+		  .setSize(sizeof(BaseTexturePipeline::PushConstants))
+		  .setStageFlags(vk::ShaderStageFlagBits::eVertex);
 	
-	if (sizeof(BaseTexturePipeline::PushConstants) > 128) {
+	if (push_constant_range.size > 128) {
 		logger.warn(std::source_location::current(), 
 					std::format("PushConstant size={} is larger than minimum supported (128)"
 								"This can cause compatability issues on some devices",
-								sizeof(BaseTexturePipeline::PushConstants)));
+								push_constant_range.size));
 	}
 
 	std::array<vk::DescriptorSetLayoutBinding, 1> camera_bindings{
@@ -226,7 +248,7 @@ create_base_texture_pipeline(Logger& logger,
 		.setStageFlags(vk::ShaderStageFlagBits::eVertex)
 		.setBinding(0)
 		.setDescriptorCount(1)
-		.setDescriptorType(vk::DescriptorType::eUniformBuffer),
+		.setDescriptorType(vk::DescriptorType::eUniformBufferDynamic),
 	};
 
 	const auto camera_set_info = vk::DescriptorSetLayoutCreateInfo{}
@@ -254,7 +276,9 @@ create_base_texture_pipeline(Logger& logger,
 
 	std::array<vk::DescriptorSetLayout, 2> descriptorset_layouts{
 		pipeline.camera_descriptor.layout.get(),
-		pipeline.texture_descriptor.layout.get(),
+		bindless_textures
+		? bindless_textures->layout()
+		: pipeline.texture_descriptor.layout.get(),
 	};
 	
     auto pipelineLayoutCreateInfo = vk::PipelineLayoutCreateInfo{}
@@ -292,8 +316,8 @@ create_base_texture_pipeline(Logger& logger,
 		.setRenderPass(renderpass);
 
 	vk::ResultValue<vk::UniquePipeline> result =
-		context->device.get().createGraphicsPipelineUnique(nullptr,
-														   graphicsPipelineCreateInfo);
+		pipeline_cache->create_graphics_pipeline(pipeline_name,
+												 graphicsPipelineCreateInfo);
 	
     switch (result.result) {
 	case vk::Result::eSuccess:
@@ -308,65 +332,39 @@ create_base_texture_pipeline(Logger& logger,
 	
 	pipeline.pipeline = std::move(result.value);
 
-	/*Allocate Camera Descriptor Sets*/
-	for (uint32_t i = 0; i < frames_in_flight; i++) {
-		pipeline.camera_descriptor.memories
-			.push_back(allocate_memory(context->physical_device,
-									   context->device.get(),
-									   sizeof(BaseTexturePipeline::Camera),
-									   vk::BufferUsageFlagBits::eTransferSrc
-									   | vk::BufferUsageFlagBits::eUniformBuffer,
-									   // Host Visible and Coherent allows direct
-									   // writes into the buffers without sync issues.
-									   vk::MemoryPropertyFlagBits::eHostVisible
-									   | vk::MemoryPropertyFlagBits::eHostCoherent));
-		
-		const auto allocate_info = vk::DescriptorSetAllocateInfo{}
-			.setDescriptorPool(descriptor_pool->descriptor_pool.get())
-			.setDescriptorSetCount(1)
-			.setSetLayouts(pipeline.camera_descriptor.layout.get());
-		
-		auto sets = context->device.get().allocateDescriptorSetsUnique(allocate_info);
-		if (sets.size() != 1) {
-			logger.error(std::source_location::current(),
-						 "This system only allows handling 1 set per frame in flight"
-						 "\n if you want more sets find another way to store them..");
-		}
-		
-		pipeline.camera_descriptor.sets.push_back(std::move(sets[0]));
-		
-		const auto buffer_info = vk::DescriptorBufferInfo{}
-			.setBuffer(pipeline.camera_descriptor.memories[i].buffer.get())
-			.setOffset(0)
-			.setRange(sizeof(BaseTexturePipeline::Camera));
+	/*Allocate Camera Descriptor Set*/
+	// NOTE the camera is pushed to the presenters uniform ring every frame,
+	//      so a single set with a dynamic offset serves all frames in flight.
+	pipeline.camera_descriptor.uniforms = presenter->uniform_ring.get();
+
+	const auto allocate_info = vk::DescriptorSetAllocateInfo{}
+		.setDescriptorPool(descriptor_pool->descriptor_pool.get())
+		.setDescriptorSetCount(1)
+		.setSetLayouts(pipeline.camera_descriptor.layout.get());
 	
-		const std::array<vk::WriteDescriptorSet, 1> camera_write{
-			vk::WriteDescriptorSet{}
-			.setDstBinding(0)
-			.setDstArrayElement(0)
-			.setDstSet(pipeline.camera_descriptor.sets[i].get())
-			.setDescriptorCount(1)
-			.setDescriptorType(vk::DescriptorType::eUniformBuffer)
-			.setBufferInfo(buffer_info),
-		};
-		
-		BaseTexturePipeline::Camera camera{};	
-		camera.view = glm::mat4(1.0f);
-		camera.proj = glm::mat4(1.0f);
-		
-		copy_to_allocated_memory(context->device.get(),
-								 pipeline.camera_descriptor.memories[i],
-								 reinterpret_cast<void*>(&camera),
-								 sizeof(camera));
-		
-		context->device.get().updateDescriptorSets(camera_write.size(),
-												   camera_write.data(),
-												   0,
-												   nullptr);
-	}
+	auto sets = descriptor_pool->allocate(context->device.get(), allocate_info);
+	pipeline.camera_descriptor.set = std::move(sets[0]);
+	
+	const auto buffer_info =
+		pipeline.camera_descriptor.uniforms->descriptor_info<BaseTexturePipeline::Camera>();
+
+	const std::array<vk::WriteDescriptorSet, 1> camera_write{
+		vk::WriteDescriptorSet{}
+		.setDstBinding(0)
+		.setDstArrayElement(0)
+		.setDstSet(pipeline.camera_descriptor.set.get())
+		.setDescriptorCount(1)
+		.setDescriptorType(vk::DescriptorType::eUniformBufferDynamic)
+		.setBufferInfo(buffer_info),
+	};
+	
+	context->device.get().updateDescriptorSets(camera_write.size(),
+											   camera_write.data(),
+											   0,
+											   nullptr);
 
 	logger.info(std::source_location::current(),
-				"created camera descriptor sets");
+				"created camera descriptor set");
 
 	/*Setup base_texture*/
 	const auto purple = Pixel8bitRGBA{170, 0, 170, 255};
@@ -392,7 +390,7 @@ bool texture_changed(TextureSamplerReadOnly* lhs, TextureSamplerReadOnly* rhs)
 void draw_base_texture_renderables(BaseTexturePipeline& pipeline,
 								   Logger& logger,
 								   vk::Device& device,
-								   vk::DescriptorPool descriptor_pool,
+								   DescriptorPool::Impl* descriptor_pool,
 								   vk::CommandBuffer& commandbuffer,
 								   const uint32_t frame_in_flight,
 								   const uint32_t max_frames_in_flight,
@@ -400,7 +398,8 @@ void draw_base_texture_renderables(BaseTexturePipeline& pipeline,
 								   std::vector<BaseTextureRenderable> renderables)
 {
 	// ensure base texture is available
-	if (!pipeline.texture_descriptor.sets.contains(&pipeline.base_texture)) {
+	if (!pipeline.bindless_textures
+		&& !pipeline.texture_descriptor.sets.contains(&pipeline.base_texture)) {
 		logger.info(std::source_location::current(),
 					"texture descriptor sets does not exist in descriptor cache yet,"
 					" it will be created and added cached.");
@@ -426,87 +425,98 @@ void draw_base_texture_renderables(BaseTexturePipeline& pipeline,
 	camera.view = info.view;
 	camera.proj = info.proj;
 	
-	copy_to_allocated_memory(device,
-							 pipeline.camera_descriptor.memories[frame_in_flight],
-							 reinterpret_cast<void*>(&camera),
-							 sizeof(camera));
-	
+	const uint32_t camera_offset = pipeline.camera_descriptor.uniforms->push(camera);
 
 	commandbuffer.bindPipeline(vk::PipelineBindPoint::eGraphics,
 							   pipeline.pipeline.get());
 	
 	std::array<vk::DescriptorSet, 2> init_sets{
-		pipeline.camera_descriptor.sets[frame_in_flight].get(),
-		pipeline.texture_descriptor.sets[&pipeline.base_texture][frame_in_flight].get()
+		pipeline.camera_descriptor.set.get(),
+		pipeline.bindless_textures
+		? pipeline.bindless_textures->set()
+		: pipeline.texture_descriptor.sets[&pipeline.base_texture][frame_in_flight].get()
 	};
 	const uint32_t first_set = 0;
+	const uint32_t dynamic_offset_count = 1;
 	commandbuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
 									 pipeline.layout.get(),
 									 first_set,
 									 init_sets.size(),
 									 init_sets.data(),
-									 0,
-									 nullptr);
+									 dynamic_offset_count,
+									 &camera_offset);
 
 	TextureSamplerReadOnly* last_bound_texture = &pipeline.base_texture;
 
+	TexturedMesh* last_mesh = nullptr;
+
 	for (BaseTextureRenderable& renderable: renderables) {
 		TextureSamplerReadOnly* texture = 
 			renderable.texture ? renderable.texture : &pipeline.base_texture;
 		
-		if (texture_changed(texture, last_bound_texture)) {
-			if (!pipeline.texture_descriptor.sets.contains(texture)) {
-				pipeline.texture_descriptor.sets.insert({
-						texture,
-						create_descriptorset_for_texture(device,
-														 pipeline.texture_descriptor.layout.get(),
-														 descriptor_pool,
-														 max_frames_in_flight,
-														 *texture)});
+		if (pipeline.bindless_textures) {
+			BaseTexturePipeline::BindlessPushConstants push{};
+			push.model = renderable.model;
+			push.texture_index = pipeline.bindless_textures->index(*texture);
+			const uint32_t push_offset = 0;
+			commandbuffer.pushConstants(pipeline.layout.get(),
+										vk::ShaderStageFlagBits::eVertex
+										| vk::ShaderStageFlagBits::eFragment,
+										push_offset,
+										sizeof(push),
+										&push);
+		}
+		else {
+			if (texture_changed(texture, last_bound_texture)) {
+				if (!pipeline.texture_descriptor.sets.contains(texture)) {
+					pipeline.texture_descriptor.sets.insert({
+							texture,
+							create_descriptorset_for_texture(device,
+															 pipeline.texture_descriptor.layout.get(),
+															 descriptor_pool,
+															 max_frames_in_flight,
+															 *texture)});
+				}
+
+				const uint32_t first_set = 1;
+				std::array<vk::DescriptorSet, 1> texture_descriptorset{
+					pipeline.texture_descriptor.sets[texture][frame_in_flight].get()
+				};
+				commandbuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
+												 pipeline.layout.get(),
+												 first_set,
+												 texture_descriptorset.size(),
+												 texture_descriptorset.data(),
+												 0,
+												 nullptr);
+				last_bound_texture = texture;
 			}
 
-			const uint32_t first_set = 1;
-			std::array<vk::DescriptorSet, 1> texture_descriptorset{
-				pipeline.texture_descriptor.sets[texture][frame_in_flight].get()
-			};
-			commandbuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
-											 pipeline.layout.get(),
-											 first_set,
-											 texture_descriptorset.size(),
-											 texture_descriptorset.data(),
-											 0,
-											 nullptr);
-			last_bound_texture = texture;
+			BaseTexturePipeline::PushConstants push{};
+			push.model = renderable.model;
+			const uint32_t push_offset = 0;
+			commandbuffer.pushConstants(pipeline.layout.get(),
+										vk::ShaderStageFlagBits::eVertex,
+										push_offset,
+										sizeof(push),
+										&push);
 		}
 
-		BaseTexturePipeline::PushConstants push{};
-		push.model = renderable.model;
-		const uint32_t push_offset = 0;
-		commandbuffer.pushConstants(pipeline.layout.get(),
-									vk::ShaderStageFlagBits::eVertex,
-									push_offset,
-									sizeof(push),
-									&push);
-	
-		const uint32_t firstBinding = 0;
-		const uint32_t bindingCount = 1;
-		std::array<vk::DeviceSize, bindingCount> offsets = {0};
-		std::array<vk::Buffer, bindingCount> buffers {
-			renderable.mesh->vertexbuffer.impl->buffer.get(),
-		};
-		commandbuffer.bindVertexBuffers(firstBinding,
-										bindingCount,
-										buffers.data(),
-										offsets.data());
+		if (renderable.mesh != last_mesh) {
+			bind_mesh_buffers(commandbuffer,
+							  renderable.mesh->vertexbuffer,
+							  renderable.mesh->indexbuffer);
+			last_mesh = renderable.mesh;
+		}
 		
 		
 		const uint32_t instanceCount = 1;
-		const uint32_t firstVertex = 0;
 		const uint32_t firstInstance = 0;
-		commandbuffer.draw(renderable.mesh->vertexbuffer.impl->length,
-						   instanceCount,
-						   firstVertex,
-						   firstInstance);
+		record_draw(commandbuffer,
+					renderable.mesh->vertexbuffer,
+					renderable.mesh->indexbuffer,
+					instanceCount,
+					firstInstance);
 		
 	}
 }
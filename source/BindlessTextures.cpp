@@ -0,0 +1,153 @@
+#include "BindlessTextures.hpp"
+
+#include <algorithm>
+#include <format>
+
+BindlessTextures::BindlessTextures(Logger logger,
+								   vk::PhysicalDevice physical_device,
+								   vk::Device device,
+								   MaxFlightFrames max_flightframes,
+								   uint32_t capacity)
+	: m_logger(logger)
+	, m_device(device)
+	, m_max_flightframes(max_flightframes)
+{
+	const auto properties =
+		physical_device.getProperties2<vk::PhysicalDeviceProperties2,
+									   vk::PhysicalDeviceDescriptorIndexingPropertiesEXT>();
+	const auto& indexing = properties.get<vk::PhysicalDeviceDescriptorIndexingPropertiesEXT>();
+	m_capacity = std::min({capacity,
+						   indexing.maxDescriptorSetUpdateAfterBindSampledImages,
+						   indexing.maxPerStageDescriptorUpdateAfterBindSampledImages});
+
+	const auto pool_size = vk::DescriptorPoolSize{}
+		.setType(vk::DescriptorType::eCombinedImageSampler)
+		.setDescriptorCount(m_capacity);
+
+	const auto pool_info = vk::DescriptorPoolCreateInfo{}
+		.setFlags(vk::DescriptorPoolCreateFlagBits::eUpdateAfterBindEXT
+				  | vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet)
+		.setMaxSets(1)
+		.setPoolSizes(pool_size);
+	m_pool = m_device.createDescriptorPoolUnique(pool_info, nullptr);
+
+	const auto binding = vk::DescriptorSetLayoutBinding{}
+		.setStageFlags(vk::ShaderStageFlagBits::eFragment)
+		.setBinding(0)
+		.setDescriptorCount(m_capacity)
+		.setDescriptorType(vk::DescriptorType::eCombinedImageSampler);
+
+	// NOTE unused slots are never read, and a slot is only written while no pending
+	//      command buffer uses it, either for the first time or once its texture retired.
+	const vk::DescriptorBindingFlagsEXT binding_flags =
+		vk::DescriptorBindingFlagBitsEXT::ePartiallyBound
+		| vk::DescriptorBindingFlagBitsEXT::eUpdateAfterBind
+		| vk::DescriptorBindingFlagBitsEXT::eUpdateUnusedWhilePending;
+
+	auto binding_flags_info = vk::DescriptorSetLayoutBindingFlagsCreateInfoEXT{}
+		.setBindingFlags(binding_flags);
+
+	const auto layout_info = vk::DescriptorSetLayoutCreateInfo{}
+		.setPNext(&binding_flags_info)
+		.setFlags(vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPoolEXT)
+		.setBindings(binding);
+	m_layout = m_device.createDescriptorSetLayoutUnique(layout_info, nullptr);
+
+	const auto allocate_info = vk::DescriptorSetAllocateInfo{}
+		.setDescriptorPool(m_pool.get())
+		.setDescriptorSetCount(1)
+		.setSetLayouts(m_layout.get());
+	auto sets = m_device.allocateDescriptorSetsUnique(allocate_info);
+	m_set = std::move(sets[0]);
+
+	m_logger.info(std::source_location::current(),
+				  std::format("Created BindlessTextures with {} slots", m_capacity));
+}
+
+BindlessTextures::~BindlessTextures()
+{
+	// NOTE the textures may outlive the array, they must not release into it then
+	std::scoped_lock lock(m_mutex);
+	for (auto const& [texture, slot]: m_indices)
+		std::erase(texture->bindless, this);
+}
+
+vk::DescriptorSetLayout BindlessTextures::layout() const noexcept
+{
+	return m_layout.get();
+}
+
+vk::DescriptorSet BindlessTextures::set() const noexcept
+{
+	return m_set.get();
+}
+
+auto BindlessTextures::index(TextureSamplerReadOnly& texture)
+	-> uint32_t
+{
+	std::scoped_lock lock(m_mutex);
+
+	auto it = m_indices.find(texture.impl.get());
+	if (it != m_indices.end())
+		return it->second;
+
+	// NOTE a reused slot still refers to the view of its destroyed texture, it is rewritten below
+	uint32_t slot = m_next_slot;
+	if (!m_free_slots.empty()) {
+		slot = m_free_slots.back();
+		m_free_slots.pop_back();
+	}
+	else if (m_next_slot < m_capacity) {
+		m_next_slot++;
+	}
+	else {
+		const std::string msg = std::format("BindlessTextures is full, all {} slots are used",
+											m_capacity);
+		m_logger.fatal(std::source_location::current(), msg);
+		throw std::runtime_error(msg);
+	}
+
+	const auto image_info = vk::DescriptorImageInfo{}
+		.setImageLayout(vk::ImageLayout::eShaderReadOnlyOptimal)
+		.setImageView(texture.impl->view.get())
+		.setSampler(texture.impl->sampler.get());
+
+	const std::array<vk::WriteDescriptorSet, 1> writes{
+		vk::WriteDescriptorSet{}
+		.setDstBinding(0)
+		.setDstArrayElement(slot)
+		.setDstSet(m_set.get())
+		.setDescriptorCount(1)
+		.setDescriptorType(vk::DescriptorType::eCombinedImageSampler)
+		.setImageInfo(image_info),
+	};
+	m_device.updateDescriptorSets(writes.size(), writes.data(), 0, nullptr);
+
+	m_indices.insert({texture.impl.get(), slot});
+	texture.impl->bindless.push_back(this);
+	return slot;
+}
+
+void BindlessTextures::begin_frame()
+{
+	std::scoped_lock lock(m_mutex);
+	m_frame++;
+
+	std::erase_if(m_released_slots, [this] (std::pair<uint64_t, uint32_t> const& released) {
+		if (released.first + *m_max_flightframes > m_frame)
+			return false;
+		m_free_slots.push_back(released.second);
+		return true;
+	});
+}
+
+void BindlessTextures::release(TextureSamplerReadOnly::Impl* texture)
+{
+	std::scoped_lock lock(m_mutex);
+	auto it = m_indices.find(texture);
+	if (it == m_indices.end())
+		return;
+
+	m_released_slots.emplace_back(m_frame, it->second);
+	m_indices.erase(it);
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "ShaderTextureImpl.hpp"
+#include "FlightFrames.hpp"
+
+#include <vulkan/vulkan.hpp>
+
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * A single sampler2D[] descriptor array every texture is registered into,
+ * so pipelines bind one set per pass and select textures by index.
+ *
+ * Requires VK_EXT_descriptor_indexing. The binding is partially bound and
+ * update after bind, so new textures can be written into free slots while
+ * earlier frames using the set are still in flight.
+ *
+ * A texture keeps its index until it is destroyed, its slot is then only reused once
+ * the frames in flight that may still sample it have retired, and is rewritten
+ * with the texture it is reused for.
+ */
+class BindlessTextures
+{
+public:
+	BindlessTextures(Logger logger,
+					 vk::PhysicalDevice physical_device,
+					 vk::Device device,
+					 MaxFlightFrames max_flightframes,
+					 uint32_t capacity);
+	~BindlessTextures();
+
+	BindlessTextures(BindlessTextures&) = delete;
+	BindlessTextures& operator=(BindlessTextures&) = delete;
+
+	[[nodiscard]]
+	vk::DescriptorSetLayout layout() const noexcept;
+
+	[[nodiscard]]
+	vk::DescriptorSet set() const noexcept;
+
+	/**
+	 * Index of texture in the array, the texture is written into
+	 * the next free slot the first time it is seen.
+	 * Safe to call from several recording threads.
+	 */
+	[[nodiscard]]
+	auto index(TextureSamplerReadOnly& texture)
+		-> uint32_t;
+
+	/**
+	 * Count a frame, expected once the fence of the flight frame has been waited on.
+	 * The slots released max flight frames ago are free to be reused from then on.
+	 */
+	void begin_frame();
+
+	/**
+	 * Forget texture, called when it is destroyed. Its slot is kept from reuse until
+	 * the frames that may have sampled it have retired.
+	 */
+	void release(TextureSamplerReadOnly::Impl* texture);
+
+private:
+	Logger m_logger;
+	vk::Device m_device;
+	uint32_t m_capacity{0};
+	MaxFlightFrames m_max_flightframes;
+	vk::UniqueDescriptorPool m_pool;
+	vk::UniqueDescriptorSetLayout m_layout;
+	vk::UniqueDescriptorSet m_set;
+
+	std::mutex m_mutex;
+	// NOTE keyed by the impl, which does not move with the texture
+	std::unordered_map<TextureSamplerReadOnly::Impl*, uint32_t> m_indices;
+	uint64_t m_frame{0};
+	// NOTE slots that were never used start after the highest slot used so far
+	uint32_t m_next_slot{0};
+	std::vector<uint32_t> m_free_slots;
+	// NOTE released slots, with the frame they were released in
+	std::vector<std::pair<uint64_t, uint32_t>> m_released_slots;
+};
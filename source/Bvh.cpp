@@ -0,0 +1,495 @@
+#include "Bvh.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+
+// NOTE the same box FrustumCull gives a mesh without bounds
+float constexpr unbounded_extent = 1.0e30f;
+uint32_t constexpr bin_count = 16;
+// NOTE cost of visiting a node relative to testing one object box
+float constexpr traversal_cost = 1.0f;
+
+struct Bounds
+{
+	glm::vec3 min{std::numeric_limits<float>::max()};
+	glm::vec3 max{-std::numeric_limits<float>::max()};
+
+	void grow(glm::vec3 const& point)
+	{
+		min = glm::min(min, point);
+		max = glm::max(max, point);
+	}
+
+	void grow(BvhBox const& box)
+	{
+		min = glm::min(min, box.min);
+		max = glm::max(max, box.max);
+	}
+
+	void grow(Bounds const& bounds)
+	{
+		min = glm::min(min, bounds.min);
+		max = glm::max(max, bounds.max);
+	}
+
+	// NOTE half the surface area, in double since unbounded boxes overflow a float
+	[[nodiscard]]
+	auto area() const noexcept
+		-> double
+	{
+		if (min.x > max.x)
+			return 0.0;
+		const double x = static_cast<double>(max.x) - min.x;
+		const double y = static_cast<double>(max.y) - min.y;
+		const double z = static_cast<double>(max.z) - min.z;
+		return x * y + y * z + z * x;
+	}
+};
+
+/**
+ * An object while building, the items are partitioned in place so every node
+ * reads its objects from one contiguous range instead of through the indices.
+ */
+struct BuildItem
+{
+	BvhBox box;
+	glm::vec3 centroid;
+	uint32_t object;
+};
+
+struct Builder
+{
+	std::vector<BuildItem> items;
+	std::vector<BvhNode>& nodes;
+
+	auto bin_of(float centroid,
+				float min,
+				float scale) const
+		-> uint32_t
+	{
+		const float scaled = (centroid - min) * scale;
+		return std::min(static_cast<uint32_t>(std::max(scaled, 0.0f)), bin_count - 1);
+	}
+
+	void build(uint32_t node_index, uint32_t first, uint32_t count, uint32_t depth)
+	{
+		BuildItem* const begin = items.data() + first;
+		BuildItem* const end = begin + count;
+
+		Bounds bounds{};
+		Bounds centroid_bounds{};
+		for (BuildItem const* item = begin; item != end; item++) {
+			bounds.grow(item->box);
+			centroid_bounds.grow(item->centroid);
+		}
+		nodes[node_index] = BvhNode{bounds.min, first, bounds.max, count};
+
+		if (count <= 1)
+			return;
+
+		/* Find the cheapest split over the bins of every axis, all axes are binned
+		 * in one pass and the bins are swept from both sides to get the cost of each boundary.
+		 */
+		glm::vec3 scale{0.0f};
+		for (int axis = 0; axis < 3; axis++) {
+			const float extent = centroid_bounds.max[axis] - centroid_bounds.min[axis];
+			scale[axis] = extent > 0.0f ? bin_count / extent : 0.0f;
+		}
+
+		std::array<std::array<Bounds, bin_count>, 3> bins{};
+		std::array<std::array<uint32_t, bin_count>, 3> bin_counts{};
+		for (BuildItem const* item = begin; item != end; item++) {
+			for (int axis = 0; axis < 3; axis++) {
+				const uint32_t bin = bin_of(item->centroid[axis], centroid_bounds.min[axis], scale[axis]);
+				bins[axis][bin].grow(item->box);
+				bin_counts[axis][bin]++;
+			}
+		}
+
+		int best_axis = -1;
+		uint32_t best_split = 0;
+		double best_cost = std::numeric_limits<double>::max();
+		for (int axis = 0; axis < 3; axis++) {
+			if (scale[axis] == 0.0f)
+				continue;
+
+			std::array<double, bin_count - 1> left_costs{};
+			Bounds left{};
+			uint32_t left_count = 0;
+			for (uint32_t split = 0; split < bin_count - 1; split++) {
+				left.grow(bins[axis][split]);
+				left_count += bin_counts[axis][split];
+				left_costs[split] = left.area() * left_count;
+			}
+
+			Bounds right{};
+			uint32_t right_count = 0;
+			for (uint32_t split = bin_count - 1; split > 0; split--) {
+				right.grow(bins[axis][split]);
+				right_count += bin_counts[axis][split];
+				const double cost = left_costs[split - 1] + right.area() * right_count;
+				if (right_count > 0 && right_count < count && cost < best_cost) {
+					best_cost = cost;
+					best_axis = axis;
+					best_split = split;
+				}
+			}
+		}
+
+		const double parent_area = bounds.area();
+		const double split_cost = parent_area > 0.0
+			? traversal_cost + best_cost / parent_area
+			: std::numeric_limits<double>::max();
+		if (count <= Bvh::max_leaf_size && split_cost >= static_cast<double>(count))
+			return;
+
+		uint32_t left_count = 0;
+		// NOTE median splits halve the objects, so near the depth limit they are all that is used
+		const bool near_max_depth = depth + std::bit_width(count) + 1 >= Bvh::max_depth;
+		if (best_axis >= 0 && !near_max_depth) {
+			const float min = centroid_bounds.min[best_axis];
+			const float axis_scale = scale[best_axis];
+			BuildItem* middle = std::partition(begin, end, [&] (BuildItem const& item) {
+				return bin_of(item.centroid[best_axis], min, axis_scale) < best_split;
+			});
+			left_count = static_cast<uint32_t>(middle - begin);
+		}
+
+		if (left_count == 0 || left_count == count) {
+			const glm::vec3 extent = centroid_bounds.max - centroid_bounds.min;
+			const int axis = extent.x >= extent.y && extent.x >= extent.z ? 0
+				: extent.y >= extent.z ? 1 : 2;
+			left_count = count / 2;
+			std::nth_element(begin, begin + left_count, end,
+							 [&] (BuildItem const& a, BuildItem const& b) {
+								 return a.centroid[axis] < b.centroid[axis];
+							 });
+		}
+
+		// NOTE the left child is always the next node, it has to be added before anything else
+		const uint32_t left = static_cast<uint32_t>(nodes.size());
+		nodes.emplace_back();
+		build(left, first, left_count, depth + 1);
+
+		const uint32_t right = static_cast<uint32_t>(nodes.size());
+		nodes.emplace_back();
+		build(right, first + left_count, count - left_count, depth + 1);
+
+		nodes[node_index].left_first = right;
+		nodes[node_index].count = 0;
+	}
+};
+
+/**
+ * Distance along the ray to where it enters the box, or infinity if it misses it
+ * or enters it after max_distance.
+ */
+auto ray_box(glm::vec3 const& min,
+			 glm::vec3 const& max,
+			 glm::vec3 const& origin,
+			 glm::vec3 const& inverse_direction,
+			 float max_distance)
+	-> float
+{
+	float enter = 0.0f;
+	float exit = max_distance;
+	for (int axis = 0; axis < 3; axis++) {
+		const float t0 = (min[axis] - origin[axis]) * inverse_direction[axis];
+		const float t1 = (max[axis] - origin[axis]) * inverse_direction[axis];
+		enter = std::max(enter, std::min(t0, t1));
+		exit = std::min(exit, std::max(t0, t1));
+	}
+	return enter <= exit ? enter : std::numeric_limits<float>::infinity();
+}
+
+/**
+ * Test a box against the planes set in planes, clearing the planes the box
+ * is entirely inside of. False if the box is outside any of them.
+ */
+auto box_in_planes(Frustum const& frustum,
+				   glm::vec3 const& min,
+				   glm::vec3 const& max,
+				   uint32_t& planes)
+	-> bool
+{
+	const glm::vec3 center = (min + max) * 0.5f;
+	const glm::vec3 extent = (max - min) * 0.5f;
+	for (uint32_t p = 0; p < frustum.planes.size(); p++) {
+		if (!(planes & (1u << p)))
+			continue;
+		glm::vec4 const& plane = frustum.planes[p];
+		const float distance = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+		const float radius = std::abs(plane.x) * extent.x
+			+ std::abs(plane.y) * extent.y
+			+ std::abs(plane.z) * extent.z;
+		// NOTE written so NaN is outside, the same as cull_boxes
+		if (!(distance + radius >= 0.0f))
+			return false;
+		if (distance - radius >= 0.0f)
+			planes &= ~(1u << p);
+	}
+	return true;
+}
+
+auto contains(glm::vec3 const& min,
+			  glm::vec3 const& max,
+			  glm::vec3 const& point)
+	-> bool
+{
+	return point.x >= min.x && point.y >= min.y && point.z >= min.z
+		&& point.x <= max.x && point.y <= max.y && point.z <= max.z;
+}
+
+}
+
+auto bvh_box(std::optional<MeshBounds> const& bounds,
+			 glm::mat4 const& model)
+	-> BvhBox
+{
+	const glm::vec3 translation = glm::vec3(model[3]);
+	if (!bounds.has_value())
+		return BvhBox{translation - unbounded_extent, translation + unbounded_extent};
+
+	// NOTE the same world space box CullBoxes::push makes
+	const glm::vec3 center = (bounds->min + bounds->max) * 0.5f;
+	const glm::vec3 extent = (bounds->max - bounds->min) * 0.5f;
+	const glm::vec3 world_center = glm::vec3(model * glm::vec4(center, 1.0f));
+
+	glm::vec3 world_extent{0.0f};
+	for (int axis = 0; axis < 3; axis++) {
+		world_extent[axis] = std::abs(model[0][axis]) * extent.x
+			+ std::abs(model[1][axis]) * extent.y
+			+ std::abs(model[2][axis]) * extent.z;
+	}
+	return BvhBox{world_center - world_extent, world_center + world_extent};
+}
+
+void Bvh::build(std::vector<BvhBox> const& boxes)
+{
+	m_nodes.clear();
+	m_indices.clear();
+	m_boxes.clear();
+	if (boxes.empty())
+		return;
+
+	const uint32_t count = static_cast<uint32_t>(boxes.size());
+	Builder builder{{}, m_nodes};
+	builder.items.reserve(count);
+	for (uint32_t i = 0; i < count; i++)
+		builder.items.push_back(BuildItem{boxes[i], (boxes[i].min + boxes[i].max) * 0.5f, i});
+
+	// NOTE a binary tree with at least one object per leaf never has more nodes than this
+	m_nodes.reserve(2 * count - 1);
+	m_nodes.emplace_back();
+	builder.build(0, 0, count, 0);
+
+	m_indices.reserve(count);
+	m_boxes.reserve(count);
+	for (BuildItem const& item: builder.items) {
+		m_indices.push_back(item.object);
+		m_boxes.push_back(item.box);
+	}
+}
+
+void Bvh::gather_boxes(std::vector<BvhBox> const& boxes)
+{
+	m_boxes.resize(m_indices.size());
+	for (size_t i = 0; i < m_indices.size(); i++)
+		m_boxes[i] = boxes[m_indices[i]];
+}
+
+void Bvh::refit(std::vector<BvhBox> const& boxes)
+{
+	if (boxes.size() != m_indices.size()) {
+		build(boxes);
+		return;
+	}
+
+	gather_boxes(boxes);
+
+	// NOTE children are always after their parent, so walking backwards refits them first
+	for (size_t i = m_nodes.size(); i-- > 0;) {
+		BvhNode& node = m_nodes[i];
+		Bounds bounds{};
+		if (node.count > 0) {
+			for (uint32_t j = node.left_first; j < node.left_first + node.count; j++)
+				bounds.grow(m_boxes[j]);
+		}
+		else {
+			BvhNode const& left = m_nodes[i + 1];
+			BvhNode const& right = m_nodes[node.left_first];
+			bounds.grow(BvhBox{left.min, left.max});
+			bounds.grow(BvhBox{right.min, right.max});
+		}
+		node.min = bounds.min;
+		node.max = bounds.max;
+	}
+}
+
+void Bvh::query_frustum(Frustum const& frustum,
+						std::vector<uint32_t>& visible) const
+{
+	if (m_nodes.empty())
+		return;
+
+	struct Entry
+	{
+		uint32_t node;
+		// NOTE bit per plane the parent was not entirely inside of
+		uint32_t planes;
+	};
+
+	const auto append_subtree = [&] (uint32_t node_index) {
+		uint32_t first = node_index;
+		while (m_nodes[first].count == 0)
+			first = first + 1;
+		uint32_t last = node_index;
+		while (m_nodes[last].count == 0)
+			last = m_nodes[last].left_first;
+		const uint32_t begin = m_nodes[first].left_first;
+		const uint32_t end = m_nodes[last].left_first + m_nodes[last].count;
+		visible.insert(visible.end(), m_indices.begin() + begin, m_indices.begin() + end);
+	};
+
+	std::array<Entry, max_depth> stack{};
+	uint32_t stack_size = 0;
+	stack[stack_size++] = Entry{0, 0x3f};
+
+	while (stack_size > 0) {
+		const Entry entry = stack[--stack_size];
+		BvhNode const& node = m_nodes[entry.node];
+
+		uint32_t planes = entry.planes;
+		if (!box_in_planes(frustum, node.min, node.max, planes))
+			continue;
+
+		if (planes == 0) {
+			append_subtree(entry.node);
+			continue;
+		}
+
+		if (node.count > 0) {
+			for (uint32_t i = node.left_first; i < node.left_first + node.count; i++) {
+				uint32_t object_planes = planes;
+				if (box_in_planes(frustum, m_boxes[i].min, m_boxes[i].max, object_planes))
+					visible.push_back(m_indices[i]);
+			}
+			continue;
+		}
+
+		stack[stack_size++] = Entry{node.left_first, planes};
+		stack[stack_size++] = Entry{entry.node + 1, planes};
+	}
+}
+
+auto Bvh::raycast(glm::vec3 origin,
+				  glm::vec3 direction,
+				  float max_distance) const
+	-> std::optional<BvhHit>
+{
+	if (m_nodes.empty())
+		return std::nullopt;
+
+	struct Entry
+	{
+		uint32_t node;
+		float distance;
+	};
+
+	const glm::vec3 inverse = 1.0f / direction;
+	float closest = max_distance;
+	std::optional<BvhHit> hit = std::nullopt;
+
+	std::array<Entry, max_depth> stack{};
+	uint32_t stack_size = 0;
+	const float root = ray_box(m_nodes[0].min, m_nodes[0].max, origin, inverse, closest);
+	if (std::isinf(root))
+		return std::nullopt;
+	stack[stack_size++] = Entry{0, root};
+
+	while (stack_size > 0) {
+		const Entry entry = stack[--stack_size];
+		if (entry.distance > closest)
+			continue;
+
+		BvhNode const& node = m_nodes[entry.node];
+		if (node.count > 0) {
+			for (uint32_t i = node.left_first; i < node.left_first + node.count; i++) {
+				const float distance = ray_box(m_boxes[i].min, m_boxes[i].max, origin, inverse, closest);
+				if (!std::isinf(distance)) {
+					closest = distance;
+					hit = BvhHit{m_indices[i], distance};
+				}
+			}
+			continue;
+		}
+
+		/* Visit the nearer child first, so the closest hit found
+		 * shrinks the ray before the farther child is tested.
+		 */
+		Entry near{entry.node + 1, 0.0f};
+		Entry far{node.left_first, 0.0f};
+		near.distance = ray_box(m_nodes[near.node].min, m_nodes[near.node].max, origin, inverse, closest);
+		far.distance = ray_box(m_nodes[far.node].min, m_nodes[far.node].max, origin, inverse, closest);
+		if (far.distance < near.distance)
+			std::swap(near, far);
+		if (!std::isinf(far.distance))
+			stack[stack_size++] = far;
+		if (!std::isinf(near.distance))
+			stack[stack_size++] = near;
+	}
+
+	return hit;
+}
+
+void Bvh::query_point(glm::vec3 point,
+					  std::vector<uint32_t>& hits) const
+{
+	if (m_nodes.empty())
+		return;
+
+	std::array<uint32_t, max_depth> stack{};
+	uint32_t stack_size = 0;
+	stack[stack_size++] = 0;
+
+	while (stack_size > 0) {
+		BvhNode const& node = m_nodes[stack[--stack_size]];
+		if (!contains(node.min, node.max, point))
+			continue;
+
+		if (node.count > 0) {
+			for (uint32_t i = node.left_first; i < node.left_first + node.count; i++) {
+				if (contains(m_boxes[i].min, m_boxes[i].max, point))
+					hits.push_back(m_indices[i]);
+			}
+			continue;
+		}
+
+		stack[stack_size++] = node.left_first;
+		stack[stack_size++] = static_cast<uint32_t>(&node - m_nodes.data()) + 1;
+	}
+}
+
+auto Bvh::nodes() const noexcept
+	-> std::vector<BvhNode> const&
+{
+	return m_nodes;
+}
+
+auto Bvh::indices() const noexcept
+	-> std::vector<uint32_t> const&
+{
+	return m_indices;
+}
+
+auto Bvh::size() const noexcept
+	-> size_t
+{
+	return m_indices.size();
+}
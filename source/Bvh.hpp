@@ -0,0 +1,137 @@
+#pragma once
+
+#include "FrustumCull.hpp"
+
+#include <VulkanRenderer/glm.hpp>
+#include <VulkanRenderer/VertexBuffer.hpp>
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+/**
+ * A world space axis aligned box of one object in a Bvh.
+ */
+struct BvhBox
+{
+	glm::vec3 min;
+	glm::vec3 max;
+};
+
+/**
+ * The world space box of a mesh transformed by model.
+ * A mesh without bounds gets a box that is never culled.
+ */
+[[nodiscard]]
+auto bvh_box(std::optional<MeshBounds> const& bounds,
+			 glm::mat4 const& model)
+	-> BvhBox;
+
+template<typename Renderable>
+[[nodiscard]]
+auto bvh_boxes(std::vector<Renderable> const& renderables)
+	-> std::vector<BvhBox>
+{
+	std::vector<BvhBox> boxes{};
+	boxes.reserve(renderables.size());
+	for (Renderable const& renderable: renderables)
+		boxes.push_back(bvh_box(renderable.mesh->bounds(), renderable.model));
+	return boxes;
+}
+
+/**
+ * One node of a Bvh, two fit in a cache line.
+ * A leaf has a count and the first of its objects in Bvh::indices, an interior
+ * node has a count of 0, its left child is the next node and left_first is its
+ * right child.
+ */
+struct BvhNode
+{
+	glm::vec3 min;
+	uint32_t left_first;
+	glm::vec3 max;
+	uint32_t count;
+};
+
+struct BvhHit
+{
+	uint32_t object;
+	float distance;
+};
+
+/**
+ * A bounding volume hierarchy over a set of object boxes, for hierarchical culling
+ * and scene queries such as picking.
+ *
+ * The tree is built with the surface area heuristic over binned centroids, and stored
+ * as a flat array in depth first order, so every subtree is a contiguous range of
+ * nodes and its objects a contiguous range of indices.
+ * Objects are refered to by their index in the boxes the tree was built from.
+ */
+class Bvh
+{
+public:
+	Bvh() = default;
+
+	/**
+	 * Build the tree from scratch over boxes.
+	 */
+	void build(std::vector<BvhBox> const& boxes);
+
+	/**
+	 * Update the node boxes to new boxes of the same objects without changing the
+	 * structure of the tree. Much cheaper than build, but the tree gets worse the
+	 * further objects move from where they were when it was built.
+	 */
+	void refit(std::vector<BvhBox> const& boxes);
+
+	/**
+	 * Append the objects at least partly inside frustum to visible, in no particular order.
+	 * Subtrees outside a plane are skipped, and subtrees inside every plane are
+	 * appended without testing the nodes below them.
+	 */
+	void query_frustum(Frustum const& frustum,
+					   std::vector<uint32_t>& visible) const;
+
+	/**
+	 * The object whose box is hit closest along the ray, within max_distance.
+	 * Only the boxes are tested, so picking exact geometry has to test the
+	 * hit object itself.
+	 */
+	[[nodiscard]]
+	auto raycast(glm::vec3 origin,
+				 glm::vec3 direction,
+				 float max_distance) const
+		-> std::optional<BvhHit>;
+
+	/**
+	 * Append the objects whose box contains point to hits.
+	 */
+	void query_point(glm::vec3 point,
+					 std::vector<uint32_t>& hits) const;
+
+	[[nodiscard]]
+	auto nodes() const noexcept
+		-> std::vector<BvhNode> const&;
+
+	[[nodiscard]]
+	auto indices() const noexcept
+		-> std::vector<uint32_t> const&;
+
+	[[nodiscard]]
+	auto size() const noexcept
+		-> size_t;
+
+	// NOTE leaves are split until they hold no more than this many objects
+	uint32_t static constexpr max_leaf_size = 8;
+	// NOTE every query walks the tree with a fixed size stack, the build keeps the depth below it
+	uint32_t static constexpr max_depth = 64;
+
+private:
+	void gather_boxes(std::vector<BvhBox> const& boxes);
+
+	std::vector<BvhNode> m_nodes;
+	std::vector<uint32_t> m_indices;
+	// NOTE the object boxes in the order of m_indices, so a leaf reads its boxes contiguously
+	std::vector<BvhBox> m_boxes;
+};
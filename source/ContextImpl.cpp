@@ -1,5 +1,7 @@
 #include "ContextImpl.hpp"
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 
 namespace Render
@@ -28,6 +30,8 @@ Context::Impl::Impl(WindowConfig const& config, Logger logger)
 	CreateDevice();
 	CreateIndexQueues();
 	CreateCommandpool();
+	CreateDeviceAllocator();
+	CreateUploadQueue();
 }
 	
 [[nodiscard]]
@@ -180,6 +184,17 @@ void Context::Impl::GetQueueFamilyIndices()
 		logger.warn(std::source_location::current(),
 					"found SPLIT graphics present indices");
 	}
+
+	transfer_index = find_dedicated_transfer_queue_family_index(physical_device);
+	if (transfer_index.has_value()) {
+		logger.info(std::source_location::current(),
+					std::format("found dedicated transfer queue family {}",
+								transfer_index.value()));
+	}
+	else {
+		logger.info(std::source_location::current(),
+					"found no dedicated transfer queue family, uploads use the graphics queue");
+	}
 }
 	
 void Context::Impl::CreateIndexQueues()
@@ -202,15 +217,71 @@ void Context::Impl::CreateDevice()
 	float queuePriority = 1.0f;
 	uint32_t device_index = present_index(graphics_present_indices);
 
-	auto deviceQueueCreateInfo = vk::DeviceQueueCreateInfo{}
+	std::vector<vk::DeviceQueueCreateInfo> deviceQueueCreateInfos{
+		vk::DeviceQueueCreateInfo{}
 		.setFlags({})
 		.setQueueFamilyIndex(device_index)
 		.setPQueuePriorities(&queuePriority)
-		.setQueueCount(1);
+		.setQueueCount(1),
+	};
+
+	if (transfer_index.has_value()) {
+		deviceQueueCreateInfos.push_back(vk::DeviceQueueCreateInfo{}
+										 .setFlags({})
+										 .setQueueFamilyIndex(transfer_index.value())
+										 .setPQueuePriorities(&queuePriority)
+										 .setQueueCount(1));
+	}
 
-	const std::vector<const char*> device_extensions = {
+	std::vector<const char*> device_extensions = {
 		VK_KHR_SWAPCHAIN_EXTENSION_NAME,
 	};
+
+	const auto available_extensions = physical_device.enumerateDeviceExtensionProperties();
+	const auto is_available = [&] (const char* name) {
+		return std::ranges::any_of(available_extensions,
+								   [&] (vk::ExtensionProperties const& properties) {
+									   return std::strcmp(properties.extensionName, name) == 0;
+								   });
+	};
+
+	if (is_available(VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME)) {
+		device_extensions.push_back(VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME);
+		optional_extensions.pipeline_creation_feedback = true;
+	}
+
+	auto descriptor_indexing_features = vk::PhysicalDeviceDescriptorIndexingFeaturesEXT{}
+		.setRuntimeDescriptorArray(true)
+		.setDescriptorBindingPartiallyBound(true)
+		.setDescriptorBindingSampledImageUpdateAfterBind(true)
+		.setDescriptorBindingUpdateUnusedWhilePending(true);
+
+	if (is_available(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME)) {
+		const auto supported =
+			physical_device.getFeatures2<vk::PhysicalDeviceFeatures2,
+										 vk::PhysicalDeviceDescriptorIndexingFeaturesEXT>();
+		const auto& indexing = supported.get<vk::PhysicalDeviceDescriptorIndexingFeaturesEXT>();
+		if (indexing.runtimeDescriptorArray
+			&& indexing.descriptorBindingPartiallyBound
+			&& indexing.descriptorBindingSampledImageUpdateAfterBind
+			&& indexing.descriptorBindingUpdateUnusedWhilePending) {
+			device_extensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+			optional_extensions.descriptor_indexing = true;
+		}
+	}
+
+	auto synchronization2_features = vk::PhysicalDeviceSynchronization2FeaturesKHR{}
+		.setSynchronization2(true);
+
+	if (is_available(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME)) {
+		const auto supported =
+			physical_device.getFeatures2<vk::PhysicalDeviceFeatures2,
+										 vk::PhysicalDeviceSynchronization2FeaturesKHR>();
+		if (supported.get<vk::PhysicalDeviceSynchronization2FeaturesKHR>().synchronization2) {
+			device_extensions.push_back(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME);
+			optional_extensions.synchronization2 = true;
+		}
+	}
 	
 	logger.info(std::source_location::current(), "requred device extensions:");
 	for (auto extension: device_extensions) {
@@ -230,11 +301,22 @@ void Context::Impl::CreateDevice()
 		.setSamplerAnisotropy(true);
 	
 	auto deviceCreateInfo = vk::DeviceCreateInfo{}
-		.setQueueCreateInfoCount(1)
-		.setQueueCreateInfos(deviceQueueCreateInfo)
+		.setQueueCreateInfos(deviceQueueCreateInfos)
 		.setPEnabledFeatures(&features)
 		.setPpEnabledExtensionNames(device_extensions.data())
 		.setEnabledExtensionCount(device_extensions.size());
+
+	// NOTE the feature structs of the enabled extensions are chained in front of each other
+	void* features_chain = nullptr;
+	if (optional_extensions.descriptor_indexing) {
+		descriptor_indexing_features.setPNext(features_chain);
+		features_chain = &descriptor_indexing_features;
+	}
+	if (optional_extensions.synchronization2) {
+		synchronization2_features.setPNext(features_chain);
+		features_chain = &synchronization2_features;
+	}
+	deviceCreateInfo.setPNext(features_chain);
 	
 	device = physical_device.createDeviceUnique(deviceCreateInfo);
 	logger.info(std::source_location::current(), "Created Logical Device!");
@@ -249,6 +331,41 @@ void Context::Impl::CreateCommandpool()
 	logger.info(std::source_location::current(), "Created Graphics Command pool!");
 }
 
+void Context::Impl::CreateDeviceAllocator()
+{
+	// NOTE resources larger than half a block get a dedicated allocation.
+	vk::DeviceSize constexpr block_size = 64 * 1024 * 1024;
+	allocator = std::make_unique<DeviceAllocator>(logger,
+												  physical_device,
+												  device.get(),
+												  block_size);
+}
+
+void Context::Impl::CreateUploadQueue()
+{
+	// NOTE large enough for a couple of 2k RGBA textures per batch,
+	//      larger uploads fall back to a dedicated staging buffer.
+	vk::DeviceSize constexpr staging_size = 64 * 1024 * 1024;
+
+	std::optional<UploadQueue::TransferQueue> transfer_queue;
+	if (transfer_index.has_value()) {
+		transfer_queue = UploadQueue::TransferQueue{
+			transfer_index.value(),
+			device->getQueue(transfer_index.value(), 0)
+		};
+	}
+
+	upload_queue = std::make_unique<UploadQueue>(logger,
+												 physical_device,
+												 device.get(),
+												 allocator.get(),
+												 graphics_index(graphics_present_indices),
+												 graphics_queue(),
+												 transfer_queue,
+												 &queue_mutex,
+												 staging_size);
+}
+
 vk::Extent2D
 Context::Impl::get_window_extent() const noexcept
 {
@@ -268,6 +385,7 @@ Context::Impl::window_resize_event_triggered() noexcept
 
 void Context::Impl::wait_until_idle() noexcept
 {
+	std::scoped_lock lock(queue_mutex);
 	device.get().waitIdle();
 }
 	
@@ -315,4 +433,24 @@ void Context::wait_until_idle() noexcept
 	impl->wait_until_idle();
 }
 
+UploadTicket Context::flush_uploads()
+{
+	return impl->upload_queue->flush();
+}
+
+bool Context::is_upload_complete(UploadTicket ticket)
+{
+	return impl->upload_queue->is_complete(ticket);
+}
+
+void Context::wait_for_upload(UploadTicket ticket)
+{
+	impl->upload_queue->wait(ticket);
+}
+
+MemoryStats Context::memory_stats()
+{
+	return impl->allocator->stats();
+}
+
 }
@@ -3,6 +3,9 @@
 #include <VulkanRenderer/Context.hpp>
 #include "Utils.hpp"
 #include "DebugMessenger.hpp"
+#include "UploadQueue.hpp"
+
+#include <mutex>
 
 namespace Render
 {
@@ -29,9 +32,25 @@ public:
 	VkSurfaceKHR raw_window_surface;
 	vk::PhysicalDevice physical_device;
 	GraphicsPresentIndices graphics_present_indices;
+	std::optional<uint32_t> transfer_index;
 	vk::UniqueDevice device;
+
+	// NOTE device extensions that are enabled only when the device supports them
+	struct OptionalExtensions
+	{
+		bool pipeline_creation_feedback{false};
+		// NOTE only set when the features bindless textures need are supported as well
+		bool descriptor_indexing{false};
+		// NOTE the frame graph records its barriers with vkCmdPipelineBarrier2KHR when set
+		bool synchronization2{false};
+	};
+	OptionalExtensions optional_extensions;
+
 	IndexQueues index_queues;
+	std::mutex queue_mutex;
 	vk::UniqueCommandPool commandpool;
+	std::unique_ptr<DeviceAllocator> allocator;
+	std::unique_ptr<UploadQueue> upload_queue;
 
 private:	
 	void InitSDL();
@@ -44,6 +63,8 @@ private:
 	void CreateDevice();
 	void CreateIndexQueues();
 	void CreateCommandpool();
+	void CreateDeviceAllocator();
+	void CreateUploadQueue();
 };
 
 }
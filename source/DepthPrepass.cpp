@@ -0,0 +1,310 @@
+#include "DepthPrepass.hpp"
+
+#include <array>
+#include <format>
+
+DepthPrepass::DepthPrepass(Logger& logger,
+						   Render::Context::Impl* context,
+						   Presenter::Impl* presenter,
+						   PipelineCache* pipeline_cache,
+						   vk::Extent2D extent,
+						   vk::Format depth_format,
+						   std::filesystem::path shader_root_path)
+	: m_device(context->device.get())
+	, m_extent(extent)
+{
+	const VertexPath vertex_path{shader_root_path / "DepthPrepass.vert.spv"};
+	const std::string pipeline_name = "DepthPrepass";
+
+	/* Depth only, the depth attachment is the depthbuffer of the geometry pass.
+	 * NOTE it is cleared and kept for the geometry pass to load, the frame graph
+	 *      places it in the depth attachment layout and orders both passes.
+	 */
+    const auto depth_attachment = vk::AttachmentDescription{}
+		.setFlags(vk::AttachmentDescriptionFlags())
+		.setFormat(depth_format)
+		.setSamples(vk::SampleCountFlagBits::e1)
+		.setLoadOp(vk::AttachmentLoadOp::eClear)
+		.setStoreOp(vk::AttachmentStoreOp::eStore)
+		.setStencilLoadOp(vk::AttachmentLoadOp::eDontCare)
+		.setStencilStoreOp(vk::AttachmentStoreOp::eDontCare)
+		.setInitialLayout(vk::ImageLayout::eDepthStencilAttachmentOptimal)
+		.setFinalLayout(vk::ImageLayout::eDepthStencilAttachmentOptimal);
+
+	const auto depth_reference = vk::AttachmentReference{}
+		.setAttachment(0)
+		.setLayout(vk::ImageLayout::eDepthStencilAttachmentOptimal);
+
+    auto subpass = vk::SubpassDescription{}
+		.setFlags(vk::SubpassDescriptionFlags())
+		.setPipelineBindPoint(vk::PipelineBindPoint::eGraphics)
+		.setInputAttachments({})
+		.setResolveAttachments({})
+		.setColorAttachments({})
+		.setPDepthStencilAttachment(&depth_reference);
+
+    auto renderPassCreateInfo = vk::RenderPassCreateInfo{}
+		.setFlags(vk::RenderPassCreateFlags())
+		.setAttachments(depth_attachment)
+		.setSubpasses(subpass);
+
+	m_renderpass = m_device.createRenderPassUnique(renderPassCreateInfo);
+	logger.info(std::source_location::current(),
+				"Created Depth Prepass Render Pass!");
+
+	// NOTE only the depth is written, so there is no fragment shader
+	auto shaderstage_info = create_vertex_shaderstage_info(m_device, vertex_path);
+
+	if (!shaderstage_info) {
+		std::string const msg = std::format("{} could not load vertex source {}",
+											pipeline_name,
+											vertex_path.get().string());
+		logger.fatal(std::source_location::current(), msg);
+		throw std::runtime_error(msg);
+	}
+
+    std::array<vk::DynamicState, 2> dynamic_states{
+		vk::DynamicState::eViewport,
+		vk::DynamicState::eScissor
+	};
+
+	auto pipelineDynamicStateCreateInfo = vk::PipelineDynamicStateCreateInfo{}
+		.setFlags(vk::PipelineDynamicStateCreateFlags())
+		.setDynamicStates(dynamic_states);
+
+	// NOTE the vertex input of the material pipeline, so the same buffers are bound
+	const auto bindingDescriptions = instanced_binding_descriptions(VertexPosNormColorUV{});
+	const auto attributeDescriptions = instanced_attribute_descriptions(VertexPosNormColorUV{});
+
+	auto pipelineVertexInputStateCreateInfo = vk::PipelineVertexInputStateCreateInfo{}
+		.setFlags(vk::PipelineVertexInputStateCreateFlags())
+		.setVertexBindingDescriptions(bindingDescriptions)
+		.setVertexAttributeDescriptions(attributeDescriptions);
+
+    auto pipelineInputAssemblyStateCreateInfo = vk::PipelineInputAssemblyStateCreateInfo{}
+		.setFlags(vk::PipelineInputAssemblyStateCreateFlags())
+		.setPrimitiveRestartEnable(vk::False)
+		.setTopology(vk::PrimitiveTopology::eTriangleList);
+
+	 const auto initial_viewport = vk::Viewport{}
+		.setX(0.0f)
+		.setY(0.0f)
+		.setWidth(static_cast<float>(m_extent.width))
+		.setHeight(static_cast<float>(m_extent.height))
+		.setMinDepth(0.0f)
+		.setMaxDepth(1.0f);
+
+	auto initial_scissor = vk::Rect2D{}
+		.setOffset(vk::Offset2D{}.setX(0.0f)
+				                 .setY(0.0f));
+
+    auto pipelineViewportStateCreateInfo = vk::PipelineViewportStateCreateInfo{}
+		.setFlags(vk::PipelineViewportStateCreateFlags())
+		.setViewports(initial_viewport)
+		.setScissors(initial_scissor);
+
+	// NOTE culls the same faces as the material pipeline, every depth it tests against has to be here
+    auto pipelineRasterizationStateCreateInfo = vk::PipelineRasterizationStateCreateInfo{}
+		.setFlags(vk::PipelineRasterizationStateCreateFlags())
+		.setDepthClampEnable(false)
+		.setRasterizerDiscardEnable(false)
+		.setPolygonMode(vk::PolygonMode::eFill)
+		.setCullMode(vk::CullModeFlagBits::eBack)
+		.setFrontFace(vk::FrontFace::eCounterClockwise)
+		.setDepthBiasEnable(false)
+		.setDepthBiasConstantFactor(0.0f)
+		.setDepthBiasClamp(0.0f)
+		.setDepthBiasSlopeFactor(0.0f)
+		.setLineWidth(1.0f);
+
+    auto pipelineMultisampleStateCreateInfo = vk::PipelineMultisampleStateCreateInfo{}
+		.setFlags(vk::PipelineMultisampleStateCreateFlags())
+		.setSampleShadingEnable(false)
+		.setRasterizationSamples(vk::SampleCountFlagBits::e1);
+
+	// NOTE there are no color attachments to blend into
+	auto pipelineColorBlendStateCreateInfo = vk::PipelineColorBlendStateCreateInfo{}
+		.setFlags(vk::PipelineColorBlendStateCreateFlags())
+		.setLogicOpEnable(false)
+		.setLogicOp(vk::LogicOp::eNoOp)
+		.setAttachments({})
+		.setBlendConstants({ 1.0f, 1.0f, 1.0f, 1.0f });
+
+	const auto layout_binding = vk::DescriptorSetLayoutBinding{}
+		.setStageFlags(vk::ShaderStageFlagBits::eVertex)
+		.setBinding(0)
+		.setDescriptorCount(1)
+		.setDescriptorType(vk::DescriptorType::eUniformBufferDynamic);
+
+	const auto set_info = vk::DescriptorSetLayoutCreateInfo{}
+		.setFlags(vk::DescriptorSetLayoutCreateFlags())
+		.setBindingCount(1)
+		.setBindings(layout_binding);
+
+	m_descriptor_layout = m_device.createDescriptorSetLayoutUnique(set_info, nullptr);
+
+    auto pipelineLayoutCreateInfo = vk::PipelineLayoutCreateInfo{}
+		.setFlags(vk::PipelineLayoutCreateFlags())
+		.setSetLayouts(m_descriptor_layout.get());
+
+	m_layout = m_device.createPipelineLayoutUnique(pipelineLayoutCreateInfo);
+
+	logger.info(std::source_location::current(), "Created Pipeline Layout");
+
+	auto depth_stencil_state_info = vk::PipelineDepthStencilStateCreateInfo{}
+		.setDepthTestEnable(true)
+		.setDepthWriteEnable(true)
+		.setDepthCompareOp(vk::CompareOp::eLess)
+		.setDepthBoundsTestEnable(false)
+		.setMinDepthBounds(0.0f)
+		.setMaxDepthBounds(1.0f)
+		.setStencilTestEnable(false);
+
+	auto graphicsPipelineCreateInfo = vk::GraphicsPipelineCreateInfo{}
+		.setFlags(vk::PipelineCreateFlags())
+		.setStages(shaderstage_info.value().create_info)
+		.setPVertexInputState(&pipelineVertexInputStateCreateInfo)
+		.setPInputAssemblyState(&pipelineInputAssemblyStateCreateInfo)
+		.setPTessellationState(nullptr)
+		.setPViewportState(&pipelineViewportStateCreateInfo)
+		.setPRasterizationState(&pipelineRasterizationStateCreateInfo)
+		.setPMultisampleState(&pipelineMultisampleStateCreateInfo)
+		.setPDepthStencilState(&depth_stencil_state_info)
+		.setPColorBlendState(&pipelineColorBlendStateCreateInfo)
+		.setPDynamicState(&pipelineDynamicStateCreateInfo)
+		.setLayout(m_layout.get())
+		.setRenderPass(m_renderpass.get());
+
+	vk::ResultValue<vk::UniquePipeline> result =
+		pipeline_cache->create_graphics_pipeline(pipeline_name,
+												 graphicsPipelineCreateInfo);
+
+    switch (result.result) {
+	case vk::Result::eSuccess:
+		break;
+	case vk::Result::ePipelineCompileRequiredEXT:
+		logger.error(std::source_location::current(),
+					 "Creating pipeline error: PipelineCompileRequiredEXT");
+	default:
+		logger.error(std::source_location::current(),
+					 "Creating pipeline error: Unknown invalid Result state");
+    }
+
+	m_pipeline = std::move(result.value);
+	logger.info(std::source_location::current(),
+				"Created Pipeline");
+
+	std::array<vk::DescriptorPoolSize, 1> sizes {
+		vk::DescriptorPoolSize{}
+		.setType(vk::DescriptorType::eUniformBufferDynamic)
+		.setDescriptorCount(1),
+	};
+
+	const auto pool_info = vk::DescriptorPoolCreateInfo{}
+		.setFlags(vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet)
+		.setMaxSets(1)
+		.setPoolSizes(sizes);
+
+	m_descriptor_pool = m_device.createDescriptorPoolUnique(pool_info, nullptr);
+
+	m_uniforms = presenter->uniform_ring.get();
+	m_instances = presenter->instance_ring.get();
+
+	const auto allocate_info = vk::DescriptorSetAllocateInfo{}
+		.setDescriptorPool(m_descriptor_pool.get())
+		.setDescriptorSetCount(1)
+		.setSetLayouts(m_descriptor_layout.get());
+
+	auto sets = m_device.allocateDescriptorSetsUnique(allocate_info);
+	m_descriptor_set = std::move(sets[0]);
+
+	const auto buffer_info = m_uniforms->descriptor_info<CameraUniformData>();
+
+	const auto write_descriptor = vk::WriteDescriptorSet{}
+		.setDstBinding(0)
+		.setDstSet(m_descriptor_set.get())
+		.setDstArrayElement(0)
+		.setDescriptorCount(1)
+		.setDescriptorType(vk::DescriptorType::eUniformBufferDynamic)
+		.setBufferInfo(buffer_info);
+
+	const uint32_t write_count = 1;
+	const uint32_t copy_count = 0;
+	m_device.updateDescriptorSets(write_count,
+								  &write_descriptor,
+								  copy_count,
+								  nullptr);
+
+	logger.info(std::source_location::current(),
+				"Created Depth Prepass RenderPipeline!");
+}
+
+void DepthPrepass::begin_renderpass(vk::CommandBuffer& commandbuffer,
+									CurrentFlightFrame current_flightframe,
+									vk::ImageView depthbuffer_view,
+									vk::SubpassContents contents)
+{
+	vk::UniqueFramebuffer& framebuffer = m_framebuffers[current_flightframe.get()];
+	vk::ImageView& framebuffer_view = m_framebuffer_depth_views[current_flightframe.get()];
+	if (!framebuffer || framebuffer_view != depthbuffer_view) {
+		auto framebufferCreateInfo = vk::FramebufferCreateInfo{}
+			.setFlags(vk::FramebufferCreateFlags())
+			.setAttachments(depthbuffer_view)
+			.setWidth(m_extent.width)
+			.setHeight(m_extent.height)
+			.setRenderPass(m_renderpass.get())
+			.setLayers(1);
+		framebuffer = m_device.createFramebufferUnique(framebufferCreateInfo);
+		framebuffer_view = depthbuffer_view;
+	}
+
+ 	const auto render_area = vk::Rect2D{}
+		.setOffset(vk::Offset2D{}.setX(0.0f).setY(0.0f))
+		.setExtent(m_extent);
+
+	const std::array<vk::ClearValue, 1> clearvalues{
+		vk::ClearValue{}.setDepthStencil({1.0f, 0}),
+	};
+
+	const auto renderPassInfo = vk::RenderPassBeginInfo{}
+		.setRenderPass(m_renderpass.get())
+		.setFramebuffer(framebuffer.get())
+		.setRenderArea(render_area)
+		.setClearValues(clearvalues);
+
+	commandbuffer.beginRenderPass(renderPassInfo, contents);
+}
+
+auto DepthPrepass::inheritance_info() const
+	-> vk::CommandBufferInheritanceInfo
+{
+	return vk::CommandBufferInheritanceInfo{}
+		.setRenderPass(m_renderpass.get())
+		.setSubpass(0);
+}
+
+void DepthPrepass::record(vk::CommandBuffer& commandbuffer,
+						  CameraUniformData const& camera_data,
+						  std::vector<MaterialRenderable> const& renderables,
+						  GpuCullPass* gpu_cull)
+{
+	commandbuffer.bindPipeline(vk::PipelineBindPoint::eGraphics,
+							   m_pipeline.get());
+
+	const uint32_t camera_offset = m_uniforms->push(camera_data);
+	const uint32_t first_set = 0;
+	const uint32_t descriptor_set_count = 1;
+	auto descriptor_sets = &(m_descriptor_set.get());
+	const uint32_t dynamic_offset_count = 1;
+	const uint32_t* dynamic_offsets = &camera_offset;
+	commandbuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
+									 m_layout.get(),
+									 first_set,
+									 descriptor_set_count,
+									 descriptor_sets,
+									 dynamic_offset_count,
+									 dynamic_offsets);
+
+	// NOTE with gpu culling every batch is drawn the same the material pipeline draws it with
+	record_depth_draws(commandbuffer, *m_instances, renderables, gpu_cull);
+}
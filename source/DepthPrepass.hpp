@@ -0,0 +1,89 @@
+#pragma once
+
+#include <VulkanRenderer/Renderable.hpp>
+
+#include "FlightFrames.hpp"
+#include "VertexImpl.hpp"
+#include "VertexBufferImpl.hpp"
+#include "IndexBufferImpl.hpp"
+#include "Mesh.hpp"
+#include "ContextImpl.hpp"
+#include "PresenterImpl.hpp"
+#include "PipelineUtils.hpp"
+#include "PipelineCache.hpp"
+#include "InstanceBatch.hpp"
+#include "GpuCulling.hpp"
+
+#include <filesystem>
+
+/**
+ * Lays down the depth of the material draws before the geometry pass, so the material
+ * pipeline only shades the fragment that ends up visible in every pixel instead of
+ * every fragment drawn over it. Only the positions are transformed, and there is no
+ * fragment shader.
+ *
+ * The depthbuffer is the one of the geometry pass, it is cleared and kept by this pass
+ * and loaded by the geometry pass, where the material pipeline tests for equal depths.
+ */
+class DepthPrepass
+{
+public:
+	DepthPrepass(Logger& logger,
+				 Render::Context::Impl* context,
+				 Presenter::Impl* presenter,
+				 PipelineCache* pipeline_cache,
+				 vk::Extent2D extent,
+				 vk::Format depth_format,
+				 std::filesystem::path shader_root_path);
+
+	DepthPrepass(DepthPrepass&) = delete;
+	DepthPrepass& operator=(DepthPrepass&) = delete;
+
+	struct CameraUniformData
+	{
+		glm::mat4 view;
+		glm::mat4 proj;
+	};
+
+	/**
+	 * Begin the renderpass of the flight frame into depthbuffer_view, the framebuffer
+	 * is created again whenever the frame graph placed the depthbuffer elsewhere.
+	 */
+	void begin_renderpass(vk::CommandBuffer& commandbuffer,
+						  CurrentFlightFrame current_flightframe,
+						  vk::ImageView depthbuffer_view,
+						  vk::SubpassContents contents);
+
+	// NOTE the framebuffer is left out, it is only known once the frame graph placed the depthbuffer
+	[[nodiscard]]
+	auto inheritance_info() const
+		-> vk::CommandBufferInheritanceInfo;
+
+	/**
+	 * Record the depth of every material draw, inside the renderpass begun by begin_renderpass.
+	 * With gpu culling the renderables are the ones the cull pass was prepared with.
+	 */
+	void record(vk::CommandBuffer& commandbuffer,
+				CameraUniformData const& camera_data,
+				std::vector<MaterialRenderable> const& renderables,
+				GpuCullPass* gpu_cull = nullptr);
+
+private:
+	vk::Device m_device;
+	vk::Extent2D m_extent;
+	vk::UniqueRenderPass m_renderpass;
+
+	// NOTE the framebuffer of a flight frame is only used by that flight frame
+	FlightFramesArray<vk::ImageView> m_framebuffer_depth_views;
+	FlightFramesArray<vk::UniqueFramebuffer> m_framebuffers;
+
+	vk::UniqueDescriptorSetLayout m_descriptor_layout;
+	vk::UniqueDescriptorPool m_descriptor_pool;
+	// NOTE the camera is pushed to the presenters uniform ring, selected by a dynamic offset
+	vk::UniqueDescriptorSet m_descriptor_set;
+	vk::UniquePipelineLayout m_layout;
+	vk::UniquePipeline m_pipeline;
+	UniformRing* m_uniforms{nullptr};
+	// NOTE the models of the draws are pushed to the presenters instance ring
+	InstanceRing* m_instances{nullptr};
+};
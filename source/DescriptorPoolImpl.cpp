@@ -16,6 +16,16 @@ DescriptorPool::Impl::Impl(DescriptorPoolCreateInfo const& create_info,
 		max_sets += count;
 	}
 	
+	if (create_info.uniform_buffer_dynamic_count) {
+		const auto count = create_info.uniform_buffer_dynamic_count.value();
+		const auto size = vk::DescriptorPoolSize{}
+			.setType(vk::DescriptorType::eUniformBufferDynamic)
+			.setDescriptorCount(count);
+
+		sizes.push_back(size);
+		max_sets += count;
+	}
+	
 	if (create_info.combined_image_sampler_count) {
 		const auto count = create_info.combined_image_sampler_count.value();
 		const auto size = vk::DescriptorPoolSize{}
@@ -39,6 +49,14 @@ DescriptorPool::Impl::~Impl()
 {
 }
 
+auto DescriptorPool::Impl::allocate(vk::Device device,
+									vk::DescriptorSetAllocateInfo const& allocate_info)
+	-> std::vector<vk::UniqueDescriptorSet>
+{
+	std::scoped_lock lock(mutex);
+	return device.allocateDescriptorSetsUnique(allocate_info);
+}
+
 
 DescriptorPool::DescriptorPool(DescriptorPoolCreateInfo const& create_info,
 							   Render::Context& context)
@@ -3,12 +3,23 @@
 #include <VulkanRenderer/DescriptorPool.hpp>
 #include "ContextImpl.hpp"
 
+#include <mutex>
+
 class DescriptorPool::Impl 
 {
 public:
     explicit Impl(DescriptorPoolCreateInfo const& create_info,
 				  Render::Context::Impl* context);
     ~Impl();
+
+	/**
+	 * Allocate sets while holding the pool mutex,
+	 * a vkDescriptorPool must never be used by two threads at once.
+	 */
+	auto allocate(vk::Device device,
+				  vk::DescriptorSetAllocateInfo const& allocate_info)
+		-> std::vector<vk::UniqueDescriptorSet>;
 	
 	vk::UniqueDescriptorPool descriptor_pool;
+	std::mutex mutex;
 };
@@ -0,0 +1,305 @@
+#include "DeviceAllocator.hpp"
+#include "Utils.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <format>
+
+DeviceAllocation::~DeviceAllocation()
+{
+	if (m_allocator != nullptr)
+		m_allocator->free(*this);
+}
+
+DeviceAllocation::DeviceAllocation(DeviceAllocation&& rhs) noexcept
+{
+	std::swap(m_allocator, rhs.m_allocator);
+	std::swap(m_memory, rhs.m_memory);
+	std::swap(m_offset, rhs.m_offset);
+	std::swap(m_size, rhs.m_size);
+	std::swap(m_mapped, rhs.m_mapped);
+	std::swap(m_block, rhs.m_block);
+	std::swap(m_order, rhs.m_order);
+}
+
+DeviceAllocation& DeviceAllocation::operator=(DeviceAllocation&& rhs) noexcept
+{
+	std::swap(m_allocator, rhs.m_allocator);
+	std::swap(m_memory, rhs.m_memory);
+	std::swap(m_offset, rhs.m_offset);
+	std::swap(m_size, rhs.m_size);
+	std::swap(m_mapped, rhs.m_mapped);
+	std::swap(m_block, rhs.m_block);
+	std::swap(m_order, rhs.m_order);
+	return *this;
+}
+
+vk::DeviceMemory DeviceAllocation::memory() const noexcept
+{
+	return m_memory;
+}
+
+vk::DeviceSize DeviceAllocation::offset() const noexcept
+{
+	return m_offset;
+}
+
+vk::DeviceSize DeviceAllocation::size() const noexcept
+{
+	return m_size;
+}
+
+void* DeviceAllocation::mapped() const noexcept
+{
+	return m_mapped;
+}
+
+
+DeviceAllocator::DeviceAllocator(Logger logger,
+								 vk::PhysicalDevice physical_device,
+								 vk::Device device,
+								 vk::DeviceSize block_size)
+	: m_logger(logger)
+	, m_device(device)
+	, m_memory_properties(physical_device.getMemoryProperties())
+	, m_block_size(std::bit_floor(std::max(block_size, min_allocation_size)))
+	, m_max_order(std::countr_zero(m_block_size / min_allocation_size))
+{
+	m_logger.info(std::source_location::current(),
+				  std::format("Created DeviceAllocator with {} byte blocks, {} memory types",
+							  m_block_size,
+							  m_memory_properties.memoryTypeCount));
+}
+
+DeviceAllocator::~DeviceAllocator()
+{
+	if (m_allocation_count > 0) {
+		m_logger.warn(std::source_location::current(),
+					  std::format("DeviceAllocator destroyed with {} live allocations",
+								  m_allocation_count));
+	}
+}
+
+auto DeviceAllocator::memory_properties() const noexcept
+	-> vk::PhysicalDeviceMemoryProperties const&
+{
+	return m_memory_properties;
+}
+
+vk::Device DeviceAllocator::device() const noexcept
+{
+	return m_device;
+}
+
+auto DeviceAllocator::map_if_host_visible(vk::DeviceMemory memory, uint32_t memory_type)
+	-> std::byte*
+{
+	const auto flags = m_memory_properties.memoryTypes[memory_type].propertyFlags;
+	if (!(flags & vk::MemoryPropertyFlagBits::eHostVisible))
+		return nullptr;
+
+	// NOTE a vkDeviceMemory can only be mapped once,
+	//      so the whole range is mapped for the lifetime of the memory.
+	return static_cast<std::byte*>(m_device.mapMemory(memory,
+													  0,
+													  VK_WHOLE_SIZE,
+													  vk::MemoryMapFlags()));
+}
+
+auto DeviceAllocator::allocate(vk::MemoryRequirements const& requirements,
+							   vk::MemoryPropertyFlags properties,
+							   AllocationKind kind)
+	-> DeviceAllocation
+{
+	const uint32_t memory_type = findMemoryType(m_memory_properties,
+												requirements.memoryTypeBits,
+												properties);
+
+	const vk::DeviceSize size = std::max(requirements.size, requirements.alignment);
+	if (kind == AllocationKind::Dedicated || size > m_block_size / 2)
+		return allocate_dedicated(requirements.size, memory_type);
+
+	uint32_t order = 0;
+	while ((min_allocation_size << order) < size)
+		order++;
+
+	std::scoped_lock lock(m_mutex);
+
+	std::optional<vk::DeviceSize> offset{std::nullopt};
+	uint32_t block_index = 0;
+	for (; block_index < m_blocks.size(); block_index++) {
+		Block const& block = m_blocks[block_index];
+		if (!block.memory || block.memory_type != memory_type || block.kind != kind)
+			continue;
+		offset = allocate_from_block(block_index, order);
+		if (offset.has_value())
+			break;
+	}
+
+	if (!offset.has_value()) {
+		block_index = create_block(memory_type, kind);
+		offset = allocate_from_block(block_index, order);
+	}
+
+	Block& block = m_blocks[block_index];
+	DeviceAllocation allocation{};
+	allocation.m_allocator = this;
+	allocation.m_memory = block.memory.get();
+	allocation.m_offset = offset.value();
+	allocation.m_size = requirements.size;
+	allocation.m_mapped = block.mapped ? block.mapped + offset.value() : nullptr;
+	allocation.m_block = block_index;
+	allocation.m_order = order;
+
+	m_used += requirements.size;
+	m_allocation_count++;
+	return allocation;
+}
+
+auto DeviceAllocator::allocate_dedicated(vk::DeviceSize size, uint32_t memory_type)
+	-> DeviceAllocation
+{
+	const auto allocate_info = vk::MemoryAllocateInfo{}
+		.setAllocationSize(size)
+		.setMemoryTypeIndex(memory_type);
+	vk::DeviceMemory memory = m_device.allocateMemory(allocate_info, nullptr);
+
+	DeviceAllocation allocation{};
+	allocation.m_allocator = this;
+	allocation.m_memory = memory;
+	allocation.m_offset = 0;
+	allocation.m_size = size;
+	allocation.m_mapped = map_if_host_visible(memory, memory_type);
+	allocation.m_block = dedicated_block;
+
+	std::scoped_lock lock(m_mutex);
+	m_used += size;
+	m_dedicated_reserved += size;
+	m_dedicated_count++;
+	m_allocation_count++;
+	return allocation;
+}
+
+auto DeviceAllocator::create_block(uint32_t memory_type, AllocationKind kind)
+	-> uint32_t
+{
+	uint32_t block_index = 0;
+	while (block_index < m_blocks.size() && m_blocks[block_index].memory)
+		block_index++;
+	if (block_index == m_blocks.size())
+		m_blocks.emplace_back();
+
+	const auto allocate_info = vk::MemoryAllocateInfo{}
+		.setAllocationSize(m_block_size)
+		.setMemoryTypeIndex(memory_type);
+
+	Block& block = m_blocks[block_index];
+	block.memory_type = memory_type;
+	block.kind = kind;
+	block.memory = m_device.allocateMemoryUnique(allocate_info, nullptr);
+	block.mapped = map_if_host_visible(block.memory.get(), memory_type);
+	block.used = 0;
+	block.free_lists.clear();
+	block.free_lists.resize(m_max_order + 1);
+	block.free_lists[m_max_order].insert(0);
+
+	m_logger.info(std::source_location::current(),
+				  std::format("DeviceAllocator created block {} for memory type {} ({})",
+							  block_index,
+							  memory_type,
+							  kind == AllocationKind::Linear ? "linear" : "optimal"));
+	return block_index;
+}
+
+auto DeviceAllocator::allocate_from_block(uint32_t block_index, uint32_t order)
+	-> std::optional<vk::DeviceSize>
+{
+	Block& block = m_blocks[block_index];
+
+	uint32_t current = order;
+	while (current <= m_max_order && block.free_lists[current].empty())
+		current++;
+	if (current > m_max_order)
+		return std::nullopt;
+
+	const vk::DeviceSize offset = *block.free_lists[current].begin();
+	block.free_lists[current].erase(block.free_lists[current].begin());
+
+	// split down to the requested order, keeping the upper halves free
+	while (current > order) {
+		current--;
+		block.free_lists[current].insert(offset + (min_allocation_size << current));
+	}
+
+	block.used += min_allocation_size << order;
+	return offset;
+}
+
+void DeviceAllocator::free(DeviceAllocation& allocation) noexcept
+{
+	std::scoped_lock lock(m_mutex);
+	m_used -= allocation.m_size;
+	m_allocation_count--;
+
+	if (allocation.m_block == dedicated_block) {
+		m_device.freeMemory(allocation.m_memory, nullptr);
+		m_dedicated_reserved -= allocation.m_size;
+		m_dedicated_count--;
+		allocation.m_allocator = nullptr;
+		return;
+	}
+
+	Block& block = m_blocks[allocation.m_block];
+	uint32_t order = allocation.m_order;
+	vk::DeviceSize offset = allocation.m_offset;
+	block.used -= min_allocation_size << order;
+
+	// merge with the buddy as long as it is free as well
+	while (order < m_max_order) {
+		const vk::DeviceSize buddy = offset ^ (min_allocation_size << order);
+		auto found = block.free_lists[order].find(buddy);
+		if (found == block.free_lists[order].end())
+			break;
+		block.free_lists[order].erase(found);
+		offset = std::min(offset, buddy);
+		order++;
+	}
+	block.free_lists[order].insert(offset);
+	allocation.m_allocator = nullptr;
+
+	if (block.used > 0)
+		return;
+
+	// NOTE keep one empty block per memory type and kind around,
+	//      so a single resource being recreated does not allocate every time.
+	const bool has_sibling = std::any_of(m_blocks.begin(), m_blocks.end(),
+										 [&] (Block const& other) {
+											 return &other != &block
+												 && other.memory
+												 && other.memory_type == block.memory_type
+												 && other.kind == block.kind;
+										 });
+	if (has_sibling) {
+		block.memory.reset();
+		block.mapped = nullptr;
+		block.free_lists.clear();
+	}
+}
+
+auto DeviceAllocator::stats()
+	-> MemoryStats
+{
+	std::scoped_lock lock(m_mutex);
+	MemoryStats stats{};
+	for (Block const& block: m_blocks) {
+		if (!block.memory)
+			continue;
+		stats.block_count++;
+		stats.reserved_bytes += m_block_size;
+	}
+	stats.reserved_bytes += m_dedicated_reserved;
+	stats.used_bytes = m_used;
+	stats.dedicated_count = m_dedicated_count;
+	stats.allocation_count = m_allocation_count;
+	return stats;
+}
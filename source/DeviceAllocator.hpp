@@ -0,0 +1,157 @@
+#pragma once
+
+#include <VulkanRenderer/Context.hpp>
+
+#include <vulkan/vulkan.hpp>
+
+#include <cstddef>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <vector>
+
+class DeviceAllocator;
+
+/**
+ * Describes how a resource is going to live in device memory.
+ * Linear and Optimal resources are never placed in the same block so that
+ * bufferImageGranularity never has to be considered between neighbours.
+ * Dedicated resources get their own vkDeviceMemory.
+ */
+enum class AllocationKind
+{
+	Linear,
+	Optimal,
+	Dedicated,
+};
+
+/**
+ * A range of device memory handed out by the DeviceAllocator.
+ * The range is returned to the allocator when the allocation is destroyed,
+ * so it has to be destroyed after the resource that is bound to it.
+ */
+class DeviceAllocation
+{
+public:
+	DeviceAllocation() = default;
+	~DeviceAllocation();
+
+	DeviceAllocation(DeviceAllocation const&) = delete;
+	DeviceAllocation& operator=(DeviceAllocation const&) = delete;
+	DeviceAllocation(DeviceAllocation&& rhs) noexcept;
+	DeviceAllocation& operator=(DeviceAllocation&& rhs) noexcept;
+
+	[[nodiscard]]
+	vk::DeviceMemory memory() const noexcept;
+	[[nodiscard]]
+	vk::DeviceSize offset() const noexcept;
+	[[nodiscard]]
+	vk::DeviceSize size() const noexcept;
+
+	/**
+	 * Host pointer to the start of the allocation,
+	 * nullptr if the memory is not host visible.
+	 */
+	[[nodiscard]]
+	void* mapped() const noexcept;
+
+private:
+	friend class DeviceAllocator;
+
+	DeviceAllocator* m_allocator{nullptr};
+	vk::DeviceMemory m_memory{};
+	vk::DeviceSize m_offset{0};
+	vk::DeviceSize m_size{0};
+	std::byte* m_mapped{nullptr};
+	// NOTE index into the allocators blocks, or dedicated_block for dedicated memory
+	uint32_t m_block{0};
+	uint32_t m_order{0};
+};
+
+/**
+ * Sub-allocates device memory out of large blocks instead of calling
+ * vkAllocateMemory per resource, which is both slow and limited by
+ * maxMemoryAllocationCount.
+ *
+ * Every block is managed as a buddy allocator, allocations are rounded up to a
+ * power of two which also satisfies any alignment smaller than the allocation.
+ * Blocks are created per memory type and AllocationKind, host visible blocks are
+ * persistently mapped.
+ */
+class DeviceAllocator
+{
+public:
+	DeviceAllocator(Logger logger,
+					vk::PhysicalDevice physical_device,
+					vk::Device device,
+					vk::DeviceSize block_size);
+	~DeviceAllocator();
+
+	DeviceAllocator(DeviceAllocator&) = delete;
+	DeviceAllocator& operator=(DeviceAllocator&) = delete;
+
+	[[nodiscard]]
+	auto allocate(vk::MemoryRequirements const& requirements,
+				  vk::MemoryPropertyFlags properties,
+				  AllocationKind kind)
+		-> DeviceAllocation;
+
+	[[nodiscard]]
+	auto stats()
+		-> MemoryStats;
+
+	[[nodiscard]]
+	auto memory_properties() const noexcept
+		-> vk::PhysicalDeviceMemoryProperties const&;
+
+	[[nodiscard]]
+	vk::Device device() const noexcept;
+
+	static uint32_t constexpr dedicated_block = ~0u;
+
+private:
+	friend class DeviceAllocation;
+
+	struct Block
+	{
+		uint32_t memory_type{0};
+		AllocationKind kind{AllocationKind::Linear};
+		vk::UniqueDeviceMemory memory;
+		std::byte* mapped{nullptr};
+		vk::DeviceSize used{0};
+		// NOTE free offsets per buddy order, order 0 is min_allocation_size
+		std::vector<std::set<vk::DeviceSize>> free_lists;
+	};
+
+	auto create_block(uint32_t memory_type, AllocationKind kind)
+		-> uint32_t;
+
+	auto allocate_dedicated(vk::DeviceSize size, uint32_t memory_type)
+		-> DeviceAllocation;
+
+	auto allocate_from_block(uint32_t block_index, uint32_t order)
+		-> std::optional<vk::DeviceSize>;
+
+	void free(DeviceAllocation& allocation) noexcept;
+
+	auto map_if_host_visible(vk::DeviceMemory memory, uint32_t memory_type)
+		-> std::byte*;
+
+	static vk::DeviceSize constexpr min_allocation_size = 256;
+
+	Logger m_logger;
+	vk::Device m_device;
+	vk::PhysicalDeviceMemoryProperties m_memory_properties;
+	vk::DeviceSize m_block_size{0};
+	uint32_t m_max_order{0};
+
+	// NOTE blocks are never erased, only their memory is released when empty,
+	//      so allocations can refer to them by index.
+	std::vector<Block> m_blocks;
+	vk::DeviceSize m_used{0};
+	vk::DeviceSize m_dedicated_reserved{0};
+	uint32_t m_dedicated_count{0};
+	uint32_t m_allocation_count{0};
+
+	std::mutex m_mutex;
+};
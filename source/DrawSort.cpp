@@ -0,0 +1,75 @@
+#include "DrawSort.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+
+namespace
+{
+
+uint32_t constexpr pipeline_bits = 4;
+uint32_t constexpr field_bits = 20;
+uint64_t constexpr field_mask = (uint64_t{1} << field_bits) - 1;
+uint64_t constexpr pipeline_mask = (uint64_t{1} << pipeline_bits) - 1;
+
+}
+
+auto quantize_depth(float view_depth)
+	-> uint32_t
+{
+	// NOTE behind the camera and NaN both end up at the front
+	if (!(view_depth > 0.0f))
+		return 0;
+	// NOTE the largest finite float shifted down still fits in 20 bits
+	return std::bit_cast<uint32_t>(view_depth) >> (32 - field_bits - 1);
+}
+
+auto make_draw_key(DrawOrder order,
+				   uint32_t pipeline,
+				   uint32_t material,
+				   uint32_t mesh,
+				   uint32_t quantized_depth)
+	-> uint64_t
+{
+	// NOTE ids past the field width wrap around, which only makes the sort less effective
+	const uint64_t p = pipeline & pipeline_mask;
+	const uint64_t m = material & field_mask;
+	const uint64_t v = mesh & field_mask;
+	const uint64_t d = quantized_depth & field_mask;
+
+	switch (order) {
+	case DrawOrder::FrontToBack:
+		return (p << (3 * field_bits)) | (d << (2 * field_bits)) | (m << field_bits) | v;
+	case DrawOrder::State:
+	default:
+		return (p << (3 * field_bits)) | (m << (2 * field_bits)) | (v << field_bits) | d;
+	}
+}
+
+void radix_sort(std::vector<DrawKey>& keys,
+				std::vector<DrawKey>& scratch)
+{
+	uint32_t constexpr digit_bits = 8;
+	uint32_t constexpr digits = 1 << digit_bits;
+
+	scratch.resize(keys.size());
+	for (uint32_t shift = 0; shift < 64; shift += digit_bits) {
+		std::array<size_t, digits> counts{};
+		for (DrawKey const& key: keys)
+			counts[(key.key >> shift) & (digits - 1)]++;
+
+		if (std::ranges::any_of(counts, [&] (size_t count) { return count == keys.size(); }))
+			continue;
+
+		size_t offset = 0;
+		for (size_t& count: counts) {
+			const size_t c = count;
+			count = offset;
+			offset += c;
+		}
+
+		for (DrawKey const& key: keys)
+			scratch[counts[(key.key >> shift) & (digits - 1)]++] = key;
+		std::swap(keys, scratch);
+	}
+}
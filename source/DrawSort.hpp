@@ -0,0 +1,182 @@
+#pragma once
+
+#include <VulkanRenderer/glm.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * Draws are sorted by packed 64 bit keys before recording, so draws sharing
+ * a material and mesh end up next to each other and are recorded without rebinding.
+ *
+ * Key layout, most significant bits first:
+ *   DrawOrder::State        pipeline 4 | material 20 | mesh 20 | depth 20
+ *   DrawOrder::FrontToBack  pipeline 4 | depth 20 | material 20 | mesh 20
+ */
+enum class DrawOrder
+{
+	State,
+	// NOTE for opaque geometry, nearer draws first lets early depth testing reject more
+	FrontToBack,
+};
+
+struct DrawKey
+{
+	uint64_t key;
+	uint32_t index;
+};
+
+/**
+ * The distance along the view direction quantized to 20 bits.
+ * Positive floats order the same as their bit patterns, so the top bits are kept.
+ */
+[[nodiscard]]
+auto quantize_depth(float view_depth)
+	-> uint32_t;
+
+[[nodiscard]]
+auto make_draw_key(DrawOrder order,
+				   uint32_t pipeline,
+				   uint32_t material,
+				   uint32_t mesh,
+				   uint32_t quantized_depth)
+	-> uint64_t;
+
+/**
+ * Stable LSD radix sort on the keys, 8 bits per pass.
+ * Passes where every key has the same digit are skipped.
+ */
+void radix_sort(std::vector<DrawKey>& keys,
+				std::vector<DrawKey>& scratch);
+
+/**
+ * Dense ids in first seen order, so pointers fit into the fields of a key.
+ */
+template<typename Key, typename Hash = std::hash<Key>>
+class DrawIds
+{
+public:
+	explicit DrawIds(Hash hash = Hash{})
+		: m_ids(0, std::move(hash))
+	{
+	}
+
+	auto id(Key const& key)
+		-> uint32_t
+	{
+		auto [it, inserted] = m_ids.try_emplace(key, static_cast<uint32_t>(m_ids.size()));
+		return it->second;
+	}
+
+private:
+	std::unordered_map<Key, uint32_t, Hash> m_ids;
+};
+
+struct DrawSortStatistics
+{
+	uint32_t draws{0};
+	uint32_t unsorted_binds{0};
+	uint32_t sorted_binds{0};
+};
+
+/**
+ * Material and mesh binds needed to record renderables in their current order,
+ * every change of either counts as one bind.
+ */
+template<typename Renderable, typename MaterialOf>
+[[nodiscard]]
+auto count_binds(std::vector<Renderable> const& renderables,
+				 MaterialOf material_of)
+	-> uint32_t
+{
+	uint32_t binds = 0;
+	for (size_t i = 0; i < renderables.size(); i++) {
+		if (i == 0 || !(material_of(renderables[i]) == material_of(renderables[i - 1])))
+			binds++;
+		if (i == 0 || renderables[i].mesh != renderables[i - 1].mesh)
+			binds++;
+	}
+	return binds;
+}
+
+/**
+ * The draw keys of renderables in sorted order, the index of every key
+ * is the position of its renderable.
+ * material_of maps a renderable to a hashable material, all renderables
+ * of a pipeline without textures can return the same value.
+ */
+template<typename Renderable,
+		 typename MaterialOf,
+		 typename Material = std::invoke_result_t<MaterialOf, Renderable const&>,
+		 typename MaterialHash = std::hash<Material>>
+[[nodiscard]]
+auto sorted_draw_keys(std::vector<Renderable> const& renderables,
+					  DrawOrder order,
+					  uint32_t pipeline,
+					  glm::mat4 const& view,
+					  MaterialOf material_of,
+					  MaterialHash material_hash = MaterialHash{})
+	-> std::vector<DrawKey>
+{
+	DrawIds<Material, MaterialHash> materials(std::move(material_hash));
+	DrawIds<void const*> meshes{};
+
+	std::vector<DrawKey> keys{};
+	keys.reserve(renderables.size());
+	for (uint32_t i = 0; i < renderables.size(); i++) {
+		Renderable const& renderable = renderables[i];
+		// NOTE the camera looks down -z, the translation is the origin of the model
+		const float view_depth = -(view * renderable.model[3]).z;
+		keys.push_back(DrawKey{
+			make_draw_key(order,
+						  pipeline,
+						  materials.id(material_of(renderable)),
+						  meshes.id(renderable.mesh),
+						  quantize_depth(view_depth)),
+			i});
+	}
+
+	std::vector<DrawKey> scratch{};
+	radix_sort(keys, scratch);
+	return keys;
+}
+
+/**
+ * Reorder renderables by their draw keys.
+ */
+template<typename Renderable,
+		 typename MaterialOf,
+		 typename Material = std::invoke_result_t<MaterialOf, Renderable const&>,
+		 typename MaterialHash = std::hash<Material>>
+auto sort_draws(std::vector<Renderable>& renderables,
+				DrawOrder order,
+				uint32_t pipeline,
+				glm::mat4 const& view,
+				MaterialOf material_of,
+				MaterialHash material_hash = MaterialHash{})
+	-> DrawSortStatistics
+{
+	DrawSortStatistics statistics{};
+	statistics.draws = static_cast<uint32_t>(renderables.size());
+	statistics.unsorted_binds = count_binds(renderables, material_of);
+
+	if (renderables.size() > 1) {
+		const std::vector<DrawKey> keys = sorted_draw_keys(renderables,
+														   order,
+														   pipeline,
+														   view,
+														   material_of,
+														   material_hash);
+		std::vector<Renderable> sorted{};
+		sorted.reserve(renderables.size());
+		for (DrawKey const& key: keys)
+			sorted.push_back(renderables[key.index]);
+		renderables = std::move(sorted);
+	}
+
+	statistics.sorted_binds = count_binds(renderables, material_of);
+	return statistics;
+}
@@ -0,0 +1,182 @@
+#include "FrustumCull.hpp"
+
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define FRUSTUM_CULL_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace
+{
+
+// NOTE large enough to reach every plane, small enough that |n| * extent stays finite
+float constexpr unbounded_extent = 1.0e30f;
+
+auto box_inside(Frustum const& frustum,
+				float cx, float cy, float cz,
+				float ex, float ey, float ez)
+	-> bool
+{
+	for (glm::vec4 const& plane: frustum.planes) {
+		const float distance = plane.x * cx + plane.y * cy + plane.z * cz + plane.w;
+		const float radius = std::abs(plane.x) * ex
+			+ std::abs(plane.y) * ey
+			+ std::abs(plane.z) * ez;
+		// NOTE written so NaN is outside, the same as the SSE comparison
+		if (!(distance + radius >= 0.0f))
+			return false;
+	}
+	return true;
+}
+
+}
+
+auto frustum_from_view_projection(glm::mat4 const& view_projection)
+	-> Frustum
+{
+	// NOTE glm is column major, m[column][row]
+	glm::mat4 const& m = view_projection;
+	const auto row = [&] (int r) {
+		return glm::vec4(m[0][r], m[1][r], m[2][r], m[3][r]);
+	};
+
+	Frustum frustum{};
+	frustum.planes[0] = row(3) + row(0); // left
+	frustum.planes[1] = row(3) - row(0); // right
+	frustum.planes[2] = row(3) + row(1); // bottom
+	frustum.planes[3] = row(3) - row(1); // top
+	frustum.planes[4] = row(2);          // near, depth starts at 0
+	frustum.planes[5] = row(3) - row(2); // far
+	return frustum;
+}
+
+void CullBoxes::reserve(size_t count)
+{
+	center_x.reserve(count);
+	center_y.reserve(count);
+	center_z.reserve(count);
+	extent_x.reserve(count);
+	extent_y.reserve(count);
+	extent_z.reserve(count);
+}
+
+auto CullBoxes::size() const noexcept
+	-> size_t
+{
+	return center_x.size();
+}
+
+void CullBoxes::push(std::optional<MeshBounds> const& bounds,
+					 glm::mat4 const& model)
+{
+	center_x.push_back(0.0f);
+	center_y.push_back(0.0f);
+	center_z.push_back(0.0f);
+	extent_x.push_back(0.0f);
+	extent_y.push_back(0.0f);
+	extent_z.push_back(0.0f);
+	set(size() - 1, bounds, model);
+}
+
+void CullBoxes::set(size_t index,
+					std::optional<MeshBounds> const& bounds,
+					glm::mat4 const& model)
+{
+	if (!bounds.has_value()) {
+		center_x[index] = model[3].x;
+		center_y[index] = model[3].y;
+		center_z[index] = model[3].z;
+		extent_x[index] = unbounded_extent;
+		extent_y[index] = unbounded_extent;
+		extent_z[index] = unbounded_extent;
+		return;
+	}
+
+	/* The world space box around the transformed object space box,
+	 * every world axis gets the absolute contribution of each object axis.
+	 */
+	const glm::vec3 center = (bounds->min + bounds->max) * 0.5f;
+	const glm::vec3 extent = (bounds->max - bounds->min) * 0.5f;
+	const glm::vec4 world_center = model * glm::vec4(center, 1.0f);
+
+	glm::vec3 world_extent{0.0f};
+	for (int axis = 0; axis < 3; axis++) {
+		world_extent[axis] = std::abs(model[0][axis]) * extent.x
+			+ std::abs(model[1][axis]) * extent.y
+			+ std::abs(model[2][axis]) * extent.z;
+	}
+
+	center_x[index] = world_center.x;
+	center_y[index] = world_center.y;
+	center_z[index] = world_center.z;
+	extent_x[index] = world_extent.x;
+	extent_y[index] = world_extent.y;
+	extent_z[index] = world_extent.z;
+}
+
+void cull_boxes(Frustum const& frustum,
+				CullBoxes const& boxes,
+				std::vector<uint32_t>& visible)
+{
+	const uint32_t count = static_cast<uint32_t>(boxes.size());
+	uint32_t i = 0;
+
+#ifdef FRUSTUM_CULL_SSE
+	struct SplatPlane
+	{
+		__m128 x, y, z, w;
+		__m128 abs_x, abs_y, abs_z;
+	};
+	std::array<SplatPlane, 6> planes{};
+	for (size_t p = 0; p < planes.size(); p++) {
+		glm::vec4 const& plane = frustum.planes[p];
+		planes[p] = SplatPlane{
+			_mm_set1_ps(plane.x),
+			_mm_set1_ps(plane.y),
+			_mm_set1_ps(plane.z),
+			_mm_set1_ps(plane.w),
+			_mm_set1_ps(std::abs(plane.x)),
+			_mm_set1_ps(std::abs(plane.y)),
+			_mm_set1_ps(std::abs(plane.z)),
+		};
+	}
+
+	const __m128 zero = _mm_setzero_ps();
+	for (; i + 4 <= count; i += 4) {
+		const __m128 cx = _mm_loadu_ps(boxes.center_x.data() + i);
+		const __m128 cy = _mm_loadu_ps(boxes.center_y.data() + i);
+		const __m128 cz = _mm_loadu_ps(boxes.center_z.data() + i);
+		const __m128 ex = _mm_loadu_ps(boxes.extent_x.data() + i);
+		const __m128 ey = _mm_loadu_ps(boxes.extent_y.data() + i);
+		const __m128 ez = _mm_loadu_ps(boxes.extent_z.data() + i);
+
+		__m128 inside = _mm_cmpeq_ps(zero, zero);
+		for (SplatPlane const& plane: planes) {
+			__m128 distance = _mm_add_ps(_mm_mul_ps(plane.x, cx), plane.w);
+			distance = _mm_add_ps(distance, _mm_mul_ps(plane.y, cy));
+			distance = _mm_add_ps(distance, _mm_mul_ps(plane.z, cz));
+
+			__m128 radius = _mm_mul_ps(plane.abs_x, ex);
+			radius = _mm_add_ps(radius, _mm_mul_ps(plane.abs_y, ey));
+			radius = _mm_add_ps(radius, _mm_mul_ps(plane.abs_z, ez));
+
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, radius), zero));
+		}
+
+		const int mask = _mm_movemask_ps(inside);
+		for (uint32_t lane = 0; lane < 4; lane++) {
+			if (mask & (1 << lane))
+				visible.push_back(i + lane);
+		}
+	}
+#endif
+
+	// NOTE the boxes left over after the last full group of four
+	for (; i < count; i++) {
+		if (box_inside(frustum,
+					   boxes.center_x[i], boxes.center_y[i], boxes.center_z[i],
+					   boxes.extent_x[i], boxes.extent_y[i], boxes.extent_z[i]))
+			visible.push_back(i);
+	}
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <VulkanRenderer/glm.hpp>
+#include <VulkanRenderer/VertexBuffer.hpp>
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+/**
+ * The six planes of a view projection, with the normals pointing inwards.
+ * Extracted for the [0, 1] depth range the renderer uses, the planes are not
+ * normalized since only the sign of the distance to them is tested.
+ */
+struct Frustum
+{
+	std::array<glm::vec4, 6> planes;
+};
+
+[[nodiscard]]
+auto frustum_from_view_projection(glm::mat4 const& view_projection)
+	-> Frustum;
+
+/**
+ * World space boxes of renderables, stored as a structure of arrays
+ * so the frustum test loads the same component of four boxes at once.
+ */
+struct CullBoxes
+{
+	std::vector<float> center_x;
+	std::vector<float> center_y;
+	std::vector<float> center_z;
+	std::vector<float> extent_x;
+	std::vector<float> extent_y;
+	std::vector<float> extent_z;
+
+	void reserve(size_t count);
+
+	[[nodiscard]]
+	auto size() const noexcept
+		-> size_t;
+
+	// NOTE a mesh without bounds is pushed as a box that is never outside a plane
+	void push(std::optional<MeshBounds> const& bounds,
+			  glm::mat4 const& model);
+
+	// NOTE replaces the box at index, for renderables that moved
+	void set(size_t index,
+			 std::optional<MeshBounds> const& bounds,
+			 glm::mat4 const& model);
+};
+
+/**
+ * Append the indices of the boxes that are at least partly inside frustum to visible,
+ * in increasing order. Four boxes are tested per iteration with SSE when available.
+ */
+void cull_boxes(Frustum const& frustum,
+				CullBoxes const& boxes,
+				std::vector<uint32_t>& visible);
+
+struct CullStatistics
+{
+	uint32_t visible{0};
+	uint32_t culled{0};
+};
+
+/**
+ * Copy the renderables inside frustum to visible, in the order they are in.
+ * boxes holds the box of every renderable at the same index.
+ */
+template<typename Renderable>
+auto cull_renderables(std::vector<Renderable> const& renderables,
+					  CullBoxes const& boxes,
+					  Frustum const& frustum,
+					  std::vector<Renderable>& visible)
+	-> CullStatistics
+{
+	std::vector<uint32_t> indices{};
+	indices.reserve(renderables.size());
+	cull_boxes(frustum, boxes, indices);
+
+	visible.clear();
+	visible.reserve(indices.size());
+	for (uint32_t index: indices)
+		visible.push_back(renderables[index]);
+
+	CullStatistics statistics{};
+	statistics.visible = static_cast<uint32_t>(indices.size());
+	statistics.culled = static_cast<uint32_t>(renderables.size() - indices.size());
+	return statistics;
+}
@@ -0,0 +1,292 @@
+#include "GpuCulling.hpp"
+
+#include <algorithm>
+#include <format>
+
+GpuCullPipeline::GpuCullPipeline(Logger logger,
+								 vk::Device device,
+								 PipelineCache* pipeline_cache,
+								 std::filesystem::path const shader_root_path)
+{
+	const std::filesystem::path computeshader_name = "FrustumCull.comp.spv";
+	logger.info(std::source_location::current(),
+				std::format("Compute Shader {}",
+							computeshader_name.string()));
+
+	const auto comp =
+		read_binary_file((shader_root_path / computeshader_name).string().c_str());
+	if (!comp) {
+		const auto msg = "COULD NOT LOAD COMPUTE SHADER BINARY";
+		logger.fatal(std::source_location::current(), msg);
+		throw std::runtime_error(msg);
+	}
+
+	const auto module_info = vk::ShaderModuleCreateInfo{}
+		.setFlags(vk::ShaderModuleCreateFlags())
+		.setCode(*comp);
+	vk::UniqueShaderModule compute_module = device.createShaderModuleUnique(module_info);
+
+	// NOTE objects, indirect commands and the culled instances
+	std::array<vk::DescriptorSetLayoutBinding, 3> bindings{};
+	for (uint32_t binding = 0; binding < bindings.size(); binding++) {
+		bindings[binding] = vk::DescriptorSetLayoutBinding{}
+			.setStageFlags(vk::ShaderStageFlagBits::eCompute)
+			.setBinding(binding)
+			.setDescriptorCount(1)
+			.setDescriptorType(vk::DescriptorType::eStorageBuffer);
+	}
+
+	const auto set_info = vk::DescriptorSetLayoutCreateInfo{}
+		.setFlags(vk::DescriptorSetLayoutCreateFlags())
+		.setBindings(bindings);
+	m_set_layout = device.createDescriptorSetLayoutUnique(set_info, nullptr);
+
+	const auto push_constant_range = vk::PushConstantRange{}
+		.setOffset(0)
+		.setSize(sizeof(GpuCullPushConstants))
+		.setStageFlags(vk::ShaderStageFlagBits::eCompute);
+
+	const auto layout_info = vk::PipelineLayoutCreateInfo{}
+		.setFlags(vk::PipelineLayoutCreateFlags())
+		.setSetLayouts(m_set_layout.get())
+		.setPushConstantRanges(push_constant_range);
+	m_layout = device.createPipelineLayoutUnique(layout_info);
+
+	const auto pipeline_info = vk::ComputePipelineCreateInfo{}
+		.setStage(vk::PipelineShaderStageCreateInfo{}
+				  .setStage(vk::ShaderStageFlagBits::eCompute)
+				  .setModule(compute_module.get())
+				  .setPName("main"))
+		.setLayout(m_layout.get());
+
+	vk::ResultValue<vk::UniquePipeline> result =
+		device.createComputePipelineUnique(pipeline_cache->get(), pipeline_info);
+	if (result.result != vk::Result::eSuccess) {
+		const auto msg = std::format("Creating FrustumCull pipeline error: {}",
+									 vk::to_string(result.result));
+		logger.fatal(std::source_location::current(), msg);
+		throw std::runtime_error(msg);
+	}
+
+	m_pipeline = std::move(result.value);
+	logger.info(std::source_location::current(), "Created FrustumCull Pipeline");
+}
+
+vk::DescriptorSetLayout GpuCullPipeline::set_layout() const noexcept
+{
+	return m_set_layout.get();
+}
+
+vk::PipelineLayout GpuCullPipeline::layout() const noexcept
+{
+	return m_layout.get();
+}
+
+vk::Pipeline GpuCullPipeline::pipeline() const noexcept
+{
+	return m_pipeline.get();
+}
+
+GpuCullPass::GpuCullPass(Logger logger,
+						 vk::Device device,
+						 DeviceAllocator& allocator,
+						 GpuCullPipeline* pipeline)
+	: m_logger(logger)
+	, m_device(device)
+	, m_allocator(&allocator)
+	, m_pipeline(pipeline)
+{
+	const uint32_t set_count = m_frames.size();
+	const auto pool_size = vk::DescriptorPoolSize{}
+		.setType(vk::DescriptorType::eStorageBuffer)
+		.setDescriptorCount(3 * set_count);
+
+	const auto pool_info = vk::DescriptorPoolCreateInfo{}
+		.setFlags(vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet)
+		.setMaxSets(set_count)
+		.setPoolSizes(pool_size);
+	m_pool = m_device.createDescriptorPoolUnique(pool_info, nullptr);
+
+	for (FrameBuffers& frame: m_frames) {
+		const vk::DescriptorSetLayout set_layout = m_pipeline->set_layout();
+		const auto allocate_info = vk::DescriptorSetAllocateInfo{}
+			.setDescriptorPool(m_pool.get())
+			.setDescriptorSetCount(1)
+			.setSetLayouts(set_layout);
+		auto sets = m_device.allocateDescriptorSetsUnique(allocate_info);
+		frame.set = std::move(sets[0]);
+	}
+}
+
+void GpuCullPass::reserve(uint32_t object_count, uint32_t command_count)
+{
+	FrameBuffers& frame = m_frames[m_current];
+
+	// NOTE reserved once the frame fence was waited on, the set is rewritten before the next dispatch
+	const bool objects_grown = frame.objects.reserve(*m_allocator,
+													 object_count,
+													 sizeof(GpuCullObject));
+	const bool commands_grown = frame.commands.reserve(*m_allocator,
+													   command_count,
+													   sizeof(vk::DrawIndexedIndirectCommand),
+													   vk::BufferUsageFlagBits::eIndirectBuffer);
+	if (!objects_grown && !commands_grown)
+		return;
+
+	if (objects_grown) {
+		frame.instances = allocate_memory(*m_allocator,
+										  frame.objects.capacity * sizeof(glm::mat4),
+										  vk::BufferUsageFlagBits::eStorageBuffer
+										  | vk::BufferUsageFlagBits::eVertexBuffer,
+										  vk::MemoryPropertyFlagBits::eDeviceLocal);
+		// NOTE the new object buffer is empty, the objects have to be written again
+		frame.version = 0;
+	}
+	frame.object_count = 0;
+	frame.command_count = 0;
+
+	const std::array<vk::DescriptorBufferInfo, 3> buffer_infos{
+		frame.objects.descriptor_info(),
+		frame.commands.descriptor_info(),
+
+		vk::DescriptorBufferInfo{}
+		.setBuffer(frame.instances.buffer.get())
+		.setOffset(0)
+		.setRange(VK_WHOLE_SIZE),
+	};
+
+	std::array<vk::WriteDescriptorSet, 3> writes{};
+	for (uint32_t binding = 0; binding < writes.size(); binding++) {
+		writes[binding] = vk::WriteDescriptorSet{}
+			.setDstBinding(binding)
+			.setDstSet(frame.set.get())
+			.setDstArrayElement(0)
+			.setDescriptorCount(1)
+			.setDescriptorType(vk::DescriptorType::eStorageBuffer)
+			.setBufferInfo(buffer_infos[binding]);
+	}
+	m_device.updateDescriptorSets(writes.size(), writes.data(), 0, nullptr);
+
+	m_logger.info(std::source_location::current(),
+				  std::format("GpuCullPass grown to {} objects and {} commands",
+							  frame.objects.capacity,
+							  frame.commands.capacity));
+}
+
+void GpuCullPass::upload(CurrentFlightFrame current_flightframe,
+						 Frustum const& frustum)
+{
+	m_current = current_flightframe.get();
+	FrameBuffers& frame = m_frames[m_current];
+
+	/* Read back what the gpu culled the last time this frame was used,
+	 * the frame fence has been waited on so the counts are final.
+	 */
+	if (frame.command_count > 0) {
+		auto const* culled = static_cast<vk::DrawIndexedIndirectCommand const*>(
+			frame.commands.memory.allocation.mapped());
+		uint32_t visible = 0;
+		for (uint32_t i = 0; i < frame.command_count; i++)
+			visible += culled[i].instanceCount;
+		m_statistics = CullStatistics{visible, frame.object_count - visible};
+	}
+
+	reserve(m_objects.size(), m_commands.size());
+
+	// NOTE the commands are written every frame, the shader counts the instances into them
+	const bool objects_written = m_version != 0 && frame.version == m_version;
+	frame.object_count = m_objects.size();
+	frame.command_count = m_commands.size();
+	if (!m_objects.empty()) {
+		if (!objects_written) {
+			copy_to_allocated_memory(frame.objects.memory,
+									 m_objects.data(),
+									 m_objects.size() * sizeof(GpuCullObject));
+		}
+		copy_to_allocated_memory(frame.commands.memory,
+								 m_commands.data(),
+								 m_commands.size() * sizeof(vk::DrawIndexedIndirectCommand));
+	}
+	frame.version = m_version;
+
+	m_push.planes = frustum.planes;
+	m_push.object_count = frame.object_count;
+}
+
+void GpuCullPass::dispatch(vk::CommandBuffer& commandbuffer)
+{
+	FrameBuffers& frame = m_frames[m_current];
+	if (frame.object_count == 0)
+		return;
+
+	commandbuffer.bindPipeline(vk::PipelineBindPoint::eCompute,
+							   m_pipeline->pipeline());
+
+	const vk::DescriptorSet set = frame.set.get();
+	commandbuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute,
+									 m_pipeline->layout(),
+									 0,
+									 1,
+									 &set,
+									 0,
+									 nullptr);
+
+	commandbuffer.pushConstants(m_pipeline->layout(),
+								vk::ShaderStageFlagBits::eCompute,
+								0,
+								sizeof(m_push),
+								&m_push);
+
+	const uint32_t groups = (frame.object_count + GpuCullPipeline::workgroup_size - 1)
+		/ GpuCullPipeline::workgroup_size;
+	commandbuffer.dispatch(groups, 1, 1);
+}
+
+auto GpuCullPass::batches() const noexcept
+	-> std::vector<InstanceBatch> const&
+{
+	return m_batches;
+}
+
+void GpuCullPass::draw(vk::CommandBuffer& commandbuffer,
+					   uint32_t batch,
+					   IndexBuffer& indexbuffer)
+{
+	FrameBuffers& frame = m_frames[m_current];
+
+	// NOTE binding at the batch offset keeps firstInstance at 0,
+	//      which does not need the drawIndirectFirstInstance feature.
+	const vk::Buffer instances = frame.instances.buffer.get();
+	const vk::DeviceSize instance_offset = m_batches[batch].first * sizeof(glm::mat4);
+	commandbuffer.bindVertexBuffers(instance_binding, 1, &instances, &instance_offset);
+
+	record_draw_indirect(commandbuffer,
+						 indexbuffer,
+						 frame.commands.memory.buffer.get(),
+						 batch * sizeof(vk::DrawIndexedIndirectCommand));
+}
+
+void record_gpu_cull_barrier(vk::CommandBuffer& commandbuffer)
+{
+	// NOTE the host reads the instance counts back once the frame fence is signaled
+	const auto barrier = vk::MemoryBarrier{}
+		.setSrcAccessMask(vk::AccessFlagBits::eShaderWrite)
+		.setDstAccessMask(vk::AccessFlagBits::eIndirectCommandRead
+						  | vk::AccessFlagBits::eVertexAttributeRead
+						  | vk::AccessFlagBits::eHostRead);
+
+	commandbuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+								  vk::PipelineStageFlagBits::eDrawIndirect
+								  | vk::PipelineStageFlagBits::eVertexInput
+								  | vk::PipelineStageFlagBits::eHost,
+								  vk::DependencyFlags(),
+								  barrier,
+								  nullptr,
+								  nullptr);
+}
+
+auto GpuCullPass::statistics() const noexcept
+	-> CullStatistics
+{
+	return m_statistics;
+}
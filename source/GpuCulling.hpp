@@ -0,0 +1,250 @@
+#pragma once
+
+#include "Utils.hpp"
+#include "FlightFrames.hpp"
+#include "PipelineCache.hpp"
+#include "FrustumCull.hpp"
+#include "InstanceBatch.hpp"
+#include "IndexBufferImpl.hpp"
+#include "StorageBuffer.hpp"
+
+#include <vulkan/vulkan.hpp>
+
+#include <filesystem>
+
+/**
+ * Frustum culling on the gpu, for passes with more objects than are worth culling
+ * on the cpu every frame.
+ *
+ * The objects of a pass are uploaded with their model and object space box,
+ * grouped into the same batches instanced drawing uses. A compute shader tests
+ * every object against the frustum and appends the model of each visible one to
+ * the instances of its batch, counting them into the instanceCount of the batch's
+ * indirect command. Passes then draw every batch with one indirect draw,
+ * reading the compacted models from the instance binding.
+ */
+struct GpuCullObject
+{
+	glm::mat4 model;
+	glm::vec4 box_min;
+	glm::vec4 box_max;
+	// NOTE index of the indirect command of the batch, and the batches first instance slot
+	uint32_t command;
+	uint32_t first;
+	uint32_t _padding[2];
+};
+
+struct GpuCullPushConstants
+{
+	std::array<glm::vec4, 6> planes;
+	uint32_t object_count;
+};
+
+/**
+ * The compute pipeline shared by every GpuCullPass.
+ */
+class GpuCullPipeline
+{
+public:
+	GpuCullPipeline(Logger logger,
+					vk::Device device,
+					PipelineCache* pipeline_cache,
+					std::filesystem::path const shader_root_path);
+
+	GpuCullPipeline(GpuCullPipeline&) = delete;
+	GpuCullPipeline& operator=(GpuCullPipeline&) = delete;
+
+	[[nodiscard]]
+	vk::DescriptorSetLayout set_layout() const noexcept;
+
+	[[nodiscard]]
+	vk::PipelineLayout layout() const noexcept;
+
+	[[nodiscard]]
+	vk::Pipeline pipeline() const noexcept;
+
+	uint32_t static constexpr workgroup_size = 64;
+
+private:
+	vk::UniqueDescriptorSetLayout m_set_layout;
+	vk::UniquePipelineLayout m_layout;
+	vk::UniquePipeline m_pipeline;
+};
+
+/**
+ * The buffers one pass is culled into, a set per frame in flight.
+ * prepare is called before recording, dispatch is recorded into the frame
+ * commandbuffer before the renderpass of the pass begins, and draw is recorded
+ * inside the pass for every batch.
+ */
+class GpuCullPass
+{
+public:
+	GpuCullPass(Logger logger,
+				vk::Device device,
+				DeviceAllocator& allocator,
+				GpuCullPipeline* pipeline);
+
+	GpuCullPass(GpuCullPass&) = delete;
+	GpuCullPass& operator=(GpuCullPass&) = delete;
+
+	/**
+	 * Write the objects and the zero instance commands of renderables.
+	 * The renderables are expected to be sorted, so share_batch groups equal draws.
+	 * A version other than 0 identifies the renderables, the objects of a flight frame
+	 * are then only built and written again after the version changed.
+	 */
+	template<typename Renderable, typename ShareBatch>
+	void prepare(CurrentFlightFrame current_flightframe,
+				 std::vector<Renderable> const& renderables,
+				 ShareBatch share_batch,
+				 Frustum const& frustum,
+				 uint64_t version = 0)
+	{
+		if (version != 0 && version == m_version) {
+			upload(current_flightframe, frustum);
+			return;
+		}
+
+		// NOTE a mesh without bounds is given a box that is never outside a plane
+		float constexpr unbounded = 1.0e30f;
+
+		m_objects.clear();
+		m_commands.clear();
+		m_batches.clear();
+		m_objects.reserve(renderables.size());
+
+		for (uint32_t i = 0; i < renderables.size(); i++) {
+			Renderable const& renderable = renderables[i];
+			if (i > 0 && share_batch(renderables[i - 1], renderables[i])) {
+				m_batches.back().count++;
+			}
+			else {
+				m_batches.push_back(InstanceBatch{i, 1});
+				m_commands.push_back(draw_indirect_command(renderable.mesh->vertexbuffer,
+														  renderable.mesh->indexbuffer));
+			}
+
+			const std::optional<MeshBounds> bounds = renderable.mesh->bounds();
+			GpuCullObject object{};
+			object.model = renderable.model;
+			object.box_min = bounds.has_value() ? glm::vec4(bounds->min, 1.0f) : glm::vec4(-unbounded);
+			object.box_max = bounds.has_value() ? glm::vec4(bounds->max, 1.0f) : glm::vec4(unbounded);
+			object.command = static_cast<uint32_t>(m_batches.size() - 1);
+			object.first = m_batches.back().first;
+			m_objects.push_back(object);
+		}
+
+		m_version = version;
+		upload(current_flightframe, frustum);
+	}
+
+	void dispatch(vk::CommandBuffer& commandbuffer);
+
+	[[nodiscard]]
+	auto batches() const noexcept
+		-> std::vector<InstanceBatch> const&;
+
+	/**
+	 * Bind the culled instances of batch and draw it with its indirect command.
+	 * The mesh buffers of the batch have to be bound already.
+	 */
+	void draw(vk::CommandBuffer& commandbuffer,
+			  uint32_t batch,
+			  IndexBuffer& indexbuffer);
+
+	/**
+	 * Visible and culled objects, read back from the last time the current
+	 * flight frame was culled, so a few frames behind.
+	 */
+	[[nodiscard]]
+	auto statistics() const noexcept
+		-> CullStatistics;
+
+private:
+	void upload(CurrentFlightFrame current_flightframe,
+				Frustum const& frustum);
+
+	void reserve(uint32_t object_count, uint32_t command_count);
+
+	struct FrameBuffers
+	{
+		GrowableStorageBuffer objects;
+		// NOTE host visible as well, the instance counts are read back for the statistics
+		GrowableStorageBuffer commands;
+		// NOTE device local, sized for the capacity of the objects
+		AllocatedMemory instances;
+		uint32_t object_count{0};
+		uint32_t command_count{0};
+		// NOTE the version of the objects in this frames buffer, 0 when they have to be written
+		uint64_t version{0};
+		vk::UniqueDescriptorSet set;
+	};
+
+	Logger m_logger;
+	vk::Device m_device;
+	DeviceAllocator* m_allocator{nullptr};
+	GpuCullPipeline* m_pipeline{nullptr};
+	vk::UniqueDescriptorPool m_pool;
+	FlightFramesArray<FrameBuffers> m_frames;
+	uint32_t m_current{0};
+	GpuCullPushConstants m_push{};
+	// NOTE kept between frames, so unchanged renderables do not have to be batched again
+	std::vector<GpuCullObject> m_objects;
+	std::vector<vk::DrawIndexedIndirectCommand> m_commands;
+	std::vector<InstanceBatch> m_batches;
+	uint64_t m_version{0};
+	CullStatistics m_statistics{};
+};
+
+/**
+ * Record the depth only draws of renderables, shared by the passes that only write depth.
+ * With gpu_cull every batch is drawn with the commands it culled into, the renderables are
+ * then the ones the cull pass was prepared with. Without it consecutive renderables of the
+ * same mesh are drawn instanced, no matter their material.
+ */
+template<typename Renderable>
+void record_depth_draws(vk::CommandBuffer& commandbuffer,
+						InstanceRing& instances,
+						std::vector<Renderable> const& renderables,
+						GpuCullPass* gpu_cull)
+{
+	if (gpu_cull != nullptr) {
+		std::vector<InstanceBatch> const& batches = gpu_cull->batches();
+		for (uint32_t batch = 0; batch < batches.size(); batch++) {
+			Renderable const& renderable = renderables[batches[batch].first];
+			bind_mesh_buffers(commandbuffer,
+							  renderable.mesh->vertexbuffer,
+							  renderable.mesh->indexbuffer);
+			gpu_cull->draw(commandbuffer, batch, renderable.mesh->indexbuffer);
+		}
+		return;
+	}
+
+	const InstanceBatches batches =
+		batch_instances(instances,
+						renderables,
+						[] (Renderable const& lhs, Renderable const& rhs) {
+							return lhs.mesh == rhs.mesh;
+						});
+	bind_instances(commandbuffer, batches);
+
+	for (InstanceBatch const& batch: batches.batches) {
+		Renderable const& renderable = renderables[batch.first];
+		bind_mesh_buffers(commandbuffer,
+						  renderable.mesh->vertexbuffer,
+						  renderable.mesh->indexbuffer);
+
+		record_draw(commandbuffer,
+					renderable.mesh->vertexbuffer,
+					renderable.mesh->indexbuffer,
+					batch.count,
+					batch.first);
+	}
+}
+
+/**
+ * Make the culled commands and instances of every dispatched GpuCullPass
+ * visible to the draws that read them, recorded once after all dispatches.
+ */
+void record_gpu_cull_barrier(vk::CommandBuffer& commandbuffer);
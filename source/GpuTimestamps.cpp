@@ -0,0 +1,110 @@
+#include "GpuTimestamps.hpp"
+
+#include <array>
+#include <format>
+
+GpuTimestamps::GpuTimestamps(Logger logger,
+							 vk::PhysicalDevice physical_device,
+							 vk::Device device,
+							 uint32_t queue_family_index,
+							 MaxFlightFrames max_flightframes,
+							 uint32_t capacity)
+	: m_logger(logger)
+	, m_device(device)
+	, m_capacity(capacity)
+{
+	const auto families = physical_device.getQueueFamilyProperties();
+	const uint32_t valid_bits = families[queue_family_index].timestampValidBits;
+	if (valid_bits == 0) {
+		m_logger.warn(std::source_location::current(),
+					  "The graphics queue can not write timestamps, no gpu timings are measured");
+		return;
+	}
+
+	m_period = physical_device.getProperties().limits.timestampPeriod;
+	m_valid_mask = valid_bits >= 64 ? ~uint64_t{0} : (uint64_t{1} << valid_bits) - 1;
+
+	const auto pool_info = vk::QueryPoolCreateInfo{}
+		.setQueryType(vk::QueryType::eTimestamp)
+		.setQueryCount(2 * m_capacity);
+
+	for (uint32_t i = 0; i < *max_flightframes; i++)
+		m_frames[i].pool = m_device.createQueryPoolUnique(pool_info);
+
+	m_logger.info(std::source_location::current(),
+				  std::format("Created gpu timestamps for {} timings, {} ns per tick",
+							  m_capacity,
+							  m_period));
+}
+
+void GpuTimestamps::begin_frame(CurrentFlightFrame current_flightframe,
+								std::vector<RendererTiming>& timings)
+{
+	timings.clear();
+	Frame& frame = m_frames[current_flightframe.get()];
+	if (!frame.pool)
+		return;
+
+	/* Every timing is read with the availability of its queries, those that were
+	 * reserved but never written are not available and are skipped.
+	 */
+	for (uint32_t timing = 0; timing < frame.names.size(); timing++) {
+		std::array<uint64_t, 4> results{};
+		const uint32_t first_query = 2 * timing;
+		const uint32_t query_count = 2;
+		const vk::DeviceSize stride = 2 * sizeof(uint64_t);
+		const vk::Result result =
+			m_device.getQueryPoolResults(frame.pool.get(),
+										 first_query,
+										 query_count,
+										 sizeof(results),
+										 results.data(),
+										 stride,
+										 vk::QueryResultFlagBits::e64
+										 | vk::QueryResultFlagBits::eWithAvailability);
+		const bool available = results[1] != 0 && results[3] != 0;
+		if ((result != vk::Result::eSuccess && result != vk::Result::eNotReady) || !available)
+			continue;
+
+		const uint64_t ticks = (results[2] - results[0]) & m_valid_mask;
+		timings.push_back(RendererTiming{frame.names[timing],
+										 static_cast<double>(ticks) * m_period / 1.0e6});
+	}
+	frame.names.clear();
+}
+
+void GpuTimestamps::reset(vk::CommandBuffer& commandbuffer,
+						  CurrentFlightFrame current_flightframe)
+{
+	Frame const& frame = m_frames[current_flightframe.get()];
+	if (!frame.pool)
+		return;
+	commandbuffer.resetQueryPool(frame.pool.get(), 0, 2 * m_capacity);
+}
+
+auto GpuTimestamps::add(CurrentFlightFrame current_flightframe, std::string name)
+	-> std::optional<uint32_t>
+{
+	Frame& frame = m_frames[current_flightframe.get()];
+	if (!frame.pool || frame.names.size() >= m_capacity)
+		return std::nullopt;
+
+	frame.names.push_back(std::move(name));
+	return static_cast<uint32_t>(frame.names.size() - 1);
+}
+
+void GpuTimestamps::begin(vk::CommandBuffer& commandbuffer,
+						  CurrentFlightFrame current_flightframe,
+						  uint32_t timing)
+{
+	vk::QueryPool pool = m_frames[current_flightframe.get()].pool.get();
+	commandbuffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, pool, 2 * timing);
+}
+
+void GpuTimestamps::end(vk::CommandBuffer& commandbuffer,
+						CurrentFlightFrame current_flightframe,
+						uint32_t timing)
+{
+	vk::QueryPool pool = m_frames[current_flightframe.get()].pool.get();
+	commandbuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, pool, 2 * timing + 1);
+}
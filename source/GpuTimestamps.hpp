@@ -0,0 +1,80 @@
+#pragma once
+
+#include <VulkanRenderer/Renderer.hpp>
+
+#include "FlightFrames.hpp"
+
+#include <vulkan/vulkan.hpp>
+
+#include <optional>
+#include <string>
+#include <vector>
+
+/**
+ * Gpu time spent between two timestamps written into the commandbuffer of a frame,
+ * every flight frame has its own query pool. The timings are read back once the
+ * flight frame comes around again, so a few frames late.
+ */
+class GpuTimestamps
+{
+public:
+	GpuTimestamps(Logger logger,
+				  vk::PhysicalDevice physical_device,
+				  vk::Device device,
+				  uint32_t queue_family_index,
+				  MaxFlightFrames max_flightframes,
+				  uint32_t capacity);
+
+	GpuTimestamps(GpuTimestamps&) = delete;
+	GpuTimestamps& operator=(GpuTimestamps&) = delete;
+
+	/**
+	 * Read back the timings the flight frame wrote the last time it was used into timings,
+	 * expected once the fence of the flight frame has been waited on.
+	 * Timings that were not written, like those of a culled pass, are left out.
+	 */
+	void begin_frame(CurrentFlightFrame current_flightframe,
+					 std::vector<RendererTiming>& timings);
+
+	/**
+	 * Reset every query of the flight frame, recorded outside of any renderpass before
+	 * the timings of the frame are written. Timings whose passes were culled are left
+	 * unavailable, so they are not read back.
+	 */
+	void reset(vk::CommandBuffer& commandbuffer,
+			   CurrentFlightFrame current_flightframe);
+
+	/**
+	 * Reserve a timing in the flight frame, nothing when the queue can not write
+	 * timestamps or the flight frame has no timings left.
+	 */
+	[[nodiscard]]
+	auto add(CurrentFlightFrame current_flightframe, std::string name)
+		-> std::optional<uint32_t>;
+
+	/**
+	 * Write the begin and end of timing, both outside of any renderpass and after the reset.
+	 */
+	void begin(vk::CommandBuffer& commandbuffer,
+			   CurrentFlightFrame current_flightframe,
+			   uint32_t timing);
+	void end(vk::CommandBuffer& commandbuffer,
+			 CurrentFlightFrame current_flightframe,
+			 uint32_t timing);
+
+private:
+	struct Frame
+	{
+		vk::UniqueQueryPool pool;
+		// NOTE the timings reserved in the frame, every one is a begin and an end query
+		std::vector<std::string> names;
+	};
+
+	Logger m_logger;
+	vk::Device m_device;
+	uint32_t m_capacity{0};
+	// NOTE nanoseconds per tick, 0 when the queue can not write timestamps
+	double m_period{0.0};
+	uint64_t m_valid_mask{0};
+	FlightFramesArray<Frame> m_frames;
+};
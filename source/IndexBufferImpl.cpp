@@ -0,0 +1,138 @@
+#include "IndexBufferImpl.hpp"
+
+IndexBuffer::Impl::Impl(Render::Context::Impl* context,
+						const uint32_t* indices,
+						size_t indices_length)
+{
+	length = indices_length;
+
+	const vk::DeviceSize size = indices_length * sizeof(uint32_t);
+	memory = allocate_memory(*context->allocator,
+							 size,
+							 vk::BufferUsageFlagBits::eIndexBuffer
+							 | vk::BufferUsageFlagBits::eTransferDst,
+							 vk::MemoryPropertyFlagBits::eDeviceLocal);
+	upload = context->upload_queue->upload_to_buffer(memory.buffer.get(),
+													 0,
+													 indices,
+													 size,
+													 vk::PipelineStageFlagBits::eVertexInput,
+													 vk::AccessFlagBits::eIndexRead);
+}
+
+void bind_mesh_buffers(vk::CommandBuffer& commandbuffer,
+					   VertexBuffer& vertexbuffer,
+					   IndexBuffer& indexbuffer)
+{
+	const uint32_t firstBinding = 0;
+	const uint32_t bindingCount = 1;
+	std::array<vk::DeviceSize, bindingCount> offsets = {0};
+	std::array<vk::Buffer, bindingCount> buffers {
+		vertexbuffer.impl->memory.buffer.get(),
+	};
+	commandbuffer.bindVertexBuffers(firstBinding,
+									bindingCount,
+									buffers.data(),
+									offsets.data());
+
+	if (!indexbuffer.impl)
+		return;
+
+	const vk::DeviceSize offset = 0;
+	commandbuffer.bindIndexBuffer(indexbuffer.impl->memory.buffer.get(),
+								  offset,
+								  vk::IndexType::eUint32);
+}
+
+void record_draw(vk::CommandBuffer& commandbuffer,
+				 VertexBuffer& vertexbuffer,
+				 IndexBuffer& indexbuffer,
+				 const uint32_t instance_count,
+				 const uint32_t first_instance)
+{
+	if (!indexbuffer.impl) {
+		const uint32_t firstVertex = 0;
+		commandbuffer.draw(vertexbuffer.impl->length,
+						   instance_count,
+						   firstVertex,
+						   first_instance);
+		return;
+	}
+
+	const uint32_t firstIndex = 0;
+	const int32_t vertexOffset = 0;
+	commandbuffer.drawIndexed(indexbuffer.impl->length,
+							  instance_count,
+							  firstIndex,
+							  vertexOffset,
+							  first_instance);
+}
+
+auto draw_indirect_command(VertexBuffer& vertexbuffer,
+						   IndexBuffer& indexbuffer)
+	-> vk::DrawIndexedIndirectCommand
+{
+	const uint32_t count = indexbuffer.impl
+		? static_cast<uint32_t>(indexbuffer.impl->length)
+		: static_cast<uint32_t>(vertexbuffer.impl->length);
+
+	return vk::DrawIndexedIndirectCommand{}
+		.setIndexCount(count)
+		.setInstanceCount(0)
+		.setFirstIndex(0)
+		.setVertexOffset(0)
+		.setFirstInstance(0);
+}
+
+void record_draw_indirect(vk::CommandBuffer& commandbuffer,
+						  IndexBuffer& indexbuffer,
+						  vk::Buffer commands,
+						  vk::DeviceSize offset)
+{
+	const uint32_t draw_count = 1;
+	if (!indexbuffer.impl) {
+		commandbuffer.drawIndirect(commands,
+								   offset,
+								   draw_count,
+								   sizeof(vk::DrawIndirectCommand));
+		return;
+	}
+
+	commandbuffer.drawIndexedIndirect(commands,
+									  offset,
+									  draw_count,
+									  sizeof(vk::DrawIndexedIndirectCommand));
+}
+
+
+IndexBuffer::IndexBuffer() {}
+
+IndexBuffer::IndexBuffer(Render::Context& context,
+						 const uint32_t* indices,
+						 size_t indices_length)
+	: impl(std::make_unique<Impl>(context.impl.get(),
+								  indices,
+								  indices_length))
+{
+}
+
+auto IndexBuffer::upload_ticket()
+	const noexcept -> UploadTicket
+{
+	return impl->upload;
+}
+	
+IndexBuffer::IndexBuffer(IndexBuffer&& rhs)
+{
+	std::swap(impl, rhs.impl);
+}
+
+IndexBuffer::~IndexBuffer() 
+{
+}
+
+IndexBuffer& IndexBuffer::operator=(IndexBuffer&& rhs)
+{
+	std::swap(impl, rhs.impl);
+	return *this;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <VulkanRenderer/IndexBuffer.hpp>
+#include "VertexBufferImpl.hpp"
+
+struct IndexBuffer::Impl
+{
+	Impl(Render::Context::Impl* context,
+		 const uint32_t* indices,
+		 size_t indices_length);
+	
+	AllocatedMemory memory;
+	size_t length;
+	UploadTicket upload{};
+};
+
+/**
+ * Bind the vertex buffer of a mesh, and its index buffer if it has one.
+ * Draws of the same mesh only need this once.
+ */
+void bind_mesh_buffers(vk::CommandBuffer& commandbuffer,
+					   VertexBuffer& vertexbuffer,
+					   IndexBuffer& indexbuffer);
+
+/**
+ * Draw the buffers bound by bind_mesh_buffers, through the index buffer if the mesh has one.
+ * Meshes created without indices fall back to a plain vertex draw.
+ */
+void record_draw(vk::CommandBuffer& commandbuffer,
+				 VertexBuffer& vertexbuffer,
+				 IndexBuffer& indexbuffer,
+				 const uint32_t instance_count,
+				 const uint32_t first_instance);
+
+/**
+ * The command record_draw would draw the mesh with, without any instances.
+ * A plain vertex draw keeps its vertex count in indexCount, both commands
+ * store instanceCount in their second word so a shader can fill in either.
+ */
+auto draw_indirect_command(VertexBuffer& vertexbuffer,
+						   IndexBuffer& indexbuffer)
+	-> vk::DrawIndexedIndirectCommand;
+
+/**
+ * Draw the buffers bound by bind_mesh_buffers with a command made by draw_indirect_command.
+ */
+void record_draw_indirect(vk::CommandBuffer& commandbuffer,
+						  IndexBuffer& indexbuffer,
+						  vk::Buffer commands,
+						  vk::DeviceSize offset);
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "InstanceRing.hpp"
+#include "VertexImpl.hpp"
+
+#include <vector>
+
+/**
+ * A run of consecutive renderables drawn as one instanced draw,
+ * first is both the index of the first renderable and its firstInstance.
+ */
+struct InstanceBatch
+{
+	uint32_t first;
+	uint32_t count;
+};
+
+struct InstanceBatches
+{
+	// NOTE the instance data in the instance ring, bound once per pass
+	InstanceRing::Allocation instances{};
+	std::vector<InstanceBatch> batches;
+};
+
+/**
+ * Write the models of renderables to the instance ring as one array, and split
+ * them into runs that share_batch allows to be drawn together.
+ * The renderables are expected to be sorted, so equal draws are next to each other.
+ */
+template<typename Renderable, typename ShareBatch>
+auto batch_instances(InstanceRing& instances,
+					 std::vector<Renderable> const& renderables,
+					 ShareBatch share_batch)
+	-> InstanceBatches
+{
+	InstanceBatches result{};
+	if (renderables.empty())
+		return result;
+
+	std::vector<InstanceData> data{};
+	data.reserve(renderables.size());
+	for (uint32_t i = 0; i < renderables.size(); i++) {
+		data.push_back(InstanceData{renderables[i].model});
+		if (i > 0 && share_batch(renderables[i - 1], renderables[i]))
+			result.batches.back().count++;
+		else
+			result.batches.push_back(InstanceBatch{i, 1});
+	}
+
+	result.instances = instances.push(data.data(), data.size() * sizeof(InstanceData));
+	return result;
+}
+
+/**
+ * Bind the instance data of batches to the instance binding.
+ */
+inline void bind_instances(vk::CommandBuffer& commandbuffer,
+						   InstanceBatches const& batches)
+{
+	commandbuffer.bindVertexBuffers(instance_binding,
+									1,
+									&batches.instances.buffer,
+									&batches.instances.offset);
+}
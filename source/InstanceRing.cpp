@@ -0,0 +1,93 @@
+#include "InstanceRing.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <format>
+
+namespace
+{
+
+// NOTE vertex buffer offsets only need to be aligned to the attributes
+vk::DeviceSize constexpr instance_alignment = 16;
+
+auto align_instances(vk::DeviceSize size)
+	-> vk::DeviceSize
+{
+	return (size + instance_alignment - 1) / instance_alignment * instance_alignment;
+}
+
+}
+
+InstanceRing::InstanceRing(Logger logger,
+						   DeviceAllocator& allocator,
+						   vk::DeviceSize frame_size,
+						   uint32_t frames_in_flight)
+	: m_logger(logger)
+	, m_allocator(&allocator)
+{
+	for (uint32_t i = 0; i < frames_in_flight; i++)
+		add_block(m_frames[i], align_instances(frame_size));
+
+	m_logger.info(std::source_location::current(),
+				  std::format("Created InstanceRing with {} frames of {} bytes",
+							  frames_in_flight,
+							  align_instances(frame_size)));
+}
+
+void InstanceRing::add_block(Frame& frame, vk::DeviceSize size)
+{
+	Block block{};
+	block.memory = allocate_memory(*m_allocator,
+								   size,
+								   vk::BufferUsageFlagBits::eVertexBuffer,
+								   // Host Visible and Coherent allows direct
+								   // writes into the buffers without sync issues.
+								   vk::MemoryPropertyFlagBits::eHostVisible
+								   | vk::MemoryPropertyFlagBits::eHostCoherent);
+	block.size = size;
+	frame.blocks.push_back(std::move(block));
+	frame.head = 0;
+}
+
+void InstanceRing::begin_frame(CurrentFlightFrame current_flightframe)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_current = current_flightframe.get();
+	Frame& frame = m_frames[m_current];
+
+	// NOTE the fence of the frame has been waited on, so none of its blocks are in use
+	if (frame.blocks.size() > 1) {
+		vk::DeviceSize total = 0;
+		for (Block const& block: frame.blocks)
+			total += block.size;
+		frame.blocks.clear();
+		add_block(frame, total);
+
+		m_logger.info(std::source_location::current(),
+					  std::format("InstanceRing frame {} grown to {} bytes",
+								  m_current,
+								  total));
+	}
+	frame.head = 0;
+}
+
+auto InstanceRing::push(void const* data, vk::DeviceSize size)
+	-> Allocation
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	Frame& frame = m_frames[m_current];
+
+	// NOTE the earlier blocks stay bound by the passes recorded into them
+	const vk::DeviceSize reserved = align_instances(size);
+	if (frame.head + reserved > frame.blocks.back().size)
+		add_block(frame, std::max(reserved, frame.blocks.back().size));
+
+	Block& block = frame.blocks.back();
+	const vk::DeviceSize offset = frame.head;
+	frame.head += reserved;
+	if (size > 0) {
+		auto* mapped = static_cast<std::byte*>(block.memory.allocation.mapped());
+		memcpy(mapped + offset, data, size);
+	}
+	return Allocation{block.memory.buffer.get(), offset};
+}
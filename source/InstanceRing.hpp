@@ -0,0 +1,67 @@
+#pragma once
+
+#include "Utils.hpp"
+#include "FlightFrames.hpp"
+
+#include <mutex>
+#include <vector>
+
+/**
+ * Linear allocator for per-frame instance data, bound as a vertex buffer.
+ *
+ * Every frame in flight owns persistently mapped blocks, a push that does not fit
+ * the current block of the frame allocates another one instead of failing, so a frame
+ * holds any number of instances. The blocks already bound by recorded passes are kept
+ * until the frame is rewound, then they are replaced by a single block large enough
+ * for all of them, so the frame settles at a size after a few frames.
+ */
+class InstanceRing
+{
+public:
+	InstanceRing(Logger logger,
+				 DeviceAllocator& allocator,
+				 vk::DeviceSize frame_size,
+				 uint32_t frames_in_flight);
+
+	InstanceRing(InstanceRing&) = delete;
+	InstanceRing& operator=(InstanceRing&) = delete;
+
+	void begin_frame(CurrentFlightFrame current_flightframe);
+
+	// NOTE where a push was copied to, passed to bindVertexBuffers
+	struct Allocation
+	{
+		vk::Buffer buffer;
+		vk::DeviceSize offset{0};
+	};
+
+	/**
+	 * Copy size bytes into the current frame, valid until the frame is rewound.
+	 */
+	[[nodiscard]]
+	auto push(void const* data, vk::DeviceSize size)
+		-> Allocation;
+
+private:
+	struct Block
+	{
+		AllocatedMemory memory;
+		vk::DeviceSize size{0};
+	};
+
+	struct Frame
+	{
+		std::vector<Block> blocks;
+		// NOTE relative to the start of the last block
+		vk::DeviceSize head{0};
+	};
+
+	void add_block(Frame& frame, vk::DeviceSize size);
+
+	Logger m_logger;
+	DeviceAllocator* m_allocator{nullptr};
+	FlightFramesArray<Frame> m_frames;
+	uint32_t m_current{0};
+	// NOTE recording threads push concurrently, every pass pushes a single array so it is rarely contended
+	std::mutex m_mutex;
+};
@@ -0,0 +1,229 @@
+#include "LightBuffers.hpp"
+
+#include <cstddef>
+#include <cstring>
+#include <format>
+
+namespace
+{
+
+uint32_t constexpr light_binding_count = 5;
+uint32_t constexpr cluster_binding_count = 2;
+
+}
+
+LightBuffers::LightBuffers(Logger logger,
+						   vk::Device device,
+						   DeviceAllocator& allocator,
+						   bool clustered,
+						   LightClusterGrid grid)
+	: m_logger(logger)
+	, m_device(device)
+	, m_allocator(&allocator)
+	, m_clustered(clustered)
+	, m_clusters(grid)
+{
+	// NOTE point, spot and directional lights, the shadow casters,
+	//      then the clusters and light indices
+	const uint32_t binding_count = m_clustered
+		? light_binding_count + cluster_binding_count
+		: light_binding_count;
+
+	std::vector<vk::DescriptorSetLayoutBinding> bindings(binding_count);
+	for (uint32_t binding = 0; binding < bindings.size(); binding++) {
+		bindings[binding] = vk::DescriptorSetLayoutBinding{}
+			.setStageFlags(vk::ShaderStageFlagBits::eFragment)
+			.setBinding(binding)
+			.setDescriptorCount(1)
+			.setDescriptorType(vk::DescriptorType::eStorageBuffer);
+	}
+
+	const auto set_info = vk::DescriptorSetLayoutCreateInfo{}
+		.setFlags(vk::DescriptorSetLayoutCreateFlags())
+		.setBindings(bindings);
+	m_set_layout = m_device.createDescriptorSetLayoutUnique(set_info, nullptr);
+
+	const uint32_t set_count = m_frames.size();
+	const auto pool_size = vk::DescriptorPoolSize{}
+		.setType(vk::DescriptorType::eStorageBuffer)
+		.setDescriptorCount(binding_count * set_count);
+
+	const auto pool_info = vk::DescriptorPoolCreateInfo{}
+		.setFlags(vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet)
+		.setMaxSets(set_count)
+		.setPoolSizes(pool_size);
+	m_pool = m_device.createDescriptorPoolUnique(pool_info, nullptr);
+
+	for (uint32_t i = 0; i < m_frames.size(); i++) {
+		const vk::DescriptorSetLayout set_layout = m_set_layout.get();
+		const auto allocate_info = vk::DescriptorSetAllocateInfo{}
+			.setDescriptorPool(m_pool.get())
+			.setDescriptorSetCount(1)
+			.setSetLayouts(set_layout);
+		auto sets = m_device.allocateDescriptorSetsUnique(allocate_info);
+		m_frames[i].set = std::move(sets[0]);
+
+		// NOTE creates the buffers, the cluster buffer is sized for the grid once
+		m_current = i;
+		reserve(0, 0, 0, 0, 0, 0);
+	}
+	m_current = 0;
+}
+
+bool LightBuffers::clustered() const noexcept
+{
+	return m_clustered;
+}
+
+vk::DescriptorSetLayout LightBuffers::set_layout() const noexcept
+{
+	return m_set_layout.get();
+}
+
+vk::DescriptorSet LightBuffers::set(CurrentFlightFrame current_flightframe) const noexcept
+{
+	return m_frames[current_flightframe.get()].set.get();
+}
+
+void LightBuffers::reserve(uint32_t directional_count,
+						   uint32_t point_count,
+						   uint32_t spot_count,
+						   uint32_t directional_caster_count,
+						   uint32_t spot_caster_count,
+						   uint32_t index_count)
+{
+	FrameBuffers& frame = m_frames[m_current];
+	const bool created = static_cast<bool>(frame.points.memory.buffer);
+
+	// NOTE the buffers of this flight frame are no longer used by the gpu,
+	//      so they can be replaced and the set rewritten right away.
+	bool grown = false;
+	grown |= frame.points.reserve(*m_allocator, point_count, sizeof(PointLightUniformData));
+	grown |= frame.spots.reserve(*m_allocator, spot_count, sizeof(SpotLightUniformData));
+	grown |= frame.directionals.reserve(*m_allocator,
+										directional_count,
+										sizeof(DirectionalLightUniformData));
+	grown |= frame.directional_casters.reserve(*m_allocator,
+											   directional_caster_count,
+											   sizeof(DirectionalShadowCasterUniformData));
+	grown |= frame.spot_casters.reserve(*m_allocator,
+										spot_caster_count,
+										sizeof(SpotShadowCasterUniformData));
+	if (m_clustered) {
+		const auto cluster_size = static_cast<uint32_t>(sizeof(LightClusterHeader)
+			+ m_clusters.cluster_count() * sizeof(LightClusterRange));
+		grown |= frame.clusters.reserve(*m_allocator, cluster_size, sizeof(std::byte));
+		grown |= frame.indices.reserve(*m_allocator, index_count, sizeof(uint32_t));
+	}
+	if (!grown)
+		return;
+
+	std::vector<vk::DescriptorBufferInfo> buffer_infos{
+		frame.points.descriptor_info(),
+		frame.spots.descriptor_info(),
+		frame.directionals.descriptor_info(),
+		frame.directional_casters.descriptor_info(),
+		frame.spot_casters.descriptor_info(),
+	};
+	if (m_clustered) {
+		buffer_infos.push_back(frame.clusters.descriptor_info());
+		buffer_infos.push_back(frame.indices.descriptor_info());
+	}
+
+	std::vector<vk::WriteDescriptorSet> writes(buffer_infos.size());
+	for (uint32_t binding = 0; binding < writes.size(); binding++) {
+		writes[binding] = vk::WriteDescriptorSet{}
+			.setDstBinding(binding)
+			.setDstSet(frame.set.get())
+			.setDstArrayElement(0)
+			.setDescriptorCount(1)
+			.setDescriptorType(vk::DescriptorType::eStorageBuffer)
+			.setBufferInfo(buffer_infos[binding]);
+	}
+	m_device.updateDescriptorSets(writes.size(), writes.data(), 0, nullptr);
+
+	if (created) {
+		m_logger.info(std::source_location::current(),
+					  std::format("LightBuffers grown to {} point lights, {} spot lights,"
+								  " {} directional lights, {} shadow casters and {} light indices",
+								  frame.points.capacity,
+								  frame.spots.capacity,
+								  frame.directionals.capacity,
+								  frame.directional_casters.capacity + frame.spot_casters.capacity,
+								  frame.indices.capacity));
+	}
+}
+
+void LightBuffers::upload(CurrentFlightFrame current_flightframe,
+						  glm::mat4 const& view,
+						  glm::mat4 const& projection,
+						  vk::Extent2D extent,
+						  std::vector<DirectionalLight> const& directionals,
+						  std::vector<PointLight> const& points,
+						  std::vector<SpotLight> const& spots,
+						  ShadowCasters const& casters,
+						  ShadowAtlasLayout const& atlas,
+						  std::vector<std::vector<ShadowCascade>> const& cascades)
+{
+	m_current = current_flightframe.get();
+	if (m_clustered) {
+		m_clusters.build(view,
+						 projection,
+						 glm::uvec2(extent.width, extent.height),
+						 points,
+						 spots);
+	}
+
+	const uint32_t index_count = m_clustered
+		? static_cast<uint32_t>(m_clusters.indices().size())
+		: 0;
+	reserve(static_cast<uint32_t>(directionals.size()),
+			static_cast<uint32_t>(points.size()),
+			static_cast<uint32_t>(spots.size()),
+			static_cast<uint32_t>(casters.directional_casters.size()),
+			static_cast<uint32_t>(casters.spot_casters.size()),
+			index_count);
+	FrameBuffers& frame = m_frames[m_current];
+
+	// NOTE the lights are packed straight into the mapped buffers
+	auto* point_data = frame.points.mapped<PointLightUniformData>();
+	for (size_t i = 0; i < points.size(); i++)
+		point_data[i] = points[i];
+
+	auto* spot_data = frame.spots.mapped<SpotLightUniformData>();
+	for (size_t i = 0; i < spots.size(); i++)
+		spot_data[i] = spots[i];
+
+	auto* directional_data = frame.directionals.mapped<DirectionalLightUniformData>();
+	for (size_t i = 0; i < directionals.size(); i++)
+		directional_data[i] = directionals[i];
+
+	auto* directional_caster_data = frame.directional_casters.mapped<DirectionalShadowCasterUniformData>();
+	for (size_t i = 0; i < casters.directional_casters.size(); i++) {
+		std::vector<glm::vec4> atlas_rects{};
+		for (std::optional<ShadowAtlasRect> const& rect: atlas.directionals[i])
+			atlas_rects.push_back(atlas_uv_rect(atlas, rect));
+		directional_caster_data[i] = DirectionalShadowCasterUniformData(casters.directional_casters[i],
+																		cascades[i],
+																		atlas_rects);
+	}
+
+	auto* spot_caster_data = frame.spot_casters.mapped<SpotShadowCasterUniformData>();
+	for (size_t i = 0; i < casters.spot_casters.size(); i++) {
+		spot_caster_data[i] = SpotShadowCasterUniformData(casters.spot_casters[i],
+														  atlas_uv_rect(atlas, atlas.spots[i]));
+	}
+
+	if (!m_clustered)
+		return;
+
+	auto* cluster_data = frame.clusters.mapped<std::byte>();
+	std::memcpy(cluster_data, &m_clusters.header(), sizeof(LightClusterHeader));
+	std::memcpy(cluster_data + sizeof(LightClusterHeader),
+				m_clusters.ranges().data(),
+				m_clusters.ranges().size() * sizeof(LightClusterRange));
+
+	std::vector<uint32_t> const& indices = m_clusters.indices();
+	if (!indices.empty())
+		std::memcpy(frame.indices.mapped<uint32_t>(), indices.data(), indices.size() * sizeof(uint32_t));
+}
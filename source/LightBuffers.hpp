@@ -0,0 +1,88 @@
+#pragma once
+
+#include "Utils.hpp"
+#include "FlightFrames.hpp"
+#include "LightUniforms.hpp"
+#include "LightClusters.hpp"
+#include "StorageBuffer.hpp"
+#include "ShadowAtlas.hpp"
+#include "ShadowCascades.hpp"
+
+#include <vulkan/vulkan.hpp>
+
+/**
+ * The storage buffers the material pass reads its lights from, a set per frame in flight.
+ *
+ * Binding 0, 1 and 2 hold every point, spot and directional light, packed std430.
+ * Binding 3 and 4 hold every directional and spot shadow caster, with the rect of its
+ * tile in the shadow atlas, and the tile and split depth of every cascade of a directional one.
+ * With clustered lighting binding 5 holds the LightClusterHeader followed by the range
+ * of every cluster, and binding 6 the light indices the ranges refer to.
+ * The buffers grow when a frame needs more than they hold, so the light count is not capped.
+ */
+class LightBuffers
+{
+public:
+	LightBuffers(Logger logger,
+				 vk::Device device,
+				 DeviceAllocator& allocator,
+				 bool clustered,
+				 LightClusterGrid grid = LightClusterGrid{});
+
+	LightBuffers(LightBuffers&) = delete;
+	LightBuffers& operator=(LightBuffers&) = delete;
+
+	[[nodiscard]]
+	bool clustered() const noexcept;
+
+	[[nodiscard]]
+	vk::DescriptorSetLayout set_layout() const noexcept;
+
+	/**
+	 * Write the lights into the buffers of the flight frame, which the gpu has to be done with.
+	 * When clustered the point and spot lights are also binned into the clusters of the view.
+	 */
+	void upload(CurrentFlightFrame current_flightframe,
+				glm::mat4 const& view,
+				glm::mat4 const& projection,
+				vk::Extent2D extent,
+				std::vector<DirectionalLight> const& directionals,
+				std::vector<PointLight> const& points,
+				std::vector<SpotLight> const& spots,
+				ShadowCasters const& casters,
+				ShadowAtlasLayout const& atlas,
+				std::vector<std::vector<ShadowCascade>> const& cascades);
+
+	[[nodiscard]]
+	vk::DescriptorSet set(CurrentFlightFrame current_flightframe) const noexcept;
+
+private:
+	void reserve(uint32_t directional_count,
+				 uint32_t point_count,
+				 uint32_t spot_count,
+				 uint32_t directional_caster_count,
+				 uint32_t spot_caster_count,
+				 uint32_t index_count);
+
+	struct FrameBuffers
+	{
+		GrowableStorageBuffer points;
+		GrowableStorageBuffer spots;
+		GrowableStorageBuffer directionals;
+		GrowableStorageBuffer directional_casters;
+		GrowableStorageBuffer spot_casters;
+		GrowableStorageBuffer clusters;
+		GrowableStorageBuffer indices;
+		vk::UniqueDescriptorSet set;
+	};
+
+	Logger m_logger;
+	vk::Device m_device;
+	DeviceAllocator* m_allocator{nullptr};
+	bool m_clustered{false};
+	vk::UniqueDescriptorSetLayout m_set_layout;
+	vk::UniqueDescriptorPool m_pool;
+	FlightFramesArray<FrameBuffers> m_frames;
+	uint32_t m_current{0};
+	LightClusters m_clusters;
+};
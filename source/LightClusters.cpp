@@ -0,0 +1,248 @@
+#include "LightClusters.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+
+float constexpr infinity = std::numeric_limits<float>::infinity();
+
+auto brightest(glm::vec3 const& ambient,
+			   glm::vec3 const& diffuse,
+			   glm::vec3 const& specular) noexcept
+	-> float
+{
+	return std::max({ambient.x, ambient.y, ambient.z,
+					 diffuse.x, diffuse.y, diffuse.z,
+					 specular.x, specular.y, specular.z});
+}
+
+auto radius_of(Attenuation const& attenuation, float brightness) noexcept
+	-> float
+{
+	if (!(brightness > 0.0f))
+		return 0.0f;
+	return attenuation.approximate_distance(std::min(1.0f, light_cutoff_intensity / brightness));
+}
+
+auto unproject(glm::mat4 const& inverse_projection, float x, float y, float z)
+	-> glm::vec3
+{
+	const glm::vec4 point = inverse_projection * glm::vec4(x, y, z, 1.0f);
+	return glm::vec3(point) / point.w;
+}
+
+}
+
+auto light_radius(PointLight const& light) noexcept
+	-> float
+{
+	return radius_of(light.attenuation, brightest(light.ambient, light.diffuse, light.specular));
+}
+
+auto light_radius(SpotLight const& light) noexcept
+	-> float
+{
+	return radius_of(light.attenuation, brightest(light.ambient, light.diffuse, light.specular));
+}
+
+LightClusters::LightClusters(LightClusterGrid grid)
+	: m_grid(grid)
+{
+	m_header.grid = glm::uvec4(grid.x, grid.y, grid.z, 0);
+}
+
+void LightClusters::build_boxes(glm::mat4 const& projection)
+{
+	m_projection = projection;
+	const glm::mat4 inverse_projection = glm::inverse(projection);
+
+	// NOTE view space looks down -z, the depth is the distance along it
+	const float near_depth = -unproject(inverse_projection, 0.0f, 0.0f, 0.0f).z;
+	const float far_depth = -unproject(inverse_projection, 0.0f, 0.0f, 1.0f).z;
+	m_near = std::max(std::min(near_depth, far_depth), 1.0e-4f);
+	m_far = std::max(std::max(near_depth, far_depth), m_near * 1.0001f);
+
+	const float depth_ratio = std::log(m_far / m_near);
+	m_header.slice_scale = static_cast<float>(m_grid.z) / depth_ratio;
+	m_header.slice_bias = -static_cast<float>(m_grid.z) * std::log(m_near) / depth_ratio;
+
+	m_boxes.resize(cluster_count());
+	m_columns.assign(m_grid.z * m_grid.x, Interval{infinity, -infinity});
+	m_rows.assign(m_grid.z * m_grid.y, Interval{infinity, -infinity});
+
+	/* The corners of every tile on the far plane, the edges of a tile are the rays
+	 * from the eye through them, and every slice cuts them at its near and far depth.
+	 */
+	std::vector<glm::vec3> corners{};
+	corners.reserve((m_grid.x + 1) * (m_grid.y + 1));
+	for (uint32_t y = 0; y <= m_grid.y; y++) {
+		for (uint32_t x = 0; x <= m_grid.x; x++) {
+			const float ndc_x = -1.0f + 2.0f * static_cast<float>(x) / static_cast<float>(m_grid.x);
+			const float ndc_y = -1.0f + 2.0f * static_cast<float>(y) / static_cast<float>(m_grid.y);
+			const glm::vec3 corner = unproject(inverse_projection, ndc_x, ndc_y, 1.0f);
+			corners.push_back(corner / -corner.z);
+		}
+	}
+
+	for (uint32_t z = 0; z < m_grid.z; z++) {
+		const float slice_near = m_near * std::pow(m_far / m_near, static_cast<float>(z) / static_cast<float>(m_grid.z));
+		const float slice_far = m_near * std::pow(m_far / m_near, static_cast<float>(z + 1) / static_cast<float>(m_grid.z));
+
+		for (uint32_t y = 0; y < m_grid.y; y++) {
+			for (uint32_t x = 0; x < m_grid.x; x++) {
+				ClusterBox box{glm::vec3(infinity), glm::vec3(-infinity)};
+				for (uint32_t corner_y = y; corner_y <= y + 1; corner_y++) {
+					for (uint32_t corner_x = x; corner_x <= x + 1; corner_x++) {
+						const glm::vec3 ray = corners[corner_y * (m_grid.x + 1) + corner_x];
+						for (float depth: {slice_near, slice_far}) {
+							box.min = glm::min(box.min, ray * depth);
+							box.max = glm::max(box.max, ray * depth);
+						}
+					}
+				}
+				m_boxes[x + m_grid.x * (y + m_grid.y * z)] = box;
+
+				Interval& column = m_columns[z * m_grid.x + x];
+				column.min = std::min(column.min, box.min.x);
+				column.max = std::max(column.max, box.max.x);
+				Interval& row = m_rows[z * m_grid.y + y];
+				row.min = std::min(row.min, box.min.y);
+				row.max = std::max(row.max, box.max.y);
+			}
+		}
+	}
+}
+
+auto LightClusters::slice_of(float depth) const noexcept
+	-> uint32_t
+{
+	const float slice = std::floor(std::log(depth) * m_header.slice_scale + m_header.slice_bias);
+	return static_cast<uint32_t>(std::clamp(slice, 0.0f, static_cast<float>(m_grid.z - 1)));
+}
+
+void LightClusters::bin(glm::vec3 const& center,
+						float radius,
+						uint32_t light,
+						std::vector<LightPair>& pairs)
+{
+	const float depth = -center.z;
+	if (!(radius > 0.0f) || depth + radius < m_near || depth - radius > m_far)
+		return;
+
+	/* Only the columns and rows of a slice overlapping the sphere on their own axis
+	 * can hold a cluster it reaches, their clusters are then tested exactly.
+	 */
+	const uint32_t first_slice = slice_of(std::max(depth - radius, m_near));
+	const uint32_t last_slice = slice_of(std::min(depth + radius, m_far));
+	const float radius_squared = radius * radius;
+
+	for (uint32_t z = first_slice; z <= last_slice; z++) {
+		for (uint32_t y = 0; y < m_grid.y; y++) {
+			Interval const& row = m_rows[z * m_grid.y + y];
+			if (center.y + radius < row.min || center.y - radius > row.max)
+				continue;
+
+			for (uint32_t x = 0; x < m_grid.x; x++) {
+				Interval const& column = m_columns[z * m_grid.x + x];
+				if (center.x + radius < column.min || center.x - radius > column.max)
+					continue;
+
+				const uint32_t cluster = x + m_grid.x * (y + m_grid.y * z);
+				ClusterBox const& box = m_boxes[cluster];
+				const glm::vec3 closest = glm::clamp(center, box.min, box.max);
+				const glm::vec3 offset = closest - center;
+				if (glm::dot(offset, offset) <= radius_squared)
+					pairs.push_back(LightPair{cluster, light});
+			}
+		}
+	}
+}
+
+void LightClusters::build(glm::mat4 const& view,
+						  glm::mat4 const& projection,
+						  glm::uvec2 extent,
+						  std::vector<PointLight> const& points,
+						  std::vector<SpotLight> const& spots)
+{
+	if (m_boxes.empty() || projection != m_projection)
+		build_boxes(projection);
+
+	m_header.view_z = glm::vec4(view[0][2], view[1][2], view[2][2], view[3][2]);
+	m_header.extent_inverse = glm::vec2(1.0f / static_cast<float>(std::max(extent.x, 1u)),
+										1.0f / static_cast<float>(std::max(extent.y, 1u)));
+
+	m_point_pairs.clear();
+	for (uint32_t i = 0; i < points.size(); i++) {
+		const glm::vec3 center = glm::vec3(view * glm::vec4(points[i].position, 1.0f));
+		bin(center, light_radius(points[i]), i, m_point_pairs);
+	}
+
+	/* A spot light is bounded by the sphere around its cone, centered halfway
+	 * along it for narrow cones, and by its whole sphere for wide ones.
+	 */
+	m_spot_pairs.clear();
+	for (uint32_t i = 0; i < spots.size(); i++) {
+		SpotLight const& spot = spots[i];
+		const float range = light_radius(spot);
+		const float cone = std::sqrt(std::max(1.25f - spot.cutoff.outer, 0.0f));
+		const bool narrow = cone < 1.0f && std::isfinite(range);
+		const glm::vec3 position = narrow
+			? spot.position + glm::normalize(spot.direction) * (range * 0.5f)
+			: spot.position;
+		const glm::vec3 center = glm::vec3(view * glm::vec4(position, 1.0f));
+		bin(center, narrow ? range * cone : range, i, m_spot_pairs);
+	}
+
+	/* Count the lights of every cluster, and place the indices of each light
+	 * after the offsets of the clusters before it.
+	 */
+	m_ranges.assign(cluster_count(), LightClusterRange{0, 0, 0});
+	for (LightPair const& pair: m_point_pairs)
+		m_ranges[pair.cluster].point_count++;
+	for (LightPair const& pair: m_spot_pairs)
+		m_ranges[pair.cluster].spot_count++;
+
+	uint32_t offset = 0;
+	for (LightClusterRange& range: m_ranges) {
+		range.offset = offset;
+		offset += range.point_count + range.spot_count;
+	}
+
+	m_indices.resize(offset);
+	std::vector<uint32_t> cursors(cluster_count(), 0);
+	for (LightPair const& pair: m_point_pairs) {
+		LightClusterRange const& range = m_ranges[pair.cluster];
+		m_indices[range.offset + cursors[pair.cluster]++] = pair.light;
+	}
+	for (LightPair const& pair: m_spot_pairs) {
+		LightClusterRange const& range = m_ranges[pair.cluster];
+		m_indices[range.offset + cursors[pair.cluster]++] = pair.light;
+	}
+}
+
+auto LightClusters::header() const noexcept
+	-> LightClusterHeader const&
+{
+	return m_header;
+}
+
+auto LightClusters::ranges() const noexcept
+	-> std::vector<LightClusterRange> const&
+{
+	return m_ranges;
+}
+
+auto LightClusters::indices() const noexcept
+	-> std::vector<uint32_t> const&
+{
+	return m_indices;
+}
+
+auto LightClusters::cluster_count() const noexcept
+	-> uint32_t
+{
+	return m_grid.x * m_grid.y * m_grid.z;
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <VulkanRenderer/glm.hpp>
+#include <VulkanRenderer/Light.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * Clustered forward light culling.
+ *
+ * The view frustum is split into a grid of froxels, tiles of the screen that are
+ * sliced exponentially in view space depth. Every point and spot light is tested
+ * against the view space box of each cluster its sphere of influence can reach,
+ * and the lights of every cluster are written as one contiguous range of indices.
+ * The fragment shader finds its cluster from its screen position and depth,
+ * and only shades the lights in that range.
+ *
+ * The boxes only depend on the projection, so they are rebuilt when it changes.
+ * Expects a perspective projection with the eye at the origin of view space.
+ */
+struct LightClusterGrid
+{
+	uint32_t x{16};
+	uint32_t y{9};
+	uint32_t z{24};
+};
+
+// NOTE the std430 header of the cluster buffer, followed by a LightClusterRange per cluster
+struct LightClusterHeader
+{
+	glm::uvec4 grid;
+	// NOTE the row of the view matrix giving view space z, negated for the depth
+	glm::vec4 view_z;
+	glm::vec2 extent_inverse;
+	// NOTE slice = log(depth) * slice_scale + slice_bias
+	float slice_scale;
+	float slice_bias;
+};
+
+struct LightClusterRange
+{
+	uint32_t offset;
+	uint32_t point_count;
+	uint32_t spot_count;
+	uint32_t _padding{0};
+};
+
+// NOTE the fraction of a lights strength below which it is considered out of reach
+float constexpr light_cutoff_intensity = 1.0f / 256.0f;
+
+/**
+ * Distance at which the brightest color of a light has fallen off
+ * below light_cutoff_intensity.
+ */
+[[nodiscard]]
+auto light_radius(PointLight const& light) noexcept
+	-> float;
+
+[[nodiscard]]
+auto light_radius(SpotLight const& light) noexcept
+	-> float;
+
+class LightClusters
+{
+public:
+	explicit LightClusters(LightClusterGrid grid = LightClusterGrid{});
+
+	/**
+	 * Bin the lights into the clusters of a view, extent is the size in pixels
+	 * of the target the clusters are looked up from.
+	 */
+	void build(glm::mat4 const& view,
+			   glm::mat4 const& projection,
+			   glm::uvec2 extent,
+			   std::vector<PointLight> const& points,
+			   std::vector<SpotLight> const& spots);
+
+	[[nodiscard]]
+	auto header() const noexcept
+		-> LightClusterHeader const&;
+
+	// NOTE indexed by x + grid.x * (y + grid.y * z)
+	[[nodiscard]]
+	auto ranges() const noexcept
+		-> std::vector<LightClusterRange> const&;
+
+	// NOTE the point light indices of a cluster come before its spot light indices
+	[[nodiscard]]
+	auto indices() const noexcept
+		-> std::vector<uint32_t> const&;
+
+	[[nodiscard]]
+	auto cluster_count() const noexcept
+		-> uint32_t;
+
+private:
+	struct ClusterBox
+	{
+		glm::vec3 min;
+		glm::vec3 max;
+	};
+
+	struct Interval
+	{
+		float min;
+		float max;
+	};
+
+	struct LightPair
+	{
+		uint32_t cluster;
+		uint32_t light;
+	};
+
+	void build_boxes(glm::mat4 const& projection);
+
+	void bin(glm::vec3 const& center,
+			 float radius,
+			 uint32_t light,
+			 std::vector<LightPair>& pairs);
+
+	[[nodiscard]]
+	auto slice_of(float depth) const noexcept
+		-> uint32_t;
+
+	LightClusterGrid m_grid;
+	LightClusterHeader m_header{};
+	glm::mat4 m_projection{0.0f};
+	float m_near{0.0f};
+	float m_far{0.0f};
+
+	std::vector<ClusterBox> m_boxes;
+	// NOTE the x extent of every column and y extent of every row of a slice, over all its clusters
+	std::vector<Interval> m_columns;
+	std::vector<Interval> m_rows;
+
+	std::vector<LightPair> m_point_pairs;
+	std::vector<LightPair> m_spot_pairs;
+	std::vector<LightClusterRange> m_ranges;
+	std::vector<uint32_t> m_indices;
+};
@@ -1,5 +1,7 @@
 #include "LightUniforms.hpp"
 
+#include <algorithm>
+
 DirectionalLightUniformData::DirectionalLightUniformData(DirectionalLight light)
 	: direction{light.direction}
 	, ambient{light.ambient}
@@ -68,17 +70,31 @@ SpotLightUniformData& SpotLightUniformData::operator=(SpotLight light)
 }
 
 DirectionalShadowCasterUniformData::DirectionalShadowCasterUniformData(
-    DirectionalShadowCaster caster)
+    DirectionalShadowCaster caster,
+	std::vector<ShadowCascade> const& cascades,
+	std::vector<glm::vec4> const& atlas_rects)
 	: direction{caster.light().direction}
 	, ambient{caster.light().ambient}
 	, diffuse{caster.light().diffuse}
 	, specular{caster.light().specular}
-	, viewproj_matrix{caster.projection().get() * caster.view()}
-	, exists{true}
-{}
+{
+	const size_t count = std::min<size_t>(cascades.size(), max_shadow_cascades);
+	cascade_count = static_cast<int>(count);
+	for (size_t cascade = 0; cascade < max_shadow_cascades; cascade++) {
+		const bool used = cascade < count;
+		viewproj_matrix[cascade] = used
+			? cascades[cascade].projection * cascades[cascade].view
+			: glm::mat4(1.0f);
+		atlas_rect[cascade] = used && cascade < atlas_rects.size()
+			? atlas_rects[cascade]
+			: glm::vec4(0.0f);
+		cascade_far_depth[cascade] = used ? cascades[cascade].far_depth : 0.0f;
+	}
+}
 
 SpotShadowCasterUniformData::SpotShadowCasterUniformData(
-    SpotShadowCaster caster)
+    SpotShadowCaster caster,
+	glm::vec4 atlas_rect)
 	: position{caster.light().position}
 	, direction{caster.light().direction}
 	, ambient{caster.light().ambient}
@@ -90,7 +106,7 @@ SpotShadowCasterUniformData::SpotShadowCasterUniformData(
 	, cutoff_inner(caster.light().cutoff.inner)
 	, cutoff_outer(caster.light().cutoff.outer)
 	, viewproj_matrix{caster.projection().get() * caster.view()}
-	, exists{true}
+	, atlas_rect{atlas_rect}
 {}
 
 
@@ -3,6 +3,10 @@
 #include <VulkanRenderer/Light.hpp>
 #include <VulkanRenderer/ShadowCaster.hpp>
 
+#include "ShadowCascades.hpp"
+
+#include <vector>
+
 
 struct DirectionalLightUniformData
 {
@@ -75,12 +79,18 @@ struct DirectionalShadowCasterUniformData
 	float _padding3{1.0f};
 	glm::vec3 specular;
 	float _padding4{1.0f};
-	glm::mat4 viewproj_matrix;
-	int exists{false};
-	float _padding5[3];
+	glm::mat4 viewproj_matrix[max_shadow_cascades];
+	// NOTE offset and scale of the tile of every cascade in the shadow atlas, zero without one
+	glm::vec4 atlas_rect[max_shadow_cascades];
+	// NOTE the view depth every cascade ends at
+	float cascade_far_depth[max_shadow_cascades];
+	int cascade_count{0};
+	int _padding5[3]{0, 0, 0};
 	
 	DirectionalShadowCasterUniformData() = default;
-	DirectionalShadowCasterUniformData(DirectionalShadowCaster caster);
+	DirectionalShadowCasterUniformData(DirectionalShadowCaster caster,
+									   std::vector<ShadowCascade> const& cascades,
+									   std::vector<glm::vec4> const& atlas_rects);
 };
 
 struct SpotShadowCasterUniformData
@@ -103,11 +113,10 @@ struct SpotShadowCasterUniformData
 	float cutoff_outer;
 	float _padding7[2]{1.0f, 1.0f};
 	glm::mat4 viewproj_matrix;
-	int exists{false};
-	float _padding8[3];
+	glm::vec4 atlas_rect{0.0f};
 
 	SpotShadowCasterUniformData() = default;
-	SpotShadowCasterUniformData(SpotShadowCaster caster);
+	SpotShadowCasterUniformData(SpotShadowCaster caster, glm::vec4 atlas_rect);
 };
 
 
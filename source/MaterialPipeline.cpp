@@ -1,5 +1,6 @@
 #include "MaterialPipeline.hpp"
 #include "VertexBufferImpl.hpp"
+#include "IndexBufferImpl.hpp"
 
 #include <format>
 
@@ -23,12 +24,21 @@ MaterialPipeline::MaterialPipeline(Logger& logger,
 								   Render::Context::Impl* context,
 								   Presenter::Impl* presenter,
 								   DescriptorPool::Impl* descriptor_pool,
+								   PipelineCache* pipeline_cache,
+								   BindlessTextures* bindless_textures,
+								   LightBuffers* lights,
 								   vk::RenderPass& renderpass,
+								   const bool depth_prepass,
 								   std::filesystem::path const shader_root_path)
+	: m_bindless_textures(bindless_textures)
+	, m_lights(lights)
 {
 	std::string const pipeline_name = "MaterialPipeline";
 	std::string const vertexshader_name = "Material.vert.spv";
-	std::string const fragmentshader_name = "Material.frag.spv";
+	// NOTE every combination of bindless textures and clustered lights is its own variant
+	std::string const fragmentshader_name = std::format("Material{}{}.frag.spv",
+														m_bindless_textures ? "Bindless" : "",
+														m_lights->clustered() ? "Clustered" : "");
 	logger.info(std::source_location::current(),
 				std::format("Creating Pipeline {}",
 							pipeline_name));
@@ -66,8 +76,9 @@ MaterialPipeline::MaterialPipeline(Logger& logger,
 		.setFlags(vk::PipelineDynamicStateCreateFlags())
 		.setDynamicStates(dynamicStates);
 	
-	const auto bindingDescriptions = binding_descriptions(VertexPosNormColorUV{});
-	const auto attributeDescriptions = attribute_descriptions(VertexPosNormColorUV{});
+	// NOTE the model matrices are read per instance, from the presenters instance ring
+	const auto bindingDescriptions = instanced_binding_descriptions(VertexPosNormColorUV{});
+	const auto attributeDescriptions = instanced_attribute_descriptions(VertexPosNormColorUV{});
 	
 	auto pipelineVertexInputStateCreateInfo = vk::PipelineVertexInputStateCreateInfo{}
 		.setFlags(vk::PipelineVertexInputStateCreateFlags())
@@ -137,62 +148,30 @@ MaterialPipeline::MaterialPipeline(Logger& logger,
 		.setAttachments(pipelineColorBlendAttachmentState)
 		.setBlendConstants({ 1.0f, 1.0f, 1.0f, 1.0f });
 
-	const auto push_constant_range = vk::PushConstantRange{}
-		.setOffset(0)
-		.setSize(sizeof(PushConstants))
-		.setStageFlags(vk::ShaderStageFlagBits::eVertex);
-	
-	if (sizeof(PushConstants) > 128) {
-		logger.warn(std::source_location::current(), 
-					std::format("PushConstant size={} is larger than minimum supported (128)"
-								"This can cause compatability issues on some devices",
-								sizeof(PushConstants)));
+	// NOTE only bindless textures need push constants, for the texture indices
+	std::vector<vk::PushConstantRange> push_constant_ranges{};
+	if (m_bindless_textures) {
+		push_constant_ranges.push_back(vk::PushConstantRange{}
+									   .setOffset(0)
+									   .setSize(sizeof(BindlessPushConstants))
+									   .setStageFlags(vk::ShaderStageFlagBits::eFragment));
 	}
 	
-	std::array<vk::DescriptorSetLayoutBinding, 7> frame_uniform_bindings{
+	// NOTE the lights themselves are storage buffers in the LightBuffers set
+	// NOTE the fragment shader selects the shadow cascade from the view depth of the camera
+	std::array<vk::DescriptorSetLayoutBinding, 2> frame_uniform_bindings{
 		vk::DescriptorSetLayoutBinding{}
-		.setStageFlags(vk::ShaderStageFlagBits::eVertex)
+		.setStageFlags(vk::ShaderStageFlagBits::eVertex
+					   | vk::ShaderStageFlagBits::eFragment)
 		.setBinding(0)
 		.setDescriptorCount(1)
-		.setDescriptorType(vk::DescriptorType::eUniformBuffer),
+		.setDescriptorType(vk::DescriptorType::eUniformBufferDynamic),
 
 		vk::DescriptorSetLayoutBinding{}
 		.setStageFlags(vk::ShaderStageFlagBits::eFragment)
 		.setBinding(1)
 		.setDescriptorCount(1)
-		.setDescriptorType(vk::DescriptorType::eUniformBuffer),
-
-		vk::DescriptorSetLayoutBinding{}
-		.setStageFlags(vk::ShaderStageFlagBits::eFragment)
-		.setBinding(2)
-		.setDescriptorCount(1)
-		.setDescriptorType(vk::DescriptorType::eUniformBuffer),
-
-		vk::DescriptorSetLayoutBinding{}
-		.setStageFlags(vk::ShaderStageFlagBits::eFragment)
-		.setBinding(3)
-		.setDescriptorCount(1)
-		.setDescriptorType(vk::DescriptorType::eUniformBuffer),
-
-		vk::DescriptorSetLayoutBinding{}
-		.setStageFlags(vk::ShaderStageFlagBits::eFragment)
-		.setBinding(4)
-		.setDescriptorCount(1)
-		.setDescriptorType(vk::DescriptorType::eUniformBuffer),
-
-		vk::DescriptorSetLayoutBinding{}
-		.setStageFlags(vk::ShaderStageFlagBits::eFragment
-					   | vk::ShaderStageFlagBits::eVertex)
-		.setBinding(5)
-		.setDescriptorCount(1)
-		.setDescriptorType(vk::DescriptorType::eUniformBuffer),
-		
-		vk::DescriptorSetLayoutBinding{}
-		.setStageFlags(vk::ShaderStageFlagBits::eFragment
-					   | vk::ShaderStageFlagBits::eVertex)
-		.setBinding(6)
-		.setDescriptorCount(1)
-		.setDescriptorType(vk::DescriptorType::eUniformBuffer),
+		.setDescriptorType(vk::DescriptorType::eUniformBufferDynamic),
 	};
 
 	const auto frame_uniform_setinfo = vk::DescriptorSetLayoutCreateInfo{}
@@ -205,114 +184,70 @@ MaterialPipeline::MaterialPipeline(Logger& logger,
 	
 	logger.info(std::source_location::current(), "Created frame uniform layout");
 	
-	std::array<vk::DescriptorSetLayoutBinding, 1> ambient_texture_bindings{
+	//NOTE: these MUST match the bindings written by create_material_descriptorset
+	std::array<vk::DescriptorSetLayoutBinding, 4> material_texture_bindings{
 		vk::DescriptorSetLayoutBinding{}
 		.setStageFlags(vk::ShaderStageFlagBits::eFragment)
 		.setBinding(0)
 		.setDescriptorCount(1)
 		.setDescriptorType(vk::DescriptorType::eCombinedImageSampler),
-	};
-	auto ambient_texture_setinfo = vk::DescriptorSetLayoutCreateInfo{}
-		.setFlags(vk::DescriptorSetLayoutCreateFlags())
-		.setBindings(ambient_texture_bindings);
-	
-	m_ambient.layout =
-		context->device.get().createDescriptorSetLayoutUnique(ambient_texture_setinfo,
-															  nullptr);
 
-	std::array<vk::DescriptorSetLayoutBinding, 1> diffuse_texture_bindings{
 		vk::DescriptorSetLayoutBinding{}
 		.setStageFlags(vk::ShaderStageFlagBits::eFragment)
-		.setBinding(0)
+		.setBinding(1)
 		.setDescriptorCount(1)
 		.setDescriptorType(vk::DescriptorType::eCombinedImageSampler),
-	};
-	auto diffuse_texture_setinfo = vk::DescriptorSetLayoutCreateInfo{}
-		.setFlags(vk::DescriptorSetLayoutCreateFlags())
-		.setBindings(diffuse_texture_bindings);
-	
-	m_diffuse.layout =
-		context->device.get().createDescriptorSetLayoutUnique(diffuse_texture_setinfo,
-															  nullptr);
-	
-	std::array<vk::DescriptorSetLayoutBinding, 1> normal_texture_bindings{
+
 		vk::DescriptorSetLayoutBinding{}
 		.setStageFlags(vk::ShaderStageFlagBits::eFragment)
-		.setBinding(0)
+		.setBinding(2)
 		.setDescriptorCount(1)
 		.setDescriptorType(vk::DescriptorType::eCombinedImageSampler),
-	};
-	auto normal_texture_setinfo = vk::DescriptorSetLayoutCreateInfo{}
-		.setFlags(vk::DescriptorSetLayoutCreateFlags())
-		.setBindings(normal_texture_bindings);
-	
-	m_normal.layout =
-		context->device.get().createDescriptorSetLayoutUnique(normal_texture_setinfo,
-															  nullptr);
-	
-	std::array<vk::DescriptorSetLayoutBinding, 1> specular_texture_bindings{
+
 		vk::DescriptorSetLayoutBinding{}
 		.setStageFlags(vk::ShaderStageFlagBits::eFragment)
-		.setBinding(0)
+		.setBinding(3)
 		.setDescriptorCount(1)
 		.setDescriptorType(vk::DescriptorType::eCombinedImageSampler),
 	};
-	auto specular_texture_setinfo = vk::DescriptorSetLayoutCreateInfo{}
+	auto material_texture_setinfo = vk::DescriptorSetLayoutCreateInfo{}
 		.setFlags(vk::DescriptorSetLayoutCreateFlags())
-		.setBindings(specular_texture_bindings);
+		.setBindings(material_texture_bindings);
 	
-	m_specular.layout =
-		context->device.get().createDescriptorSetLayoutUnique(specular_texture_setinfo,
+	m_material.layout =
+		context->device.get().createDescriptorSetLayoutUnique(material_texture_setinfo,
 															  nullptr);
 	
-	logger.info(std::source_location::current(), "Created texture descriptorset layouts");
+	logger.info(std::source_location::current(), "Created material descriptorset layout");
 	
-	std::array<vk::DescriptorSetLayoutBinding, 1> directional_shadowmap_bindings{
+	std::array<vk::DescriptorSetLayoutBinding, 1> shadow_atlas_bindings{
 		vk::DescriptorSetLayoutBinding{}
 		.setStageFlags(vk::ShaderStageFlagBits::eFragment)
 		.setBinding(0)
 		.setDescriptorCount(1)
 		.setDescriptorType(vk::DescriptorType::eCombinedImageSampler),
 	};
-	auto directional_shadowmap_setinfo = vk::DescriptorSetLayoutCreateInfo{}
+	auto shadow_atlas_setinfo = vk::DescriptorSetLayoutCreateInfo{}
 		.setFlags(vk::DescriptorSetLayoutCreateFlags())
-		.setBindings(directional_shadowmap_bindings);
+		.setBindings(shadow_atlas_bindings);
 	
-	m_directional_shadowmap_layout =
-		context->device.get().createDescriptorSetLayoutUnique(directional_shadowmap_setinfo,
+	m_shadow_atlas_layout =
+		context->device.get().createDescriptorSetLayoutUnique(shadow_atlas_setinfo,
 															  nullptr);
-	
-	std::array<vk::DescriptorSetLayoutBinding, 1> spot_shadowmap_bindings{
-		vk::DescriptorSetLayoutBinding{}
-		.setStageFlags(vk::ShaderStageFlagBits::eFragment)
-		.setBinding(0)
-		.setDescriptorCount(1)
-		.setDescriptorType(vk::DescriptorType::eCombinedImageSampler),
-	};
-	auto spot_shadowmap_setinfo = vk::DescriptorSetLayoutCreateInfo{}
-		.setFlags(vk::DescriptorSetLayoutCreateFlags())
-		.setBindings(spot_shadowmap_bindings);
-	
-	m_spot_shadowmap_layout =
-		context->device.get().createDescriptorSetLayoutUnique(spot_shadowmap_setinfo,
-															  nullptr);
-
-
 
-	std::array<vk::DescriptorSetLayout, 7> const descriptorset_layouts{
+	std::array<vk::DescriptorSetLayout, 4> const descriptorset_layouts{
 		m_global_set_layout.get(),
-		m_ambient.layout.get(),
-		m_diffuse.layout.get(),
-		m_specular.layout.get(),
-		m_normal.layout.get(),
-		m_directional_shadowmap_layout.get(),
-		m_spot_shadowmap_layout.get(),
+		m_bindless_textures
+		? m_bindless_textures->layout()
+		: m_material.layout.get(),
+		m_shadow_atlas_layout.get(),
+		m_lights->set_layout(),
 	};
 
     auto pipelineLayoutCreateInfo = vk::PipelineLayoutCreateInfo{}
 		.setFlags(vk::PipelineLayoutCreateFlags())
 		.setSetLayouts(descriptorset_layouts)
-		.setPushConstantRanges(push_constant_range);
+		.setPushConstantRanges(push_constant_ranges);
 
 	m_layout = 
 		context->device.get().createPipelineLayoutUnique(pipelineLayoutCreateInfo);
@@ -327,33 +262,36 @@ MaterialPipeline::MaterialPipeline(Logger& logger,
 	Pixel8bitRGBA constexpr normal_default(128, 128, 255, 255);
 	Pixel8bitRGBA constexpr specular_default(128, 128, 128, 255);
 	
-	m_ambient.default_texture = 
+	m_default_textures.ambient = 
 		create_canvas(ambient_basic, CanvasExtent{64, 64})
 		| move_canvas_to_gpu(context)
 		| make_shader_readonly(context, InterpolationType::Point);
 
-	m_diffuse.default_texture = 
+	m_default_textures.diffuse = 
 		create_canvas(diffuse_blue, CanvasExtent{64, 64})
 		| canvas_draw_checkerboard(diffuse_red, CheckerSquareSize{4})
 		| move_canvas_to_gpu(context)
 		| make_shader_readonly(context, InterpolationType::Point);
 	
-	m_specular.default_texture = 
+	m_default_textures.specular = 
 		create_canvas(specular_default, CanvasExtent{64, 64})
 		| move_canvas_to_gpu(context)
 		| make_shader_readonly(context, InterpolationType::Point);
 	
-	m_normal.default_texture = 
+	m_default_textures.normal = 
 		create_canvas(normal_default, CanvasExtent{64, 64})
 		| move_canvas_to_gpu(context)
 		| make_shader_readonly(context, InterpolationType::Point);
 	
 	logger.info(std::source_location::current(), "Created default textures");
 
+	/* With a depth pre-pass the depth of every draw is already laid down,
+	 * so only the fragment matching it is shaded and nothing is written.
+	 */
 	auto depth_stencil_state_info = vk::PipelineDepthStencilStateCreateInfo{}
 		.setDepthTestEnable(true)
-		.setDepthWriteEnable(true)
-		.setDepthCompareOp(vk::CompareOp::eLess)
+		.setDepthWriteEnable(!depth_prepass)
+		.setDepthCompareOp(depth_prepass ? vk::CompareOp::eEqual : vk::CompareOp::eLess)
 		.setDepthBoundsTestEnable(false)
 		.setMinDepthBounds(0.0f)
 		.setMaxDepthBounds(1.0f)
@@ -375,8 +313,8 @@ MaterialPipeline::MaterialPipeline(Logger& logger,
 		.setRenderPass(renderpass);
 
 	vk::ResultValue<vk::UniquePipeline> result =
-		context->device.get().createGraphicsPipelineUnique(nullptr,
-														   graphicsPipelineCreateInfo);
+		pipeline_cache->create_graphics_pipeline(pipeline_name,
+												 graphicsPipelineCreateInfo);
 	
     switch (result.result) {
 	case vk::Result::eSuccess:
@@ -393,188 +331,52 @@ MaterialPipeline::MaterialPipeline(Logger& logger,
 	logger.info(std::source_location::current(), "Created Pipeline");
 	
 
-	/*Allocate Per-Frame Uniform Descriptor Sets*/
+	/*Allocate the Uniform Descriptor Set*/
+	// NOTE: every binding is a dynamic uniform buffer into the presenters uniform ring,
+	//       so a single set serves all frames in flight, the frame data is selected
+	//       through the dynamic offsets when binding it.
+	m_uniforms = presenter->uniform_ring.get();
+	m_instances = presenter->instance_ring.get();
+
 	uint32_t constexpr layouts_size = 1;
 	const auto frame_uniform_allocate_info = vk::DescriptorSetAllocateInfo{}
 		.setDescriptorPool(descriptor_pool->descriptor_pool.get())
 		.setDescriptorSetCount(layouts_size)
 		.setSetLayouts(m_global_set_layout.get());
 
-	
-	//NOTE: due to only having 1 identical layout for each set, we need to allocate
-	//      them seperately like this. this is assumed to be better than having
-	//      duplicate layouts laying around
-	for (size_t i = 0; i < m_global_set_uniforms.size(); i++) {
-		std::vector<vk::UniqueDescriptorSet> sets =
-			context->device.get().allocateDescriptorSetsUnique(frame_uniform_allocate_info);
-
-		m_global_set_uniforms[i].set = std::move(sets[0]);
-		logger.info(std::source_location::current(),
-					"created frame uniform descriptor set");
-	}
-
-	CameraUniformData camera_init_data;
-	camera_init_data.view = glm::mat4(1.0f);
-	camera_init_data.proj = glm::mat4(1.0f);
-	camera_init_data.position = glm::vec3(0.0f);
-	
-	PointLightUniformData pointlight_init_data;
-	SpotLightUniformData spotlight_init_data;
-	DirectionalLightUniformData dirlight_init_data;
-	
-	LightArrayLengthsUniformData lightarray_lengths_init_data;
-	lightarray_lengths_init_data.point_length = 0;
-	lightarray_lengths_init_data.spot_length = 0;
-	lightarray_lengths_init_data.directional_length = 0;
-	
-	DirectionalShadowCasterUniformData directional_shadowcaster_init_data{};
-	SpotShadowCasterUniformData spot_shadowcaster_init_data{};
-
-	for (auto& uniform: m_global_set_uniforms) {
-		uniform.camera =
-			UniformMemoryDirectWrite<CameraUniformData>(context->physical_device,
-														context->device.get(),
-														camera_uniform_count);
-		uniform.camera.write(context->device.get(), &camera_init_data, 1);
-
-		logger.info(std::source_location::current(),
-					"created frame uniform camera descriptor memories");
-	
-		uniform.pointlight =
-			UniformMemoryDirectWrite<PointLightUniformData>(context->physical_device,
-															context->device.get(),
-															max_pointlights);
-
-		uniform.pointlight.write(context->device.get(), &pointlight_init_data, 1);
-
-		logger.info(std::source_location::current(),
-					"created frame uniform pointlight descriptor memories");
-	
-		uniform.spotlight =
-			UniformMemoryDirectWrite<SpotLightUniformData>(context->physical_device,
-														   context->device.get(),
-														   max_spotlights);
-		uniform.spotlight.write(context->device.get(), &spotlight_init_data, 1);
-		logger.info(std::source_location::current(),
-					"created frame uniform spotlight descriptor memories");
-	
-		uniform.directionallight =
-			UniformMemoryDirectWrite<DirectionalLightUniformData>(context->physical_device,
-																  context->device.get(),
-																  max_directionallights);
-
-		uniform.directionallight.write(context->device.get(), &dirlight_init_data, 1);
-		logger.info(std::source_location::current(),
-					"created frame uniform directional light descriptor memories");
-		
-		uniform.lightarray_lengths =
-			UniformMemoryDirectWrite<LightArrayLengthsUniformData>(context->physical_device,
-																   context->device.get(),
-																   lightarray_lengths_count);
-		uniform.lightarray_lengths.write(context->device.get(),
-										 &lightarray_lengths_init_data,
-										 lightarray_lengths_count);
-
-		logger.info(std::source_location::current(),
-					"created frame uniform light array lengths descriptor memories");
-		
-	   uniform.directional_shadowcaster =
-		   UniformMemoryDirectWrite<DirectionalShadowCasterUniformData>(
-               context->physical_device,
-			   context->device.get(),
-			   directional_shadowcasters_count);
-
-		uniform.directional_shadowcaster.write(context->device.get(),
-											   &directional_shadowcaster_init_data,
-											   directional_shadowcasters_count);
-
-		logger.info(std::source_location::current(),
-					"created frame uniform directional shadowcaster descriptor memories");
+	std::vector<vk::UniqueDescriptorSet> sets =
+		descriptor_pool->allocate(context->device.get(), frame_uniform_allocate_info);
+	m_global_set = std::move(sets[0]);
+	logger.info(std::source_location::current(),
+				"created frame uniform descriptor set");
+
+	const auto camera_info =
+		m_uniforms->descriptor_info<CameraUniformData>(camera_uniform_count);
+	const auto lightarray_lengths_info =
+		m_uniforms->descriptor_info<LightArrayLengthsUniformData>(lightarray_lengths_count);
+
+	std::array<vk::WriteDescriptorSet, 2> writes {
+		vk::WriteDescriptorSet{}
+		.setDstSet(m_global_set.get())
+		.setDstBinding(0)
+		.setDstArrayElement(0)
+		.setDescriptorCount(1)
+		.setDescriptorType(vk::DescriptorType::eUniformBufferDynamic)
+		.setBufferInfo(camera_info),
 		
-	   uniform.spot_shadowcaster =
-		   UniformMemoryDirectWrite<SpotShadowCasterUniformData>(
-               context->physical_device,
-			   context->device.get(),
-			   spot_shadowcasters_count);
-
-		uniform.spot_shadowcaster.write(context->device.get(),
-											   &spot_shadowcaster_init_data,
-											   spot_shadowcasters_count);
-
-		logger.info(std::source_location::current(),
-					"created frame uniform spot shadowcaster descriptor memories");
-	}
+		vk::WriteDescriptorSet{}
+		.setDstSet(m_global_set.get())
+		.setDstBinding(1)
+		.setDstArrayElement(0)
+		.setDescriptorCount(1)
+		.setDescriptorType(vk::DescriptorType::eUniformBufferDynamic)
+		.setBufferInfo(lightarray_lengths_info),
+	};
 
-	// NOTE: Here we technically update the descriptor sets, but this is done to
-	//       initialize them before use. Aftwerwards, it is not nessecary to update with a write 
-    //       as the uniforms are direct write uniforms, thus simply writing to the memory
-	//       is considered updating them
-	for (size_t i = 0; i < m_global_set_uniforms.size(); i++) {
-		std::array<vk::WriteDescriptorSet, 7> writes {
-			vk::WriteDescriptorSet{}
-			.setDstSet(m_global_set_uniforms[i].set.get())
-			.setDstBinding(0)
-			.setDstArrayElement(0)
-			.setDescriptorCount(1)
-			.setDescriptorType(vk::DescriptorType::eUniformBuffer)
-			.setBufferInfo(m_global_set_uniforms[i].camera.buffer_info()),
-			
-			vk::WriteDescriptorSet{}
-			.setDstSet(m_global_set_uniforms[i].set.get())
-			.setDstBinding(1)
-			.setDstArrayElement(0)
-			.setDescriptorCount(1)
-			.setDescriptorType(vk::DescriptorType::eUniformBuffer)
-			.setBufferInfo(m_global_set_uniforms[i].pointlight.buffer_info()),
-			
-			vk::WriteDescriptorSet{}
-			.setDstSet(m_global_set_uniforms[i].set.get())
-			.setDstBinding(2)
-			.setDstArrayElement(0)
-			.setDescriptorCount(1)
-			.setDescriptorType(vk::DescriptorType::eUniformBuffer)
-			.setBufferInfo(m_global_set_uniforms[i].spotlight.buffer_info()),
-			
-			vk::WriteDescriptorSet{}
-			.setDstSet(m_global_set_uniforms[i].set.get())
-			.setDstBinding(3)
-			.setDstArrayElement(0)
-			.setDescriptorCount(1)
-			.setDescriptorType(vk::DescriptorType::eUniformBuffer)
-			.setBufferInfo(m_global_set_uniforms[i].directionallight.buffer_info()),
-
-			vk::WriteDescriptorSet{}
-			.setDstSet(m_global_set_uniforms[i].set.get())
-			.setDstBinding(4)
-			.setDstArrayElement(0)
-			.setDescriptorCount(1)
-			.setDescriptorType(vk::DescriptorType::eUniformBuffer)
-			.setBufferInfo(m_global_set_uniforms[i].lightarray_lengths.buffer_info()),
-
-			vk::WriteDescriptorSet{}
-			.setDstSet(m_global_set_uniforms[i].set.get())
-			.setDstBinding(5)
-			.setDstArrayElement(0)
-			.setDescriptorCount(1)
-			.setDescriptorType(vk::DescriptorType::eUniformBuffer)
-			.setBufferInfo(m_global_set_uniforms[i].directional_shadowcaster.buffer_info()),
-			
-			vk::WriteDescriptorSet{}
-			.setDstSet(m_global_set_uniforms[i].set.get())
-			.setDstBinding(6)
-			.setDstArrayElement(0)
-			.setDescriptorCount(1)
-			.setDescriptorType(vk::DescriptorType::eUniformBuffer)
-			.setBufferInfo(m_global_set_uniforms[i].spot_shadowcaster.buffer_info()),
-		};
-
-		context->device.get().updateDescriptorSets(writes.size(),
-												   writes.data(),
-												   0,
-												   nullptr);
-		logger.info(std::source_location::current(),
-					"added another set of writes");
-	}
+	context->device.get().updateDescriptorSets(writes.size(),
+											   writes.data(),
+											   0,
+											   nullptr);
 }
 
 
@@ -583,11 +385,14 @@ MaterialPipeline::MaterialPipeline(MaterialPipeline&& rhs) noexcept
 	std::swap(m_layout, rhs.m_layout);
 	std::swap(m_pipeline, rhs.m_pipeline);
 	std::swap(m_global_set_layout, rhs.m_global_set_layout);
-	std::swap(m_global_set_uniforms, rhs.m_global_set_uniforms);
-	std::swap(m_ambient, rhs.m_ambient);
-	std::swap(m_diffuse, rhs.m_diffuse);
-	std::swap(m_specular, rhs.m_specular);
-	std::swap(m_normal, rhs.m_normal);
+	std::swap(m_global_set, rhs.m_global_set);
+	std::swap(m_uniforms, rhs.m_uniforms);
+	std::swap(m_instances, rhs.m_instances);
+	std::swap(m_default_textures, rhs.m_default_textures);
+	std::swap(m_material, rhs.m_material);
+	std::swap(m_bindless_textures, rhs.m_bindless_textures);
+	std::swap(m_lights, rhs.m_lights);
+	std::swap(m_shadow_atlas_layout, rhs.m_shadow_atlas_layout);
 }
 
 MaterialPipeline& MaterialPipeline::operator=(MaterialPipeline&& rhs) noexcept
@@ -595,12 +400,14 @@ MaterialPipeline& MaterialPipeline::operator=(MaterialPipeline&& rhs) noexcept
 	std::swap(m_layout, rhs.m_layout);
 	std::swap(m_pipeline, rhs.m_pipeline);
 	std::swap(m_global_set_layout, rhs.m_global_set_layout);
-	std::swap(m_global_set_layout, rhs.m_global_set_layout);
-	std::swap(m_global_set_uniforms, rhs.m_global_set_uniforms);
-	std::swap(m_ambient, rhs.m_ambient);
-	std::swap(m_diffuse, rhs.m_diffuse);
-	std::swap(m_specular, rhs.m_specular);
-	std::swap(m_normal, rhs.m_normal);
+	std::swap(m_global_set, rhs.m_global_set);
+	std::swap(m_uniforms, rhs.m_uniforms);
+	std::swap(m_instances, rhs.m_instances);
+	std::swap(m_default_textures, rhs.m_default_textures);
+	std::swap(m_material, rhs.m_material);
+	std::swap(m_bindless_textures, rhs.m_bindless_textures);
+	std::swap(m_lights, rhs.m_lights);
+	std::swap(m_shadow_atlas_layout, rhs.m_shadow_atlas_layout);
 	return *this;
 }
 
@@ -611,101 +418,75 @@ MaterialPipeline::~MaterialPipeline()
 void MaterialPipeline::render(MaterialPipeline::FrameInfo& frame_info,
 							  Logger& logger,
 							  vk::Device& device,
-							  vk::DescriptorPool descriptor_pool,
+							  DescriptorPool::Impl* descriptor_pool,
 							  vk::CommandBuffer& commandbuffer,
 							  CurrentFlightFrame const current_flightframe,
 							  MaxFlightFrames const max_frames_in_flight,
-							  std::vector<MaterialRenderable>& renderables,
+							  std::vector<MaterialRenderable> const& renderables,
 							  std::vector<Light>& lights,
-							  MaterialShadowCasters shadowcasters)
+							  MaterialShadowCasters shadowcasters,
+							  GpuCullPass* gpu_cull)
 {
-	if (!m_ambient.sets.contains(&m_ambient.default_texture)) {
-		m_ambient.sets.insert({&m_ambient.default_texture,
-							  create_texture_descriptorset(device,
-														   m_ambient.layout.get(),
-														   descriptor_pool,
-														   m_ambient.default_texture)});
-		logger.info(std::source_location::current(), "Created ambient default");
-	}
-	
-	if (!m_diffuse.sets.contains(&m_diffuse.default_texture)) {
-		m_diffuse.sets.insert({&m_diffuse.default_texture,
-							  create_texture_descriptorset(device,
-														   m_diffuse.layout.get(),
-														   descriptor_pool,
-														   m_diffuse.default_texture)});
-		logger.info(std::source_location::current(), "Created diffuse default");
-	}
-			
-	if (!m_specular.sets.contains(&m_specular.default_texture)) {
-		m_specular.sets.insert({&m_specular.default_texture,
-							  create_texture_descriptorset(device,
-														   m_specular.layout.get(),
-														   descriptor_pool,
-														   m_specular.default_texture)});
-		logger.info(std::source_location::current(), "Created specular default");
-	}
-	
-	if (!m_normal.sets.contains(&m_normal.default_texture)) {
-		m_normal.sets.insert({&m_normal.default_texture,
-							  create_texture_descriptorset(device,
-														   m_normal.layout.get(),
-														   descriptor_pool,
-														   m_normal.default_texture)});
-		logger.info(std::source_location::current(), "Created normal default");
+	TextureMaterial const default_material{
+		&m_default_textures.ambient,
+		&m_default_textures.diffuse,
+		&m_default_textures.specular,
+		&m_default_textures.normal,
+	};
+
+	if (!m_bindless_textures && !m_material.sets.contains(default_material)) {
+		m_material.sets.insert({default_material,
+							   create_material_descriptorset(device,
+															 m_material.layout.get(),
+															 descriptor_pool,
+															 default_material)});
+		logger.info(std::source_location::current(), "Created default material");
 	}
 	
+	/* Push this frames uniforms, in the binding order of the global set
+	 */
+	std::array<uint32_t, 2> dynamic_offsets{};
+
 	CameraUniformData camera_data;
 	camera_data.view = frame_info.view;
 	camera_data.proj = frame_info.proj;
 	camera_data.position = frame_info.camera_position;
-	m_global_set_uniforms[*current_flightframe].camera.write(device, &camera_data, 1);
+	dynamic_offsets[0] = m_uniforms->push(&camera_data, 1, camera_uniform_count);
 	
 	SortedLights sorted_lights;
 	std::ranges::for_each(lights, std::bind_front(sort_light, &logger, &sorted_lights));
 	
-	LightArrayLengthsUniformData lightarray_lengths_data{};
-	
-	if (!sorted_lights.points.empty()) {
-		std::vector<PointLightUniformData> data;
-		for (auto light: sorted_lights.points)
-			data.emplace_back(light);
-		
-		size_t const length = std::min(data.size(), max_pointlights);
-		m_global_set_uniforms[*current_flightframe].pointlight.write(device,
-																	 data.data(),
-																	 data.size());
-		lightarray_lengths_data.point_length = length;
-	}
-
-	if (!sorted_lights.spots.empty()) {
-		std::vector<SpotLightUniformData> data;
-		for (auto light: sorted_lights.spots)
-			data.emplace_back(light);
-
-		size_t const length = std::min(data.size(), max_spotlights);
-		m_global_set_uniforms[*current_flightframe].spotlight.write(device,
-																	data.data(),
-																	data.size());
-		lightarray_lengths_data.spot_length = length;
-	}
-
-	if (!sorted_lights.directionals.empty()) {
-		std::vector<DirectionalLightUniformData> data;
-		for (auto light: sorted_lights.directionals)
-			data.emplace_back(light);
-
-		size_t const length = std::min(data.size(), max_directionallights);
-		m_global_set_uniforms[*current_flightframe].directionallight.write(device,
-																		   data.data(),
-																		   data.size());
-		lightarray_lengths_data.directional_length = length;
+	ShadowCasters const no_casters{};
+	ShadowAtlasLayout const no_layout{};
+	std::vector<std::vector<ShadowCascade>> const no_cascades{};
+	ShadowCasters const& casters = shadowcasters.casters ? *shadowcasters.casters : no_casters;
+	ShadowAtlasLayout const& atlas = shadowcasters.layout ? *shadowcasters.layout : no_layout;
+	std::vector<std::vector<ShadowCascade>> const& cascades =
+		shadowcasters.cascades ? *shadowcasters.cascades : no_cascades;
+
+	/* The lights and shadow casters are packed into this frames storage buffers, with
+	 * clustered lights the point and spot lights are also binned into the clusters of the view.
+	 */
+	m_lights->upload(current_flightframe,
+					 frame_info.view,
+					 frame_info.proj,
+					 frame_info.extent,
+					 sorted_lights.directionals,
+					 sorted_lights.points,
+					 sorted_lights.spots,
+					 casters,
+					 atlas,
+					 cascades);
 
-	}
-
-	m_global_set_uniforms[*current_flightframe].lightarray_lengths.write(device,
-																		 &lightarray_lengths_data,
-																		 lightarray_lengths_count);
+	LightArrayLengthsUniformData lightarray_lengths_data{};
+	lightarray_lengths_data.point_length = static_cast<int>(sorted_lights.points.size());
+	lightarray_lengths_data.spot_length = static_cast<int>(sorted_lights.spots.size());
+	lightarray_lengths_data.directional_length = static_cast<int>(sorted_lights.directionals.size());
+	lightarray_lengths_data.directional_caster_length = static_cast<int>(casters.directional_casters.size());
+	lightarray_lengths_data.spot_caster_length = static_cast<int>(casters.spot_casters.size());
+	dynamic_offsets[1] = m_uniforms->push(&lightarray_lengths_data,
+										  1,
+										  lightarray_lengths_count);
 
 #if 0
 	const auto msg = std::format("Pointlights: {}\nSpotlights: {}\n DirLights: {}",
@@ -716,48 +497,21 @@ void MaterialPipeline::render(MaterialPipeline::FrameInfo& frame_info,
 				msg.c_str());
 #endif	
 	
-	if (shadowcasters.directional.caster.has_value()) {
-		DirectionalShadowCasterUniformData data(shadowcasters.directional.caster.value());
-		m_global_set_uniforms[*current_flightframe]
-			.directional_shadowcaster.write(device,
-											&data,
-											directional_shadowcasters_count);
-	}
-	else {
-		DirectionalShadowCasterUniformData data{};
-		data.exists = false;
-		m_global_set_uniforms[*current_flightframe]
-			.directional_shadowcaster.write(device,
-											&data,
-											directional_shadowcasters_count);
-	}
-	
-	if (shadowcasters.spot.caster.has_value()) {
-		SpotShadowCasterUniformData data(shadowcasters.spot.caster.value());
-		m_global_set_uniforms[*current_flightframe]
-			.spot_shadowcaster.write(device,
-									 &data,
-									 spot_shadowcasters_count);
-	}
-	else {
-		SpotShadowCasterUniformData data{};
-		data.exists = false;
-		m_global_set_uniforms[*current_flightframe]
-			.spot_shadowcaster.write(device,
-									 &data,
-									 spot_shadowcasters_count);
-	}
-
 	commandbuffer.bindPipeline(vk::PipelineBindPoint::eGraphics,
 							   m_pipeline.get());
 	
+	/* The global set, shadow atlas and lights stay bound for the whole pass,
+	 * only the material set is rebound when the material changes.
+	 * With bindless textures set 1 is the texture array, and nothing is rebound.
+	 */
 	//NOTE: thsese MUST match the indices of each individual set
-	std::array<vk::DescriptorSet, 5> init_sets{
-		m_global_set_uniforms[*current_flightframe].set.get(),
-		m_ambient.sets[&m_ambient.default_texture][*current_flightframe].get(),
-		m_diffuse.sets[&m_diffuse.default_texture][*current_flightframe].get(),
-		m_specular.sets[&m_specular.default_texture][*current_flightframe].get(),
-		m_normal.sets[&m_normal.default_texture][*current_flightframe].get(),
+	std::array<vk::DescriptorSet, 4> init_sets{
+		m_global_set.get(),
+		m_bindless_textures
+		? m_bindless_textures->set()
+		: m_material.get_set(default_material).value(),
+		shadowcasters.atlas,
+		m_lights->set(current_flightframe),
 	};
 
 	const uint32_t first_set = 0;
@@ -766,188 +520,111 @@ void MaterialPipeline::render(MaterialPipeline::FrameInfo& frame_info,
 									 first_set,
 									 init_sets.size(),
 									 init_sets.data(),
-									 0,
-									 nullptr);
-	
-	TextureSamplerReadOnly* last_ambient_texture = &m_ambient.default_texture;
-	TextureSamplerReadOnly* last_diffuse_texture = &m_diffuse.default_texture;
-	TextureSamplerReadOnly* last_specular_texture = &m_specular.default_texture;
-	TextureSamplerReadOnly* last_normal_texture = &m_normal.default_texture;
-
-	int i = 0;
-	for (MaterialRenderable& renderable: renderables) {
-		
-		TextureSamplerReadOnly* ambient_texture = renderable.texture.ambient 
-			? renderable.texture.ambient 
-			: &m_ambient.default_texture;
-		
-		if (ambient_texture != last_ambient_texture) {
-			if (!m_ambient.sets.contains(ambient_texture)) {
-				m_ambient.sets.insert({ambient_texture,
-									  create_texture_descriptorset(device,
-																   m_ambient.layout.get(),
-																   descriptor_pool,
-																   *ambient_texture)});
-
-				logger.info(std::source_location::current(),
-							"Added new ambient texture to cache");
-			}	
+									 dynamic_offsets.size(),
+									 dynamic_offsets.data());
+	
+	/* Consecutive renderables sharing a mesh and material are drawn instanced,
+	 * the models of all of them are written to the instance ring once.
+	 */
+	InstanceBatches batches{};
+	if (gpu_cull == nullptr) {
+		batches = batch_instances(*m_instances,
+								  renderables,
+								  [this] (MaterialRenderable const& lhs, MaterialRenderable const& rhs) {
+									  return lhs.mesh == rhs.mesh
+										  && texture_material(lhs) == texture_material(rhs);
+								  });
+		bind_instances(commandbuffer, batches);
+	}
+	else {
+		// NOTE the gpu cull pass was prepared with these renderables and the same batching,
+		//      the instances of every batch are bound when it is drawn.
+		batches.batches = gpu_cull->batches();
+	}
 
-			std::array<vk::DescriptorSet, 1> descriptorset{
-				m_ambient.sets[ambient_texture][*current_flightframe].get()
-			};
-			commandbuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
-											 m_layout.get(),
-											 *m_ambient.set_index,
-											 descriptorset.size(),
-											 descriptorset.data(),
-											 0,
-											 nullptr);
-			last_ambient_texture = ambient_texture;
-		}
+	TextureMaterial last_material = default_material;
+	TexturedMesh* last_mesh = nullptr;
 
-		TextureSamplerReadOnly* diffuse_texture = renderable.texture.diffuse 
-			? renderable.texture.diffuse 
-			: &m_diffuse.default_texture;
+	for (uint32_t batch_index = 0; batch_index < batches.batches.size(); batch_index++) {
+		InstanceBatch const& batch = batches.batches[batch_index];
+		MaterialRenderable const& renderable = renderables[batch.first];
+		TextureMaterial const material = texture_material(renderable);
 		
-		if (diffuse_texture != last_diffuse_texture) {
-			if (!m_diffuse.sets.contains(diffuse_texture)) {
-				m_diffuse.sets.insert({diffuse_texture,
-									  create_texture_descriptorset(device,
-																   m_diffuse.layout.get(),
-																   descriptor_pool,
-																   *diffuse_texture)});
-
-				logger.info(std::source_location::current(),
-							"Added new diffuse texture to cache");
-			}	
-
-			std::array<vk::DescriptorSet, 1> descriptorset{
-				m_diffuse.sets[diffuse_texture][*current_flightframe].get()
-			};
-			commandbuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
-											 m_layout.get(),
-											 *m_diffuse.set_index,
-											 descriptorset.size(),
-											 descriptorset.data(),
-											 0,
-											 nullptr);
-			last_diffuse_texture = diffuse_texture;
+		if (m_bindless_textures) {
+			BindlessPushConstants push{};
+			push.textures = glm::uvec4{m_bindless_textures->index(*material.ambient),
+									   m_bindless_textures->index(*material.diffuse),
+									   m_bindless_textures->index(*material.specular),
+									   m_bindless_textures->index(*material.normal)};
+			const uint32_t push_offset = 0;
+			commandbuffer.pushConstants(m_layout.get(),
+										vk::ShaderStageFlagBits::eFragment,
+										push_offset,
+										sizeof(push),
+										&push);
 		}
-	
-
-		TextureSamplerReadOnly* specular_texture = renderable.texture.specular 
-			? renderable.texture.specular 
-			: &m_specular.default_texture;
-		
-		if (specular_texture != last_specular_texture) {
-			if (!m_specular.sets.contains(specular_texture)) {
-				m_specular.sets.insert({specular_texture,
-									  create_texture_descriptorset(device,
-																   m_specular.layout.get(),
-																   descriptor_pool,
-																   *specular_texture)});
+		else if (material != last_material) {
+			std::optional<vk::DescriptorSet> material_set = m_material.get_set(material);
+			if (!material_set.has_value()) {
+				auto created = create_material_descriptorset(device,
+															 m_material.layout.get(),
+															 descriptor_pool,
+															 material);
+				material_set = created.get();
+				m_material.sets.insert({material, std::move(created)});
 
 				logger.info(std::source_location::current(),
-							"Added new specular texture to cache");
-			}	
+							"Added new material to cache");
+			}
 
 			std::array<vk::DescriptorSet, 1> descriptorset{
-				m_specular.sets[specular_texture][*current_flightframe].get()
+				material_set.value()
 			};
 			commandbuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
 											 m_layout.get(),
-											 *m_specular.set_index,
+											 *m_material.set_index,
 											 descriptorset.size(),
 											 descriptorset.data(),
 											 0,
 											 nullptr);
-			last_specular_texture = specular_texture;
+			last_material = material;
 		}
-		
-		TextureSamplerReadOnly* normal_texture = renderable.texture.normal 
-			? renderable.texture.normal 
-			: &m_normal.default_texture;
-		
-		if (normal_texture != last_normal_texture) {
-			if (!m_normal.sets.contains(normal_texture)) {
-				m_normal.sets.insert({normal_texture,
-									  create_texture_descriptorset(device,
-																   m_normal.layout.get(),
-																   descriptor_pool,
-																   *normal_texture)});
 
-				logger.info(std::source_location::current(),
-							"Added new normal texture to cache");
-			}	
+		if (renderable.mesh != last_mesh) {
+			bind_mesh_buffers(commandbuffer,
+							  renderable.mesh->vertexbuffer,
+							  renderable.mesh->indexbuffer);
+			last_mesh = renderable.mesh;
+		}
 
-			{
-			std::array<vk::DescriptorSet, 1> descriptorset{
-				m_normal.sets[normal_texture][*current_flightframe].get()
-			};
-			commandbuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
-											 m_layout.get(),
-											 *m_normal.set_index,
-											 descriptorset.size(),
-											 descriptorset.data(),
-											 0,
-											 nullptr);
-			last_normal_texture = normal_texture;
-			}
-			
-			{
-			std::array<vk::DescriptorSet, 1> descriptorset{
-				shadowcasters.directional.descriptorset
-			};
-			commandbuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
-											 m_layout.get(),
-											 directional_shadowcaster_set_index,
-											 descriptorset.size(),
-											 descriptorset.data(),
-											 0,
-											 nullptr);
-			}
-			
-			{
-			std::array<vk::DescriptorSet, 1> descriptorset{
-				shadowcasters.spot.descriptorset
-			};
-			commandbuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
-											 m_layout.get(),
-											 spot_shadowcaster_set_index,
-											 descriptorset.size(),
-											 descriptorset.data(),
-											 0,
-											 nullptr);
-			}
+		if (gpu_cull != nullptr) {
+			gpu_cull->draw(commandbuffer, batch_index, renderable.mesh->indexbuffer);
+			continue;
 		}
-	
-		PushConstants push{};
-		push.model = renderable.model;
-		const uint32_t push_offset = 0;
-		commandbuffer.pushConstants(m_layout.get(),
-									vk::ShaderStageFlagBits::eVertex,
-									push_offset,
-									sizeof(push),
-									&push);
-
-		const uint32_t firstBinding = 0;
-		const uint32_t bindingCount = 1;
-		std::array<vk::DeviceSize, bindingCount> offsets = {0};
-		std::array<vk::Buffer, bindingCount> buffers {
-			renderable.mesh->vertexbuffer.impl->buffer.get(),
-		};
-		commandbuffer.bindVertexBuffers(firstBinding,
-										bindingCount,
-										buffers.data(),
-										offsets.data());
-
-		const uint32_t instanceCount = 1;
-		const uint32_t firstVertex = 0;
-		const uint32_t firstInstance = 0;
-		commandbuffer.draw(renderable.mesh->vertexbuffer.impl->length,
-						   instanceCount,
-						   firstVertex,
-						   firstInstance);
+
+		record_draw(commandbuffer,
+					renderable.mesh->vertexbuffer,
+					renderable.mesh->indexbuffer,
+					batch.count,
+					batch.first);
 	}
 }
+
+auto MaterialPipeline::texture_material(MaterialRenderable const& renderable)
+	-> TextureMaterial
+{
+	return TextureMaterial{
+		renderable.texture.ambient 
+		? renderable.texture.ambient 
+		: &m_default_textures.ambient,
+		renderable.texture.diffuse 
+		? renderable.texture.diffuse 
+		: &m_default_textures.diffuse,
+		renderable.texture.specular 
+		? renderable.texture.specular 
+		: &m_default_textures.specular,
+		renderable.texture.normal 
+		? renderable.texture.normal 
+		: &m_default_textures.normal,
+	};
+}
@@ -19,6 +19,11 @@
 
 #include "LightUniforms.hpp"
 #include "PipelineUtils.hpp"
+#include "PipelineCache.hpp"
+#include "BindlessTextures.hpp"
+#include "InstanceBatch.hpp"
+#include "GpuCulling.hpp"
+#include "LightBuffers.hpp"
 
 #include <algorithm>
 #include <map>
@@ -47,7 +52,11 @@ struct MaterialPipeline
 							  Render::Context::Impl* context,
 							  Presenter::Impl* presenter,
 							  DescriptorPool::Impl* descriptor_pool,
+							  PipelineCache* pipeline_cache,
+							  BindlessTextures* bindless_textures,
+							  LightBuffers* lights,
 							  vk::RenderPass& renderpass,
+							  const bool depth_prepass,
 							  std::filesystem::path const shader_root_path);
 
 	~MaterialPipeline();
@@ -61,42 +70,40 @@ struct MaterialPipeline
 		glm::mat4 view;
 		glm::mat4 proj;
 		glm::vec3 camera_position;
+		vk::Extent2D extent;
 	};
 	
+	/* Every shadow caster has been rendered into its rect of the atlas,
+	 * the casters, their rects and the cascades of every directional caster
+	 * are written to the light buffers.
+	 */
 	struct MaterialShadowCasters
 	{
-		struct DirectionalShadowCasterTexture
-		{
-			vk::DescriptorSet descriptorset;
-			std::optional<DirectionalShadowCaster> caster;
-		};
-		DirectionalShadowCasterTexture directional;
-
-		struct SpotShadowCasterTexture
-		{
-			vk::DescriptorSet descriptorset;
-			std::optional<SpotShadowCaster> caster;
-		};
-		SpotShadowCasterTexture spot;
+		vk::DescriptorSet atlas;
+		ShadowCasters const* casters{nullptr};
+		ShadowAtlasLayout const* layout{nullptr};
+		std::vector<std::vector<ShadowCascade>> const* cascades{nullptr};
 	};
 	
 	void render(FrameInfo& frame_info,
 				Logger& logger,
 				vk::Device& device,
-				vk::DescriptorPool descriptor_pool,
+				DescriptorPool::Impl* descriptor_pool,
 				vk::CommandBuffer& commandbuffer,
 				CurrentFlightFrame const current_flightframe,
 				MaxFlightFrames const max_frames_in_flight,
-				std::vector<MaterialRenderable>& renderables,
+				std::vector<MaterialRenderable> const& renderables,
 				std::vector<Light>& lights,
-				MaterialShadowCasters shadowcasters);
+				MaterialShadowCasters shadowcasters,
+				GpuCullPass* gpu_cull = nullptr);
 
 	MaterialPipeline(MaterialPipeline&& rhs) noexcept;
 	MaterialPipeline& operator=(MaterialPipeline&& rhs) noexcept;
 	
 private:
-	struct PushConstants {
-		glm::mat4 model;
+	// NOTE the texture indices are only read by the fragment shader
+	struct BindlessPushConstants {
+		glm::uvec4 textures;
 	};
 	
 	vk::UniquePipelineLayout m_layout;
@@ -116,42 +123,43 @@ private:
 		int spot_length = 0;
 		int directional_length = 0;
 		int _padding1{0};
+		int directional_caster_length = 0;
+		int spot_caster_length = 0;
+		int _padding2[2]{0, 0};
 	};
 
 	static constexpr size_t camera_uniform_count = 1;
 	static constexpr size_t lightarray_lengths_count = 1;
-	static constexpr size_t directional_shadowcasters_count = 1;
-	static constexpr size_t spot_shadowcasters_count = 1;
 
-	static constexpr uint32_t directional_shadowcaster_set_index = 5;
-	static constexpr uint32_t spot_shadowcaster_set_index = 6;
+	static constexpr uint32_t shadow_atlas_set_index = 2;
+	static constexpr uint32_t light_set_index = 3;
 
-	static constexpr size_t max_pointlights = 10;
-	static constexpr size_t max_spotlights = 10;
-	static constexpr size_t max_directionallights = 10;
+	vk::UniqueDescriptorSetLayout m_global_set_layout;
+	// NOTE the frame data lives in the presenters uniform ring, selected by dynamic offsets
+	vk::UniqueDescriptorSet m_global_set;
+	UniformRing* m_uniforms{nullptr};
+	InstanceRing* m_instances{nullptr};
 
-	struct GlobalSetUniform
+	/* Used in place of the textures a MaterialRenderable does not have
+	 */
+	struct DefaultTextures
 	{
-		vk::UniqueDescriptorSet set;
-		UniformMemoryDirectWrite<CameraUniformData> camera; 
-		UniformMemoryDirectWrite<PointLightUniformData> pointlight; 
-		UniformMemoryDirectWrite<SpotLightUniformData> spotlight; 
-		UniformMemoryDirectWrite<DirectionalLightUniformData> directionallight; 
-		UniformMemoryDirectWrite<LightArrayLengthsUniformData> lightarray_lengths; 
-		UniformMemoryDirectWrite<DirectionalShadowCasterUniformData> directional_shadowcaster; 
-		UniformMemoryDirectWrite<SpotShadowCasterUniformData> spot_shadowcaster; 
+		TextureSamplerReadOnly ambient;
+		TextureSamplerReadOnly diffuse;
+		TextureSamplerReadOnly specular;
+		TextureSamplerReadOnly normal;
 	};
-	
-	vk::UniqueDescriptorSetLayout m_global_set_layout;
-	FlightFramesArray<GlobalSetUniform> m_global_set_uniforms;
+	DefaultTextures m_default_textures;
+
+	TextureMaterialDescriptorSet<DescriptorSetIndex{1}> m_material;
+	// NOTE replaces the material sets when set, the shader then indexes the textures
+	BindlessTextures* m_bindless_textures{nullptr};
+	// NOTE the storage buffers of every light, when clustered read per cluster by the shader
+	LightBuffers* m_lights{nullptr};
 
-	//TODO make all the samplers part of a single sampler uniform set
-	TextureDescriptor<DescriptorSetIndex{1}> m_ambient;
-	TextureDescriptor<DescriptorSetIndex{2}> m_diffuse;
-	TextureDescriptor<DescriptorSetIndex{3}> m_specular;
-	TextureDescriptor<DescriptorSetIndex{4}> m_normal;
+	auto texture_material(MaterialRenderable const& renderable)
+		-> TextureMaterial;
 
-	vk::UniqueDescriptorSetLayout m_directional_shadowmap_layout;
-	vk::UniqueDescriptorSetLayout m_spot_shadowmap_layout;
+	vk::UniqueDescriptorSetLayout m_shadow_atlas_layout;
 };
 
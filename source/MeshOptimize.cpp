@@ -0,0 +1,266 @@
+#include "MeshOptimize.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+auto compute_acmr(std::vector<uint32_t> const& indices,
+				  size_t vertex_count,
+				  uint32_t cache_size)
+	-> float
+{
+	const size_t triangle_count = indices.size() / 3;
+	if (triangle_count == 0)
+		return 0.0f;
+
+	// NOTE a vertex is in the fifo as long as fewer than cache_size
+	//      misses happened since it was last loaded.
+	std::vector<uint32_t> loaded_at(vertex_count, 0);
+	uint32_t time = cache_size + 1;
+	size_t misses = 0;
+	for (uint32_t index: indices) {
+		if (time - loaded_at[index] > cache_size) {
+			loaded_at[index] = time++;
+			misses++;
+		}
+	}
+	return static_cast<float>(misses) / static_cast<float>(triangle_count);
+}
+
+
+/* Forsyth vertex cache optimisation
+ */
+namespace
+{
+
+uint32_t constexpr forsyth_cache_size = 32;
+uint32_t constexpr invalid_triangle = ~0u;
+
+float forsyth_vertex_score(int cache_position, uint32_t active_triangles)
+{
+	if (active_triangles == 0)
+		return -1.0f;
+
+	float score = 0.0f;
+	if (cache_position >= 0) {
+		// the last triangle's vertices are scored equally,
+		// so the order they were added in does not matter.
+		if (cache_position < 3) {
+			score = 0.75f;
+		}
+		else {
+			const float scaler = 1.0f / static_cast<float>(forsyth_cache_size - 3);
+			score = std::pow(1.0f - static_cast<float>(cache_position - 3) * scaler, 1.5f);
+		}
+	}
+
+	// boost vertices with few triangles left, so lone triangles are not left behind
+	score += 2.0f * std::pow(static_cast<float>(active_triangles), -0.5f);
+	return score;
+}
+
+}
+
+void optimize_vertex_cache(std::vector<uint32_t>& indices,
+						   size_t vertex_count)
+{
+	const size_t triangle_count = indices.size() / 3;
+	if (triangle_count == 0)
+		return;
+
+	std::vector<uint32_t> active(vertex_count, 0);
+	for (uint32_t index: indices)
+		active[index]++;
+
+	// triangles per vertex, packed with offsets into one array
+	std::vector<uint32_t> offsets(vertex_count + 1, 0);
+	for (size_t v = 0; v < vertex_count; v++)
+		offsets[v + 1] = offsets[v] + active[v];
+	std::vector<uint32_t> adjacency(indices.size());
+	std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+	for (size_t t = 0; t < triangle_count; t++) {
+		for (size_t k = 0; k < 3; k++)
+			adjacency[fill[indices[3 * t + k]]++] = static_cast<uint32_t>(t);
+	}
+
+	std::vector<int> cache_position(vertex_count, -1);
+	std::vector<float> vertex_scores(vertex_count);
+	for (size_t v = 0; v < vertex_count; v++)
+		vertex_scores[v] = forsyth_vertex_score(-1, active[v]);
+
+	const auto score_triangle = [&] (uint32_t t) {
+		return vertex_scores[indices[3 * t + 0]]
+			+ vertex_scores[indices[3 * t + 1]]
+			+ vertex_scores[indices[3 * t + 2]];
+	};
+
+	std::vector<float> triangle_scores(triangle_count);
+	std::vector<bool> emitted(triangle_count, false);
+	uint32_t best = 0;
+	for (uint32_t t = 0; t < triangle_count; t++) {
+		triangle_scores[t] = score_triangle(t);
+		if (triangle_scores[t] > triangle_scores[best])
+			best = t;
+	}
+
+	std::vector<uint32_t> output{};
+	output.reserve(indices.size());
+	std::vector<uint32_t> cache{};
+	std::vector<uint32_t> next_cache{};
+	size_t scan_cursor = 0;
+
+	for (size_t n = 0; n < triangle_count; n++) {
+		if (best == invalid_triangle) {
+			// dead end, none of the cached vertices has triangles left.
+			while (emitted[scan_cursor])
+				scan_cursor++;
+			best = static_cast<uint32_t>(scan_cursor);
+		}
+
+		const uint32_t triangle = best;
+		emitted[triangle] = true;
+
+		next_cache.clear();
+		for (size_t k = 0; k < 3; k++) {
+			const uint32_t v = indices[3 * triangle + k];
+			output.push_back(v);
+			next_cache.push_back(v);
+
+			auto begin = adjacency.begin() + offsets[v];
+			auto end = begin + active[v];
+			auto found = std::find(begin, end, triangle);
+			if (found != end) {
+				std::iter_swap(found, end - 1);
+				active[v]--;
+			}
+		}
+
+		for (uint32_t v: cache) {
+			if (std::find(next_cache.begin(), next_cache.begin() + 3, v) == next_cache.begin() + 3)
+				next_cache.push_back(v);
+		}
+
+		for (size_t i = forsyth_cache_size; i < next_cache.size(); i++)
+			cache_position[next_cache[i]] = -1;
+		for (size_t i = 0; i < std::min<size_t>(forsyth_cache_size, next_cache.size()); i++)
+			cache_position[next_cache[i]] = static_cast<int>(i);
+
+		// rescore every vertex that moved, including the evicted ones
+		for (uint32_t v: next_cache)
+			vertex_scores[v] = forsyth_vertex_score(cache_position[v], active[v]);
+
+		best = invalid_triangle;
+		float best_score = -1.0f;
+		for (size_t i = 0; i < next_cache.size(); i++) {
+			const uint32_t v = next_cache[i];
+			for (uint32_t a = 0; a < active[v]; a++) {
+				const uint32_t t = adjacency[offsets[v] + a];
+				triangle_scores[t] = score_triangle(t);
+				if (i < forsyth_cache_size && triangle_scores[t] > best_score) {
+					best_score = triangle_scores[t];
+					best = t;
+				}
+			}
+		}
+
+		if (next_cache.size() > forsyth_cache_size)
+			next_cache.resize(forsyth_cache_size);
+		std::swap(cache, next_cache);
+	}
+
+	indices = std::move(output);
+}
+
+
+/* Overdraw optimisation
+ */
+void optimize_overdraw(std::vector<uint32_t>& indices,
+					   std::vector<glm::vec3> const& positions,
+					   float threshold)
+{
+	const size_t triangle_count = indices.size() / 3;
+	if (triangle_count < 2)
+		return;
+
+	const float acmr_before = compute_acmr(indices, positions.size());
+
+	/* Split into clusters at triangles where all three vertices miss the cache,
+	 * reordering clusters there barely changes the cache behaviour.
+	 */
+	uint32_t constexpr cache_size = 16;
+	std::vector<uint32_t> loaded_at(positions.size(), 0);
+	uint32_t time = cache_size + 1;
+	std::vector<size_t> cluster_starts{0};
+	for (size_t t = 0; t < triangle_count; t++) {
+		uint32_t misses = 0;
+		for (size_t k = 0; k < 3; k++) {
+			const uint32_t v = indices[3 * t + k];
+			if (time - loaded_at[v] > cache_size) {
+				loaded_at[v] = time++;
+				misses++;
+			}
+		}
+		if (misses == 3 && t != 0)
+			cluster_starts.push_back(t);
+	}
+	cluster_starts.push_back(triangle_count);
+
+	const size_t cluster_count = cluster_starts.size() - 1;
+	if (cluster_count < 2)
+		return;
+
+	/* Sort clusters by how much they face away from the mesh center,
+	 * outer clusters are likely to occlude the inner ones.
+	 */
+	glm::vec3 mesh_center{0.0f};
+	float mesh_area = 0.0f;
+	std::vector<glm::vec3> cluster_centers(cluster_count, glm::vec3{0.0f});
+	std::vector<glm::vec3> cluster_normals(cluster_count, glm::vec3{0.0f});
+	for (size_t c = 0; c < cluster_count; c++) {
+		float cluster_area = 0.0f;
+		for (size_t t = cluster_starts[c]; t < cluster_starts[c + 1]; t++) {
+			const glm::vec3 a = positions[indices[3 * t + 0]];
+			const glm::vec3 b = positions[indices[3 * t + 1]];
+			const glm::vec3 d = positions[indices[3 * t + 2]];
+			const glm::vec3 normal = glm::cross(b - a, d - a);
+			const float area = glm::length(normal);
+			const glm::vec3 center = (a + b + d) / 3.0f;
+			cluster_centers[c] += center * area;
+			cluster_normals[c] += normal;
+			cluster_area += area;
+		}
+		mesh_center += cluster_centers[c];
+		mesh_area += cluster_area;
+		if (cluster_area > 0.0f)
+			cluster_centers[c] /= cluster_area;
+	}
+	if (mesh_area > 0.0f)
+		mesh_center /= mesh_area;
+
+	std::vector<float> cluster_sort(cluster_count, 0.0f);
+	for (size_t c = 0; c < cluster_count; c++) {
+		const float length = glm::length(cluster_normals[c]);
+		if (length > 0.0f)
+			cluster_sort[c] = glm::dot(cluster_centers[c] - mesh_center,
+									   cluster_normals[c] / length);
+	}
+
+	std::vector<size_t> order(cluster_count);
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&] (size_t lhs, size_t rhs) {
+		return cluster_sort[lhs] > cluster_sort[rhs];
+	});
+
+	std::vector<uint32_t> reordered{};
+	reordered.reserve(indices.size());
+	for (size_t c: order) {
+		reordered.insert(reordered.end(),
+						 indices.begin() + 3 * cluster_starts[c],
+						 indices.begin() + 3 * cluster_starts[c + 1]);
+	}
+
+	if (compute_acmr(reordered, positions.size()) > acmr_before * threshold)
+		return;
+
+	indices = std::move(reordered);
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <VulkanRenderer/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * Average cache miss ratio, the number of vertex shader invocations per triangle
+ * for a fifo post-transform cache of the given size.
+ * 3.0 is the worst case of unindexed geometry, ~0.5-0.7 is a good result.
+ */
+[[nodiscard]]
+auto compute_acmr(std::vector<uint32_t> const& indices,
+				  size_t vertex_count,
+				  uint32_t cache_size = 16)
+	-> float;
+
+/**
+ * Reorder triangles to reuse the post-transform vertex cache,
+ * using Tom Forsyth's linear-speed vertex cache optimisation.
+ */
+void optimize_vertex_cache(std::vector<uint32_t>& indices,
+						   size_t vertex_count);
+
+/**
+ * Reorder clusters of the cache optimized triangles so that outward facing
+ * clusters are drawn first, reducing overdraw from any view.
+ * Clusters are split where the vertex cache is cold anyway, and the new order is
+ * discarded if the cache miss ratio grows by more than the threshold factor.
+ */
+void optimize_overdraw(std::vector<uint32_t>& indices,
+					   std::vector<glm::vec3> const& positions,
+					   float threshold);
+
+/**
+ * Reorder vertices in the order they are first referenced by the indices,
+ * so vertex fetches walk the buffer linearly. Unreferenced vertices are dropped.
+ */
+template<typename Vertex>
+void optimize_vertex_fetch(std::vector<Vertex>& vertices,
+						   std::vector<uint32_t>& indices)
+{
+	const uint32_t unmapped = ~0u;
+	std::vector<uint32_t> remap(vertices.size(), unmapped);
+	std::vector<Vertex> reordered{};
+	reordered.reserve(vertices.size());
+
+	for (uint32_t& index: indices) {
+		if (remap[index] == unmapped) {
+			remap[index] = static_cast<uint32_t>(reordered.size());
+			reordered.push_back(vertices[index]);
+		}
+		index = remap[index];
+	}
+
+	vertices = std::move(reordered);
+}
@@ -7,8 +7,11 @@
 
 #include "Utils.hpp"
 #include "VertexBufferImpl.hpp"
+#include "IndexBufferImpl.hpp"
+#include "PipelineCache.hpp"
 #include "VertexImpl.hpp"
 #include "Mesh.hpp"
+#include "InstanceBatch.hpp"
 
 #include <vector>
 
@@ -20,11 +23,6 @@ struct NormRenderPipeline
 	vk::UniqueDescriptorSetLayout descriptor_layout;
 	vk::UniqueDescriptorPool descriptor_pool;
 
-	struct PushConstants
-	{
-		glm::mat4 model;
-	};
-
 	/* The Camera descriptor loads persistent perspective
 	 * data, and should happen as a single descriptor load
 	 * every frame.
@@ -34,8 +32,12 @@ struct NormRenderPipeline
 		glm::mat4 view;
 		glm::mat4 proj;
 	};
-	std::vector<AllocatedMemory> descriptor_memories;
-	std::vector<vk::UniqueDescriptorSet> descriptor_sets;
+	// NOTE the camera is pushed to the presenters uniform ring every frame,
+	//      so a single set with a dynamic offset serves all frames in flight.
+	vk::UniqueDescriptorSet descriptor_set;
+	UniformRing* uniforms{nullptr};
+	// NOTE the models are pushed to the presenters instance ring every frame
+	InstanceRing* instances{nullptr};
 };
 
 struct NormColorRenderInfo
@@ -55,7 +57,7 @@ norm_render_pipeline_descriptorset_layout(vk::Device& device)
 		.setStageFlags(vk::ShaderStageFlagBits::eVertex)
 		.setBinding(0)
 		.setDescriptorCount(1)
-		.setDescriptorType(vk::DescriptorType::eUniformBuffer);
+		.setDescriptorType(vk::DescriptorType::eUniformBufferDynamic);
 	
 	const auto set_info = vk::DescriptorSetLayoutCreateInfo{}
 		.setFlags(vk::DescriptorSetLayoutCreateFlags())
@@ -67,8 +69,10 @@ norm_render_pipeline_descriptorset_layout(vk::Device& device)
 
 NormRenderPipeline
 create_norm_render_pipeline(Logger& logger,
-							vk::PhysicalDevice& physical_device,
+							UniformRing& uniforms,
+							InstanceRing& instances,
 							vk::Device& device,
+							PipelineCache* pipeline_cache,
 							vk::RenderPass& renderpass,
 							const uint32_t frames_in_flight,
 							const vk::Extent2D render_extent,
@@ -144,8 +148,8 @@ create_norm_render_pipeline(Logger& logger,
 		.setFlags(vk::PipelineDynamicStateCreateFlags())
 		.setDynamicStates(dynamicStates);
 	
-	const auto bindingDescriptions = binding_descriptions(VertexPosNormColor{});
-	const auto attributeDescriptions = attribute_descriptions(VertexPosNormColor{});
+	const auto bindingDescriptions = instanced_binding_descriptions(VertexPosNormColor{});
+	const auto attributeDescriptions = instanced_attribute_descriptions(VertexPosNormColor{});
 	
 	auto pipelineVertexInputStateCreateInfo = vk::PipelineVertexInputStateCreateInfo{}
 		.setFlags(vk::PipelineVertexInputStateCreateFlags())
@@ -216,24 +220,11 @@ create_norm_render_pipeline(Logger& logger,
 		.setAttachments(pipelineColorBlendAttachmentState)
 		.setBlendConstants({ 1.0f, 1.0f, 1.0f, 1.0f });
 	
-	const auto push_constant_range = vk::PushConstantRange{}
-		.setOffset(0)
-		.setSize(sizeof(NormRenderPipeline::PushConstants))
-		.setStageFlags(vk::ShaderStageFlagBits::eVertex);
-	
-	if (sizeof(NormRenderPipeline::PushConstants) > 128) {
-		logger.warn(std::source_location::current(), 
-					std::format("PushConstant size={} is larger than minimum supported (128)"
-								"This can cause compatability issues on some devices",
-								sizeof(NormRenderPipeline::PushConstants)));
-	}
-
 	pipeline.descriptor_layout = norm_render_pipeline_descriptorset_layout(device);
 	
     auto pipelineLayoutCreateInfo = vk::PipelineLayoutCreateInfo{}
 		.setFlags(vk::PipelineLayoutCreateFlags())
-		.setSetLayouts(pipeline.descriptor_layout.get())
-		.setPushConstantRanges(push_constant_range);
+		.setSetLayouts(pipeline.descriptor_layout.get());
 
 	pipeline.layout = 
 		device.createPipelineLayoutUnique(pipelineLayoutCreateInfo);
@@ -265,8 +256,8 @@ create_norm_render_pipeline(Logger& logger,
 		.setRenderPass(renderpass);
 
 	vk::ResultValue<vk::UniquePipeline> result =
-		device.createGraphicsPipelineUnique(nullptr,
-											graphicsPipelineCreateInfo);
+		pipeline_cache->create_graphics_pipeline(pipeline_name,
+												 graphicsPipelineCreateInfo);
 	
     switch (result.result) {
 	case vk::Result::eSuccess:
@@ -285,7 +276,7 @@ create_norm_render_pipeline(Logger& logger,
 	
 	std::array<vk::DescriptorPoolSize, 1> sizes {
 		vk::DescriptorPoolSize{}
-		.setType(vk::DescriptorType::eUniformBuffer)
+		.setType(vk::DescriptorType::eUniformBufferDynamic)
 		.setDescriptorCount(10),
 	};
 	
@@ -298,58 +289,36 @@ create_norm_render_pipeline(Logger& logger,
 	logger.info(std::source_location::current(),
 				"Created Descriptor Pool");
 	
-	for (uint32_t i = 0; i < frames_in_flight; i++) {
-		pipeline.descriptor_memories
-			.push_back(allocate_memory(physical_device,
-									   device,
-									   sizeof(NormRenderPipeline::Camera),
-									   vk::BufferUsageFlagBits::eTransferSrc
-									   | vk::BufferUsageFlagBits::eUniformBuffer,
-									   // Host Visible and Coherent allows direct
-									   // writes into the buffers without sync issues.
-									   vk::MemoryPropertyFlagBits::eHostVisible
-									   | vk::MemoryPropertyFlagBits::eHostCoherent));
-
-		const auto allocate_info = vk::DescriptorSetAllocateInfo{}
-			.setDescriptorPool(pipeline.descriptor_pool.get())
-			.setDescriptorSetCount(1)
-			.setSetLayouts(pipeline.descriptor_layout.get());
-		
-		auto sets = device.allocateDescriptorSetsUnique(allocate_info);
-		if (sets.size() != 1) {
-			logger.error(std::source_location::current(),
-						 "This system only allows handling 1 set per frame in flight"
-						 "\n if you want more sets find another way to store them..");
-		}
-		
-		pipeline.descriptor_sets.push_back(std::move(sets[0]));
+	pipeline.uniforms = &uniforms;
+	pipeline.instances = &instances;
 
-		const auto buffer_info = vk::DescriptorBufferInfo{}
-			.setBuffer(pipeline.descriptor_memories[i].buffer.get())
-			.setOffset(0)
-			.setRange(sizeof(NormRenderPipeline::Camera));
-		
-		const auto write_descriptor = vk::WriteDescriptorSet{}
-			.setDstBinding(0)
-			.setDstSet(pipeline.descriptor_sets[i].get())
-			.setDstArrayElement(0)
-			.setDescriptorCount(1)
-			.setDescriptorType(vk::DescriptorType::eUniformBuffer)
-			// here images can be set aswell
-			.setBufferInfo(buffer_info);
-		
-		const uint32_t write_count = 1;
-		const uint32_t copy_count = 0;
-		device.updateDescriptorSets(write_count,
-									&write_descriptor,
-									copy_count,
-									nullptr);
-	}
+	const auto allocate_info = vk::DescriptorSetAllocateInfo{}
+		.setDescriptorPool(pipeline.descriptor_pool.get())
+		.setDescriptorSetCount(1)
+		.setSetLayouts(pipeline.descriptor_layout.get());
+	
+	auto sets = device.allocateDescriptorSetsUnique(allocate_info);
+	pipeline.descriptor_set = std::move(sets[0]);
+
+	const auto buffer_info = uniforms.descriptor_info<NormRenderPipeline::Camera>();
+	
+	const auto write_descriptor = vk::WriteDescriptorSet{}
+		.setDstBinding(0)
+		.setDstSet(pipeline.descriptor_set.get())
+		.setDstArrayElement(0)
+		.setDescriptorCount(1)
+		.setDescriptorType(vk::DescriptorType::eUniformBufferDynamic)
+		.setBufferInfo(buffer_info);
+	
+	const uint32_t write_count = 1;
+	const uint32_t copy_count = 0;
+	device.updateDescriptorSets(write_count,
+								&write_descriptor,
+								copy_count,
+								nullptr);
 
 	logger.info(std::source_location::current(),
-				std::format("Allocated {} descriptor sets for {} frames in flight",
-							 pipeline.descriptor_sets.size(),
-							 frames_in_flight));
+				"Allocated camera descriptor set");
 	return pipeline;
 }
 
@@ -361,7 +330,7 @@ void draw_normcolors(vk::Device& device,
 					 std::vector<NormColorRenderable> renderables)
 {
 	/* Norm Direction Drawing uses a setup where the model is provided
-	 * in the push constant, and the view and proj is provided
+	 * per instance, and the view and proj is provided
 	 * in a camera descriptor set.
 	 */
 	
@@ -374,54 +343,42 @@ void draw_normcolors(vk::Device& device,
 	camera.view = info.view;
 	camera.proj = info.proj;
 
-	copy_to_allocated_memory(device,
-							 pipeline.descriptor_memories[frame_in_flight],
-							 reinterpret_cast<void*>(&camera),
-							 sizeof(camera));
+	const uint32_t camera_offset = pipeline.uniforms->push(camera);
 
 	const uint32_t first_set = 0;
 	const uint32_t descriptor_set_count = 1;
-	const uint32_t dynamic_offset_count = 0;
-	const uint32_t* dynamic_offsets = nullptr;
+	const uint32_t dynamic_offset_count = 1;
+	const uint32_t* dynamic_offsets = &camera_offset;
 	commandbuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
 									 pipeline.layout.get(),
 									 first_set,
 									 descriptor_set_count,
-									 &(pipeline.descriptor_sets[frame_in_flight].get()),
+									 &(pipeline.descriptor_set.get()),
 									 dynamic_offset_count,
 									 dynamic_offsets);
 	
 
-	for (auto renderable: renderables) {
-		NormRenderPipeline::PushConstants push{};
-		push.model = renderable.model;
-		const uint32_t push_offset = 0;
-		commandbuffer.pushConstants(pipeline.layout.get(),
-									vk::ShaderStageFlagBits::eVertex,
-									push_offset,
-									sizeof(push),
-									&push);
-		
-		
-		const uint32_t firstBinding = 0;
-		const uint32_t bindingCount = 1;
-		std::array<vk::DeviceSize, bindingCount> offsets = {0};
-		std::array<vk::Buffer, bindingCount> buffers {
-			renderable.mesh->vertexbuffer.impl->buffer.get(),
-		};
-		commandbuffer.bindVertexBuffers(firstBinding,
-										bindingCount,
-										buffers.data(),
-										offsets.data());
-		
-		
-		const uint32_t instanceCount = 1;
-		const uint32_t firstVertex = 0;
-		const uint32_t firstInstance = 0;
-		commandbuffer.draw(renderable.mesh->vertexbuffer.impl->length,
-						   instanceCount,
-						   firstVertex,
-						   firstInstance);
-		
+	/* Consecutive renderables of the same mesh are drawn instanced
+	 */
+	const InstanceBatches batches =
+		batch_instances(*pipeline.instances,
+						renderables,
+						[] (NormColorRenderable const& lhs, NormColorRenderable const& rhs) {
+							return lhs.mesh == rhs.mesh;
+						});
+	bind_instances(commandbuffer, batches);
+
+	for (InstanceBatch const& batch: batches.batches) {
+		NormColorRenderable const& renderable = renderables[batch.first];
+		// NOTE every batch is a new mesh, equal meshes are already in the same batch
+		bind_mesh_buffers(commandbuffer,
+						  renderable.mesh->vertexbuffer,
+						  renderable.mesh->indexbuffer);
+
+		record_draw(commandbuffer,
+					renderable.mesh->vertexbuffer,
+					renderable.mesh->indexbuffer,
+					batch.count,
+					batch.first);
 	}
 }
@@ -0,0 +1,204 @@
+#include "PipelineCache.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <format>
+#include <fstream>
+
+namespace
+{
+
+std::filesystem::path const cache_filename = "pipeline_cache.bin";
+
+}
+
+PipelineCache::PipelineCache(Logger logger,
+							 vk::PhysicalDevice physical_device,
+							 vk::Device device,
+							 bool creation_feedback,
+							 std::optional<std::filesystem::path> directory)
+	: m_logger(logger)
+	, m_device(device)
+	, m_properties(physical_device.getProperties())
+	, m_creation_feedback(creation_feedback)
+{
+	if (directory.has_value())
+		m_path = directory.value() / cache_filename;
+
+	const std::vector<char> initial_data = load();
+
+	const auto create_info = vk::PipelineCacheCreateInfo{}
+		.setFlags(vk::PipelineCacheCreateFlags())
+		.setInitialDataSize(initial_data.size())
+		.setPInitialData(initial_data.empty() ? nullptr : initial_data.data());
+
+	m_cache = m_device.createPipelineCacheUnique(create_info, nullptr);
+	m_logger.info(std::source_location::current(),
+				  std::format("Created PipelineCache with {} bytes of initial data",
+							  initial_data.size()));
+}
+
+PipelineCache::~PipelineCache()
+{
+	try {
+		save();
+	}
+	catch (std::exception const& e) {
+		m_logger.warn(std::source_location::current(),
+					  std::format("Could not save pipeline cache: {}", e.what()));
+	}
+}
+
+vk::PipelineCache PipelineCache::get() const noexcept
+{
+	return m_cache.get();
+}
+
+auto PipelineCache::load()
+	-> std::vector<char>
+{
+	if (!m_path.has_value() || !std::filesystem::exists(m_path.value())) {
+		m_logger.info(std::source_location::current(),
+					  "No pipeline cache file found, starting with an empty cache");
+		return {};
+	}
+
+	std::ifstream file(m_path.value(), std::ios::ate | std::ios::binary);
+	if (!file.is_open()) {
+		m_logger.warn(std::source_location::current(),
+					  std::format("Could not open pipeline cache file {}",
+								  m_path.value().string()));
+		return {};
+	}
+
+	const size_t size = static_cast<size_t>(file.tellg());
+	std::vector<char> data(size);
+	file.seekg(0);
+	file.read(data.data(), size);
+
+	if (!header_is_valid(data)) {
+		m_logger.warn(std::source_location::current(),
+					  std::format("Pipeline cache file {} was created for another device "
+								  "or driver, it is ignored",
+								  m_path.value().string()));
+		return {};
+	}
+	return data;
+}
+
+bool PipelineCache::header_is_valid(std::vector<char> const& data) const
+{
+	/* VkPipelineCacheHeaderVersionOne:
+	 * uint32 header size, uint32 header version, uint32 vendor id,
+	 * uint32 device id, uint8[VK_UUID_SIZE] pipeline cache uuid
+	 */
+	size_t constexpr header_size = 4 * sizeof(uint32_t) + VK_UUID_SIZE;
+	if (data.size() < header_size)
+		return false;
+
+	uint32_t fields[4];
+	std::memcpy(fields, data.data(), sizeof(fields));
+	const auto version = static_cast<uint32_t>(vk::PipelineCacheHeaderVersion::eOne);
+
+	return fields[0] >= header_size
+		&& fields[1] == version
+		&& fields[2] == m_properties.vendorID
+		&& fields[3] == m_properties.deviceID
+		&& std::memcmp(data.data() + sizeof(fields),
+					   m_properties.pipelineCacheUUID.data(),
+					   VK_UUID_SIZE) == 0;
+}
+
+auto PipelineCache::data_size() const
+	-> size_t
+{
+	size_t size = 0;
+	const auto result = m_device.getPipelineCacheData(m_cache.get(), &size, nullptr);
+	if (result != vk::Result::eSuccess)
+		return 0;
+	return size;
+}
+
+auto PipelineCache::create_graphics_pipeline(std::string const& name,
+											 vk::GraphicsPipelineCreateInfo const& create_info)
+	-> vk::ResultValue<vk::UniquePipeline>
+{
+	if (!m_creation_feedback) {
+		// NOTE without VK_EXT_pipeline_creation_feedback the only way to tell a hit
+		//      from a miss is whether the driver had to add new data to the cache,
+		//      pipelines created concurrently on other threads can make a hit look like a miss.
+		const size_t size_before = data_size();
+		const auto start = std::chrono::steady_clock::now();
+
+		auto result = m_device.createGraphicsPipelineUnique(m_cache.get(), create_info);
+
+		const auto elapsed = std::chrono::duration<double, std::milli>(
+			std::chrono::steady_clock::now() - start);
+		const bool hit = data_size() == size_before;
+
+		m_logger.info(std::source_location::current(),
+					  std::format("Pipeline {} created in {:.3f} ms (cache {})",
+								  name,
+								  elapsed.count(),
+								  hit ? "hit" : "miss"));
+		return result;
+	}
+
+	std::vector<vk::PipelineCreationFeedbackEXT> stage_feedbacks(create_info.stageCount);
+	vk::PipelineCreationFeedbackEXT feedback{};
+	auto feedback_info = vk::PipelineCreationFeedbackCreateInfoEXT{}
+		.setPNext(create_info.pNext)
+		.setPPipelineCreationFeedback(&feedback)
+		.setPipelineStageCreationFeedbacks(stage_feedbacks);
+
+	auto feedback_create_info = create_info;
+	feedback_create_info.setPNext(&feedback_info);
+
+	auto result = m_device.createGraphicsPipelineUnique(m_cache.get(), feedback_create_info);
+
+	if (!(feedback.flags & vk::PipelineCreationFeedbackFlagBitsEXT::eValid)) {
+		m_logger.info(std::source_location::current(),
+					  std::format("Pipeline {} created, the driver gave no feedback", name));
+		return result;
+	}
+
+	const bool hit = static_cast<bool>(
+		feedback.flags & vk::PipelineCreationFeedbackFlagBitsEXT::eApplicationPipelineCacheHit);
+	m_logger.info(std::source_location::current(),
+				  std::format("Pipeline {} created in {:.3f} ms (cache {})",
+							  name,
+							  static_cast<double>(feedback.duration) / 1e6,
+							  hit ? "hit" : "miss"));
+	return result;
+}
+
+void PipelineCache::save()
+{
+	if (!m_path.has_value())
+		return;
+
+	const std::vector<uint8_t> data = m_device.getPipelineCacheData(m_cache.get());
+
+	std::filesystem::create_directories(m_path.value().parent_path());
+
+	// NOTE written next to the cache first, so a crash while saving can never
+	//      leave a truncated cache file behind.
+	std::filesystem::path temporary = m_path.value();
+	temporary += ".tmp";
+	{
+		std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) {
+			m_logger.warn(std::source_location::current(),
+						  std::format("Could not write pipeline cache file {}",
+									  temporary.string()));
+			return;
+		}
+		file.write(reinterpret_cast<char const*>(data.data()), data.size());
+	}
+	std::filesystem::rename(temporary, m_path.value());
+
+	m_logger.info(std::source_location::current(),
+				  std::format("Saved {} bytes of pipeline cache to {}",
+							  data.size(),
+							  m_path.value().string()));
+}
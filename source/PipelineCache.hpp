@@ -0,0 +1,68 @@
+#pragma once
+
+#include <VulkanRenderer/Context.hpp>
+
+#include <vulkan/vulkan.hpp>
+
+#include <filesystem>
+#include <optional>
+#include <string>
+
+/**
+ * Wraps a vk::PipelineCache that is shared by every pipeline the renderer creates.
+ *
+ * When a directory is given the cache is loaded from it on construction and
+ * written back on destruction, so pipelines compiled by a previous run of the
+ * application do not have to be compiled again.
+ * A cache file is only used if its header matches the vendor, device and
+ * pipelineCacheUUID of the current physical device, otherwise the driver could
+ * reject it or worse, hand out pipelines built for another driver version.
+ */
+class PipelineCache
+{
+public:
+	PipelineCache(Logger logger,
+				  vk::PhysicalDevice physical_device,
+				  vk::Device device,
+				  bool creation_feedback,
+				  std::optional<std::filesystem::path> directory);
+	~PipelineCache();
+
+	PipelineCache(PipelineCache&) = delete;
+	PipelineCache& operator=(PipelineCache&) = delete;
+
+	[[nodiscard]]
+	vk::PipelineCache get() const noexcept;
+
+	/**
+	 * Create a graphics pipeline through the cache, logging how long it took and
+	 * whether it was found in the cache.
+	 */
+	[[nodiscard]]
+	auto create_graphics_pipeline(std::string const& name,
+								  vk::GraphicsPipelineCreateInfo const& create_info)
+		-> vk::ResultValue<vk::UniquePipeline>;
+
+	/**
+	 * Write the cache to the directory, does nothing if there is no directory.
+	 */
+	void save();
+
+private:
+	auto load()
+		-> std::vector<char>;
+
+	[[nodiscard]]
+	bool header_is_valid(std::vector<char> const& data) const;
+
+	[[nodiscard]]
+	auto data_size() const
+		-> size_t;
+
+	Logger m_logger;
+	vk::Device m_device;
+	vk::PhysicalDeviceProperties m_properties;
+	bool m_creation_feedback{false};
+	std::optional<std::filesystem::path> m_path{std::nullopt};
+	vk::UniquePipelineCache m_cache;
+};
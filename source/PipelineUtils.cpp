@@ -3,7 +3,7 @@
 
 auto create_descriptorset_for_texture(vk::Device device,
 									  vk::DescriptorSetLayout descriptorset_layout,
-									  vk::DescriptorPool descriptor_pool,
+									  DescriptorPool::Impl* descriptor_pool,
 									  size_t frames_in_flight,
 									  TextureSamplerReadOnly& texture)
 	-> std::vector<vk::UniqueDescriptorSet>
@@ -11,11 +11,11 @@ auto create_descriptorset_for_texture(vk::Device device,
 	std::vector<vk::UniqueDescriptorSet> sets;
 	for (uint32_t i = 0; i < frames_in_flight; i++) {
 		const auto allocate_info = vk::DescriptorSetAllocateInfo{}
-			.setDescriptorPool(descriptor_pool)
+			.setDescriptorPool(descriptor_pool->descriptor_pool.get())
 			.setDescriptorSetCount(1)
 			.setSetLayouts(descriptorset_layout);
 		
-		auto createdsets = device.allocateDescriptorSetsUnique(allocate_info);
+		auto createdsets = descriptor_pool->allocate(device, allocate_info);
 		sets.push_back(std::move(createdsets[0]));
 		
 		const auto image_info = vk::DescriptorImageInfo{}
@@ -83,40 +83,82 @@ auto create_shaderstage_infos(vk::Device device,
 	return shaderstage;
 }
 
-auto create_texture_descriptorset(vk::Device device,
-								  vk::DescriptorSetLayout descriptorset_layout,
-								  vk::DescriptorPool descriptor_pool,
-								  TextureSamplerReadOnly& texture)
-	-> FlightFramesArray<vk::UniqueDescriptorSet>
+auto create_vertex_shaderstage_info(vk::Device device,
+									VertexPath const vertex_path)
+	noexcept -> std::optional<VertexShaderStageInfo>
 {
-	FlightFramesArray<vk::UniqueDescriptorSet> sets;
+	auto vert = read_binary_file(vertex_path.get().string().c_str());
+	if (!vert)
+		return std::nullopt;
+	
+	auto vertexShaderModuleCreateInfo = vk::ShaderModuleCreateInfo{}
+		.setFlags(vk::ShaderModuleCreateFlags())
+		.setCode(*vert);
 
-	for (uint32_t i = 0; i < sets.size(); i++) {
-		const auto allocate_info = vk::DescriptorSetAllocateInfo{}
-			.setDescriptorPool(descriptor_pool)
-			.setDescriptorSetCount(1)
-			.setSetLayouts(descriptorset_layout);
-		
-		auto createdsets = device.allocateDescriptorSetsUnique(allocate_info);
-		sets[i] = std::move(createdsets[0]);
-		
-		const auto image_info = vk::DescriptorImageInfo{}
+	VertexShaderStageInfo shaderstage;
+	shaderstage.module = device.createShaderModuleUnique(vertexShaderModuleCreateInfo);
+	shaderstage.create_info = vk::PipelineShaderStageCreateInfo{}
+		.setStage(vk::ShaderStageFlagBits::eVertex)
+		.setFlags(vk::PipelineShaderStageCreateFlags())
+		.setModule(*shaderstage.module)
+		.setPName("main");
+	
+	return shaderstage;
+}
+
+size_t TextureMaterialHash::operator()(TextureMaterial const& material) const noexcept
+{
+	const std::hash<TextureSamplerReadOnly*> hasher{};
+	size_t hash = 0;
+	for (TextureSamplerReadOnly* texture: {material.ambient,
+										   material.diffuse,
+										   material.specular,
+										   material.normal}) {
+		hash ^= hasher(texture) + 0x9e3779b97f4a7c15 + (hash << 6) + (hash >> 2);
+	}
+	return hash;
+}
+
+auto create_material_descriptorset(vk::Device device,
+								   vk::DescriptorSetLayout descriptorset_layout,
+								   DescriptorPool::Impl* descriptor_pool,
+								   TextureMaterial const& material)
+	-> vk::UniqueDescriptorSet
+{
+	const auto allocate_info = vk::DescriptorSetAllocateInfo{}
+		.setDescriptorPool(descriptor_pool->descriptor_pool.get())
+		.setDescriptorSetCount(1)
+		.setSetLayouts(descriptorset_layout);
+	
+	auto createdsets = descriptor_pool->allocate(device, allocate_info);
+	vk::UniqueDescriptorSet set = std::move(createdsets[0]);
+
+	const auto image_info = [] (TextureSamplerReadOnly* texture) {
+		return vk::DescriptorImageInfo{}
 			.setImageLayout(vk::ImageLayout::eShaderReadOnlyOptimal)
-			.setImageView(texture.impl->view.get())
-			.setSampler(texture.impl->sampler.get());
-		
-		const std::array<vk::WriteDescriptorSet, 1> writes{
-			vk::WriteDescriptorSet{}
-			.setDstBinding(0)
+			.setImageView(texture->impl->view.get())
+			.setSampler(texture->impl->sampler.get());
+	};
+
+	//NOTE: these MUST match the bindings of the material set layout
+	const std::array<vk::DescriptorImageInfo, 4> image_infos{
+		image_info(material.ambient),
+		image_info(material.diffuse),
+		image_info(material.specular),
+		image_info(material.normal),
+	};
+
+	std::array<vk::WriteDescriptorSet, 4> writes{};
+	for (uint32_t binding = 0; binding < writes.size(); binding++) {
+		writes[binding] = vk::WriteDescriptorSet{}
+			.setDstBinding(binding)
 			.setDstArrayElement(0)
-			.setDstSet(sets[i].get())
+			.setDstSet(set.get())
 			.setDescriptorCount(1)
 			.setDescriptorType(vk::DescriptorType::eCombinedImageSampler)
-			.setImageInfo(image_info),
-		};
-
-		device.updateDescriptorSets(writes.size(), writes.data(), 0, nullptr);
+			.setImageInfo(image_infos[binding]);
 	}
 
-	return sets;
+	device.updateDescriptorSets(writes.size(), writes.data(), 0, nullptr);
+	return set;
 }
@@ -3,11 +3,14 @@
 #include <VulkanRenderer/StrongType.hpp>
 
 #include "ShaderTextureImpl.hpp"
+#include "DescriptorPoolImpl.hpp"
 #include "FlightFrames.hpp"
 
 #include <vulkan/vulkan.hpp>
 
 #include <map>
+#include <optional>
+#include <unordered_map>
 #include <utility>
 
 using BindingIndex = StrongType<uint32_t, struct BindingIndexTag>;
@@ -21,16 +24,11 @@ using DescriptorSetBindingIndex = StrongType<uint32_t, struct DescriptorSetBindi
 
 auto create_descriptorset_for_texture(vk::Device device,
 									  vk::DescriptorSetLayout descriptorset_layout,
-									  vk::DescriptorPool descriptor_pool,
+									  DescriptorPool::Impl* descriptor_pool,
 									  size_t frames_in_flight,
 									  TextureSamplerReadOnly& texture)
 	-> std::vector<vk::UniqueDescriptorSet>;
 
-auto create_texture_descriptorset(vk::Device device,
-								  vk::DescriptorSetLayout descriptorset_layout,
-								  vk::DescriptorPool descriptor_pool,
-								  TextureSamplerReadOnly& texture)
-	-> FlightFramesArray<vk::UniqueDescriptorSet>;
 
 struct ShaderStageInfos
 {
@@ -47,69 +45,19 @@ auto create_shaderstage_infos(vk::Device device,
 							  FragmentPath const fragment_path)
 	noexcept -> std::optional<ShaderStageInfos>;
 
-
-template<typename TData>
-struct UniformMemoryDirectWrite
+/**
+ * A vertex stage without a fragment stage, for depth only pipelines.
+ */
+struct VertexShaderStageInfo
 {
-	using Data = std::remove_cvref_t<TData>;
-	size_t m_count;
-	AllocatedMemory m_memory;
-	
-	UniformMemoryDirectWrite() = default;
-
-	UniformMemoryDirectWrite(const UniformMemoryDirectWrite& rhs) = delete;
-	UniformMemoryDirectWrite(UniformMemoryDirectWrite&& rhs)
-	{
-		std::swap(m_memory, rhs.m_memory);
-		std::swap(m_count, rhs.m_count);
-	}
-
-	UniformMemoryDirectWrite& operator=(const UniformMemoryDirectWrite&) = delete;
-	UniformMemoryDirectWrite& operator=(UniformMemoryDirectWrite&& rhs)
-	{
-		std::swap(m_memory, rhs.m_memory);
-		std::swap(m_count, rhs.m_count);
-		return *this;
-	}
-
-	explicit UniformMemoryDirectWrite(vk::PhysicalDevice physical_device,
-									  vk::Device device,
-									  size_t count)
-	{
-		m_count = (count < 1) ? 1 : count;
-		m_memory = allocate_memory(physical_device,
-								   device,
-								   sizeof(Data) * m_count,
-								   vk::BufferUsageFlagBits::eTransferSrc
-								   | vk::BufferUsageFlagBits::eUniformBuffer,
-								   // Host Visible and Coherent allows direct
-								   // writes into the buffers without sync issues.
-								   // but it can be slower overall
-								   vk::MemoryPropertyFlagBits::eHostVisible
-								   | vk::MemoryPropertyFlagBits::eHostCoherent);
-	}
-	
-	void write(vk::Device device, Data* data, size_t length)
-	{
-		if (length == 0) return;
-		if (length > m_count) length = m_count;
-		copy_to_allocated_memory(device,
-								 m_memory,
-								 reinterpret_cast<void*>(data),
-								 sizeof(Data) * length);
-	}
-	
-	vk::DescriptorBufferInfo& buffer_info() const
-	{
-		static auto info = vk::DescriptorBufferInfo{}
-			.setBuffer(m_memory.buffer.get())
-			.setOffset(0)
-			.setRange(sizeof(Data) * m_count);
-		return info;
-	}
-	
+	vk::UniqueShaderModule module;
+	vk::PipelineShaderStageCreateInfo create_info;
 };
 
+auto create_vertex_shaderstage_info(vk::Device device,
+									VertexPath const vertex_path)
+	noexcept -> std::optional<VertexShaderStageInfo>;
+
 
 template<typename Data>
 struct UniformBuffer
@@ -123,13 +71,12 @@ struct UniformBuffer
 
 	explicit UniformBuffer(UniformDataType* init,
 						   Logger& logger,
-						   vk::PhysicalDevice physical_device,
+						   DeviceAllocator& allocator,
 						   vk::Device device,
 						   vk::DescriptorPool pool,
 						   vk::DescriptorSetLayout layout)
 	{
-		m_memory = allocate_memory(physical_device,
-								   device,
+		m_memory = allocate_memory(allocator,
 								   sizeof(UniformDataType),
 								   vk::BufferUsageFlagBits::eTransferSrc
 								   | vk::BufferUsageFlagBits::eUniformBuffer,
@@ -157,8 +104,7 @@ struct UniformBuffer
 			.setOffset(0)
 			.setRange(sizeof(UniformDataType));
 		
-		copy_to_allocated_memory(device,
-								 m_memory,
+		copy_to_allocated_memory(m_memory,
 								 reinterpret_cast<void*>(init),
 								 sizeof(UniformDataType));
 		
@@ -195,20 +141,9 @@ struct Uniform {
 	FlightFramesArray<BufferType> buffers;
 };
 
-template <DescriptorSetIndex t_set_index>
-struct TextureDescriptor
-{
-	DescriptorSetIndex static constexpr set_index = t_set_index;
-	TextureSamplerReadOnly default_texture;
-	vk::UniqueDescriptorSetLayout layout;
-	std::map<TextureSamplerReadOnly*, FlightFramesArray<vk::UniqueDescriptorSet>> sets;
-};
-
-
-
-//TODO: This was an attempt at making it nice to automatically get textures
-//      for a material, but it was abandoned..
-#if 0
+/**
+ * The four textures a material is drawn with, used as the key of its descriptor set.
+ */
 struct TextureMaterial
 {
 	TextureSamplerReadOnly* ambient;
@@ -216,36 +151,42 @@ struct TextureMaterial
 	TextureSamplerReadOnly* specular;
 	TextureSamplerReadOnly* normal;
 	
-	bool operator==(TextureMaterial const& rhs) const
-	{
-		return ambient == rhs.ambient
-			&& diffuse == rhs.diffuse
-			&& specular == rhs.specular
-			&& normal == rhs.normal;
-	}
+	bool operator==(TextureMaterial const& rhs) const = default;
 };
 
+struct TextureMaterialHash
+{
+	size_t operator()(TextureMaterial const& material) const noexcept;
+};
+
+/**
+ * Allocate a set with the ambient, diffuse, specular and normal samplers
+ * of material written to bindings 0 to 3.
+ */
+auto create_material_descriptorset(vk::Device device,
+								   vk::DescriptorSetLayout descriptorset_layout,
+								   DescriptorPool::Impl* descriptor_pool,
+								   TextureMaterial const& material)
+	-> vk::UniqueDescriptorSet;
+
+/**
+ * A single descriptor set per material, holding all four samplers.
+ * NOTE the textures of a material never change after the set is written,
+ *      so one set is shared by all frames in flight.
+ */
 template <DescriptorSetIndex t_set_index>
 struct TextureMaterialDescriptorSet
 {
-	using MaterialDescriptorSet = std::pair<
-		TextureMaterial,
-		FlightFramesArray<vk::UniqueDescriptorSet>>;
-
 	DescriptorSetIndex static constexpr set_index = t_set_index;
-	TextureMaterial default_material;
 	vk::UniqueDescriptorSetLayout layout;
-	std::vector<MaterialDescriptorSet> sets;
+	std::unordered_map<TextureMaterial, vk::UniqueDescriptorSet, TextureMaterialHash> sets;
 	
-	auto get_set(TextureMaterial const& material, CurrentFlightFrame flightframe)
+	auto get_set(TextureMaterial const& material)
 		-> std::optional<vk::DescriptorSet>
 	{
-		for (MaterialDescriptorSet const& set: sets) {
-			if (set.first == material)
-				return set.second[*flightframe].get();
-		}
-		
-		return std::nullopt;
+		auto it = sets.find(material);
+		if (it == sets.end())
+			return std::nullopt;
+		return it->second.get();
 	}
 };
-#endif
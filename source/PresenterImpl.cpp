@@ -8,6 +8,11 @@ vk::CommandPool& Presenter::Impl::command_pool()
 	return commandpool.get();
 }
 
+vk::CommandBuffer& Presenter::Impl::current_commandbuffer()
+{
+	return commandbuffers[current_frame_in_flight].get();
+}
+
 Presenter::Impl::~Impl()
 {
 	// TODO: Port over the ResourceWrapperRuntime so we can automatically destroy all this stuff..
@@ -27,6 +32,9 @@ Presenter::Impl::Impl(Render::Context::Impl* context, Logger logger)
 	CreateCommandbuffers();
 	CreateSyncObjects();
 	CreateRenderTargets();
+	CreateUniformRing();
+	CreateInstanceRing();
+	CreateFrameGraph();
 }
 
 void Presenter::Impl::CreateSwapChain()
@@ -207,17 +215,6 @@ void Presenter::Impl::CreateRenderTargets()
 										   extent.height},
 									   TextureFormat::R8G8B8A8Srgb);
 
-		with_buffer_submit(context->device.get(),
-						   command_pool(),
-						   context->graphics_queue(),
-						   [&] (vk::CommandBuffer& commandbuffer)
-						   {
-							   texture.layout =
-								  transition_image_for_color_override(texture.image(),
-																	  commandbuffer);
-
-						   });
-		
 		rendertargets.push_back(std::move(texture));
 	}
 
@@ -273,59 +270,47 @@ void Presenter::Impl::CreateSyncObjects()
 				"Created Sync objects for Presenter");
 }
 
+void Presenter::Impl::CreateUniformRing()
+{
+	// NOTE every pipeline pushes its camera/light uniforms once per frame,
+	//      this leaves plenty of room for more passes.
+	vk::DeviceSize constexpr frame_size = 256 * 1024;
+	uniform_ring = std::make_unique<UniformRing>(logger,
+												 *context->allocator,
+												 context->physical_device,
+												 frame_size,
+												 max_frames_in_flight);
+}
+
+void Presenter::Impl::CreateInstanceRing()
+{
+	// NOTE room for 16k model matrices per frame to start with, shared by the shadow and
+	//      geometry passes. A frame that needs more grows, instead of running out.
+	vk::DeviceSize constexpr frame_size = 16384 * sizeof(glm::mat4);
+	instance_ring = std::make_unique<InstanceRing>(logger,
+												   *context->allocator,
+												   frame_size,
+												   max_frames_in_flight);
+}
+
+void Presenter::Impl::CreateFrameGraph()
+{
+	frame_graph = std::make_unique<RenderGraph>(logger,
+												context->allocator.get(),
+												MaxFlightFrames{static_cast<uint32_t>(max_frames_in_flight)},
+												context->optional_extensions.synchronization2);
+}
+
 void
 Presenter::Impl::RecordBlitTextureToSwapchain(vk::CommandBuffer& commandbuffer,
-											 vk::Image& swapchain_image,
+											 vk::Image swapchain_image,
 											 Texture2D::Impl* texture)
 {
-	auto printImageBarrierTransition = [&] (const std::string name, 
-											const vk::ImageMemoryBarrier& barrier)
-	{
-		if (!per_frame_debug_print)
-			return;
-		std::cout << "Transfered " << name << " from " 
-				  << vk::to_string(barrier.oldLayout) << " to "
-				  << vk::to_string(barrier.newLayout) << "\n"
-				  << "=======================================" 
-				  << std::endl;
-	};
-
 	if (per_frame_debug_print) {
 		std::cout << "=======================================" << std::endl;
 		std::cout << "=======================================" << std::endl;
 	}
-	
-	commandbuffer.reset(vk::CommandBufferResetFlags());
-	const auto beginInfo = vk::CommandBufferBeginInfo{};
-	commandbuffer.begin(beginInfo);
 
-	if (true) {
-		auto range = vk::ImageSubresourceRange{}
-			.setAspectMask(vk::ImageAspectFlagBits::eColor)
-			.setBaseMipLevel(0)
-			.setLevelCount(1)
-			.setBaseArrayLayer(0)
-			.setLayerCount(1);
-		
-		auto barrier = vk::ImageMemoryBarrier{}
-			.setImage(swapchain_image)
-			.setSubresourceRange(range)
-			.setOldLayout(vk::ImageLayout::eUndefined)
-			.setNewLayout(vk::ImageLayout::eTransferDstOptimal)
-			.setSrcAccessMask(vk::AccessFlagBits::eTransferRead)
-			.setDstAccessMask(vk::AccessFlags())
-			.setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
-			.setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED);
-		
-		commandbuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
-									  vk::PipelineStageFlagBits::eTransfer,
-									  vk::DependencyFlags(),
-									  nullptr,
-									  nullptr,
-									  barrier);
-
-		printImageBarrierTransition("SwapChain image", barrier);
-	}
 	if (true) {
 		auto src_subresource = vk::ImageSubresourceLayers{}
 			.setAspectMask(vk::ImageAspectFlagBits::eColor)
@@ -371,35 +356,6 @@ Presenter::Impl::RecordBlitTextureToSwapchain(vk::CommandBuffer& commandbuffer,
 			std::cout << "=======================================" << std::endl;
 		}
 	}
-	if (true) {
-		auto range = vk::ImageSubresourceRange{}
-			.setAspectMask(vk::ImageAspectFlagBits::eColor)
-			.setBaseMipLevel(0)
-			.setLevelCount(1)
-			.setBaseArrayLayer(0)
-			.setLayerCount(1);
-		
-		auto barrier = vk::ImageMemoryBarrier{}
-			.setImage(swapchain_image)
-			.setSubresourceRange(range)
-			.setOldLayout(vk::ImageLayout::eTransferDstOptimal)
-			.setNewLayout(vk::ImageLayout::ePresentSrcKHR)
-			.setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
-			.setDstAccessMask(vk::AccessFlagBits::eTransferRead)
-			.setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
-			.setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED);
-		
-		commandbuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
-									  vk::PipelineStageFlagBits::eTransfer,
-									  vk::DependencyFlags(),
-									  nullptr,
-									  nullptr,
-									  barrier);
-
-		printImageBarrierTransition("SwapChain Image", barrier);
-	}
-
-	commandbuffer.end();
 }
 
 
@@ -410,8 +366,6 @@ void Presenter::Impl::with_presentation(FrameProducer& currentFrameGenerator)
 	auto waitresult = context->device->waitForFences(*(inFlightFences[current_frame_in_flight]),
 													 true,
 													 maxTimeout);
-	context->device->resetFences(*(inFlightFences[current_frame_in_flight]));
-
 	if (waitresult != vk::Result::eSuccess) {
 		logger.error(std::source_location::current(), 
 					 "Could not wait for inFlightFence");
@@ -435,6 +389,17 @@ void Presenter::Impl::with_presentation(FrameProducer& currentFrameGenerator)
 				  << std::endl;
 	}
 	
+	// NOTE the fence has been waited on, so the commandbuffer of this flight frame
+	//      and every resource indexed by it is no longer in use by the gpu.
+	vk::CommandBuffer& commandbuffer = current_commandbuffer();
+	uniform_ring->begin_frame(CurrentFlightFrame{current_frame_in_flight});
+	instance_ring->begin_frame(CurrentFlightFrame{current_frame_in_flight});
+	frame_graph->begin_frame();
+	commandbuffer.reset(vk::CommandBufferResetFlags());
+	const auto beginInfo = vk::CommandBufferBeginInfo{}
+		.setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
+	commandbuffer.begin(beginInfo);
+
 	CurrentFrameInfo currentFrameInfo;
 	currentFrameInfo.current_flight_frame_index = current_frame_in_flight;
 	currentFrameInfo.total_frame_count = total_frames;
@@ -442,15 +407,43 @@ void Presenter::Impl::with_presentation(FrameProducer& currentFrameGenerator)
 	std::optional<Texture2D::Impl*> frameToPresent = std::invoke(currentFrameGenerator,
 																 currentFrameInfo);
 	if (!frameToPresent.has_value()) {
+		commandbuffer.end();
 		const auto msg = "SwapChain has not implemented a way to present the old"
 								 " swapchain image if generator returns nullopt";
 		logger.error(std::source_location::current(), msg);
 		throw std::runtime_error(msg);
 	}
 	
-	RecordBlitTextureToSwapchain(commandbuffers[current_frame_in_flight].get(),
-								 swapchain_images[swapchain_index],
-								 frameToPresent.value());
+	/* The blit is the last pass of the frame graph, it is what makes the swapchain
+	 * image an output, so every pass the presented texture depends on is kept.
+	 * NOTE the texture was usually imported by the producer already, importing it
+	 *      again refers to the same image of the graph.
+	 */
+	Texture2D::Impl* texture = frameToPresent.value();
+	vk::Image swapchain_image = swapchain_images[swapchain_index];
+	const RenderGraphImage presented =
+		frame_graph->import_image(RenderGraphImport{"Presented texture",
+													texture->image(),
+													vk::ImageAspectFlagBits::eColor});
+	const RenderGraphImage swapchain_target =
+		frame_graph->import_image(RenderGraphImport{"Swapchain image",
+													swapchain_image,
+													vk::ImageAspectFlagBits::eColor,
+													RenderGraphAccess::None,
+													vk::PipelineStageFlagBits2KHR::eTransfer,
+													RenderGraphAccess::Present});
+	frame_graph->add_pass(RenderGraphPass{
+			"Swapchain blit",
+			{
+				RenderGraphUse{presented, RenderGraphAccess::TransferSrc},
+				RenderGraphUse{swapchain_target, RenderGraphAccess::TransferDst, true},
+			},
+			[this, swapchain_image, texture] (vk::CommandBuffer& commandbuffer, RenderGraph const&) {
+				RecordBlitTextureToSwapchain(commandbuffer, swapchain_image, texture);
+			}});
+
+	frame_graph->execute(commandbuffer);
+	commandbuffer.end();
 
 	const std::vector<vk::Semaphore> waitSemaphores{
 		*(imageAvailableSemaphores[current_frame_in_flight]),
@@ -459,8 +452,11 @@ void Presenter::Impl::with_presentation(FrameProducer& currentFrameGenerator)
 		*(renderFinishedSemaphores[current_frame_in_flight]),
 	};
 	
+	// NOTE the swapchain image is only touched by the blit, so the shadow and
+	//      geometry passes of the frame can run before the image is available.
+	//      The frame graph imports the swapchain image as waited on in this stage.
 	const std::vector<vk::PipelineStageFlags> waitStages{
-		vk::PipelineStageFlagBits::eColorAttachmentOutput,
+		vk::PipelineStageFlagBits::eTransfer,
 	};
 
 	auto submitInfo = vk::SubmitInfo{}
@@ -469,8 +465,18 @@ void Presenter::Impl::with_presentation(FrameProducer& currentFrameGenerator)
 		.setCommandBuffers(*(commandbuffers[current_frame_in_flight]))
 		.setSignalSemaphores(signalSemaphores);
 	
-	::present_queue(context->index_queues).submit(submitInfo,
-												  *(inFlightFences[current_frame_in_flight]));
+	// NOTE uploads recorded while producing the frame (or before it) are submitted
+	//      ahead of it on the same queue, so the frame sees them completed.
+	context->upload_queue->flush();
+	std::scoped_lock queue_lock(context->queue_mutex);
+
+	// NOTE reset as late as possible, so an exception thrown while producing the
+	//      frame does not leave the fence unsignaled forever.
+	context->device->resetFences(*(inFlightFences[current_frame_in_flight]));
+	// NOTE the commandbuffer holds the whole frame, so it has to go to the queue
+	//      family the commandpool was created for.
+	context->graphics_queue().submit(submitInfo,
+									 *(inFlightFences[current_frame_in_flight]));
 
 	const std::vector<vk::SwapchainKHR> swapchains = {*swapchain};
 	const std::vector<uint32_t> imageIndices = {swapchain_index};
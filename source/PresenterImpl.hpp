@@ -4,6 +4,9 @@
 #include <VulkanRenderer/Texture.hpp>
 #include "ContextImpl.hpp"
 #include "Utils.hpp"
+#include "UniformRing.hpp"
+#include "InstanceRing.hpp"
+#include "RenderGraph.hpp"
 
 class Presenter::Impl 
 {
@@ -14,6 +17,11 @@ public:
 	void with_presentation(FrameProducer& f);
 	vk::CommandPool& command_pool();
 
+	// NOTE the commandbuffer of the current frame in flight is begun before the
+	//      FrameProducer is invoked, and submitted once after the swapchain blit.
+	//      The frame graph is executed into it.
+	vk::CommandBuffer& current_commandbuffer();
+
 	Render::Context::Impl* context;
 	Logger logger;
 
@@ -38,6 +46,15 @@ public:
 	std::vector<vk::UniqueSemaphore> imageAvailableSemaphores;
 	std::vector<vk::UniqueSemaphore> renderFinishedSemaphores;
 	std::vector<vk::UniqueFence> inFlightFences;
+
+	// NOTE rewound to the current flight frame once its fence has been waited on.
+	std::unique_ptr<UniformRing> uniform_ring;
+	std::unique_ptr<InstanceRing> instance_ring;
+
+	// NOTE begun once the fence of the current flight frame has been waited on, everything
+	//      that renders a frame adds its passes to it while the FrameProducer is invoked.
+	//      The swapchain blit is added last, then the graph is executed.
+	std::unique_ptr<RenderGraph> frame_graph;
 	
 private:
 	void CreateSwapChain();
@@ -45,9 +62,13 @@ private:
 	void CreateCommandbuffers();
 	void CreateRenderTargets();
 	void CreateSyncObjects();
+	void CreateUniformRing();
+	void CreateInstanceRing();
+	void CreateFrameGraph();
 
+	// NOTE the frame graph places the texture and swapchain image in their transfer layouts
 	void RecordBlitTextureToSwapchain(vk::CommandBuffer& commandbuffer,
-									  vk::Image& swapchain_image,
+									  vk::Image swapchain_image,
 									  Texture2D::Impl* texture);
 
 };
@@ -0,0 +1,511 @@
+#include "RenderGraph.hpp"
+
+#include "Utils.hpp"
+
+#include <algorithm>
+#include <format>
+#include <numeric>
+
+namespace
+{
+
+struct AccessInfo
+{
+	vk::ImageLayout layout;
+	vk::PipelineStageFlags2KHR stages;
+	vk::AccessFlags2KHR access;
+	bool writes;
+};
+
+auto access_info(RenderGraphAccess access)
+	-> AccessInfo
+{
+	using Stage = vk::PipelineStageFlagBits2KHR;
+	using Access = vk::AccessFlagBits2KHR;
+
+	switch (access) {
+	case RenderGraphAccess::None:
+		return AccessInfo{vk::ImageLayout::eUndefined, {}, {}, false};
+	case RenderGraphAccess::ColorAttachment:
+		return AccessInfo{vk::ImageLayout::eColorAttachmentOptimal,
+						  Stage::eColorAttachmentOutput,
+						  Access::eColorAttachmentRead | Access::eColorAttachmentWrite,
+						  true};
+	case RenderGraphAccess::DepthAttachment:
+		return AccessInfo{vk::ImageLayout::eDepthStencilAttachmentOptimal,
+						  Stage::eEarlyFragmentTests | Stage::eLateFragmentTests,
+						  Access::eDepthStencilAttachmentRead | Access::eDepthStencilAttachmentWrite,
+						  true};
+	case RenderGraphAccess::FragmentSampled:
+		return AccessInfo{vk::ImageLayout::eShaderReadOnlyOptimal,
+						  Stage::eFragmentShader,
+						  Access::eShaderRead,
+						  false};
+	case RenderGraphAccess::TransferSrc:
+		return AccessInfo{vk::ImageLayout::eTransferSrcOptimal,
+						  Stage::eTransfer,
+						  Access::eTransferRead,
+						  false};
+	case RenderGraphAccess::TransferDst:
+		return AccessInfo{vk::ImageLayout::eTransferDstOptimal,
+						  Stage::eTransfer,
+						  Access::eTransferWrite,
+						  true};
+	case RenderGraphAccess::Present:
+		// NOTE the presentation engine waits on the semaphore of the submit, not on a stage
+		return AccessInfo{vk::ImageLayout::ePresentSrcKHR, Stage::eBottomOfPipe, {}, false};
+	}
+	return AccessInfo{vk::ImageLayout::eUndefined, {}, {}, false};
+}
+
+// NOTE the stages and accesses of synchronization2 that the legacy flags have share their bits
+auto legacy_stages(vk::PipelineStageFlags2KHR stages)
+	-> vk::PipelineStageFlags
+{
+	return vk::PipelineStageFlags(static_cast<VkPipelineStageFlags>(static_cast<VkFlags64>(stages)));
+}
+
+auto legacy_access(vk::AccessFlags2KHR access)
+	-> vk::AccessFlags
+{
+	return vk::AccessFlags(static_cast<VkAccessFlags>(static_cast<VkFlags64>(access)));
+}
+
+bool covers(vk::PipelineStageFlags2KHR stages, vk::PipelineStageFlags2KHR covered)
+{
+	return (stages & covered) == covered;
+}
+
+bool covers(vk::AccessFlags2KHR access, vk::AccessFlags2KHR covered)
+{
+	return (access & covered) == covered;
+}
+
+}
+
+RenderGraph::RenderGraph(Logger logger,
+						 DeviceAllocator* allocator,
+						 MaxFlightFrames max_flightframes,
+						 bool synchronization2)
+	: m_logger(logger)
+	, m_allocator(allocator)
+	, m_device(allocator->device())
+	, m_max_flightframes(max_flightframes)
+{
+	// NOTE an extension command, so it is not exported by the loader
+	if (synchronization2) {
+		m_pipeline_barrier2 = reinterpret_cast<PFN_vkCmdPipelineBarrier2KHR>(
+			m_device.getProcAddr("vkCmdPipelineBarrier2KHR"));
+	}
+
+	m_logger.info(std::source_location::current(),
+				  std::format("RenderGraph records its barriers with {}",
+							  m_pipeline_barrier2 != nullptr
+							  ? "vkCmdPipelineBarrier2KHR"
+							  : "vkCmdPipelineBarrier"));
+}
+
+RenderGraph::~RenderGraph() = default;
+
+void RenderGraph::begin_frame()
+{
+	m_frame++;
+	m_images.clear();
+	m_transients.clear();
+	m_passes.clear();
+
+	// NOTE a placement replaced in a frame is used by the frames in flight before it at most
+	std::erase_if(m_retired, [&] (std::pair<uint64_t, TransientMemory> const& retired) {
+		return retired.first + *m_max_flightframes - 1 <= m_frame;
+	});
+}
+
+auto RenderGraph::import_image(RenderGraphImport const& import)
+	-> RenderGraphImage
+{
+	for (uint32_t i = 0; i < m_images.size(); i++) {
+		if (!m_images[i].transient.has_value() && m_images[i].image == import.image)
+			return RenderGraphImage{i};
+	}
+
+	const AccessInfo initial = access_info(import.initial);
+	Image image{};
+	image.name = import.name;
+	image.image = import.image;
+	image.aspect = import.aspect;
+	image.final = import.final;
+	image.state.layout = initial.layout;
+	if (initial.writes) {
+		image.state.write_stages = initial.stages | import.wait_stages;
+		image.state.write_access = initial.access;
+	}
+	else {
+		image.state.read_stages = initial.stages | import.wait_stages;
+	}
+
+	m_images.push_back(std::move(image));
+	return RenderGraphImage{static_cast<uint32_t>(m_images.size() - 1)};
+}
+
+auto RenderGraph::create_transient(RenderGraphTransient const& transient)
+	-> RenderGraphImage
+{
+	Image image{};
+	image.name = transient.name;
+	image.aspect = transient.aspect;
+	image.transient = static_cast<uint32_t>(m_transients.size());
+	m_transients.push_back(transient);
+
+	m_images.push_back(std::move(image));
+	return RenderGraphImage{static_cast<uint32_t>(m_images.size() - 1)};
+}
+
+void RenderGraph::add_pass(RenderGraphPass&& pass)
+{
+	m_passes.push_back(std::move(pass));
+}
+
+vk::Image RenderGraph::image(RenderGraphImage image) const
+{
+	return m_images[image.get()].image;
+}
+
+vk::ImageView RenderGraph::view(RenderGraphImage image) const
+{
+	return m_images[image.get()].view;
+}
+
+auto RenderGraph::cull_passes() const
+	-> std::vector<bool>
+{
+	/* Walks the passes backwards from the outputs, a pass is kept when it writes
+	 * an image that is needed by the outputs or by a pass kept after it.
+	 */
+	std::vector<bool> needed(m_images.size(), false);
+	for (size_t i = 0; i < m_images.size(); i++)
+		needed[i] = m_images[i].final.has_value();
+
+	std::vector<bool> kept(m_passes.size(), false);
+	for (size_t pass = m_passes.size(); pass-- > 0;) {
+		RenderGraphPass const& current = m_passes[pass];
+		kept[pass] = current.side_effects
+			|| std::ranges::any_of(current.uses, [&] (RenderGraphUse const& use) {
+				return access_info(use.access).writes && needed[use.image.get()];
+			});
+		if (!kept[pass])
+			continue;
+
+		// NOTE a discarding write does not need what the passes before it wrote
+		for (RenderGraphUse const& use: current.uses)
+			needed[use.image.get()] = !(use.discard && access_info(use.access).writes);
+	}
+	return kept;
+}
+
+void RenderGraph::place_transients(std::vector<TransientLifetime> const& lifetimes)
+{
+	if (!m_memory.images.empty())
+		m_retired.emplace_back(m_frame, std::move(m_memory));
+	m_memory = TransientMemory{};
+	m_memory.lifetimes = lifetimes;
+
+	for (TransientLifetime const& lifetime: lifetimes) {
+		const auto image_info = vk::ImageCreateInfo{}
+			.setImageType(vk::ImageType::e2D)
+			.setFormat(lifetime.transient.format)
+			.setExtent(vk::Extent3D{lifetime.transient.extent.width,
+									lifetime.transient.extent.height,
+									1})
+			.setMipLevels(1)
+			.setArrayLayers(1)
+			.setTiling(vk::ImageTiling::eOptimal)
+			.setUsage(lifetime.transient.usage)
+			.setInitialLayout(vk::ImageLayout::eUndefined)
+			.setSharingMode(vk::SharingMode::eExclusive)
+			.setSamples(vk::SampleCountFlagBits::e1);
+		m_memory.images.push_back(m_device.createImageUnique(image_info));
+	}
+
+	/* The transients are placed in the order their lifetimes begin, each into the first
+	 * slot whose transients all ended before it and that shares a memory type with it.
+	 * Every transient of a slot is bound to its start, a slot is as large as its largest.
+	 */
+	struct Slot
+	{
+		vk::MemoryRequirements requirements;
+		uint32_t last_pass;
+	};
+	std::vector<Slot> slots{};
+
+	std::vector<uint32_t> order(lifetimes.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::ranges::stable_sort(order, [&] (uint32_t lhs, uint32_t rhs) {
+		return lifetimes[lhs].first_pass < lifetimes[rhs].first_pass;
+	});
+
+	vk::DeviceSize unaliased_size = 0;
+	m_memory.image_slots.resize(lifetimes.size());
+	for (uint32_t transient: order) {
+		const vk::MemoryRequirements requirements =
+			m_device.getImageMemoryRequirements(m_memory.images[transient].get());
+		unaliased_size += requirements.size;
+
+		auto slot = std::ranges::find_if(slots, [&] (Slot const& candidate) {
+			return candidate.last_pass < lifetimes[transient].first_pass
+				&& (candidate.requirements.memoryTypeBits & requirements.memoryTypeBits) != 0;
+		});
+		if (slot == slots.end()) {
+			m_memory.image_slots[transient] = static_cast<uint32_t>(slots.size());
+			slots.push_back(Slot{requirements, lifetimes[transient].last_pass});
+			continue;
+		}
+
+		slot->requirements.size = std::max(slot->requirements.size, requirements.size);
+		slot->requirements.alignment = std::max(slot->requirements.alignment, requirements.alignment);
+		slot->requirements.memoryTypeBits &= requirements.memoryTypeBits;
+		slot->last_pass = lifetimes[transient].last_pass;
+		m_memory.image_slots[transient] = static_cast<uint32_t>(std::distance(slots.begin(), slot));
+	}
+
+	vk::DeviceSize placed_size = 0;
+	for (Slot const& slot: slots) {
+		m_memory.slots.push_back(m_allocator->allocate(slot.requirements,
+													   vk::MemoryPropertyFlagBits::eDeviceLocal,
+													   AllocationKind::Dedicated));
+		placed_size += slot.requirements.size;
+	}
+
+	for (size_t transient = 0; transient < lifetimes.size(); transient++) {
+		DeviceAllocation const& slot = m_memory.slots[m_memory.image_slots[transient]];
+		m_device.bindImageMemory(m_memory.images[transient].get(),
+								 slot.memory(),
+								 slot.offset());
+
+		const auto view_info = vk::ImageViewCreateInfo{}
+			.setImage(m_memory.images[transient].get())
+			.setFormat(lifetimes[transient].transient.format)
+			.setSubresourceRange(image_subresource_range(lifetimes[transient].transient.aspect))
+			.setViewType(vk::ImageViewType::e2D);
+		m_memory.views.push_back(m_device.createImageViewUnique(view_info));
+	}
+
+	// NOTE new memory, nothing used it before
+	m_slot_states.assign(slots.size(), ImageState{});
+
+	m_logger.info(std::source_location::current(),
+				  std::format("RenderGraph placed {} transients in {} allocations, {} bytes instead of {}",
+							  lifetimes.size(),
+							  slots.size(),
+							  placed_size,
+							  unaliased_size));
+}
+
+auto RenderGraph::transition(Image& image,
+							 RenderGraphAccess access,
+							 bool discard)
+	-> std::optional<vk::ImageMemoryBarrier2KHR>
+{
+	const AccessInfo next = access_info(access);
+	ImageState& state = image.state;
+	const bool layout_change = next.layout != state.layout;
+
+	/* A layout transition or a write waits on every earlier access, a read only waits
+	 * on the last write, unless an earlier read of the same stage already did.
+	 */
+	const bool waits_on_all = layout_change || next.writes;
+	const bool needed = waits_on_all
+		? layout_change || static_cast<bool>(state.write_stages | state.read_stages)
+		: static_cast<bool>(state.write_stages)
+		  && !(covers(state.visible_stages, next.stages)
+			   && covers(state.visible_access, next.access));
+
+	std::optional<vk::ImageMemoryBarrier2KHR> barrier{};
+	if (needed) {
+		const vk::ImageLayout old_layout = (layout_change && discard)
+			? vk::ImageLayout::eUndefined
+			: state.layout;
+		barrier = vk::ImageMemoryBarrier2KHR{}
+			.setSrcStageMask(waits_on_all
+							 ? state.write_stages | state.read_stages
+							 : state.write_stages)
+			.setSrcAccessMask(state.write_access)
+			.setDstStageMask(next.stages)
+			.setDstAccessMask(next.access)
+			.setOldLayout(old_layout)
+			.setNewLayout(next.layout)
+			.setSrcQueueFamilyIndex(vk::QueueFamilyIgnored)
+			.setDstQueueFamilyIndex(vk::QueueFamilyIgnored)
+			.setImage(image.image)
+			.setSubresourceRange(image_subresource_range(image.aspect));
+	}
+
+	if (next.writes) {
+		state.write_stages = next.stages;
+		state.write_access = next.access;
+		state.read_stages = {};
+		state.visible_stages = {};
+		state.visible_access = {};
+	}
+	else if (layout_change) {
+		// NOTE the transition is a write of its own, already visible to the access it was made for
+		state.write_stages = next.stages;
+		state.write_access = {};
+		state.read_stages = {};
+		state.visible_stages = next.stages;
+		state.visible_access = next.access;
+	}
+	else {
+		state.read_stages |= next.stages;
+		if (needed) {
+			state.visible_stages |= next.stages;
+			state.visible_access |= next.access;
+		}
+	}
+	state.layout = next.layout;
+
+	return barrier;
+}
+
+void RenderGraph::record_barriers(vk::CommandBuffer& commandbuffer,
+								  std::vector<vk::ImageMemoryBarrier2KHR> const& barriers)
+{
+	if (barriers.empty())
+		return;
+
+	if (m_pipeline_barrier2 != nullptr) {
+		const auto dependency = vk::DependencyInfoKHR{}
+			.setImageMemoryBarriers(barriers);
+		m_pipeline_barrier2(static_cast<VkCommandBuffer>(commandbuffer),
+							&static_cast<VkDependencyInfoKHR const&>(dependency));
+		return;
+	}
+
+	/* Without synchronization2 the batch is a single legacy barrier,
+	 * that waits on the stages of every image at once.
+	 */
+	vk::PipelineStageFlags src_stages{};
+	vk::PipelineStageFlags dst_stages{};
+	std::vector<vk::ImageMemoryBarrier> legacy_barriers{};
+	legacy_barriers.reserve(barriers.size());
+	for (vk::ImageMemoryBarrier2KHR const& barrier: barriers) {
+		src_stages |= legacy_stages(barrier.srcStageMask);
+		dst_stages |= legacy_stages(barrier.dstStageMask);
+		legacy_barriers.push_back(vk::ImageMemoryBarrier{}
+								  .setSrcAccessMask(legacy_access(barrier.srcAccessMask))
+								  .setDstAccessMask(legacy_access(barrier.dstAccessMask))
+								  .setOldLayout(barrier.oldLayout)
+								  .setNewLayout(barrier.newLayout)
+								  .setSrcQueueFamilyIndex(vk::QueueFamilyIgnored)
+								  .setDstQueueFamilyIndex(vk::QueueFamilyIgnored)
+								  .setImage(barrier.image)
+								  .setSubresourceRange(barrier.subresourceRange));
+	}
+	if (!src_stages)
+		src_stages = vk::PipelineStageFlagBits::eTopOfPipe;
+	if (!dst_stages)
+		dst_stages = vk::PipelineStageFlagBits::eBottomOfPipe;
+
+	commandbuffer.pipelineBarrier(src_stages,
+								  dst_stages,
+								  vk::DependencyFlags(),
+								  nullptr,
+								  nullptr,
+								  legacy_barriers);
+}
+
+void RenderGraph::execute(vk::CommandBuffer& commandbuffer)
+{
+	const std::vector<bool> kept = cull_passes();
+
+	/* Every transient lives from the first to the last kept pass that uses it,
+	 * the transients no kept pass uses are not placed at all.
+	 * NOTE lifetimes are counted only over the kept passes that use transients, so passes
+	 *      that come and go around them, like the shadow passes, do not move the lifetimes
+	 *      and the transients stay placed where they are.
+	 */
+	std::vector<TransientLifetime> lifetimes{};
+	std::vector<std::optional<uint32_t>> placed(m_transients.size());
+	std::vector<std::optional<uint32_t>> ranks(m_passes.size());
+	uint32_t rank = 0;
+	for (size_t pass = 0; pass < m_passes.size(); pass++) {
+		if (!kept[pass])
+			continue;
+		const bool uses_transients =
+			std::ranges::any_of(m_passes[pass].uses, [&] (RenderGraphUse const& use) {
+				return m_images[use.image.get()].transient.has_value();
+			});
+		if (!uses_transients)
+			continue;
+
+		ranks[pass] = rank;
+		for (RenderGraphUse const& use: m_passes[pass].uses) {
+			Image const& image = m_images[use.image.get()];
+			if (!image.transient.has_value())
+				continue;
+			std::optional<uint32_t>& lifetime = placed[image.transient.value()];
+			if (!lifetime.has_value()) {
+				lifetime = static_cast<uint32_t>(lifetimes.size());
+				lifetimes.push_back(TransientLifetime{m_transients[image.transient.value()],
+													  rank,
+													  rank});
+			}
+			lifetimes[lifetime.value()].last_pass = rank;
+		}
+		rank++;
+	}
+
+	if (lifetimes != m_memory.lifetimes)
+		place_transients(lifetimes);
+
+	for (Image& image: m_images) {
+		if (!image.transient.has_value() || !placed[image.transient.value()].has_value())
+			continue;
+		const uint32_t transient = placed[image.transient.value()].value();
+		image.image = m_memory.images[transient].get();
+		image.view = m_memory.views[transient].get();
+	}
+
+	/* Every kept pass is recorded behind the batch of barriers its uses need.
+	 * NOTE a transient starts out undefined, after whatever used its memory before it,
+	 *      and leaves behind what the next user of its memory has to wait on.
+	 */
+	std::vector<vk::ImageMemoryBarrier2KHR> barriers{};
+	for (size_t pass = 0; pass < m_passes.size(); pass++) {
+		if (!kept[pass])
+			continue;
+
+		barriers.clear();
+		for (RenderGraphUse const& use: m_passes[pass].uses) {
+			Image& image = m_images[use.image.get()];
+			std::optional<uint32_t> transient{};
+			if (image.transient.has_value())
+				transient = placed[image.transient.value()];
+
+			if (transient.has_value() && lifetimes[transient.value()].first_pass == ranks[pass]) {
+				image.state = m_slot_states[m_memory.image_slots[transient.value()]];
+				image.state.layout = vk::ImageLayout::eUndefined;
+			}
+
+			if (auto barrier = transition(image, use.access, use.discard))
+				barriers.push_back(barrier.value());
+
+			if (transient.has_value() && lifetimes[transient.value()].last_pass == ranks[pass])
+				m_slot_states[m_memory.image_slots[transient.value()]] = image.state;
+		}
+		record_barriers(commandbuffer, barriers);
+
+		if (m_passes[pass].record)
+			std::invoke(m_passes[pass].record, commandbuffer, *this);
+	}
+
+	/* The outputs are left in their final access
+	 */
+	barriers.clear();
+	for (Image& image: m_images) {
+		if (!image.final.has_value())
+			continue;
+		if (auto barrier = transition(image, image.final.value(), false))
+			barriers.push_back(barrier.value());
+	}
+	record_barriers(commandbuffer, barriers);
+}
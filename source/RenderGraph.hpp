@@ -0,0 +1,220 @@
+#pragma once
+
+#include <VulkanRenderer/Context.hpp>
+#include <VulkanRenderer/StrongType.hpp>
+
+#include "DeviceAllocator.hpp"
+#include "FlightFrames.hpp"
+
+#include <vulkan/vulkan.hpp>
+
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+/**
+ * How a pass touches an image, every access implies the layout the image has to be in,
+ * and the stages and accesses that have to wait on earlier passes.
+ */
+enum class RenderGraphAccess
+{
+	// NOTE undefined contents, only meaningful as the access an image is imported in
+	None,
+	ColorAttachment,
+	DepthAttachment,
+	FragmentSampled,
+	TransferSrc,
+	TransferDst,
+	Present,
+};
+
+using RenderGraphImage = StrongType<uint32_t, struct RenderGraphImageTag>;
+
+/**
+ * An image that lives outside of the graph, like the swapchain or a texture kept between frames.
+ */
+struct RenderGraphImport
+{
+	std::string name;
+	vk::Image image;
+	vk::ImageAspectFlags aspect;
+	// NOTE the access the image was left in by the frames before
+	RenderGraphAccess initial{RenderGraphAccess::None};
+	// NOTE stages a semaphore of the submit waits in, before the image may be touched
+	vk::PipelineStageFlags2KHR wait_stages{};
+	// NOTE an image with a final access is an output of the graph, and is left in that access
+	std::optional<RenderGraphAccess> final;
+};
+
+/**
+ * An image only used within a frame, created by the graph and placed in memory shared
+ * with the transients whose passes do not overlap it.
+ */
+struct RenderGraphTransient
+{
+	std::string name;
+	vk::Extent2D extent;
+	vk::Format format;
+	vk::ImageUsageFlags usage;
+	vk::ImageAspectFlags aspect;
+
+	bool operator==(RenderGraphTransient const&) const = default;
+};
+
+struct RenderGraphUse
+{
+	RenderGraphImage image;
+	RenderGraphAccess access;
+	// NOTE the pass overwrites what it touches, so the earlier contents are not kept
+	bool discard{false};
+};
+
+class RenderGraph;
+using RenderGraphRecord = std::function<void(vk::CommandBuffer&, RenderGraph const&)>;
+
+struct RenderGraphPass
+{
+	std::string name;
+	// NOTE at most one use per image
+	std::vector<RenderGraphUse> uses;
+	RenderGraphRecord record;
+	// NOTE a pass that writes more than its images is never culled
+	bool side_effects{false};
+};
+
+/**
+ * A frame graph, passes declare the images they read and write and are recorded
+ * in the order they were added, into the single commandbuffer of the frame.
+ *
+ * The graph culls the passes nothing that is output depends on, and places a single
+ * batch of barriers in front of every pass, covering only the layout transitions and
+ * hazards between the accesses of consecutive passes. Transients are aliased, those
+ * whose passes do not overlap share the same memory.
+ *
+ * The passes and images are declared anew every frame. The memory of the transients is
+ * only placed again when they or their lifetimes relative to each other change, passes
+ * without transients do not count. The previous placement is kept alive until the frames
+ * in flight that may use it have retired.
+ */
+class RenderGraph
+{
+public:
+	RenderGraph(Logger logger,
+				DeviceAllocator* allocator,
+				MaxFlightFrames max_flightframes,
+				bool synchronization2);
+	~RenderGraph();
+
+	RenderGraph(RenderGraph&) = delete;
+	RenderGraph& operator=(RenderGraph&) = delete;
+
+	/**
+	 * Forget the passes and images of the last frame, expected once the fence of the
+	 * flight frame has been waited on.
+	 */
+	void begin_frame();
+
+	/**
+	 * Import image, an image imported twice in a frame refers to the same image of the graph.
+	 */
+	[[nodiscard]]
+	auto import_image(RenderGraphImport const& import)
+		-> RenderGraphImage;
+
+	[[nodiscard]]
+	auto create_transient(RenderGraphTransient const& transient)
+		-> RenderGraphImage;
+
+	void add_pass(RenderGraphPass&& pass);
+
+	/**
+	 * Record every pass that was not culled, and the barriers in between them.
+	 */
+	void execute(vk::CommandBuffer& commandbuffer);
+
+	[[nodiscard]]
+	vk::Image image(RenderGraphImage image) const;
+
+	/**
+	 * The view of a transient over its whole aspect, only valid while the graph executes.
+	 */
+	[[nodiscard]]
+	vk::ImageView view(RenderGraphImage image) const;
+
+private:
+	struct ImageState
+	{
+		vk::ImageLayout layout{vk::ImageLayout::eUndefined};
+		vk::PipelineStageFlags2KHR write_stages{};
+		vk::AccessFlags2KHR write_access{};
+		// NOTE stages that read since the last write, a following write waits on them
+		vk::PipelineStageFlags2KHR read_stages{};
+		// NOTE the stages and accesses the last write already is visible to
+		vk::PipelineStageFlags2KHR visible_stages{};
+		vk::AccessFlags2KHR visible_access{};
+	};
+
+	struct Image
+	{
+		std::string name;
+		vk::Image image;
+		vk::ImageView view;
+		vk::ImageAspectFlags aspect;
+		std::optional<RenderGraphAccess> final;
+		// NOTE index into the transients of the frame
+		std::optional<uint32_t> transient;
+		ImageState state;
+	};
+
+	// NOTE a transient together with the passes it lives between, counted over the
+	//      kept passes that use transients
+	struct TransientLifetime
+	{
+		RenderGraphTransient transient;
+		uint32_t first_pass{0};
+		uint32_t last_pass{0};
+
+		bool operator==(TransientLifetime const&) const = default;
+	};
+
+	struct TransientMemory
+	{
+		std::vector<TransientLifetime> lifetimes;
+		// NOTE declared before the images and views so they are destroyed last
+		std::vector<DeviceAllocation> slots;
+		std::vector<vk::UniqueImage> images;
+		std::vector<vk::UniqueImageView> views;
+		std::vector<uint32_t> image_slots;
+	};
+
+	auto cull_passes() const
+		-> std::vector<bool>;
+
+	void place_transients(std::vector<TransientLifetime> const& lifetimes);
+
+	auto transition(Image& image,
+					RenderGraphAccess access,
+					bool discard)
+		-> std::optional<vk::ImageMemoryBarrier2KHR>;
+
+	void record_barriers(vk::CommandBuffer& commandbuffer,
+						 std::vector<vk::ImageMemoryBarrier2KHR> const& barriers);
+
+	Logger m_logger;
+	DeviceAllocator* m_allocator{nullptr};
+	vk::Device m_device;
+	MaxFlightFrames m_max_flightframes;
+	PFN_vkCmdPipelineBarrier2KHR m_pipeline_barrier2{nullptr};
+
+	uint64_t m_frame{0};
+	std::vector<Image> m_images;
+	std::vector<RenderGraphTransient> m_transients;
+	std::vector<RenderGraphPass> m_passes;
+
+	TransientMemory m_memory;
+	// NOTE what the last user of every slot left behind, a transient placed in it waits on that
+	std::vector<ImageState> m_slot_states;
+	// NOTE earlier placements, with the frame they were replaced in
+	std::vector<std::pair<uint64_t, TransientMemory>> m_retired;
+};
@@ -2,6 +2,11 @@
 
 #include "MaterialPipeline.hpp"
 
+#include <bit>
+#include <chrono>
+#include <format>
+#include <thread>
+
 auto create_texture_view(vk::Device& device,
 						 Texture2D& texture,
 						 const vk::ImageAspectFlags aspect)
@@ -30,28 +35,10 @@ auto create_texture_view(vk::Device& device,
 	return device.createImageViewUnique(imageViewCreateInfo);
 }
 
-void sort_renderable(Logger* logger,
-					 SortedRenderables* sorted,
-					 Renderable renderable)
-{
-	if (auto p = std::get_if<NormColorRenderable>(&renderable))
-		sorted->normcolors.push_back(*p);
-	else if (auto p = std::get_if<WireframeRenderable>(&renderable))
-		sorted->wireframes.push_back(*p);
-	else if (auto p = std::get_if<BaseTextureRenderable>(&renderable))
-		sorted->basetextures.push_back(*p);
-	else if (auto p = std::get_if<MaterialRenderable>(&renderable))
-		sorted->materialrenderables.push_back(*p);
-	else {
-		logger->warn(std::source_location::current(),
-					 "Found unknown Renderable that can not be sorted and drawn");
-	}
-}
-
-
 auto create_geometry_pass(Render::Context::Impl* context,
 						  vk::Extent2D render_extent,
 						  const uint32_t frames_in_flight,
+						  const bool depth_prepass,
 						  const bool debug_print)
 	-> GeometryPass
 {
@@ -60,8 +47,12 @@ auto create_geometry_pass(Render::Context::Impl* context,
 
 	GeometryPass pass{};
 	pass.extent = render_extent;
+	pass.depth_format = depth_format;
 
 	/* Setup the renderpass
+	 * NOTE the frame graph places the attachments in their layouts and orders the renderpass
+	 *      against the shadow atlas it samples and the blit of the colorbuffer.
+	 * NOTE with a depth pre-pass the depthbuffer is loaded with the depth it laid down.
 	 */
     const auto color_attachment = vk::AttachmentDescription{}
 		.setFlags(vk::AttachmentDescriptionFlags())
@@ -71,22 +62,18 @@ auto create_geometry_pass(Render::Context::Impl* context,
 		.setStoreOp(vk::AttachmentStoreOp::eStore)
 		.setStencilLoadOp(vk::AttachmentLoadOp::eDontCare)
 		.setStencilStoreOp(vk::AttachmentStoreOp::eDontCare)
-		// NOTE these are important, as they determine the layout of the image before and after
-		// the renderpass
-		.setInitialLayout(vk::ImageLayout::eUndefined)
-		.setFinalLayout(vk::ImageLayout::eTransferSrcOptimal);
+		.setInitialLayout(vk::ImageLayout::eColorAttachmentOptimal)
+		.setFinalLayout(vk::ImageLayout::eColorAttachmentOptimal);
 
     const auto depth_attachment = vk::AttachmentDescription{}
 		.setFlags(vk::AttachmentDescriptionFlags())
 		.setFormat(depth_format)
 		.setSamples(vk::SampleCountFlagBits::e1)
-		.setLoadOp(vk::AttachmentLoadOp::eClear)
+		.setLoadOp(depth_prepass ? vk::AttachmentLoadOp::eLoad : vk::AttachmentLoadOp::eClear)
 		.setStoreOp(vk::AttachmentStoreOp::eDontCare)
 		.setStencilLoadOp(vk::AttachmentLoadOp::eDontCare)
 		.setStencilStoreOp(vk::AttachmentStoreOp::eDontCare)
-		// NOTE these are important, as they determine the layout of the image before and after
-		// the renderpass
-		.setInitialLayout(vk::ImageLayout::eUndefined)
+		.setInitialLayout(vk::ImageLayout::eDepthStencilAttachmentOptimal)
 		.setFinalLayout(vk::ImageLayout::eDepthStencilAttachmentOptimal);
 
 	const auto color_reference = vk::AttachmentReference{}
@@ -105,25 +92,10 @@ auto create_geometry_pass(Render::Context::Impl* context,
 		.setColorAttachments(color_reference)
 		.setPDepthStencilAttachment(&depth_reference);
 	
-	// @note we could also specify color and depth dependencies seperately
-	//       and put them together in the renderpass as an array
-	auto color_depth_dependency = vk::SubpassDependency{}
-		.setSrcSubpass(vk::SubpassExternal)
-		.setDstSubpass(0)
-		.setSrcStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput
-						 | vk::PipelineStageFlagBits::eEarlyFragmentTests)
-		.setSrcAccessMask(vk::AccessFlags())
-		.setDstStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput
-						 | vk::PipelineStageFlagBits::eEarlyFragmentTests)
-		.setDstAccessMask(vk::AccessFlagBits::eColorAttachmentWrite
-						  | vk::AccessFlagBits::eDepthStencilAttachmentWrite);
-	
 	std::array<vk::AttachmentDescription, 2> attachments {color_attachment, depth_attachment};
-	std::array<vk::SubpassDependency, 1> dependencies {color_depth_dependency};
     auto renderPassCreateInfo = vk::RenderPassCreateInfo{}
 		.setFlags(vk::RenderPassCreateFlags())
 		.setAttachments(attachments)
-		.setDependencies(dependencies)
 		.setSubpasses(subpass);
 
     pass.renderpass = context->device.get().createRenderPassUnique(renderPassCreateInfo);
@@ -138,85 +110,104 @@ auto create_geometry_pass(Render::Context::Impl* context,
 	for (size_t i = 0; i < frames_in_flight; i++) {
 		/* Setup the rendertarget for the render pass
 		 */
-
 		pass.colorbuffers.push_back(Texture2D::Impl(RenderTargetTexture,
 													context,
 													texture_extent,
 													vkformat_to_textureformat(render_format)));
 		
-		auto transition_to_transfer_src = [&] (vk::CommandBuffer& commandbuffer)
-		{
-			/* Setup the rendertarget
-			 */
-			pass.colorbuffers.back().layout =
-				transition_image_for_color_override(pass.colorbuffers.back().allocated.image.get(),
-													commandbuffer);
-		};
-		
-		with_buffer_submit(context->device.get(),
-						   context->commandpool.get(),
-						   context->graphics_queue(),
-						   transition_to_transfer_src);
-		
 		/* Setup the rendertarget view
 		 */
 		pass.colorbuffer_views
 			.push_back(pass.colorbuffers.back()
 					   .create_view(context,
 									vk::ImageAspectFlagBits::eColor));
-
-		/* Setup the Depthbuffers
-		 */
-		pass.depthbuffers.push_back(Texture2D::Impl(DepthBufferTexture,
-													context,
-													texture_extent));
-														 
-		/* Setup the depthbuffer view
-		 */
-		pass.depthbuffer_views
-			.push_back(pass.depthbuffers.back()
-					   .create_view(context,
-									vk::ImageAspectFlagBits::eDepth));
-		
-		/* Setup the FrameBuffers
-		 */
-		std::array<vk::ImageView, 2> attachments{
-			pass.colorbuffer_views.back().get(),
-			pass.depthbuffer_views.back().get(),
-		};
-		auto framebufferCreateInfo = vk::FramebufferCreateInfo{}
-			.setFlags(vk::FramebufferCreateFlags())
-			.setAttachments(attachments)
-			.setWidth(render_extent.width)
-			.setHeight(render_extent.height)
-			.setRenderPass(pass.renderpass.get())
-			.setLayers(1);
-		pass.framebuffers
-			.push_back(context->device.get()
-					   .createFramebufferUnique(framebufferCreateInfo));
 	}
 
+	/* The FrameBuffers are created once the frame graph placed the depthbuffer
+	 */
+	pass.framebuffer_depth_views.resize(frames_in_flight);
+	pass.framebuffers.resize(frames_in_flight);
+
 	context->logger.info(std::source_location::current(),
 						 "Created FramePasses!");
 
 	return pass;
 }
 
+auto geometry_framebuffer(GeometryPass& pass,
+						  vk::Device device,
+						  const uint32_t current_frame_in_flight,
+						  vk::ImageView depthbuffer_view)
+	-> vk::Framebuffer
+{
+	// NOTE the framebuffer of a flight frame is only used by that flight frame
+	if (pass.framebuffers[current_frame_in_flight]
+		&& pass.framebuffer_depth_views[current_frame_in_flight] == depthbuffer_view)
+		return pass.framebuffers[current_frame_in_flight].get();
+
+	std::array<vk::ImageView, 2> attachments{
+		pass.colorbuffer_views[current_frame_in_flight].get(),
+		depthbuffer_view,
+	};
+	auto framebufferCreateInfo = vk::FramebufferCreateInfo{}
+		.setFlags(vk::FramebufferCreateFlags())
+		.setAttachments(attachments)
+		.setWidth(pass.extent.width)
+		.setHeight(pass.extent.height)
+		.setRenderPass(pass.renderpass.get())
+		.setLayers(1);
+	pass.framebuffers[current_frame_in_flight] = device.createFramebufferUnique(framebufferCreateInfo);
+	pass.framebuffer_depth_views[current_frame_in_flight] = depthbuffer_view;
+	return pass.framebuffers[current_frame_in_flight].get();
+}
+
+void set_viewport_and_scissor(vk::CommandBuffer& commandbuffer,
+							  vk::Extent2D const extent)
+{
+	const std::array<vk::Viewport, 1> viewports{
+		vk::Viewport{}
+		.setX(0.0f)
+		.setY(0.0f)
+		.setWidth(extent.width)
+		.setHeight(extent.height)
+		.setMinDepth(0.0f)
+		.setMaxDepth(1.0f),
+	};
+	const uint32_t viewport_start = 0;
+	commandbuffer.setViewport(viewport_start, viewports);
+
+	const std::array<vk::Rect2D, 1> scissors{
+		vk::Rect2D{}
+		.setOffset(vk::Offset2D{}.setX(0.0f).setY(0.0f))
+		.setExtent(extent),
+	};
+	const uint32_t scissor_start = 0;
+	commandbuffer.setScissor(scissor_start, scissors);
+}
+
 auto render_geometry_pass(GeometryPass& pass,
-						  Renderer::Impl::ShadowPasses& shadow_passes,
+						  ShadowAtlasPass* shadow_atlas,
+						  DepthPrepass* depth_prepass,
+						  Renderer::Impl::GpuCullPasses* gpu_cull,
 						  // TODO: Pipelines are captured as a ptr because bind_front
 						  //       does not want to capture a reference for it...
 						  GeometryPipelines* pipelines,
 						  Logger* logger,
+						  ThreadPool* thread_pool,
+						  SecondaryCommandPools* secondary_pools,
+						  std::vector<RendererTiming>* recording_timings,
+						  GpuTimestamps* gpu_timestamps,
+						  const DrawOrder draw_order,
+						  std::vector<RendererDrawStatistics>* draw_statistics,
+						  std::vector<RendererCullStatistics>* cull_statistics,
 						  const uint32_t current_frame_in_flight,
 						  const uint32_t max_frames_in_flight,
 						  const uint64_t total_frames,
 						  vk::Device& device,
-						  vk::DescriptorPool descriptor_pool,
-						  vk::CommandPool& command_pool,
-						  vk::Queue& queue,
+						  DescriptorPool::Impl* descriptor_pool,
+						  RenderGraph& graph,
 						  const WorldRenderInfo& world_info,
-						  std::vector<Renderable>& renderables,
+						  SceneDraws const& draws,
 						  std::vector<Light>& lights,
 						  ShadowCasters& shadowcasters)
 	-> Texture2D::Impl*
@@ -228,163 +219,625 @@ auto render_geometry_pass(GeometryPass& pass,
 		vk::ClearValue{}.setDepthStencil({1.0f, 0}),
 	};
 	
+	/* Cull every pipelines draws against the camera, with gpu culling the material
+	 * draws are culled by the compute pre-pass instead.
+	 * NOTE objects outside the view can still cast shadows into it, so the shadow
+	 *      casters are culled from all of them against their own frustums.
+	 */
+	const bool gpu_culling = gpu_cull->pipeline != nullptr;
+	const Frustum camera_frustum =
+		frustum_from_view_projection(world_info.projection * world_info.view);
+	cull_statistics->clear();
+
+	const auto cull_pass = [&] (std::string name,
+								auto const& pass_renderables,
+								CullBoxes const& boxes,
+								Frustum const& frustum,
+								auto& visible) {
+		const CullStatistics statistics =
+			cull_renderables(pass_renderables, boxes, frustum, visible);
+		cull_statistics->push_back(RendererCullStatistics{name,
+														  statistics.visible,
+														  statistics.culled});
+	};
+
 	SortedRenderables sorted{};
-	std::ranges::for_each(renderables,
-						  std::bind_front(sort_renderable, logger, &sorted));
-	
+	cull_pass("NormColorPipeline",
+			  draws.renderables.normcolors,
+			  draws.boxes.normcolors,
+			  camera_frustum,
+			  sorted.normcolors);
+	cull_pass("WireframePipeline",
+			  draws.renderables.wireframes,
+			  draws.boxes.wireframes,
+			  camera_frustum,
+			  sorted.wireframes);
+	cull_pass("BaseTexturePipeline",
+			  draws.renderables.basetextures,
+			  draws.boxes.basetextures,
+			  camera_frustum,
+			  sorted.basetextures);
+	if (!gpu_culling) {
+		cull_pass("MaterialPipeline",
+				  draws.renderables.materialrenderables,
+				  draws.boxes.materialrenderables,
+				  camera_frustum,
+				  sorted.materialrenderables);
+	}
+	else if (!draws.sorted) {
+		sorted.materialrenderables = draws.renderables.materialrenderables;
+	}
+
+	// NOTE sorted draws culled on the gpu are drawn straight from the scene, without a copy
+	const bool draw_from_scene = gpu_culling && draws.sorted;
+	std::vector<MaterialRenderable> const& material_draws = draw_from_scene
+		? draws.renderables.materialrenderables
+		: sorted.materialrenderables;
+
+	// NOTE the gpu statistics are from the last time the flight frame was culled
+	const auto gpu_cull_statistics = [&] (std::string name, GpuCullPass const& gpu_pass) {
+		const CullStatistics statistics = gpu_pass.statistics();
+		cull_statistics->push_back(RendererCullStatistics{name,
+														  statistics.visible,
+														  statistics.culled});
+	};
+
+	/* Sort every pipelines draws by state, so consecutive draws share their
+	 * material and mesh buffers. Draws of a scene are already sorted, and culling
+	 * keeps their order. The shadow passes sort their own culled casters.
+	 */
+	draw_statistics->clear();
+
+	const auto sorted_statistics = [&] (std::string name, auto const& pass_renderables) {
+		draw_statistics->push_back(RendererDrawStatistics{name,
+														  static_cast<uint32_t>(pass_renderables.size()),
+														  std::nullopt,
+														  count_binds(pass_renderables,
+																	  DrawMaterialOf{})});
+	};
+
+	const auto sort_pass = [&] (std::string name, auto& pass_renderables, uint32_t pipeline) {
+		if (draws.sorted) {
+			sorted_statistics(name, pass_renderables);
+			return;
+		}
+		const DrawSortStatistics statistics = sort_draws(pass_renderables,
+														 draw_order,
+														 pipeline,
+														 world_info.view,
+														 DrawMaterialOf{},
+														 DrawMaterialHash{});
+		draw_statistics->push_back(RendererDrawStatistics{name,
+														  statistics.draws,
+														  statistics.unsorted_binds,
+														  statistics.sorted_binds});
+	};
+
+	sort_pass("NormColorPipeline", sorted.normcolors, normcolor_draw_pipeline);
+	sort_pass("WireframePipeline", sorted.wireframes, wireframe_draw_pipeline);
+	sort_pass("BaseTexturePipeline", sorted.basetextures, basetexture_draw_pipeline);
+	if (draw_from_scene)
+		sorted_statistics("MaterialPipeline", material_draws);
+	else
+		sort_pass("MaterialPipeline", sorted.materialrenderables, material_draw_pipeline);
+
+	CurrentFlightFrame const current_flightframe{ current_frame_in_flight };
+	MaxFlightFrames const max_flightframes{ max_frames_in_flight };
+
+	// NOTE only sorted draws keep their order between frames, so only their version identifies them
+	const uint64_t gpu_cull_version = draws.sorted ? draws.version : 0;
+
+	if (gpu_culling) {
+		gpu_cull->material->prepare(current_flightframe,
+									material_draws,
+									[] (MaterialRenderable const& lhs, MaterialRenderable const& rhs) {
+										return lhs.mesh == rhs.mesh
+											&& DrawMaterialOf{}(lhs) == DrawMaterialOf{}(rhs);
+									},
+									camera_frustum,
+									gpu_cull_version);
+		gpu_cull_statistics("MaterialPipeline", *gpu_cull->material);
+	}
 
-	auto generate_shadow_passes = [&] (vk::CommandBuffer& commandbuffer) 
+	/* Every pass records its draws into a secondary commandbuffer on a worker,
+	 * the frame graph only begins the renderpasses and executes them in order.
+	 * NOTE a pipeline is only ever recorded by a single task, so the descriptor set
+	 *      caches inside the pipelines are never touched by two threads at once.
+	 */
+	using Clock = std::chrono::steady_clock;
+	struct RecordedPass
 	{
-		std::optional<OrthographicShadowPass::CameraUniformData> ortho_caster_data;
-		if (shadowcasters.directional_caster.has_value()) {
-			ortho_caster_data.emplace();
-			DirectionalShadowCaster& dircaster = shadowcasters.directional_caster.value();
-			ortho_caster_data.value().view = dircaster.view();
-			ortho_caster_data.value().proj = dircaster.projection().get();
+		vk::CommandBuffer commandbuffer;
+		RendererTiming timing;
+	};
+
+	const auto record_pass = [&] (std::string name,
+								  vk::CommandBufferInheritanceInfo inheritance,
+								  auto record) {
+		return thread_pool->submit([=] () mutable {
+			const auto begin = Clock::now();
+			vk::CommandBuffer secondary =
+				secondary_pools->begin(thread_pool->thread_index(), inheritance);
+			record(secondary);
+			secondary.end();
+			const std::chrono::duration<double, std::milli> elapsed = Clock::now() - begin;
+			return RecordedPass{secondary, RendererTiming{name, elapsed.count()}};
+		});
+	};
+
+	/* Shadow passes
+	 * NOTE the frame graph orders the shadow writes before the geometry reads.
+	 */
+	const auto no_material = [] (auto const&) { return 0; };
+	const auto cull_casters = [&] (std::string name,
+								   std::vector<MaterialRenderable> const& pass_list,
+								   CullBoxes const& pass_boxes,
+								   std::vector<MaterialRenderable>& casters,
+								   glm::mat4 const& view,
+								   glm::mat4 const& proj,
+								   GpuCullPass* gpu_pass)
+		-> std::vector<MaterialRenderable> const& {
+		const Frustum frustum = frustum_from_view_projection(proj * view);
+		if (gpu_pass == nullptr)
+			cull_pass(name, pass_list, pass_boxes, frustum, casters);
+		else if (!draws.sorted)
+			casters = pass_list;
+
+		// NOTE depth only, so the casters are only sorted by mesh
+		if (!draws.sorted)
+			sort_draws(casters, DrawOrder::State, material_draw_pipeline, view, no_material);
+
+		if (gpu_pass == nullptr)
+			return casters;
+
+		std::vector<MaterialRenderable> const& pass_casters =
+			draws.sorted ? pass_list : casters;
+		gpu_pass->prepare(current_flightframe,
+						  pass_casters,
+						  [] (MaterialRenderable const& lhs, MaterialRenderable const& rhs) {
+							  return lhs.mesh == rhs.mesh;
+						  },
+						  frustum,
+						  gpu_cull_version);
+		gpu_cull_statistics(name, *gpu_pass);
+		return pass_casters;
+	};
+
+	/* Every caster is given a tile of the shadow atlas sized by how much of the view
+	 * it lights, and casters that do not fit or light nothing in view get none.
+	 */
+	ShadowAtlasPass& atlas = *shadow_atlas;
+	const ShadowAtlasLayout atlas_layout = layout_shadow_atlas(atlas.extent().width(),
+															   shadowcasters,
+															   world_info.view,
+															   world_info.projection);
+
+	/* Cascaded directional casters are fitted around the view every frame,
+	 * snapped to the texels of their tiles.
+	 */
+	std::vector<std::vector<ShadowCascade>> cascades{};
+	for (size_t i = 0; i < shadowcasters.directional_casters.size(); i++) {
+		cascades.push_back(fit_shadow_cascades(shadowcasters.directional_casters[i],
+											   world_info.view,
+											   world_info.projection,
+											   atlas_layout.directionals[i]));
+	}
+
+	/* The static casters of a tile are drawn into the static layer of the atlas, only when
+	 * the tile was drawn with another rect, camera or static casters before. The dynamic
+	 * casters are drawn every frame, over the static tiles copied into the frame atlas.
+	 */
+	struct AtlasCaster
+	{
+		std::string name;
+		ShadowAtlasRect rect;
+		ShadowAtlasPass::CameraUniformData camera;
+		bool refresh_static{false};
+		GpuCullPass* static_gpu_pass{nullptr};
+		GpuCullPass* gpu_pass{nullptr};
+	};
+
+	// NOTE every tile is culled against its own frustum, by its own gpu cull passes
+	std::vector<AtlasCaster> atlas_casters{};
+	size_t tile_index = 0;
+	const auto add_caster = [&] (std::string name,
+								 std::optional<ShadowAtlasRect> const& rect,
+								 glm::mat4 const& view,
+								 glm::mat4 const& projection) {
+		const size_t tile = tile_index++;
+		if (!rect.has_value()) {
+			atlas.forget_static_tile(tile);
+			return;
 		}
+		const bool refresh_static =
+			atlas.refresh_static_tile(tile, ShadowAtlasPass::StaticTileKey{rect.value(),
+																		   view,
+																		   projection,
+																		   draws.static_shadow_version});
+		GpuCullPass* static_gpu_pass =
+			gpu_culling ? gpu_cull->shadows[2 * tile].get() : nullptr;
+		GpuCullPass* gpu_pass =
+			gpu_culling ? gpu_cull->shadows[2 * tile + 1].get() : nullptr;
+		atlas_casters.push_back(AtlasCaster{name,
+											rect.value(),
+											{view, projection},
+											refresh_static,
+											static_gpu_pass,
+											gpu_pass});
+	};
 
-		shadow_passes.orthographic.record(logger,
-										  device,
-										  CurrentFlightFrame{current_frame_in_flight},
-										  commandbuffer,
-										  ortho_caster_data,
-										  sorted.materialrenderables);
-		
-		
-		std::optional<PerspectiveShadowPass::CameraUniformData> pers_caster_data;
-		if (shadowcasters.spot_caster.has_value()) {
-			pers_caster_data.emplace();
-			SpotShadowCaster& spotcaster = shadowcasters.spot_caster.value();
-			pers_caster_data.value().view = spotcaster.view();
-			pers_caster_data.value().proj = spotcaster.projection().get();
+	for (size_t i = 0; i < shadowcasters.directional_casters.size(); i++) {
+		for (size_t cascade = 0; cascade < cascades[i].size(); cascade++) {
+			add_caster(std::format("ShadowAtlas directional {} cascade {}", i, cascade),
+					   atlas_layout.directionals[i][cascade],
+					   cascades[i][cascade].view,
+					   cascades[i][cascade].projection);
 		}
+	}
+	for (size_t i = 0; i < shadowcasters.spot_casters.size(); i++) {
+		add_caster(std::format("ShadowAtlas spot {}", i),
+				   atlas_layout.spots[i],
+				   shadowcasters.spot_casters[i].view(),
+				   shadowcasters.spot_casters[i].projection().get());
+	}
+	atlas.resize_static_tiles(tile_index);
 
-		//TODO: have multiple spot casters
-		shadow_passes.perspective.record(logger,
-										 device,
-										 CurrentFlightFrame{current_frame_in_flight},
-										 commandbuffer,
-										 pers_caster_data,
-										 sorted.materialrenderables);
-	};
+	// NOTE sized up front, the recording tasks refer to the culled casters of every caster
+	const bool has_dynamic_casters = !draws.dynamic_shadow_casters.empty();
+	std::vector<std::vector<MaterialRenderable>> static_culled(atlas_casters.size());
+	std::vector<std::vector<MaterialRenderable> const*> static_draws(atlas_casters.size());
+	std::vector<std::vector<MaterialRenderable>> atlas_culled(atlas_casters.size());
+	std::vector<std::vector<MaterialRenderable> const*> atlas_draws(atlas_casters.size());
+	for (size_t i = 0; i < atlas_casters.size(); i++) {
+		if (atlas_casters[i].refresh_static) {
+			static_draws[i] = &cull_casters(atlas_casters[i].name + " static",
+											draws.shadow_casters,
+											draws.shadow_caster_boxes,
+											static_culled[i],
+											atlas_casters[i].camera.view,
+											atlas_casters[i].camera.proj,
+											atlas_casters[i].static_gpu_pass);
+		}
+		if (has_dynamic_casters) {
+			atlas_draws[i] = &cull_casters(atlas_casters[i].name,
+										   draws.dynamic_shadow_casters,
+										   draws.dynamic_shadow_caster_boxes,
+										   atlas_culled[i],
+										   atlas_casters[i].camera.view,
+										   atlas_casters[i].camera.proj,
+										   atlas_casters[i].gpu_pass);
+		}
+	}
+
+	// NOTE every caster draws into its own tile, so they are recorded in parallel
+	std::vector<std::future<RecordedPass>> static_shadow_tasks{};
+	std::vector<std::future<RecordedPass>> shadow_tasks{};
+	for (size_t i = 0; i < atlas_casters.size(); i++) {
+		if (atlas_casters[i].refresh_static) {
+			static_shadow_tasks.push_back(record_pass(atlas_casters[i].name + " static",
+													  atlas.static_inheritance_info(),
+													  [&, i] (vk::CommandBuffer& secondary) {
+														  atlas.clear_tile(secondary, atlas_casters[i].rect);
+														  atlas.record(logger,
+																	   device,
+																	   current_flightframe,
+																	   secondary,
+																	   atlas_casters[i].rect,
+																	   atlas_casters[i].camera,
+																	   *static_draws[i],
+																	   atlas_casters[i].static_gpu_pass);
+													  }));
+		}
+		if (has_dynamic_casters) {
+			shadow_tasks.push_back(record_pass(atlas_casters[i].name,
+											   atlas.inheritance_info(current_flightframe),
+											   [&, i] (vk::CommandBuffer& secondary) {
+												   atlas.record(logger,
+																device,
+																current_flightframe,
+																secondary,
+																atlas_casters[i].rect,
+																atlas_casters[i].camera,
+																*atlas_draws[i],
+																atlas_casters[i].gpu_pass);
+											   }));
+		}
+	}
+
+	/* Geometry pass
+	 */
+	// NOTE the framebuffer is left out, it is only known once the frame graph placed the depthbuffer
+	const auto geometry_inheritance = vk::CommandBufferInheritanceInfo{}
+		.setRenderPass(pass.renderpass.get())
+		.setSubpass(0);
+
+	NormColorRenderInfo normcolor_info{};
+	normcolor_info.view = world_info.view;
+	normcolor_info.proj = world_info.projection;
+
+	WireframeRenderInfo wireframe_info{};
+	wireframe_info.viewproj = world_info.projection * world_info.view;
+
+	BaseTextureRenderInfo texture_info{};
+	texture_info.view = world_info.view;
+	texture_info.proj = world_info.projection;
 
-	//TODO: shadow and geometry passes should be in same commandbuffer with proper image barrier
-	with_buffer_submit(device,
-					   command_pool,
-					   queue,
-					   generate_shadow_passes);
+	MaterialPipeline::MaterialShadowCasters material_shadowcasters{
+		atlas.get_shadowtexture(current_flightframe).descriptorset.get(),
+		&shadowcasters,
+		&atlas_layout,
+		&cascades};
 	
-	auto generate_frame = [&] (vk::CommandBuffer& commandbuffer) 
-	{
-		const auto render_area = vk::Rect2D{}
-			.setOffset(vk::Offset2D{}.setX(0.0f).setY(0.0f))
-			.setExtent(pass.extent);
-		
-		const auto renderPassInfo = vk::RenderPassBeginInfo{}
-			.setRenderPass(pass.renderpass.get())
-			.setFramebuffer(pass.framebuffers[current_frame_in_flight].get())
-			.setRenderArea(render_area)
-			.setClearValues(clearvalues);
-
-		commandbuffer.beginRenderPass(renderPassInfo, vk::SubpassContents::eInline);
-		const std::vector<vk::Viewport> viewports{
-			vk::Viewport{}
-			.setX(0.0f)
-			.setY(0.0f)
-			.setWidth(pass.extent.width)
-			.setHeight(pass.extent.height)
-			.setMinDepth(0.0f)
-			.setMaxDepth(1.0f),
-		};
-		const uint32_t viewport_start = 0;
-		commandbuffer.setViewport(viewport_start, viewports);
-
-		const std::vector<vk::Rect2D> scissors{
-			vk::Rect2D{}
-			.setOffset(vk::Offset2D{}.setX(0.0f).setY(0.0f))
-			.setExtent(pass.extent),
-		};
-		const uint32_t scissor_start = 0;
-		commandbuffer.setScissor(scissor_start, scissors);
-		
-		NormColorRenderInfo normcolor_info{};
-		normcolor_info.view = world_info.view;
-		normcolor_info.proj = world_info.projection;
-
-		draw_normcolors(device,
-						pipelines->normcolor,
-						commandbuffer,
-						current_frame_in_flight,
-						normcolor_info,
-						sorted.normcolors);
-
-		WireframeRenderInfo wireframe_info{};
-		wireframe_info.viewproj = world_info.projection * world_info.view;
-
-		draw_wireframes(pipelines->wireframe,
-						commandbuffer,
-						wireframe_info,
-						sorted.wireframes);
-		
-		BaseTextureRenderInfo texture_info{};
-		texture_info.view = world_info.view;
-		texture_info.proj = world_info.projection;
-		draw_base_texture_renderables(pipelines->basetexture,
-									  *logger,
-									  device,
-									  descriptor_pool,
-									  commandbuffer,
-									  current_frame_in_flight,
-									  max_frames_in_flight,
-									  texture_info,
-									  sorted.basetextures);
-		
+	MaterialPipeline::FrameInfo material_frame_info{};
+	material_frame_info.view = world_info.view;
+	material_frame_info.proj = world_info.projection;
+	material_frame_info.camera_position = world_info.camera_position;
+	material_frame_info.extent = pass.extent;
 
-		CurrentFlightFrame const current_flightframe{ current_frame_in_flight };
-		MaxFlightFrames const max_flightframes{ max_frames_in_flight };
-		
+	// NOTE dynamic state is not inherited, every secondary sets its own viewport
+	std::vector<std::future<RecordedPass>> geometry_tasks{};
+	geometry_tasks.push_back(record_pass("NormColorPipeline",
+										 geometry_inheritance,
+										 [&] (vk::CommandBuffer& secondary) {
+											 set_viewport_and_scissor(secondary, pass.extent);
+											 draw_normcolors(device,
+															 pipelines->normcolor,
+															 secondary,
+															 current_frame_in_flight,
+															 normcolor_info,
+															 sorted.normcolors);
+										 }));
 
-		ShadowPassTexture& dirshadowtexture =
-			shadow_passes.orthographic.get_shadowtexture(current_flightframe);
-		
-		MaterialPipeline::MaterialShadowCasters::DirectionalShadowCasterTexture 
-			directional_texture{
-			dirshadowtexture.descriptorset.get(),
-			shadowcasters.directional_caster};
-
-		ShadowPassTexture& spotshadowtexture =
-			shadow_passes.perspective.get_shadowtexture(current_flightframe);
-		MaterialPipeline::MaterialShadowCasters::SpotShadowCasterTexture 
-			spot_texture{
-			spotshadowtexture.descriptorset.get(),
-			shadowcasters.spot_caster};
-
-		MaterialPipeline::MaterialShadowCasters material_shadowcasters{
-			directional_texture,
-			spot_texture};
-		
-		MaterialPipeline::FrameInfo material_frame_info{};
-		material_frame_info.view = world_info.view;
-		material_frame_info.proj = world_info.projection;
-		material_frame_info.camera_position = world_info.camera_position;
-		pipelines->material.render(material_frame_info,
-								   *logger,
-								   device,
-								   descriptor_pool,
-								   commandbuffer,
-								   current_flightframe,
-								   max_flightframes,
-								   sorted.materialrenderables,
-								   lights,
-								   material_shadowcasters);
-
-		commandbuffer.endRenderPass();
+	geometry_tasks.push_back(record_pass("WireframePipeline",
+										 geometry_inheritance,
+										 [&] (vk::CommandBuffer& secondary) {
+											 set_viewport_and_scissor(secondary, pass.extent);
+											 draw_wireframes(pipelines->wireframe,
+															 secondary,
+															 wireframe_info,
+															 sorted.wireframes);
+										 }));
+
+	geometry_tasks.push_back(record_pass("BaseTexturePipeline",
+										 geometry_inheritance,
+										 [&] (vk::CommandBuffer& secondary) {
+											 set_viewport_and_scissor(secondary, pass.extent);
+											 draw_base_texture_renderables(pipelines->basetexture,
+																		   *logger,
+																		   device,
+																		   descriptor_pool,
+																		   secondary,
+																		   current_frame_in_flight,
+																		   max_frames_in_flight,
+																		   texture_info,
+																		   sorted.basetextures);
+										 }));
+
+	geometry_tasks.push_back(record_pass("MaterialPipeline",
+										 geometry_inheritance,
+										 [&] (vk::CommandBuffer& secondary) {
+											 set_viewport_and_scissor(secondary, pass.extent);
+											 pipelines->material.render(material_frame_info,
+																		*logger,
+																		device,
+																		descriptor_pool,
+																		secondary,
+																		current_flightframe,
+																		max_flightframes,
+																		material_draws,
+																		lights,
+																		material_shadowcasters,
+																		gpu_cull->material.get());
+										 }));
+
+	/* The depth pre-pass draws the same material draws as the material pipeline,
+	 * so with gpu culling it draws the commands the compute pre-pass culled.
+	 */
+	const DepthPrepass::CameraUniformData prepass_camera{world_info.view, world_info.projection};
+	std::vector<std::future<RecordedPass>> prepass_tasks{};
+	if (depth_prepass != nullptr) {
+		prepass_tasks.push_back(record_pass("DepthPrepass",
+											depth_prepass->inheritance_info(),
+											[&] (vk::CommandBuffer& secondary) {
+												set_viewport_and_scissor(secondary, pass.extent);
+												depth_prepass->record(secondary,
+																	  prepass_camera,
+																	  material_draws,
+																	  gpu_cull->material.get());
+											}));
+	}
+
+	/* Join the workers, every task is waited on before any exception is rethrown,
+	 * they refer to the locals of this function.
+	 */
+	for (auto& task: static_shadow_tasks)
+		task.wait();
+	for (auto& task: shadow_tasks)
+		task.wait();
+	for (auto& task: prepass_tasks)
+		task.wait();
+	for (auto& task: geometry_tasks)
+		task.wait();
+
+	recording_timings->clear();
+	const auto collect = [&] (std::future<RecordedPass>& task) {
+		RecordedPass recorded = task.get();
+		recording_timings->push_back(recorded.timing);
+		return recorded.commandbuffer;
 	};
 
-	with_buffer_submit(device,
-					   command_pool,
-					   queue,
-					   generate_frame);
+	/* Every pass is added to the frame graph, which orders them, culls the ones the presented
+	 * frame does not depend on, and places the barriers in between them. The graph is executed
+	 * by the presenter after this returns, so the passes only capture what outlives the frame.
+	 */
+	vk::Device graph_device = device;
+	ShadowAtlasPass* atlas_pass = &atlas;
+	GeometryPass* geometry = &pass;
+
+	/* The compute pre-pass has to be recorded outside of any renderpass,
+	 * a pass that was not prepared this frame is not dispatched.
+	 * NOTE the graph only tracks images, so the pre-pass places its own buffer barrier.
+	 */
+	if (gpu_culling) {
+		std::vector<GpuCullPass*> dispatched{gpu_cull->material.get()};
+		for (AtlasCaster const& caster: atlas_casters) {
+			if (caster.refresh_static)
+				dispatched.push_back(caster.static_gpu_pass);
+			if (has_dynamic_casters)
+				dispatched.push_back(caster.gpu_pass);
+		}
+		graph.add_pass(RenderGraphPass{
+				"GpuCull",
+				{},
+				[dispatched] (vk::CommandBuffer& commandbuffer, RenderGraph const&) {
+					for (GpuCullPass* gpu_pass: dispatched)
+						gpu_pass->dispatch(commandbuffer);
+					record_gpu_cull_barrier(commandbuffer);
+				},
+				true});
+	}
+
+	const RenderGraphImage static_layer = atlas.import_static_layer(graph);
+	const RenderGraphImage shadow_atlas_image = atlas.import_atlas(graph, current_flightframe);
+
+	if (!static_shadow_tasks.empty()) {
+		std::vector<vk::CommandBuffer> static_commandbuffers{};
+		for (auto& task: static_shadow_tasks)
+			static_commandbuffers.push_back(collect(task));
+		graph.add_pass(RenderGraphPass{
+				"ShadowAtlas static",
+				{RenderGraphUse{static_layer, RenderGraphAccess::DepthAttachment}},
+				[atlas_pass, static_commandbuffers] (vk::CommandBuffer& commandbuffer, RenderGraph const&) {
+					atlas_pass->begin_static_renderpass(commandbuffer,
+														vk::SubpassContents::eSecondaryCommandBuffers);
+					commandbuffer.executeCommands(static_commandbuffers);
+					commandbuffer.endRenderPass();
+				}});
+	}
+
+	/* The static tiles are copied into the atlas, then the dynamic casters draw over them.
+	 * NOTE everything outside of the copied tiles is never sampled,
+	 *      so the atlas of the frame is discarded instead of kept.
+	 */
+	std::vector<ShadowAtlasRect> atlas_rects{};
+	for (AtlasCaster const& caster: atlas_casters)
+		atlas_rects.push_back(caster.rect);
+	graph.add_pass(RenderGraphPass{
+			"ShadowAtlas copy",
+			{
+				RenderGraphUse{static_layer, RenderGraphAccess::TransferSrc},
+				RenderGraphUse{shadow_atlas_image, RenderGraphAccess::TransferDst, true},
+			},
+			[atlas_pass, current_flightframe, atlas_rects] (vk::CommandBuffer& commandbuffer,
+															RenderGraph const&) {
+				atlas_pass->copy_static_tiles(commandbuffer, current_flightframe, atlas_rects);
+			}});
+
+	if (!shadow_tasks.empty()) {
+		std::vector<vk::CommandBuffer> shadow_commandbuffers{};
+		for (auto& task: shadow_tasks)
+			shadow_commandbuffers.push_back(collect(task));
+		graph.add_pass(RenderGraphPass{
+				"ShadowAtlas",
+				{RenderGraphUse{shadow_atlas_image, RenderGraphAccess::DepthAttachment}},
+				[atlas_pass, current_flightframe, shadow_commandbuffers] (vk::CommandBuffer& commandbuffer,
+																		  RenderGraph const&) {
+					atlas_pass->begin_renderpass(commandbuffer,
+												 current_flightframe,
+												 vk::SubpassContents::eSecondaryCommandBuffers);
+					commandbuffer.executeCommands(shadow_commandbuffers);
+					commandbuffer.endRenderPass();
+				}});
+	}
+
+	/* The depthbuffer is only used within the depth pre-pass and the geometry pass,
+	 * so it is a transient shared by every flight frame.
+	 */
+	const RenderGraphImage colorbuffer =
+		graph.import_image(RenderGraphImport{"Geometry colorbuffer",
+											 pass.colorbuffers[current_frame_in_flight].image(),
+											 vk::ImageAspectFlagBits::eColor});
+	const RenderGraphImage depthbuffer =
+		graph.create_transient(RenderGraphTransient{"Geometry depthbuffer",
+													pass.extent,
+													pass.depth_format,
+													vk::ImageUsageFlagBits::eDepthStencilAttachment,
+													vk::ImageAspectFlagBits::eDepth});
+
+	/* The depth pre-pass and the geometry pass write timestamps around their renderpasses,
+	 * so whether the pre-pass pays for itself can be told from the gpu timings of a scene.
+	 */
+	const auto add_timed_pass = [&] (RenderGraphPass&& timed_pass) {
+		const std::optional<uint32_t> timing = gpu_timestamps->add(current_flightframe, timed_pass.name);
+		if (timing.has_value()) {
+			timed_pass.record = [gpu_timestamps,
+								 current_flightframe,
+								 timing = timing.value(),
+								 record = std::move(timed_pass.record)] (vk::CommandBuffer& commandbuffer,
+																		 RenderGraph const& frame_graph) {
+				gpu_timestamps->begin(commandbuffer, current_flightframe, timing);
+				record(commandbuffer, frame_graph);
+				gpu_timestamps->end(commandbuffer, current_flightframe, timing);
+			};
+		}
+		graph.add_pass(std::move(timed_pass));
+	};
+
+	if (depth_prepass != nullptr) {
+		std::vector<vk::CommandBuffer> prepass_commandbuffers{};
+		for (auto& task: prepass_tasks)
+			prepass_commandbuffers.push_back(collect(task));
+		add_timed_pass(RenderGraphPass{
+				"Depth prepass",
+				{RenderGraphUse{depthbuffer, RenderGraphAccess::DepthAttachment, true}},
+				[depth_prepass,
+				 current_flightframe,
+				 depthbuffer,
+				 prepass_commandbuffers] (vk::CommandBuffer& commandbuffer, RenderGraph const& frame_graph) {
+					depth_prepass->begin_renderpass(commandbuffer,
+													current_flightframe,
+													frame_graph.view(depthbuffer),
+													vk::SubpassContents::eSecondaryCommandBuffers);
+					commandbuffer.executeCommands(prepass_commandbuffers);
+					commandbuffer.endRenderPass();
+				}});
+	}
+
+	std::vector<vk::CommandBuffer> geometry_commandbuffers{};
+	for (auto& task: geometry_tasks)
+		geometry_commandbuffers.push_back(collect(task));
+
+	// NOTE with a depth pre-pass the geometry pass keeps the depth it laid down
+	add_timed_pass(RenderGraphPass{
+			"Geometry",
+			{
+				RenderGraphUse{shadow_atlas_image, RenderGraphAccess::FragmentSampled},
+				RenderGraphUse{colorbuffer, RenderGraphAccess::ColorAttachment, true},
+				RenderGraphUse{depthbuffer, RenderGraphAccess::DepthAttachment, depth_prepass == nullptr},
+			},
+			[geometry,
+			 graph_device,
+			 current_frame_in_flight,
+			 depthbuffer,
+			 clearvalues,
+			 geometry_commandbuffers] (vk::CommandBuffer& commandbuffer, RenderGraph const& frame_graph) {
+				const auto render_area = vk::Rect2D{}
+					.setOffset(vk::Offset2D{}.setX(0.0f).setY(0.0f))
+					.setExtent(geometry->extent);
+	
+				const auto renderPassInfo = vk::RenderPassBeginInfo{}
+					.setRenderPass(geometry->renderpass.get())
+					.setFramebuffer(geometry_framebuffer(*geometry,
+														 graph_device,
+														 current_frame_in_flight,
+														 frame_graph.view(depthbuffer)))
+					.setRenderArea(render_area)
+					.setClearValues(clearvalues);
+
+				commandbuffer.beginRenderPass(renderPassInfo, vk::SubpassContents::eSecondaryCommandBuffers);
+				commandbuffer.executeCommands(geometry_commandbuffers);
+				commandbuffer.endRenderPass();
+			}});
 
 	return &pass.colorbuffers[current_frame_in_flight];
 }
@@ -393,83 +846,238 @@ Renderer::Impl::Impl(Render::Context::Impl* context,
 					 Presenter::Impl* presenter,
 					 Logger logger,
 					 DescriptorPool::Impl* descriptor_pool,
-					 std::filesystem::path shaders_root)
+					 std::filesystem::path shaders_root,
+					 RendererCreateInfo const& create_info)
 	: shaders_root(shaders_root)
 	, context(context)
 	, presenter(presenter)
 	, logger(logger)
 	, descriptor_pool(descriptor_pool)
+	, draw_order(create_info.front_to_back ? DrawOrder::FrontToBack : DrawOrder::State)
 {
-	
+	scene.impl->draw_order = draw_order;
 
-	U32Extent constexpr shadow_extent{1024, 1024};
-	//U32Extent constexpr shadow_extent{256, 256};
+	pipeline_cache = std::make_unique<PipelineCache>(logger,
+													 context->physical_device,
+													 context->device.get(),
+													 context->optional_extensions.pipeline_creation_feedback,
+													 create_info.pipeline_cache_directory);
+
+	const uint32_t hardware_threads = std::max(std::thread::hardware_concurrency(), 2u);
+	thread_pool = std::make_unique<ThreadPool>(create_info.worker_count.value_or(hardware_threads - 1));
+	logger.info(std::source_location::current(),
+				std::format("Created ThreadPool with {} workers",
+							thread_pool->worker_count()));
+
+	// NOTE one more than the workers, for the thread calling render
+	secondary_pools =
+		std::make_unique<SecondaryCommandPools>(context->device.get(),
+												graphics_index(context->graphics_present_indices),
+												thread_pool->worker_count() + 1,
+												presenter->max_frames_in_flight);
+
+	if (create_info.bindless_textures) {
+		if (context->optional_extensions.descriptor_indexing) {
+			uint32_t constexpr bindless_capacity = 4096;
+			bindless_textures = std::make_unique<BindlessTextures>(logger,
+																   context->physical_device,
+																   context->device.get(),
+																   MaxFlightFrames{presenter->max_frames_in_flight},
+																   bindless_capacity);
+		}
+		else {
+			logger.warn(std::source_location::current(),
+						"Bindless textures were requested, but VK_EXT_descriptor_indexing"
+						" is not supported, falling back to a descriptor set per texture");
+		}
+	}
+
+	light_buffers = std::make_unique<LightBuffers>(logger,
+												   context->device.get(),
+												   *context->allocator,
+												   create_info.clustered_lighting);
+
+	// NOTE a begin and end timestamp for the depth pre-pass and the geometry pass
+	uint32_t constexpr gpu_timing_capacity = 2;
+	gpu_timestamps = std::make_unique<GpuTimestamps>(logger,
+													 context->physical_device,
+													 context->device.get(),
+													 graphics_index(context->graphics_present_indices),
+													 MaxFlightFrames{presenter->max_frames_in_flight},
+													 gpu_timing_capacity);
+
+	// NOTE the pre-pass is dispatched on the graphics queue, so it has to support compute
+	bool gpu_culling = false;
+	if (create_info.gpu_culling) {
+		const auto families = context->physical_device.getQueueFamilyProperties();
+		const auto flags = families[graphics_index(context->graphics_present_indices)].queueFlags;
+		if (flags & vk::QueueFlagBits::eCompute) {
+			gpu_culling = true;
+		}
+		else {
+			logger.warn(std::source_location::current(),
+						"Gpu culling was requested, but the graphics queue does not"
+						" support compute, falling back to culling on the cpu");
+		}
+	}
+
+	if (!std::has_single_bit(create_info.shadow_atlas_size)) {
+		const auto msg = std::format("Shadow atlas size {} is not a power of two",
+									 create_info.shadow_atlas_size);
+		logger.error(std::source_location::current(), msg);
+		throw std::runtime_error(msg);
+	}
+	const U32Extent shadow_atlas_extent{create_info.shadow_atlas_size,
+										create_info.shadow_atlas_size};
 
 	//TODO: Allow extent to be set externally
 	//TODO: Allow debug print to be set externally
 	vk::Extent2D const render_extent = context->get_window_extent();
 	bool const debug_print = true;
-	shadow_passes.orthographic = OrthographicShadowPass(logger,
-														context,
-														presenter,
-														descriptor_pool,
-														shadow_extent,
-														shaders_root,
-														debug_print);
-
-	shadow_passes.perspective = PerspectiveShadowPass(logger,
-													  context,
-													  presenter,
-													  descriptor_pool,
-													  shadow_extent,
-													  shaders_root,
-													  debug_print);
-
-	geometry_pass = create_geometry_pass(context,
-										 render_extent,
-										 presenter->max_frames_in_flight,
-										 debug_print);
+
+	/* Every pass and pipeline reads its shaders and compiles on a worker,
+	 * only the geometry pipelines have to wait for the geometry renderpass.
+	 */
+	using Clock = std::chrono::steady_clock;
+	const auto startup_begin = Clock::now();
+
+	const auto timed = [this] (std::string name, auto create) {
+		return thread_pool->submit([name, create] () mutable {
+			const auto begin = Clock::now();
+			create();
+			const std::chrono::duration<double, std::milli> elapsed = Clock::now() - begin;
+			return RendererTiming{name, elapsed.count()};
+		});
+	};
+
+	// NOTE every task is waited on before any exception is rethrown,
+	//      the tasks refer to members of this renderer.
+	const auto join = [this] (std::vector<std::future<RendererTiming>>& tasks) {
+		for (auto& task: tasks)
+			task.wait();
+		for (auto& task: tasks)
+			startup_timings.push_back(task.get());
+		tasks.clear();
+	};
+
+	std::vector<std::future<RendererTiming>> tasks{};
+
+	tasks.push_back(timed("ShadowAtlasPass", [&] () {
+		shadow_atlas = ShadowAtlasPass(logger,
+									   context,
+									   presenter,
+									   descriptor_pool,
+									   pipeline_cache.get(),
+									   shadow_atlas_extent,
+									   shaders_root,
+									   debug_print);
+	}));
+
+	// NOTE the geometry pass is built on this thread, while the shadow atlas pass compiles.
+	try {
+		const auto begin = Clock::now();
+		geometry_pass = create_geometry_pass(context,
+											 render_extent,
+											 presenter->max_frames_in_flight,
+											 create_info.depth_prepass,
+											 debug_print);
+		const std::chrono::duration<double, std::milli> elapsed = Clock::now() - begin;
+		startup_timings.push_back(RendererTiming{"GeometryPass", elapsed.count()});
+	}
+	catch (...) {
+		for (auto& task: tasks)
+			task.wait();
+		throw;
+	}
 	
-	geometry_pipelines.material = MaterialPipeline(logger,
-												   context,
-												   presenter,
-												   descriptor_pool,
-												   geometry_pass.renderpass.get(),
-												   shaders_root);
-	context->logger.info(std::source_location::current(),
-						 "Created Material Pipeline");
+	tasks.push_back(timed("MaterialPipeline", [&] () {
+		geometry_pipelines.material = MaterialPipeline(logger,
+													   context,
+													   presenter,
+													   descriptor_pool,
+													   pipeline_cache.get(),
+													   bindless_textures.get(),
+													   light_buffers.get(),
+													   geometry_pass.renderpass.get(),
+													   create_info.depth_prepass,
+													   shaders_root);
+	}));
+
+	if (create_info.depth_prepass) {
+		tasks.push_back(timed("DepthPrepass", [&] () {
+			depth_prepass = std::make_unique<DepthPrepass>(logger,
+														   context,
+														   presenter,
+														   pipeline_cache.get(),
+														   geometry_pass.extent,
+														   geometry_pass.depth_format,
+														   shaders_root);
+		}));
+	}
 	
-	geometry_pipelines.basetexture = create_base_texture_pipeline(context->logger,
-																  context,
-																  presenter,
-																  descriptor_pool,
-																  geometry_pass.renderpass.get(),
-																  presenter->max_frames_in_flight,
-																  render_extent,
-																  shaders_root,
-																  debug_print);
-	context->logger.info(std::source_location::current(),
-						 "Created BaseTexture Pipeline");
-
-	geometry_pipelines.normcolor = create_norm_render_pipeline(context->logger,
-															   context->physical_device,
-															   context->device.get(),
-															   geometry_pass.renderpass.get(),
-															   presenter->max_frames_in_flight,
-															   render_extent,
-															   shaders_root,
-															   debug_print);
-	context->logger.info(std::source_location::current(),
-						 "Created NormColor Pipeline");
-
-	geometry_pipelines.wireframe = create_wireframe_render_pipeline(context->logger,
-																	context->device.get(),
-																	geometry_pass.renderpass.get(),
-																	render_extent,
-																	shaders_root,
-																	debug_print);
-	context->logger.info(std::source_location::current(),
-						 "Created Wireframe Pipeline");
+	tasks.push_back(timed("BaseTexturePipeline", [&] () {
+		geometry_pipelines.basetexture = create_base_texture_pipeline(context->logger,
+																	  context,
+																	  presenter,
+																	  descriptor_pool,
+																	  pipeline_cache.get(),
+																	  bindless_textures.get(),
+																	  geometry_pass.renderpass.get(),
+																	  presenter->max_frames_in_flight,
+																	  render_extent,
+																	  shaders_root,
+																	  debug_print);
+	}));
+
+	tasks.push_back(timed("NormColorPipeline", [&] () {
+		geometry_pipelines.normcolor = create_norm_render_pipeline(context->logger,
+																   *presenter->uniform_ring,
+																   *presenter->instance_ring,
+																   context->device.get(),
+																   pipeline_cache.get(),
+																   geometry_pass.renderpass.get(),
+																   presenter->max_frames_in_flight,
+																   render_extent,
+																   shaders_root,
+																   debug_print);
+	}));
+
+	tasks.push_back(timed("WireframePipeline", [&] () {
+		geometry_pipelines.wireframe = create_wireframe_render_pipeline(context->logger,
+																		context->device.get(),
+																		pipeline_cache.get(),
+																		geometry_pass.renderpass.get(),
+																		render_extent,
+																		shaders_root,
+																		debug_print);
+	}));
+
+	if (gpu_culling) {
+		tasks.push_back(timed("FrustumCullPipeline", [&] () {
+			gpu_cull.pipeline = std::make_unique<GpuCullPipeline>(logger,
+																  context->device.get(),
+																  pipeline_cache.get(),
+																  shaders_root);
+			const auto create_pass = [&] () {
+				return std::make_unique<GpuCullPass>(logger,
+													 context->device.get(),
+													 *context->allocator,
+													 gpu_cull.pipeline.get());
+			};
+			gpu_cull.material = create_pass();
+		}));
+	}
+
+	join(tasks);
+
+	const std::chrono::duration<double, std::milli> startup_elapsed = Clock::now() - startup_begin;
+	for (RendererTiming const& timing: startup_timings) {
+		logger.info(std::source_location::current(),
+					std::format("Created {} in {:.3f} ms", timing.name, timing.milliseconds));
+	}
+	logger.info(std::source_location::current(),
+				std::format("Created all passes and pipelines in {:.3f} ms",
+							startup_elapsed.count()));
 }
 
 Renderer::Impl::~Impl()
@@ -484,19 +1092,85 @@ auto Renderer::Impl::render(const uint32_t current_frame_in_flight,
 							ShadowCasters& shadowcasters)
 		-> Texture2D::Impl*
 {
+	const SceneDraws draws = scene_draws_from(renderables);
+	return render_draws(current_frame_in_flight,
+						total_frames,
+						world_info,
+						draws,
+						lights,
+						shadowcasters);
+}
+
+auto Renderer::Impl::render(const uint32_t current_frame_in_flight,
+							const uint64_t total_frames,
+							const WorldRenderInfo& world_info)
+		-> Texture2D::Impl*
+{
+	return render_draws(current_frame_in_flight,
+						total_frames,
+						world_info,
+						scene.impl->draws(),
+						scene.impl->lights(),
+						scene.impl->shadowcasters);
+}
+
+auto Renderer::Impl::render_draws(const uint32_t current_frame_in_flight,
+								  const uint64_t total_frames,
+								  const WorldRenderInfo& world_info,
+								  SceneDraws const& draws,
+								  std::vector<Light>& lights,
+								  ShadowCasters& shadowcasters)
+		-> Texture2D::Impl*
+{
+	secondary_pools->begin_frame(CurrentFlightFrame{current_frame_in_flight});
+	gpu_timestamps->begin_frame(CurrentFlightFrame{current_frame_in_flight}, gpu_timings);
+	// NOTE the first pass of the frame, so the timed passes after it write into reset queries
+	presenter->frame_graph->add_pass(RenderGraphPass{
+			"Reset gpu timestamps",
+			{},
+			[timestamps = gpu_timestamps.get(),
+			 current_flightframe = CurrentFlightFrame{current_frame_in_flight}]
+			(vk::CommandBuffer& commandbuffer, RenderGraph const&) {
+				timestamps->reset(commandbuffer, current_flightframe);
+			},
+			true});
+	if (bindless_textures)
+		bindless_textures->begin_frame();
+
+	/* Every shadow atlas tile is culled by its own passes, one for its static and one for
+	 * its dynamic casters, created the first time they are needed.
+	 */
+	size_t tile_count = shadowcasters.spot_casters.size();
+	for (DirectionalShadowCaster const& caster: shadowcasters.directional_casters)
+		tile_count += shadow_cascade_count(caster);
+	while (gpu_cull.pipeline && gpu_cull.shadows.size() < 2 * tile_count) {
+		gpu_cull.shadows.push_back(std::make_unique<GpuCullPass>(logger,
+																 context->device.get(),
+																 *context->allocator,
+																 gpu_cull.pipeline.get()));
+	}
+
 	return render_geometry_pass(geometry_pass,
-								shadow_passes,
+								&shadow_atlas,
+								depth_prepass.get(),
+								&gpu_cull,
 								&geometry_pipelines,
 								&logger,
+								thread_pool.get(),
+								secondary_pools.get(),
+								&recording_timings,
+								gpu_timestamps.get(),
+								draw_order,
+								&draw_statistics,
+								&cull_statistics,
 								current_frame_in_flight,
 								presenter->max_frames_in_flight,
 								total_frames,
 								context->device.get(),
-								descriptor_pool->descriptor_pool.get(),
-								presenter->command_pool(),
-								context->graphics_queue(),
+								descriptor_pool,
+								*presenter->frame_graph,
 								world_info,
-								renderables,
+								draws,
 								lights,
 								shadowcasters);
 }
@@ -517,19 +1191,67 @@ auto Renderer::render(const uint32_t current_frame_in_flight,
 						shadowcasters);
 }
 
+auto Renderer::render(const uint32_t current_frame_in_flight,
+					  const uint64_t total_frames,
+					  const WorldRenderInfo& world_info)
+		-> Texture2D::Impl*
+{
+	return impl->render(current_frame_in_flight,
+						total_frames,
+						world_info);
+}
+
+auto Renderer::scene()
+	-> Scene&
+{
+	return impl->scene;
+}
+
 Renderer::Renderer(Render::Context& context,
 				   Presenter& presenter,
 				   Logger logger,
 				   DescriptorPool& descriptor_pool,
-				   const std::filesystem::path shaders_root)
+				   const std::filesystem::path shaders_root,
+				   RendererCreateInfo const& create_info)
 	: impl(std::make_unique<Impl>(context.impl.get(),
 								  presenter.impl.get(),
 								  logger,
 								  descriptor_pool.impl.get(),
-								  shaders_root))
+								  shaders_root,
+								  create_info))
 {
 }
 
 Renderer::~Renderer()
 {
 }
+
+auto Renderer::startup_timings() const
+	-> std::vector<RendererTiming> const&
+{
+	return impl->startup_timings;
+}
+
+auto Renderer::recording_timings() const
+	-> std::vector<RendererTiming> const&
+{
+	return impl->recording_timings;
+}
+
+auto Renderer::gpu_timings() const
+	-> std::vector<RendererTiming> const&
+{
+	return impl->gpu_timings;
+}
+
+auto Renderer::draw_statistics() const
+	-> std::vector<RendererDrawStatistics> const&
+{
+	return impl->draw_statistics;
+}
+
+auto Renderer::cull_statistics() const
+	-> std::vector<RendererCullStatistics> const&
+{
+	return impl->cull_statistics;
+}
@@ -6,8 +6,19 @@
 #include "ContextImpl.hpp"
 #include "DescriptorPoolImpl.hpp"
 #include "FlightFrames.hpp"
+#include "PipelineCache.hpp"
+#include "ThreadPool.hpp"
+#include "SecondaryCommandPools.hpp"
+#include "BindlessTextures.hpp"
+#include "DrawSort.hpp"
+#include "FrustumCull.hpp"
+#include "GpuCulling.hpp"
+#include "LightBuffers.hpp"
+#include "SceneImpl.hpp"
+#include "GpuTimestamps.hpp"
 
 #include "ShadowPass.hpp"
+#include "DepthPrepass.hpp"
 #include "NormRenderPipeline.hpp"
 #include "WireframePipeline.hpp"
 #include "BaseTexturePipeline.hpp"
@@ -16,11 +27,13 @@
 struct GeometryPass
 {
 	vk::Extent2D extent;
+	vk::Format depth_format;
 	vk::UniqueRenderPass renderpass;
 	std::vector<Texture2D::Impl> colorbuffers;
 	std::vector<vk::UniqueImageView> colorbuffer_views;
-	std::vector<Texture2D::Impl> depthbuffers;
-	std::vector<vk::UniqueImageView> depthbuffer_views;
+	// NOTE the depthbuffer is a transient of the frame graph, the framebuffer of a flight
+	//      frame is created again whenever the graph places the depthbuffer elsewhere.
+	std::vector<vk::ImageView> framebuffer_depth_views;
 	std::vector<vk::UniqueFramebuffer> framebuffers;
 };
 
@@ -32,14 +45,6 @@ struct GeometryPipelines
 	MaterialPipeline material;
 };
 
-struct SortedRenderables
-{
-	std::vector<BaseTextureRenderable> basetextures;
-	std::vector<NormColorRenderable> normcolors;
-	std::vector<WireframeRenderable> wireframes;
-	std::vector<MaterialRenderable> materialrenderables;
-};
-
 class Renderer::Impl 
 {
 public:
@@ -47,7 +52,8 @@ public:
 				  Presenter::Impl* presenter,
 				  Logger logger,
 				  DescriptorPool::Impl* descriptor_pool,
-				  const std::filesystem::path shaders_root);
+				  const std::filesystem::path shaders_root,
+				  RendererCreateInfo const& create_info);
     ~Impl();
 	
 	auto render(const uint32_t current_frame_in_flight,
@@ -57,6 +63,19 @@ public:
 				std::vector<Light>& lights,
 				ShadowCasters& shadowcasters)
 		-> Texture2D::Impl*;
+
+	auto render(const uint32_t current_frame_in_flight,
+				const uint64_t total_frames,
+				const WorldRenderInfo& world_info)
+		-> Texture2D::Impl*;
+
+	auto render_draws(const uint32_t current_frame_in_flight,
+					  const uint64_t total_frames,
+					  const WorldRenderInfo& world_info,
+					  SceneDraws const& draws,
+					  std::vector<Light>& lights,
+					  ShadowCasters& shadowcasters)
+		-> Texture2D::Impl*;
 	
 	Logger logger;
 	std::filesystem::path shaders_root;
@@ -65,44 +84,77 @@ public:
 	Presenter::Impl* presenter{nullptr};
 	DescriptorPool::Impl* descriptor_pool;
 
-	struct ShadowPasses {
-		OrthographicShadowPass orthographic;
-		PerspectiveShadowPass perspective;
+	// NOTE declared before the pipelines, so it is saved once all of them are destroyed.
+	std::unique_ptr<PipelineCache> pipeline_cache;
+	std::unique_ptr<ThreadPool> thread_pool;
+	std::unique_ptr<SecondaryCommandPools> secondary_pools;
+	// NOTE only created when bindless textures are requested and supported
+	std::unique_ptr<BindlessTextures> bindless_textures;
+	std::unique_ptr<LightBuffers> light_buffers;
+	std::vector<RendererTiming> startup_timings;
+	std::vector<RendererTiming> recording_timings;
+	std::vector<RendererTiming> gpu_timings;
+	// NOTE the queries the gpu timings are read back from
+	std::unique_ptr<GpuTimestamps> gpu_timestamps;
+	DrawOrder draw_order{DrawOrder::State};
+	std::vector<RendererDrawStatistics> draw_statistics;
+	std::vector<RendererCullStatistics> cull_statistics;
+	Scene scene;
+
+	// NOTE only created when gpu culling is requested
+	struct GpuCullPasses {
+		std::unique_ptr<GpuCullPipeline> pipeline;
+		std::unique_ptr<GpuCullPass> material;
+		// NOTE a static and a dynamic pass for every tile, the tiles of every cascade of every
+		//      directional caster, then of every spot caster
+		std::vector<std::unique_ptr<GpuCullPass>> shadows;
 	};
+	GpuCullPasses gpu_cull;
 
-	ShadowPasses shadow_passes;
+	ShadowAtlasPass shadow_atlas;
+	// NOTE only created when a depth pre-pass is requested
+	std::unique_ptr<DepthPrepass> depth_prepass;
 	GeometryPass geometry_pass;
 	GeometryPipelines geometry_pipelines;
 };
 
-void sort_renderable(Logger* logger,
-					 SortedRenderables* sorted,
-					 Renderable renderable);
-
-auto create_geometry_pass(vk::PhysicalDevice& physical_device,
-						  vk::Device& device,
-						  vk::CommandPool& command_pool,
-						  vk::Queue& graphics_queue,
+auto create_geometry_pass(Render::Context::Impl* context,
 						  vk::Extent2D render_extent,
 						  const uint32_t frames_in_flight,
+						  const bool depth_prepass,
 						  const bool debug_print)
 	-> GeometryPass;
 
+auto geometry_framebuffer(GeometryPass& pass,
+						  vk::Device device,
+						  const uint32_t current_frame_in_flight,
+						  vk::ImageView depthbuffer_view)
+	-> vk::Framebuffer;
+
 auto render_geometry_pass(GeometryPass& pass,
-						  Renderer::Impl::ShadowPasses& shadow_passes,
+						  ShadowAtlasPass* shadow_atlas,
+						  DepthPrepass* depth_prepass,
+						  Renderer::Impl::GpuCullPasses* gpu_cull,
 						  // TODO: Pipelines are captured as a ptr because bind_front
 						  //       does not want to capture a reference for it...
 						  GeometryPipelines* pipelines,
 						  Logger* logger,
+						  ThreadPool* thread_pool,
+						  SecondaryCommandPools* secondary_pools,
+						  std::vector<RendererTiming>* recording_timings,
+						  GpuTimestamps* gpu_timestamps,
+						  const DrawOrder draw_order,
+						  std::vector<RendererDrawStatistics>* draw_statistics,
+						  std::vector<RendererCullStatistics>* cull_statistics,
 						  const uint32_t current_frame_in_flight,
 						  const uint32_t max_frames_in_flight,
 						  const uint64_t total_frames,
 						  vk::Device& device,
-						  vk::DescriptorPool descriptor_pool,
-						  vk::CommandPool& command_pool,
-						  vk::Queue& queue,
+						  DescriptorPool::Impl* descriptor_pool,
+						  RenderGraph& graph,
 						  const WorldRenderInfo& world_info,
-						  std::vector<Renderable>& renderables,
+						  SceneDraws const& draws,
+						  std::vector<Light>& lights,
 						  ShadowCasters& shadowcasters)
 
 	-> Texture2D::Impl*;
@@ -0,0 +1,523 @@
+#include "SceneImpl.hpp"
+
+#include <variant>
+
+namespace
+{
+
+auto list_of(SortedRenderables& sorted, NormColorRenderable const&)
+	-> std::vector<NormColorRenderable>&
+{
+	return sorted.normcolors;
+}
+
+auto list_of(SortedRenderables& sorted, WireframeRenderable const&)
+	-> std::vector<WireframeRenderable>&
+{
+	return sorted.wireframes;
+}
+
+auto list_of(SortedRenderables& sorted, BaseTextureRenderable const&)
+	-> std::vector<BaseTextureRenderable>&
+{
+	return sorted.basetextures;
+}
+
+auto list_of(SortedRenderables& sorted, MaterialRenderable const&)
+	-> std::vector<MaterialRenderable>&
+{
+	return sorted.materialrenderables;
+}
+
+auto boxes_of(SortedCullBoxes& boxes, NormColorRenderable const&) -> CullBoxes& { return boxes.normcolors; }
+auto boxes_of(SortedCullBoxes& boxes, WireframeRenderable const&) -> CullBoxes& { return boxes.wireframes; }
+auto boxes_of(SortedCullBoxes& boxes, BaseTextureRenderable const&) -> CullBoxes& { return boxes.basetextures; }
+auto boxes_of(SortedCullBoxes& boxes, MaterialRenderable const&) -> CullBoxes& { return boxes.materialrenderables; }
+
+auto casts_shadow(Renderable const& renderable)
+	-> bool
+{
+	auto const* material = std::get_if<MaterialRenderable>(&renderable);
+	return material != nullptr && material->has_shadow;
+}
+
+/**
+ * True when rhs is drawn by the same pipeline with the same mesh and material as lhs,
+ * so it takes the same place in the sorted draws and can replace lhs in place.
+ */
+auto same_draw(Renderable const& lhs, Renderable const& rhs)
+	-> bool
+{
+	if (lhs.index() != rhs.index() || casts_shadow(lhs) != casts_shadow(rhs))
+		return false;
+
+	return std::visit([&] (auto const& l) {
+		using Type = std::decay_t<decltype(l)>;
+		Type const& r = std::get<Type>(rhs);
+		return l.mesh == r.mesh && DrawMaterialOf{}(l) == DrawMaterialOf{}(r);
+	}, lhs);
+}
+
+/**
+ * Sort list by state and move the slots along, so slots[i] stays the slot of list[i].
+ */
+template<typename Renderable, typename MaterialOf>
+void sort_with_slots(std::vector<Renderable>& list,
+					 std::vector<uint32_t>& slots,
+					 uint32_t pipeline,
+					 MaterialOf material_of)
+{
+	if (list.size() < 2)
+		return;
+
+	const std::vector<DrawKey> keys = sorted_draw_keys(list,
+													   DrawOrder::State,
+													   pipeline,
+													   glm::mat4(1.0f),
+													   material_of,
+													   DrawMaterialHash{});
+	std::vector<Renderable> sorted_list{};
+	std::vector<uint32_t> sorted_slots{};
+	sorted_list.reserve(list.size());
+	sorted_slots.reserve(slots.size());
+	for (DrawKey const& key: keys) {
+		sorted_list.push_back(list[key.index]);
+		sorted_slots.push_back(slots[key.index]);
+	}
+	list = std::move(sorted_list);
+	slots = std::move(sorted_slots);
+}
+
+}
+
+auto scene_draws_from(std::vector<Renderable> const& renderables)
+	-> SceneDraws
+{
+	SceneDraws draws{};
+	for (Renderable const& renderable: renderables) {
+		std::visit([&] (auto const& draw) {
+			list_of(draws.renderables, draw).push_back(draw);
+			boxes_of(draws.boxes, draw).push(draw.mesh->bounds(), draw.model);
+		}, renderable);
+
+		// NOTE nothing is kept between frames, so every caster is a dynamic one
+		if (casts_shadow(renderable)) {
+			MaterialRenderable const& caster = std::get<MaterialRenderable>(renderable);
+			draws.dynamic_shadow_casters.push_back(caster);
+			draws.dynamic_shadow_caster_boxes.push(caster.mesh->bounds(), caster.model);
+		}
+	}
+	return draws;
+}
+
+auto Scene::Impl::add(Renderable const& renderable)
+	-> RenderableHandle
+{
+	uint32_t index = 0;
+	if (m_free_renderables.empty()) {
+		index = static_cast<uint32_t>(m_renderables.size());
+		m_renderables.emplace_back();
+	}
+	else {
+		index = m_free_renderables.back();
+		m_free_renderables.pop_back();
+	}
+
+	RenderableSlot& slot = m_renderables[index];
+	slot.renderable = renderable;
+	slot.alive = true;
+	slot.dirty = false;
+	slot.moved = false;
+	renderable_count++;
+	m_draws_changed = true;
+	if (casts_shadow(renderable))
+		m_static_casters_changed = true;
+	return RenderableHandle{index, slot.generation};
+}
+
+auto Scene::Impl::update(RenderableHandle handle,
+						 Renderable const& renderable)
+	-> bool
+{
+	if (!contains(handle))
+		return false;
+
+	RenderableSlot& slot = m_renderables[handle.index];
+	if (!same_draw(slot.renderable, renderable)) {
+		m_draws_changed = true;
+		if (!slot.moved && (casts_shadow(slot.renderable) || casts_shadow(renderable)))
+			m_static_casters_changed = true;
+	}
+	else {
+		promote_caster(slot);
+		if (!slot.dirty) {
+			slot.dirty = true;
+			m_dirty_renderables.push_back(handle.index);
+		}
+	}
+	slot.renderable = renderable;
+	return true;
+}
+
+auto Scene::Impl::set_model(RenderableHandle handle,
+							glm::mat4 const& model)
+	-> bool
+{
+	if (!contains(handle))
+		return false;
+
+	RenderableSlot& slot = m_renderables[handle.index];
+	std::visit([&] (auto& draw) { draw.model = model; }, slot.renderable);
+	promote_caster(slot);
+	if (!slot.dirty) {
+		slot.dirty = true;
+		m_dirty_renderables.push_back(handle.index);
+	}
+	return true;
+}
+
+auto Scene::Impl::remove(RenderableHandle handle)
+	-> bool
+{
+	if (!contains(handle))
+		return false;
+
+	RenderableSlot& slot = m_renderables[handle.index];
+	slot.alive = false;
+	slot.generation++;
+	m_free_renderables.push_back(handle.index);
+	renderable_count--;
+	m_draws_changed = true;
+	if (!slot.moved && casts_shadow(slot.renderable))
+		m_static_casters_changed = true;
+	return true;
+}
+
+void Scene::Impl::promote_caster(RenderableSlot& slot)
+{
+	if (slot.moved || !casts_shadow(slot.renderable))
+		return;
+	slot.moved = true;
+	m_draws_changed = true;
+	m_static_casters_changed = true;
+}
+
+auto Scene::Impl::contains(RenderableHandle handle) const
+	-> bool
+{
+	return handle.index < m_renderables.size()
+		&& m_renderables[handle.index].alive
+		&& m_renderables[handle.index].generation == handle.generation;
+}
+
+auto Scene::Impl::add(Light const& light)
+	-> LightHandle
+{
+	uint32_t index = 0;
+	if (m_free_lights.empty()) {
+		index = static_cast<uint32_t>(m_lights.size());
+		m_lights.emplace_back();
+	}
+	else {
+		index = m_free_lights.back();
+		m_free_lights.pop_back();
+	}
+
+	LightSlot& slot = m_lights[index];
+	slot.light = light;
+	slot.alive = true;
+	light_count++;
+	m_lights_changed = true;
+	return LightHandle{index, slot.generation};
+}
+
+auto Scene::Impl::update(LightHandle handle,
+						 Light const& light)
+	-> bool
+{
+	if (!contains(handle))
+		return false;
+
+	m_lights[handle.index].light = light;
+	m_lights_changed = true;
+	return true;
+}
+
+auto Scene::Impl::remove(LightHandle handle)
+	-> bool
+{
+	if (!contains(handle))
+		return false;
+
+	LightSlot& slot = m_lights[handle.index];
+	slot.alive = false;
+	slot.generation++;
+	m_free_lights.push_back(handle.index);
+	light_count--;
+	m_lights_changed = true;
+	return true;
+}
+
+auto Scene::Impl::contains(LightHandle handle) const
+	-> bool
+{
+	return handle.index < m_lights.size()
+		&& m_lights[handle.index].alive
+		&& m_lights[handle.index].generation == handle.generation;
+}
+
+void Scene::Impl::clear()
+{
+	// NOTE the slots are kept, so the generations keep old handles invalid
+	for (uint32_t i = 0; i < m_renderables.size(); i++) {
+		if (m_renderables[i].alive)
+			remove(RenderableHandle{i, m_renderables[i].generation});
+	}
+	for (uint32_t i = 0; i < m_lights.size(); i++) {
+		if (m_lights[i].alive)
+			remove(LightHandle{i, m_lights[i].generation});
+	}
+	shadowcasters = ShadowCasters{};
+}
+
+auto Scene::Impl::draws()
+	-> SceneDraws const&
+{
+	if (m_draws_changed || m_draws.sorted != (draw_order == DrawOrder::State))
+		rebuild_draws();
+	else if (!m_dirty_renderables.empty())
+		patch_draws();
+	return m_draws;
+}
+
+void Scene::Impl::rebuild_draws()
+{
+	struct Slots
+	{
+		std::vector<uint32_t> basetextures;
+		std::vector<uint32_t> normcolors;
+		std::vector<uint32_t> wireframes;
+		std::vector<uint32_t> materialrenderables;
+		std::vector<uint32_t> shadow_casters;
+		std::vector<uint32_t> dynamic_shadow_casters;
+	} slots{};
+
+	SceneDraws draws{};
+	for (uint32_t i = 0; i < m_renderables.size(); i++) {
+		RenderableSlot& slot = m_renderables[i];
+		slot.dirty = false;
+		if (!slot.alive)
+			continue;
+
+		std::visit([&] (auto const& draw) {
+			list_of(draws.renderables, draw).push_back(draw);
+		}, slot.renderable);
+
+		if (std::holds_alternative<NormColorRenderable>(slot.renderable))
+			slots.normcolors.push_back(i);
+		else if (std::holds_alternative<WireframeRenderable>(slot.renderable))
+			slots.wireframes.push_back(i);
+		else if (std::holds_alternative<BaseTextureRenderable>(slot.renderable))
+			slots.basetextures.push_back(i);
+		else
+			slots.materialrenderables.push_back(i);
+
+		if (casts_shadow(slot.renderable) && slot.moved) {
+			draws.dynamic_shadow_casters.push_back(std::get<MaterialRenderable>(slot.renderable));
+			slots.dynamic_shadow_casters.push_back(i);
+		}
+		else if (casts_shadow(slot.renderable)) {
+			draws.shadow_casters.push_back(std::get<MaterialRenderable>(slot.renderable));
+			slots.shadow_casters.push_back(i);
+		}
+	}
+	m_dirty_renderables.clear();
+
+	/* With state order the draws do not depend on the view, so they are sorted once here
+	 * instead of every frame. The casters of the depth only passes only need their meshes grouped.
+	 */
+	draws.sorted = draw_order == DrawOrder::State;
+	if (draws.sorted) {
+		sort_with_slots(draws.renderables.normcolors, slots.normcolors,
+						normcolor_draw_pipeline, DrawMaterialOf{});
+		sort_with_slots(draws.renderables.wireframes, slots.wireframes,
+						wireframe_draw_pipeline, DrawMaterialOf{});
+		sort_with_slots(draws.renderables.basetextures, slots.basetextures,
+						basetexture_draw_pipeline, DrawMaterialOf{});
+		sort_with_slots(draws.renderables.materialrenderables, slots.materialrenderables,
+						material_draw_pipeline, DrawMaterialOf{});
+		sort_with_slots(draws.shadow_casters, slots.shadow_casters,
+						material_draw_pipeline, [] (MaterialRenderable const&) { return 0; });
+		sort_with_slots(draws.dynamic_shadow_casters, slots.dynamic_shadow_casters,
+						material_draw_pipeline, [] (MaterialRenderable const&) { return 0; });
+	}
+
+	const auto place = [&] (auto const& list, std::vector<uint32_t> const& list_slots, CullBoxes& boxes) {
+		boxes.reserve(list.size());
+		for (uint32_t i = 0; i < list.size(); i++) {
+			boxes.push(list[i].mesh->bounds(), list[i].model);
+			m_renderables[list_slots[i]].draw_index = i;
+			m_renderables[list_slots[i]].caster_index = std::nullopt;
+		}
+	};
+	place(draws.renderables.normcolors, slots.normcolors, draws.boxes.normcolors);
+	place(draws.renderables.wireframes, slots.wireframes, draws.boxes.wireframes);
+	place(draws.renderables.basetextures, slots.basetextures, draws.boxes.basetextures);
+	place(draws.renderables.materialrenderables,
+		  slots.materialrenderables,
+		  draws.boxes.materialrenderables);
+
+	draws.shadow_caster_boxes.reserve(draws.shadow_casters.size());
+	for (MaterialRenderable const& caster: draws.shadow_casters)
+		draws.shadow_caster_boxes.push(caster.mesh->bounds(), caster.model);
+
+	draws.dynamic_shadow_caster_boxes.reserve(draws.dynamic_shadow_casters.size());
+	for (uint32_t i = 0; i < draws.dynamic_shadow_casters.size(); i++) {
+		MaterialRenderable const& caster = draws.dynamic_shadow_casters[i];
+		draws.dynamic_shadow_caster_boxes.push(caster.mesh->bounds(), caster.model);
+		m_renderables[slots.dynamic_shadow_casters[i]].caster_index = i;
+	}
+
+	// NOTE the cached static shadows are only redrawn when their casters changed
+	if (m_static_casters_changed)
+		m_static_shadow_version++;
+	m_static_casters_changed = false;
+	draws.static_shadow_version = m_static_shadow_version;
+
+	draws.version = ++m_version;
+	m_draws = std::move(draws);
+	m_draws_changed = false;
+}
+
+void Scene::Impl::patch_draws()
+{
+	for (uint32_t index: m_dirty_renderables) {
+		RenderableSlot& slot = m_renderables[index];
+		slot.dirty = false;
+		if (!slot.alive)
+			continue;
+
+		std::visit([&] (auto const& draw) {
+			list_of(m_draws.renderables, draw)[slot.draw_index] = draw;
+			boxes_of(m_draws.boxes, draw).set(slot.draw_index, draw.mesh->bounds(), draw.model);
+		}, slot.renderable);
+
+		if (slot.caster_index.has_value()) {
+			MaterialRenderable const& caster = std::get<MaterialRenderable>(slot.renderable);
+			m_draws.dynamic_shadow_casters[*slot.caster_index] = caster;
+			m_draws.dynamic_shadow_caster_boxes.set(*slot.caster_index,
+													caster.mesh->bounds(),
+													caster.model);
+		}
+	}
+	m_dirty_renderables.clear();
+	m_draws.version = ++m_version;
+}
+
+auto Scene::Impl::lights()
+	-> std::vector<Light>&
+{
+	if (m_lights_changed) {
+		m_light_list.clear();
+		for (LightSlot const& slot: m_lights) {
+			if (slot.alive)
+				m_light_list.push_back(slot.light);
+		}
+		m_lights_changed = false;
+	}
+	return m_light_list;
+}
+
+Scene::Scene()
+	: impl(std::make_unique<Impl>())
+{
+}
+
+Scene::~Scene()
+{
+}
+
+auto Scene::add(Renderable const& renderable)
+	-> RenderableHandle
+{
+	return impl->add(renderable);
+}
+
+auto Scene::update(RenderableHandle handle,
+				   Renderable const& renderable)
+	-> bool
+{
+	return impl->update(handle, renderable);
+}
+
+auto Scene::set_model(RenderableHandle handle,
+					  glm::mat4 const& model)
+	-> bool
+{
+	return impl->set_model(handle, model);
+}
+
+auto Scene::remove(RenderableHandle handle)
+	-> bool
+{
+	return impl->remove(handle);
+}
+
+auto Scene::contains(RenderableHandle handle) const
+	-> bool
+{
+	return impl->contains(handle);
+}
+
+auto Scene::add(Light const& light)
+	-> LightHandle
+{
+	return impl->add(light);
+}
+
+auto Scene::update(LightHandle handle,
+				   Light const& light)
+	-> bool
+{
+	return impl->update(handle, light);
+}
+
+auto Scene::remove(LightHandle handle)
+	-> bool
+{
+	return impl->remove(handle);
+}
+
+auto Scene::contains(LightHandle handle) const
+	-> bool
+{
+	return impl->contains(handle);
+}
+
+void Scene::set_shadowcasters(ShadowCasters const& shadowcasters)
+{
+	impl->shadowcasters = shadowcasters;
+}
+
+auto Scene::shadowcasters() const
+	-> ShadowCasters const&
+{
+	return impl->shadowcasters;
+}
+
+void Scene::clear()
+{
+	impl->clear();
+}
+
+auto Scene::renderable_count() const
+	-> size_t
+{
+	return impl->renderable_count;
+}
+
+auto Scene::light_count() const
+	-> size_t
+{
+	return impl->light_count;
+}
@@ -0,0 +1,207 @@
+#pragma once
+
+#include <VulkanRenderer/Scene.hpp>
+
+#include "DrawSort.hpp"
+#include "FrustumCull.hpp"
+#include "PipelineUtils.hpp"
+
+#include <optional>
+#include <vector>
+
+struct SortedRenderables
+{
+	std::vector<BaseTextureRenderable> basetextures;
+	std::vector<NormColorRenderable> normcolors;
+	std::vector<WireframeRenderable> wireframes;
+	std::vector<MaterialRenderable> materialrenderables;
+};
+
+struct SortedCullBoxes
+{
+	CullBoxes basetextures;
+	CullBoxes normcolors;
+	CullBoxes wireframes;
+	CullBoxes materialrenderables;
+};
+
+// NOTE the pipeline field of the draw keys of every pipeline
+uint32_t constexpr normcolor_draw_pipeline = 0;
+uint32_t constexpr wireframe_draw_pipeline = 1;
+uint32_t constexpr basetexture_draw_pipeline = 2;
+uint32_t constexpr material_draw_pipeline = 3;
+
+/**
+ * The material a renderable binds when drawn, the renderables of
+ * a pipeline without textures all share the same one.
+ */
+struct DrawMaterialOf
+{
+	auto operator()(NormColorRenderable const&) const noexcept -> int { return 0; }
+	auto operator()(WireframeRenderable const&) const noexcept -> int { return 0; }
+
+	auto operator()(BaseTextureRenderable const& renderable) const noexcept
+		-> TextureSamplerReadOnly*
+	{
+		return renderable.texture;
+	}
+
+	auto operator()(MaterialRenderable const& renderable) const noexcept
+		-> TextureMaterial
+	{
+		return TextureMaterial{renderable.texture.ambient,
+							   renderable.texture.diffuse,
+							   renderable.texture.specular,
+							   renderable.texture.normal};
+	}
+};
+
+struct DrawMaterialHash
+{
+	size_t operator()(TextureMaterial const& material) const noexcept
+	{
+		return TextureMaterialHash{}(material);
+	}
+
+	template<typename Material>
+	size_t operator()(Material const& material) const noexcept
+	{
+		return std::hash<Material>{}(material);
+	}
+};
+
+/**
+ * The renderables of every pipeline with their world space boxes at the same index,
+ * as a retained Scene keeps them between frames.
+ */
+struct SceneDraws
+{
+	SortedRenderables renderables;
+	SortedCullBoxes boxes;
+	// NOTE the material renderables with a shadow that never moved, sorted by mesh for the
+	//      depth only passes. Their depths are cached until static_shadow_version changes.
+	std::vector<MaterialRenderable> shadow_casters;
+	CullBoxes shadow_caster_boxes;
+	// NOTE the casters that were moved, their depths are drawn over the cached ones every frame
+	std::vector<MaterialRenderable> dynamic_shadow_casters;
+	CullBoxes dynamic_shadow_caster_boxes;
+	// NOTE a new version every time the static casters change, 0 for draws made for a single frame
+	uint64_t static_shadow_version{0};
+	// NOTE set when every list is already in the order the renderer records it in
+	bool sorted{false};
+	// NOTE a new version every time the draws change, 0 for draws made for a single frame
+	uint64_t version{0};
+};
+
+/**
+ * Unsorted draws of renderables for a single frame, for rendering without a Scene.
+ */
+[[nodiscard]]
+auto scene_draws_from(std::vector<Renderable> const& renderables)
+	-> SceneDraws;
+
+class Scene::Impl
+{
+public:
+	auto add(Renderable const& renderable)
+		-> RenderableHandle;
+
+	auto update(RenderableHandle handle,
+				Renderable const& renderable)
+		-> bool;
+
+	auto set_model(RenderableHandle handle,
+				   glm::mat4 const& model)
+		-> bool;
+
+	auto remove(RenderableHandle handle)
+		-> bool;
+
+	[[nodiscard]]
+	auto contains(RenderableHandle handle) const
+		-> bool;
+
+	auto add(Light const& light)
+		-> LightHandle;
+
+	auto update(LightHandle handle,
+				Light const& light)
+		-> bool;
+
+	auto remove(LightHandle handle)
+		-> bool;
+
+	[[nodiscard]]
+	auto contains(LightHandle handle) const
+		-> bool;
+
+	void clear();
+
+	/**
+	 * The draws of the scene, brought up to date with the changes since the last call.
+	 * Nothing is done when nothing changed, moved renderables are patched in place and
+	 * anything else rebuilds and sorts the draws.
+	 */
+	[[nodiscard]]
+	auto draws()
+		-> SceneDraws const&;
+
+	/**
+	 * The lights of the scene, rebuilt only after lights were changed.
+	 */
+	[[nodiscard]]
+	auto lights()
+		-> std::vector<Light>&;
+
+	// NOTE the scene can only keep its draws sorted when they do not depend on the view
+	DrawOrder draw_order{DrawOrder::State};
+	ShadowCasters shadowcasters;
+	size_t renderable_count{0};
+	size_t light_count{0};
+
+private:
+	void rebuild_draws();
+	void patch_draws();
+
+	struct RenderableSlot
+	{
+		Renderable renderable;
+		uint32_t generation{0};
+		bool alive{false};
+		bool dirty{false};
+		// NOTE set the first time a shadow caster moves, from then on it is a dynamic caster
+		bool moved{false};
+		// NOTE where the renderable was put the last time the draws were built
+		uint32_t draw_index{0};
+		// NOTE only dynamic casters are patched in place, so this indexes the dynamic casters
+		std::optional<uint32_t> caster_index{std::nullopt};
+	};
+
+	/**
+	 * A shadow caster that moves for the first time is made dynamic,
+	 * which rebuilds the draws to move it out of the cached static casters.
+	 */
+	void promote_caster(RenderableSlot& slot);
+
+	struct LightSlot
+	{
+		Light light;
+		uint32_t generation{0};
+		bool alive{false};
+	};
+
+	std::vector<RenderableSlot> m_renderables;
+	std::vector<uint32_t> m_free_renderables;
+	std::vector<uint32_t> m_dirty_renderables;
+	bool m_draws_changed{false};
+	bool m_static_casters_changed{false};
+
+	std::vector<LightSlot> m_lights;
+	std::vector<uint32_t> m_free_lights;
+	bool m_lights_changed{false};
+
+	SceneDraws m_draws;
+	std::vector<Light> m_light_list;
+	uint64_t m_version{0};
+	uint64_t m_static_shadow_version{0};
+};
@@ -0,0 +1,51 @@
+#include "SecondaryCommandPools.hpp"
+
+SecondaryCommandPools::SecondaryCommandPools(vk::Device device,
+											 uint32_t queue_family_index,
+											 uint32_t thread_count,
+											 uint32_t frames_in_flight)
+	: m_device(device)
+{
+	const auto pool_info = vk::CommandPoolCreateInfo{}
+		.setFlags(vk::CommandPoolCreateFlagBits::eTransient)
+		.setQueueFamilyIndex(queue_family_index);
+
+	m_pools.resize(frames_in_flight);
+	for (auto& frame_pools: m_pools) {
+		frame_pools.resize(thread_count);
+		for (ThreadPools& pools: frame_pools)
+			pools.pool = m_device.createCommandPoolUnique(pool_info, nullptr);
+	}
+}
+
+void SecondaryCommandPools::begin_frame(CurrentFlightFrame current_flightframe)
+{
+	m_frame = current_flightframe.get();
+	for (ThreadPools& pools: m_pools[m_frame]) {
+		m_device.resetCommandPool(pools.pool.get(), vk::CommandPoolResetFlags());
+		pools.used = 0;
+	}
+}
+
+auto SecondaryCommandPools::begin(uint32_t thread_index,
+								  vk::CommandBufferInheritanceInfo const& inheritance)
+	-> vk::CommandBuffer
+{
+	ThreadPools& pools = m_pools[m_frame][thread_index];
+	if (pools.used == pools.commandbuffers.size()) {
+		const auto allocate_info = vk::CommandBufferAllocateInfo{}
+			.setCommandPool(pools.pool.get())
+			.setLevel(vk::CommandBufferLevel::eSecondary)
+			.setCommandBufferCount(1);
+		auto commandbuffers = m_device.allocateCommandBuffersUnique(allocate_info);
+		pools.commandbuffers.push_back(std::move(commandbuffers[0]));
+	}
+
+	vk::CommandBuffer commandbuffer = pools.commandbuffers[pools.used++].get();
+	const auto begin_info = vk::CommandBufferBeginInfo{}
+		.setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit
+				  | vk::CommandBufferUsageFlagBits::eRenderPassContinue)
+		.setPInheritanceInfo(&inheritance);
+	commandbuffer.begin(begin_info);
+	return commandbuffer;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "FlightFrames.hpp"
+
+#include <vulkan/vulkan.hpp>
+
+#include <vector>
+
+/**
+ * Command pools for recording secondary commandbuffers from several threads.
+ *
+ * A vkCommandPool must only be used by one thread at a time, so every thread
+ * gets its own pool per frame in flight. The pools of a flight frame are reset
+ * as a whole once the presenter has waited on that frames fence, the
+ * commandbuffers allocated from them are kept and handed out again.
+ */
+class SecondaryCommandPools
+{
+public:
+	SecondaryCommandPools(vk::Device device,
+						  uint32_t queue_family_index,
+						  uint32_t thread_count,
+						  uint32_t frames_in_flight);
+
+	SecondaryCommandPools(SecondaryCommandPools&) = delete;
+	SecondaryCommandPools& operator=(SecondaryCommandPools&) = delete;
+
+	void begin_frame(CurrentFlightFrame current_flightframe);
+
+	/**
+	 * Begin a secondary commandbuffer that continues the renderpass of inheritance,
+	 * from the pool of the given thread.
+	 * The returned commandbuffer is only valid for the current frame.
+	 */
+	[[nodiscard]]
+	auto begin(uint32_t thread_index,
+			   vk::CommandBufferInheritanceInfo const& inheritance)
+		-> vk::CommandBuffer;
+
+private:
+	struct ThreadPools
+	{
+		vk::UniqueCommandPool pool;
+		std::vector<vk::UniqueCommandBuffer> commandbuffers;
+		size_t used{0};
+	};
+
+	vk::Device m_device;
+	uint32_t m_frame{0};
+	// NOTE indexed by [flight frame][thread]
+	std::vector<std::vector<ThreadPools>> m_pools;
+};
@@ -1,5 +1,13 @@
 #include "ShaderTextureImpl.hpp"
 
+#include "BindlessTextures.hpp"
+
+TextureSamplerReadOnly::Impl::~Impl()
+{
+	for (BindlessTextures* textures: bindless)
+		textures->release(this);
+}
+
 auto TextureSamplerReadOnly::Impl::image()
 	-> vk::Image&
 {
@@ -11,38 +19,49 @@ auto make_shader_readonly(Render::Context::Impl* context,
 						  Texture2D&& texture)
 	-> TextureSamplerReadOnly
 {
-	with_buffer_submit(context->device.get(),
-					   context->commandpool.get(),
-					   context->graphics_queue(),
-					   [&] (vk::CommandBuffer& commandbuffer)
-					   {
-						   auto range = vk::ImageSubresourceRange{}
-							   .setAspectMask(vk::ImageAspectFlagBits::eColor)
-							   .setBaseMipLevel(0)
-							   .setLevelCount(1)
-							   .setBaseArrayLayer(0)
-							   .setLayerCount(1);
-						   
-						   auto barrier = vk::ImageMemoryBarrier{}
-							   .setOldLayout(texture.impl->layout)
-							   .setNewLayout(vk::ImageLayout::eShaderReadOnlyOptimal)
-							   .setImage(texture.impl->image())
-							   .setSubresourceRange(range)
-							   .setSrcAccessMask(vk::AccessFlags())
-							   .setDstAccessMask(vk::AccessFlagBits::eTransferWrite);
-						   
-						   commandbuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe,
-														 vk::PipelineStageFlagBits::eTransfer,
-														 vk::DependencyFlags(),
-														 nullptr,
-														 nullptr,
-														 barrier);
-						   texture.impl->layout = vk::ImageLayout::eShaderReadOnlyOptimal;
-					   });
+	// NOTE recorded into the same upload batch as the copy, so the transition
+	//      executes after it without blocking here.
+	const vk::ImageLayout old_layout = texture.impl->layout;
+	vk::Image image = texture.impl->image();
+	const UploadTicket ticket =
+		context->upload_queue->record([=] (vk::CommandBuffer& commandbuffer)
+									  {
+										  auto range = vk::ImageSubresourceRange{}
+											  .setAspectMask(vk::ImageAspectFlagBits::eColor)
+											  .setBaseMipLevel(0)
+											  .setLevelCount(1)
+											  .setBaseArrayLayer(0)
+											  .setLayerCount(1);
+										  
+										  const bool was_written =
+											  old_layout == vk::ImageLayout::eTransferDstOptimal;
+										  auto barrier = vk::ImageMemoryBarrier{}
+											  .setOldLayout(old_layout)
+											  .setNewLayout(vk::ImageLayout::eShaderReadOnlyOptimal)
+											  .setSrcQueueFamilyIndex(vk::QueueFamilyIgnored)
+											  .setDstQueueFamilyIndex(vk::QueueFamilyIgnored)
+											  .setImage(image)
+											  .setSubresourceRange(range)
+											  .setSrcAccessMask(was_written
+																? vk::AccessFlags(vk::AccessFlagBits::eTransferWrite)
+																: vk::AccessFlags())
+											  .setDstAccessMask(vk::AccessFlagBits::eShaderRead);
+										  
+										  commandbuffer.pipelineBarrier(was_written
+																		? vk::PipelineStageFlagBits::eTransfer
+																		: vk::PipelineStageFlagBits::eTopOfPipe,
+																		vk::PipelineStageFlagBits::eFragmentShader,
+																		vk::DependencyFlags(),
+																		nullptr,
+																		nullptr,
+																		barrier);
+									  });
+	texture.impl->layout = vk::ImageLayout::eShaderReadOnlyOptimal;
 
 	auto sampler_impl = std::make_unique<TextureSamplerReadOnly::Impl>();
 	std::swap(sampler_impl->allocated, texture.impl->allocated);
 	sampler_impl->format = texture.impl->format;
+	sampler_impl->upload = ticket;
 	
 	const auto view_subresource_range = vk::ImageSubresourceRange{}
 		.setAspectMask(vk::ImageAspectFlagBits::eColor)
@@ -116,6 +135,12 @@ auto make_shader_readonly(Render::Context* context,
 	return make_shader_readonly(context->impl.get(), interpolation);
 }
 
+auto TextureSamplerReadOnly::upload_ticket()
+	const noexcept -> UploadTicket
+{
+	return impl->upload;
+}
+
 TextureSamplerReadOnly::TextureSamplerReadOnly(std::unique_ptr<TextureSamplerReadOnly::Impl>&& impl)
 	: impl(std::move(impl))
 {
@@ -5,10 +5,15 @@
 #include "ContextImpl.hpp"
 #include "TextureImpl.hpp"
 
+#include <vector>
+
+class BindlessTextures;
+
 struct TextureSamplerReadOnly::Impl
 {
 	explicit Impl() = default;
-	~Impl() = default;
+	// NOTE releases the slots of the bindless arrays the texture was registered into
+	~Impl();
 
 	auto image()
 		-> vk::Image&;
@@ -17,6 +22,8 @@ struct TextureSamplerReadOnly::Impl
 	vk::UniqueImageView view;
 	vk::UniqueSampler sampler;
 	vk::Format format;
+	UploadTicket upload{};
+	std::vector<BindlessTextures*> bindless;
 };
 
 auto make_shader_readonly(Render::Context::Impl* context,
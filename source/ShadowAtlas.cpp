@@ -0,0 +1,174 @@
+#include "ShadowAtlas.hpp"
+
+#include "FrustumCull.hpp"
+#include "LightClusters.hpp"
+#include "ShadowCascades.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <numeric>
+
+namespace
+{
+
+// NOTE the even bits of a Morton code, the odd bits are compacted after shifting it once
+auto compact_bits(uint32_t code) noexcept
+	-> uint32_t
+{
+	code &= 0x55555555u;
+	code = (code | (code >> 1)) & 0x33333333u;
+	code = (code | (code >> 2)) & 0x0f0f0f0fu;
+	code = (code | (code >> 4)) & 0x00ff00ffu;
+	code = (code | (code >> 8)) & 0x0000ffffu;
+	return code;
+}
+
+auto sphere_in_frustum(Frustum const& frustum, glm::vec3 const& center, float radius) noexcept
+	-> bool
+{
+	// NOTE the planes are not normalized, so the radius is scaled by the length of their normal
+	for (glm::vec4 const& plane: frustum.planes) {
+		const glm::vec3 normal(plane);
+		if (glm::dot(normal, center) + plane.w < -radius * glm::length(normal))
+			return false;
+	}
+	return true;
+}
+
+}
+
+auto shadow_importance(SpotShadowCaster const& caster,
+					   glm::mat4 const& view,
+					   glm::mat4 const& projection)
+	-> float
+{
+	SpotLight const light = caster.light();
+	const float radius = light_radius(light);
+	if (!(radius > 0.0f))
+		return 0.0f;
+	if (!std::isfinite(radius))
+		return 1.0f;
+
+	const Frustum frustum = frustum_from_view_projection(projection * view);
+	if (!sphere_in_frustum(frustum, light.position, radius))
+		return 0.0f;
+
+	const float distance = glm::length(glm::vec3(view * glm::vec4(light.position, 1.0f)));
+	if (distance <= radius)
+		return 1.0f;
+
+	// NOTE the projected radius of the reach, as a fraction of half the screen height
+	return std::min(radius / distance * std::abs(projection[1][1]), 1.0f);
+}
+
+auto pack_shadow_atlas(uint32_t atlas_size,
+					   ShadowAtlasTiles tiles,
+					   std::vector<float> const& importances)
+	-> std::vector<std::optional<ShadowAtlasRect>>
+{
+	std::vector<uint32_t> sizes(importances.size(), 0);
+	for (size_t i = 0; i < importances.size(); i++) {
+		if (!(importances[i] > 0.0f))
+			continue;
+		const float wanted = static_cast<float>(tiles.max) * std::min(importances[i], 1.0f);
+		sizes[i] = std::clamp(std::bit_floor(static_cast<uint32_t>(wanted)), tiles.min, tiles.max);
+	}
+
+	// NOTE the most important casters first, they are the last to be left out
+	std::vector<uint32_t> order(importances.size());
+	std::iota(order.begin(), order.end(), 0u);
+	std::stable_sort(order.begin(), order.end(), [&] (uint32_t lhs, uint32_t rhs) {
+		return importances[lhs] > importances[rhs];
+	});
+
+	const uint64_t atlas_area = static_cast<uint64_t>(atlas_size) * atlas_size;
+	const auto area = [&] () {
+		uint64_t total = 0;
+		for (uint32_t size: sizes)
+			total += static_cast<uint64_t>(size) * size;
+		return total;
+	};
+
+	/* Halve the largest tiles until everything fits,
+	 * and leave out the least important casters once every tile is the smallest size.
+	 */
+	while (area() > atlas_area) {
+		const uint32_t largest = *std::max_element(sizes.begin(), sizes.end());
+		if (largest > tiles.min) {
+			for (uint32_t& size: sizes) {
+				if (size == largest)
+					size /= 2;
+			}
+			continue;
+		}
+		const auto least = std::find_if(order.rbegin(), order.rend(), [&] (uint32_t i) {
+			return sizes[i] != 0;
+		});
+		sizes[*least] = 0;
+	}
+
+	/* Every tile is a multiple of the smallest one, so in decreasing size
+	 * the tiles before any tile fill whole squares of its size along the curve.
+	 */
+	std::stable_sort(order.begin(), order.end(), [&] (uint32_t lhs, uint32_t rhs) {
+		return sizes[lhs] > sizes[rhs];
+	});
+
+	std::vector<std::optional<ShadowAtlasRect>> rects(importances.size());
+	uint32_t offset = 0;
+	for (uint32_t i: order) {
+		if (sizes[i] == 0)
+			break;
+		rects[i] = ShadowAtlasRect{compact_bits(offset) * tiles.min,
+								   compact_bits(offset >> 1) * tiles.min,
+								   sizes[i]};
+		const uint32_t units = sizes[i] / tiles.min;
+		offset += units * units;
+	}
+	return rects;
+}
+
+auto layout_shadow_atlas(uint32_t atlas_size,
+						 ShadowCasters const& casters,
+						 glm::mat4 const& view,
+						 glm::mat4 const& projection)
+	-> ShadowAtlasLayout
+{
+	std::vector<float> importances{};
+	for (DirectionalShadowCaster const& caster: casters.directional_casters)
+		importances.insert(importances.end(), shadow_cascade_count(caster), 1.0f);
+	const size_t directional_tiles = importances.size();
+	for (SpotShadowCaster const& caster: casters.spot_casters)
+		importances.push_back(shadow_importance(caster, view, projection));
+
+	// NOTE the largest tile leaves room for at least four casters at full size
+	uint32_t constexpr smallest_tile = 128;
+	const ShadowAtlasTiles tiles{std::min(smallest_tile, atlas_size),
+								 std::max(atlas_size / 2, std::min(smallest_tile, atlas_size))};
+	const std::vector<std::optional<ShadowAtlasRect>> rects =
+		pack_shadow_atlas(atlas_size, tiles, importances);
+
+	ShadowAtlasLayout layout{};
+	layout.size = atlas_size;
+	auto rect = rects.begin();
+	for (DirectionalShadowCaster const& caster: casters.directional_casters) {
+		const auto cascades_end = rect + shadow_cascade_count(caster);
+		layout.directionals.emplace_back(rect, cascades_end);
+		rect = cascades_end;
+	}
+	layout.spots.assign(rects.begin() + directional_tiles, rects.end());
+	return layout;
+}
+
+auto atlas_uv_rect(ShadowAtlasLayout const& layout,
+				   std::optional<ShadowAtlasRect> const& rect) noexcept
+	-> glm::vec4
+{
+	if (!rect.has_value() || layout.size == 0)
+		return glm::vec4(0.0f);
+	return glm::vec4(static_cast<float>(rect->x),
+					 static_cast<float>(rect->y),
+					 static_cast<float>(rect->size),
+					 static_cast<float>(rect->size)) / static_cast<float>(layout.size);
+}
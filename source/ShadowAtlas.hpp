@@ -0,0 +1,80 @@
+#pragma once
+
+#include <VulkanRenderer/glm.hpp>
+#include <VulkanRenderer/ShadowCaster.hpp>
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+/**
+ * Placement of every shadow caster in one shared shadow atlas.
+ *
+ * Every caster is given a square tile with a power of two size from its importance.
+ * Directional casters light the whole view and get the largest tile, one for every
+ * cascade of a cascaded caster, spot casters
+ * a tile matching how much of the screen their reach covers, and spot casters
+ * reaching nothing in view are left out. Sorted by decreasing size the tiles are
+ * placed along a Morton curve, which packs power of two squares without gaps.
+ * When they do not fit the largest tiles are halved until they do, and once all
+ * of them are the smallest size the least important casters are left out.
+ */
+struct ShadowAtlasRect
+{
+	uint32_t x;
+	uint32_t y;
+	uint32_t size;
+
+	bool operator==(ShadowAtlasRect const&) const = default;
+};
+
+struct ShadowAtlasTiles
+{
+	uint32_t min;
+	uint32_t max;
+};
+
+struct ShadowAtlasLayout
+{
+	uint32_t size{0};
+	// NOTE at the index of every caster, a caster without a rect lights without a shadow.
+	//      Every directional caster has a rect for each of its cascades.
+	std::vector<std::vector<std::optional<ShadowAtlasRect>>> directionals;
+	std::vector<std::optional<ShadowAtlasRect>> spots;
+};
+
+/**
+ * How much of the view a spot caster reaches, from 0 when it reaches nothing in view
+ * to 1 when its reach covers the screen.
+ */
+[[nodiscard]]
+auto shadow_importance(SpotShadowCaster const& caster,
+					   glm::mat4 const& view,
+					   glm::mat4 const& projection)
+	-> float;
+
+/**
+ * Place a tile for every importance in an atlas of atlas_size,
+ * an importance of 0 or a caster that did not fit is given no rect.
+ */
+[[nodiscard]]
+auto pack_shadow_atlas(uint32_t atlas_size,
+					   ShadowAtlasTiles tiles,
+					   std::vector<float> const& importances)
+	-> std::vector<std::optional<ShadowAtlasRect>>;
+
+[[nodiscard]]
+auto layout_shadow_atlas(uint32_t atlas_size,
+						 ShadowCasters const& casters,
+						 glm::mat4 const& view,
+						 glm::mat4 const& projection)
+	-> ShadowAtlasLayout;
+
+/**
+ * The offset and scale of rect in the texture coordinates of the atlas,
+ * all zero without a rect.
+ */
+[[nodiscard]]
+auto atlas_uv_rect(ShadowAtlasLayout const& layout,
+				   std::optional<ShadowAtlasRect> const& rect) noexcept
+	-> glm::vec4;
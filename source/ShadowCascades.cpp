@@ -0,0 +1,123 @@
+#include "ShadowCascades.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+
+auto unproject(glm::mat4 const& inverse_projection, float x, float y, float z) noexcept
+	-> glm::vec3
+{
+	const glm::vec4 point = inverse_projection * glm::vec4(x, y, z, 1.0f);
+	return glm::vec3(point) / point.w;
+}
+
+}
+
+auto shadow_cascade_count(DirectionalShadowCaster const& caster) noexcept
+	-> uint32_t
+{
+	const std::optional<ShadowCascades> cascades = caster.cascades();
+	return cascades.has_value() ? cascades->count : 1;
+}
+
+auto shadow_cascade_splits(ShadowCascades const& cascades,
+						   float near_depth,
+						   float far_depth)
+	-> std::vector<float>
+{
+	std::vector<float> splits(cascades.count);
+	for (uint32_t i = 0; i < cascades.count; i++) {
+		const float fraction = static_cast<float>(i + 1) / static_cast<float>(cascades.count);
+		const float uniform = near_depth + (far_depth - near_depth) * fraction;
+		const float logarithmic = near_depth * std::pow(far_depth / near_depth, fraction);
+		splits[i] = std::lerp(uniform, logarithmic, cascades.split_lambda);
+	}
+	return splits;
+}
+
+auto fit_shadow_cascades(DirectionalShadowCaster const& caster,
+						 glm::mat4 const& camera_view,
+						 glm::mat4 const& camera_projection,
+						 std::vector<std::optional<ShadowAtlasRect>> const& rects)
+	-> std::vector<ShadowCascade>
+{
+	const std::optional<ShadowCascades> cascades = caster.cascades();
+	if (!cascades.has_value()) {
+		return {ShadowCascade{caster.view(),
+							  caster.projection().get(),
+							  std::numeric_limits<float>::max()}};
+	}
+
+	const glm::mat4 inverse_projection = glm::inverse(camera_projection);
+	const glm::mat4 inverse_view = glm::inverse(camera_view);
+
+	/* The corners of the near plane in view space, the edges of the view are the rays
+	 * from the eye through them. The far plane is not used, it may be infinitely far.
+	 */
+	std::array<glm::vec3, 4> near_corners{};
+	for (uint32_t i = 0; i < near_corners.size(); i++) {
+		const float ndc_x = (i & 1u) ? 1.0f : -1.0f;
+		const float ndc_y = (i & 2u) ? 1.0f : -1.0f;
+		near_corners[i] = unproject(inverse_projection, ndc_x, ndc_y, 0.0f);
+	}
+
+	const float near_depth = std::max(-near_corners[0].z, 1.0e-4f);
+	const float far_plane_depth = -unproject(inverse_projection, 0.0f, 0.0f, 1.0f).z;
+	float far_depth = cascades->distance;
+	if (std::isfinite(far_plane_depth) && far_plane_depth > near_depth)
+		far_depth = std::min(far_depth, far_plane_depth);
+	far_depth = std::max(far_depth, near_depth * 1.0001f);
+
+	const std::vector<float> splits = shadow_cascade_splits(cascades.value(), near_depth, far_depth);
+
+	// NOTE the light looks down its direction from the origin, so the orientation of every
+	//      cascade stays the same and they only move within the light view.
+	const glm::mat4 light_view = caster.view();
+
+	std::vector<ShadowCascade> fitted(splits.size());
+	float slice_near = near_depth;
+	for (uint32_t cascade = 0; cascade < splits.size(); cascade++) {
+		const float slice_far = splits[cascade];
+
+		std::array<glm::vec3, 8> corners{};
+		for (uint32_t i = 0; i < near_corners.size(); i++) {
+			const glm::vec3 ray = near_corners[i] / -near_corners[i].z;
+			corners[i * 2] = glm::vec3(inverse_view * glm::vec4(ray * slice_near, 1.0f));
+			corners[i * 2 + 1] = glm::vec3(inverse_view * glm::vec4(ray * slice_far, 1.0f));
+		}
+
+		glm::vec3 center(0.0f);
+		for (glm::vec3 const& corner: corners)
+			center += corner;
+		center /= static_cast<float>(corners.size());
+
+		float radius = 0.0f;
+		for (glm::vec3 const& corner: corners)
+			radius = std::max(radius, glm::length(corner - center));
+		// NOTE rounded up, so precision does not change the size of the cascade between frames
+		radius = std::ceil(radius * 16.0f) / 16.0f;
+
+		glm::vec3 light_center = glm::vec3(light_view * glm::vec4(center, 1.0f));
+		if (cascade < rects.size() && rects[cascade].has_value()) {
+			const float texel = 2.0f * radius / static_cast<float>(rects[cascade]->size);
+			light_center.x = std::floor(light_center.x / texel) * texel;
+			light_center.y = std::floor(light_center.y / texel) * texel;
+		}
+
+		// NOTE the light view looks down negative z, so the depths are negated
+		const glm::mat4 projection = glm::ortho(light_center.x - radius,
+												light_center.x + radius,
+												light_center.y - radius,
+												light_center.y + radius,
+												-light_center.z - radius - cascades->caster_reach,
+												-light_center.z + radius);
+
+		fitted[cascade] = ShadowCascade{light_view, projection, slice_far};
+		slice_near = slice_far;
+	}
+	return fitted;
+}
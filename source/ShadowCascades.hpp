@@ -0,0 +1,53 @@
+#pragma once
+
+#include <VulkanRenderer/glm.hpp>
+#include <VulkanRenderer/ShadowCaster.hpp>
+
+#include "ShadowAtlas.hpp"
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+/**
+ * The view and projection a directional caster is rendered with into one of its tiles,
+ * and the view depth of the camera its cascade ends at.
+ */
+struct ShadowCascade
+{
+	glm::mat4 view;
+	glm::mat4 projection;
+	float far_depth;
+};
+
+/**
+ * Tiles of the shadow atlas a directional caster needs, one for every cascade.
+ */
+[[nodiscard]]
+auto shadow_cascade_count(DirectionalShadowCaster const& caster) noexcept
+	-> uint32_t;
+
+/**
+ * The view depth every cascade ends at, blending uniform and logarithmic splits
+ * of the depth between near_depth and far_depth.
+ */
+[[nodiscard]]
+auto shadow_cascade_splits(ShadowCascades const& cascades,
+						   float near_depth,
+						   float far_depth)
+	-> std::vector<float>;
+
+/**
+ * Fit the cascades of a caster around the slices of the camera view they cover,
+ * a caster without cascades is rendered with its own view and projection.
+ *
+ * Every cascade bounds its slice with a sphere, so its size does not change when the
+ * camera turns, and its center is snapped to whole texels of its tile in the light view,
+ * so the shadows of static objects do not shimmer when the camera moves.
+ */
+[[nodiscard]]
+auto fit_shadow_cascades(DirectionalShadowCaster const& caster,
+						 glm::mat4 const& camera_view,
+						 glm::mat4 const& camera_projection,
+						 std::vector<std::optional<ShadowAtlasRect>> const& rects)
+	-> std::vector<ShadowCascade>;
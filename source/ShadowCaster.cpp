@@ -1,5 +1,6 @@
 #include <VulkanRenderer/ShadowCaster.hpp>
 
+#include <algorithm>
 #include <iostream>
 #include <format>
 
@@ -14,6 +15,17 @@ DirectionalShadowCaster::DirectionalShadowCaster(OrthographicProjection projecti
 {
 }
 
+DirectionalShadowCaster::DirectionalShadowCaster(DirectionalLight light,
+												 ShadowCascades cascades,
+												 UpVector up) noexcept
+	: m_light{light}
+	, m_position{glm::vec3(0.0f)}
+	, m_up{up}
+	, m_cascades{cascades}
+{
+	m_cascades->count = std::clamp(cascades.count, 2u, max_shadow_cascades);
+}
+
 glm::mat4 DirectionalShadowCaster::view() const noexcept
 {
 	glm::mat4 view =
@@ -42,6 +54,11 @@ DirectionalLight DirectionalShadowCaster::light() const noexcept
 	return m_light;
 }
 
+std::optional<ShadowCascades> DirectionalShadowCaster::cascades() const noexcept
+{
+	return m_cascades;
+}
+
 
 SpotShadowCaster::SpotShadowCaster(PerspectiveProjection projection,
 								   SpotLight light,
@@ -2,30 +2,45 @@
 
 #include "DescriptorPoolImpl.hpp"
 
+namespace
+{
+
+auto layout_barrier(vk::Image image,
+					vk::ImageAspectFlags aspect,
+					vk::ImageLayout old_layout,
+					vk::ImageLayout new_layout,
+					vk::AccessFlags src_access,
+					vk::AccessFlags dst_access)
+	-> vk::ImageMemoryBarrier
+{
+	return vk::ImageMemoryBarrier{}
+		.setOldLayout(old_layout)
+		.setNewLayout(new_layout)
+		.setSrcAccessMask(src_access)
+		.setDstAccessMask(dst_access)
+		.setSrcQueueFamilyIndex(vk::QueueFamilyIgnored)
+		.setDstQueueFamilyIndex(vk::QueueFamilyIgnored)
+		.setImage(image)
+		.setSubresourceRange(image_subresource_range(aspect));
+}
+
+}
+
 ShadowPassTexture::ShadowPassTexture(Render::Context::Impl* context,
 									 DescriptorPool::Impl* descriptor_pool,
 									 U32Extent extent)
 
 {
+	// NOTE the depths are copied in from the static layer before the casters are drawn
 	texture =
-		Texture2D(std::make_unique<Texture2D::Impl>(RenderTargetTexture,
+		Texture2D(std::make_unique<Texture2D::Impl>(DepthBufferTexture,
 													context,
 													extent,
-													TextureFormat::R32Sfloat));
+													vk::ImageUsageFlagBits::eSampled
+													| vk::ImageUsageFlagBits::eTransferDst));
 
-	auto transition_to_transfer_src = [&] (vk::CommandBuffer& commandbuffer)
-	{
-		transition_image_for_color_override(texture.impl->allocated.image.get(),
-											commandbuffer);
-	};
-	
-	with_buffer_submit(context->device.get(),
-					   context->commandpool.get(),
-					   context->graphics_queue(),
-					   transition_to_transfer_src);
-		
 	const auto subresourceRange = vk::ImageSubresourceRange{}
-		.setAspectMask(vk::ImageAspectFlagBits::eColor)
+		.setAspectMask(vk::ImageAspectFlagBits::eDepth)
 		.setBaseMipLevel(0)
 		.setLevelCount(1)
 		.setBaseArrayLayer(0)
@@ -45,27 +60,31 @@ ShadowPassTexture::ShadowPassTexture(Render::Context::Impl* context,
 		.setComponents(componentMapping);
 	view = context->device.get().createImageViewUnique(imageViewCreateInfo);
 	
-	const auto properties = context->physical_device.getProperties();
-	const auto has_anisotropy = true; // TODO: set this from device
-	const auto max_anisotropy = has_anisotropy
-		? std::min(4.0f, properties.limits.maxSamplerAnisotropy)
-		: 1.0f;
-	
-	vk::Filter const filter = vk::Filter::eLinear;
-	vk::SamplerMipmapMode const mipmap_filter = vk::SamplerMipmapMode::eLinear;
+	/* The sampler compares the depth of the fragment against the 2x2 nearest depths
+	 * and filters the results, which gives pcf for a single tap. Without linear filtering
+	 * of the depth format the comparison falls back to the nearest depth.
+	 * NOTE the depths are not wrapped, which would mix them with the neighbouring tiles,
+	 *      and the shader keeps the taps inside the tile of the caster.
+	 */
+	const vk::FormatProperties depth_properties =
+		context->physical_device.getFormatProperties(texture.impl->format);
+	const bool linear_depth = static_cast<bool>(depth_properties.optimalTilingFeatures
+												& vk::FormatFeatureFlagBits::eSampledImageFilterLinear);
+	vk::Filter const filter = linear_depth ? vk::Filter::eLinear : vk::Filter::eNearest;
+	vk::SamplerMipmapMode const mipmap_filter = vk::SamplerMipmapMode::eNearest;
 
 	const auto sampler_info = vk::SamplerCreateInfo{}
 		.setMagFilter(filter)
 		.setMinFilter(filter)
-		.setAddressModeU(vk::SamplerAddressMode::eRepeat)
-		.setAddressModeV(vk::SamplerAddressMode::eRepeat)
-		.setAddressModeW(vk::SamplerAddressMode::eRepeat)
-		.setAnisotropyEnable(has_anisotropy)
-		.setMaxAnisotropy(max_anisotropy)
-		.setBorderColor(vk::BorderColor::eIntOpaqueBlack)
+		.setAddressModeU(vk::SamplerAddressMode::eClampToEdge)
+		.setAddressModeV(vk::SamplerAddressMode::eClampToEdge)
+		.setAddressModeW(vk::SamplerAddressMode::eClampToEdge)
+		.setAnisotropyEnable(false)
+		.setMaxAnisotropy(1.0f)
+		.setBorderColor(vk::BorderColor::eFloatOpaqueWhite)
 		.setUnnormalizedCoordinates(false)
-		.setCompareEnable(false)
-		.setCompareOp(vk::CompareOp::eAlways)
+		.setCompareEnable(true)
+		.setCompareOp(vk::CompareOp::eLessOrEqual)
 		.setMipmapMode(mipmap_filter)
 		.setMipLodBias(0.0f)
 		.setMinLod(0.0f)
@@ -93,7 +112,7 @@ ShadowPassTexture::ShadowPassTexture(Render::Context::Impl* context,
 		.setSetLayouts(descriptorset_layout.get());
 	
 	auto createdsets =
-		context->device.get().allocateDescriptorSetsUnique(descriptorset_allocate_info);
+		descriptor_pool->allocate(context->device.get(), descriptorset_allocate_info);
 	descriptorset = std::move(createdsets[0]);
 	
 
@@ -122,7 +141,6 @@ ShadowPassTexture::ShadowPassTexture(ShadowPassTexture&& rhs)
 {
 	std::swap(texture, rhs.texture);
 	std::swap(sampler, rhs.sampler);
-	std::swap(state, rhs.state);
 	std::swap(view, rhs.view);
 	std::swap(descriptorset, rhs.descriptorset);
 }
@@ -131,159 +149,68 @@ ShadowPassTexture& ShadowPassTexture::operator=(ShadowPassTexture&& rhs)
 {
 	std::swap(texture, rhs.texture);
 	std::swap(sampler, rhs.sampler);
-	std::swap(state, rhs.state);
 	std::swap(view, rhs.view);
 	std::swap(descriptorset, rhs.descriptorset);
 	return *this;
 }
 
-OrthographicShadowPass::OrthographicShadowPass(Logger& logger,
-											   Render::Context::Impl* context,
-											   Presenter::Impl* presenter,
-											   DescriptorPool::Impl* descriptor_pool,
-											   U32Extent extent,
-											   std::filesystem::path shader_root_path,
-											   const bool debug_print)
-	: GenericShadowPass(logger,
-						context,
-						presenter,
-						descriptor_pool,
-						extent,
-						VertexPath{shader_root_path / "OrthographicDepth.vert.spv"},
-						FragmentPath{shader_root_path / "OrthographicDepth.frag.spv"},
-						debug_print)
-{
-}
-
-void OrthographicShadowPass::record(Logger* logger,
-									vk::Device& device,
-									CurrentFlightFrame current_flightframe,
-									vk::CommandBuffer& commandbuffer,
-									std::optional<CameraUniformData> camera_data,
-									std::vector<MaterialRenderable>& renderables)
-{
-	GenericShadowPass::record(logger,
-							  device,
-							  current_flightframe,
-							  commandbuffer,
-							  camera_data,
-							  renderables);
-}
-
-auto OrthographicShadowPass::get_shadowtexture(CurrentFlightFrame current_flightframe)
-	-> ShadowPassTexture&
-{
-	return GenericShadowPass::get_shadowtexture(current_flightframe);
-}
-
-
-PerspectiveShadowPass::PerspectiveShadowPass(Logger& logger,
-											 Render::Context::Impl* context,
-											 Presenter::Impl* presenter,
-											 DescriptorPool::Impl* descriptor_pool,
-											 U32Extent extent,
-											 std::filesystem::path shader_root_path,
-											 const bool debug_print)
-	: GenericShadowPass(logger,
-						context,
-						presenter,
-						descriptor_pool,
-						extent,
-						VertexPath{shader_root_path / "PerspectiveDepth.vert.spv"},
-						FragmentPath{shader_root_path / "PerspectiveDepth.frag.spv"},
-						debug_print)
-{
-}
-
-void PerspectiveShadowPass::record(Logger* logger,
-								   vk::Device& device,
-								   CurrentFlightFrame current_flightframe,
-								   vk::CommandBuffer& commandbuffer,
-								   std::optional<CameraUniformData> camera_data,
-								   std::vector<MaterialRenderable>& renderables)
-{
-	GenericShadowPass::record(logger,
-							  device,
-							  current_flightframe,
-							  commandbuffer,
-							  camera_data,
-							  renderables);
-}
-
-auto PerspectiveShadowPass::get_shadowtexture(CurrentFlightFrame current_flightframe)
-	-> ShadowPassTexture&
-{
-	return GenericShadowPass::get_shadowtexture(current_flightframe);
-}
-
-
-
-GenericShadowPass& GenericShadowPass::operator=(GenericShadowPass&& rhs)
+ShadowAtlasPass& ShadowAtlasPass::operator=(ShadowAtlasPass&& rhs)
 {
 	std::swap(m_extent, rhs.m_extent);
 	std::swap(m_renderpass, rhs.m_renderpass);
 	std::swap(m_framestextures, rhs.m_framestextures);
+	std::swap(m_static_renderpass, rhs.m_static_renderpass);
+	std::swap(m_static, rhs.m_static);
+	std::swap(m_static_tiles, rhs.m_static_tiles);
 	std::swap(m_pipeline, rhs.m_pipeline);
 	return *this;
 }
 
-GenericShadowPass::GenericShadowPass(GenericShadowPass&& rhs)
+ShadowAtlasPass::ShadowAtlasPass(ShadowAtlasPass&& rhs)
 {
 	std::swap(m_extent, rhs.m_extent);
 	std::swap(m_renderpass, rhs.m_renderpass);
 	std::swap(m_framestextures, rhs.m_framestextures);
+	std::swap(m_static_renderpass, rhs.m_static_renderpass);
+	std::swap(m_static, rhs.m_static);
+	std::swap(m_static_tiles, rhs.m_static_tiles);
 	std::swap(m_pipeline, rhs.m_pipeline);
 }
 
 
-GenericShadowPass::GenericShadowPass(Logger& logger,
-									 Render::Context::Impl* context,
-									 Presenter::Impl* presenter,
-									 DescriptorPool::Impl* descriptor_pool,
-									 U32Extent extent,
-									 VertexPath vertex_path,
-									 FragmentPath fragment_path,
-									 const bool debug_print)
+ShadowAtlasPass::ShadowAtlasPass(Logger& logger,
+								 Render::Context::Impl* context,
+								 Presenter::Impl* presenter,
+								 DescriptorPool::Impl* descriptor_pool,
+								 PipelineCache* pipeline_cache,
+								 U32Extent extent,
+								 std::filesystem::path shader_root_path,
+								 const bool debug_print)
 	: m_extent{extent}
 {
-	auto constexpr color_format = vk::Format::eR32Sfloat;
-	auto constexpr depth_format = vk::Format::eD32Sfloat;
-    auto constexpr colorComponentFlags(vk::ColorComponentFlagBits::eR);
-	const std::string pipeline_name = "ShadowPass";
-	auto const frames_in_flight = MaxFlightFrames{presenter->max_frames_in_flight};
+	const VertexPath vertex_path{shader_root_path / "ShadowDepth.vert.spv"};
 
-    const auto color_attachment = vk::AttachmentDescription{}
-		.setFlags(vk::AttachmentDescriptionFlags())
-		.setFormat(color_format)
-		.setSamples(vk::SampleCountFlagBits::e1)
-		.setLoadOp(vk::AttachmentLoadOp::eClear)
-		.setStoreOp(vk::AttachmentStoreOp::eStore)
-		.setStencilLoadOp(vk::AttachmentLoadOp::eDontCare)
-		.setStencilStoreOp(vk::AttachmentStoreOp::eDontCare)
-		// NOTE these are important, as they determine the layout of the image before and after
-		// the renderpass
-		.setInitialLayout(vk::ImageLayout::eUndefined)
-		.setFinalLayout(vk::ImageLayout::eShaderReadOnlyOptimal);
+	auto constexpr depth_format = vk::Format::eD32Sfloat;
+	const std::string pipeline_name = "ShadowAtlasPass";
 
+	/* Depth only, the depth attachment is the shadow atlas itself.
+	 * NOTE the atlas of the frame starts from the tiles copied out of the static layer.
+	 *      The frame graph transitions it around the renderpass and orders it after
+	 *      the copy and before the geometry pass samples it.
+	 */
     const auto depth_attachment = vk::AttachmentDescription{}
 		.setFlags(vk::AttachmentDescriptionFlags())
 		.setFormat(depth_format)
 		.setSamples(vk::SampleCountFlagBits::e1)
-		.setLoadOp(vk::AttachmentLoadOp::eClear)
-		.setStoreOp(vk::AttachmentStoreOp::eDontCare)
+		.setLoadOp(vk::AttachmentLoadOp::eLoad)
+		.setStoreOp(vk::AttachmentStoreOp::eStore)
 		.setStencilLoadOp(vk::AttachmentLoadOp::eDontCare)
 		.setStencilStoreOp(vk::AttachmentStoreOp::eDontCare)
-		// NOTE these are important, as they determine the layout of the image before and after
-		// the renderpass
-		.setInitialLayout(vk::ImageLayout::eUndefined)
+		.setInitialLayout(vk::ImageLayout::eDepthStencilAttachmentOptimal)
 		.setFinalLayout(vk::ImageLayout::eDepthStencilAttachmentOptimal);
 
-	const auto color_reference = vk::AttachmentReference{}
-		.setAttachment(0)
-		.setLayout(vk::ImageLayout::eColorAttachmentOptimal);
-
 	const auto depth_reference = vk::AttachmentReference{}
-		.setAttachment(1)
+		.setAttachment(0)
 		.setLayout(vk::ImageLayout::eDepthStencilAttachmentOptimal);
 	
     auto subpass = vk::SubpassDescription{}
@@ -291,84 +218,36 @@ GenericShadowPass::GenericShadowPass(Logger& logger,
 		.setPipelineBindPoint(vk::PipelineBindPoint::eGraphics)
 		.setInputAttachments({})
 		.setResolveAttachments({})
-		.setColorAttachments(color_reference)
+		.setColorAttachments({})
 		.setPDepthStencilAttachment(&depth_reference);
-	
-	auto color_depth_dependency = vk::SubpassDependency{}
-		.setSrcSubpass(vk::SubpassExternal)
-		.setDstSubpass(0)
-		.setSrcStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput
-						 | vk::PipelineStageFlagBits::eEarlyFragmentTests)
-		.setSrcAccessMask(vk::AccessFlags())
-		.setDstStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput
-						 | vk::PipelineStageFlagBits::eEarlyFragmentTests)
-		.setDstAccessMask(vk::AccessFlagBits::eColorAttachmentWrite
-						  | vk::AccessFlagBits::eDepthStencilAttachmentWrite);
-
-	
-	std::array<vk::AttachmentDescription, 2> attachments {
-		color_attachment,
-		depth_attachment
-	};
-	std::array<vk::SubpassDependency, 1> dependencies {
-		color_depth_dependency
-	};
+
     auto renderPassCreateInfo = vk::RenderPassCreateInfo{}
 		.setFlags(vk::RenderPassCreateFlags())
-		.setAttachments(attachments)
-		.setDependencies(dependencies)
+		.setAttachments(depth_attachment)
 		.setSubpasses(subpass);
 
 	m_renderpass = context->device.get().createRenderPassUnique(renderPassCreateInfo);
 	context->logger.info(std::source_location::current(),
 						 "Created Shadowmap Render Pass!");
 
-	for (FrameTextures& textures: m_framestextures) {
-		/* Setup the rendertarget and its view for the render pass
-		 */
-		textures.colorbuffer = ShadowPassTexture(context, descriptor_pool, m_extent);
-
-		//textures.colorbuffer = Texture2D(std::make_unique<Texture2D::Impl>(RenderTargetTexture,
-		//context,
-		//m_extent,
-		//vkformat_to_textureformat(color_format)));
-		//
-		//auto transition_to_transfer_src = [&] (vk::CommandBuffer& commandbuffer)
-		//{
-		//textures.colorbuffer.impl->layout =
-		//transition_image_for_color_override(textures.colorbuffer.impl->allocated.image.get(),
-		//commandbuffer);
-	//};
-		//
-		//with_buffer_submit(context->device.get(),
-		//context->commandpool.get(),
-		//context->graphics_queue(),
-		//transition_to_transfer_src);
-		
-		textures.colorbuffer_view
-			= textures.colorbuffer.texture.impl->create_view(context,
-															 vk::ImageAspectFlagBits::eColor);
+	/* The static layer is loaded and kept by its renderpass, in between frames it is
+	 * left ready to be copied from. Its attachment matches the atlas, so both renderpasses
+	 * are compatible and the same pipeline draws into either of them.
+	 */
+	m_static_renderpass = context->device.get().createRenderPassUnique(renderPassCreateInfo);
+	context->logger.info(std::source_location::current(),
+						 "Created static Shadowmap Render Pass!");
 
-		/* Setup the depthbuffer and its view for the render pass
-		 */
-		textures.depthbuffer = Texture2D(std::make_unique<Texture2D::Impl>(DepthBufferTexture,
-																		   context,
-																		   m_extent));
-		/* Setup the depthbuffer view
+	for (FrameTextures& textures: m_framestextures) {
+		/* Setup the shadow atlas, it is both the depth attachment and the sampled texture
 		 */
-		textures.depthbuffer_view =
-			textures.depthbuffer.impl->create_view(context,
-												   vk::ImageAspectFlagBits::eDepth);
+		textures.depthbuffer = ShadowPassTexture(context, descriptor_pool, m_extent);
 		
 		/* Setup the FrameBuffer
 		 */
-		std::array<vk::ImageView, 2> attachments{
-			textures.colorbuffer_view.get(),
-			textures.depthbuffer_view.get(),
-		};
 		auto framebufferCreateInfo = vk::FramebufferCreateInfo{}
 			.setFlags(vk::FramebufferCreateFlags())
-			.setAttachments(attachments)
+			.setAttachments(textures.depthbuffer.view.get())
 			.setWidth(m_extent.width())
 			.setHeight(m_extent.height())
 			.setRenderPass(m_renderpass.get())
@@ -380,16 +259,55 @@ GenericShadowPass::GenericShadowPass(Logger& logger,
 
 	context->logger.info(std::source_location::current(),
 						 "Created Shadowpass FramePasses!");
+
+	/* Setup the static layer, every frame imports it into the frame graph in the layout
+	 * it is copied from, so it starts out in that layout.
+	 */
+	m_static.depthbuffer = Texture2D(std::make_unique<Texture2D::Impl>(DepthBufferTexture,
+																	   context,
+																	   m_extent,
+																	   vk::ImageUsageFlagBits::eTransferSrc));
+	m_static.depthbuffer_view =
+		m_static.depthbuffer.impl->create_view(context, vk::ImageAspectFlagBits::eDepth);
+
+	auto static_framebuffer_info = vk::FramebufferCreateInfo{}
+		.setFlags(vk::FramebufferCreateFlags())
+		.setAttachments(m_static.depthbuffer_view.get())
+		.setWidth(m_extent.width())
+		.setHeight(m_extent.height())
+		.setRenderPass(m_static_renderpass.get())
+		.setLayers(1);
+	m_static.framebuffer =
+		context->device.get().createFramebufferUnique(static_framebuffer_info);
+
+	vk::Image static_depth = m_static.depthbuffer.impl->image();
+	context->upload_queue->record([=] (vk::CommandBuffer& commandbuffer) {
+		const vk::ImageMemoryBarrier barrier =
+			layout_barrier(static_depth,
+						   vk::ImageAspectFlagBits::eDepth,
+						   vk::ImageLayout::eUndefined,
+						   vk::ImageLayout::eTransferSrcOptimal,
+						   vk::AccessFlags(),
+						   vk::AccessFlagBits::eTransferRead);
+		commandbuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe,
+									  vk::PipelineStageFlagBits::eTransfer,
+									  vk::DependencyFlags(),
+									  nullptr,
+									  nullptr,
+									  barrier);
+	});
+
+	context->logger.info(std::source_location::current(),
+						 "Created Shadowpass static layer!");
 	
-	auto shaderstage_infos = create_shaderstage_infos(context->device.get(),
-													  vertex_path,
-													  fragment_path);
+	// NOTE only the depth is written, so there is no fragment shader
+	auto shaderstage_info = create_vertex_shaderstage_info(context->device.get(),
+														   vertex_path);
 
-	if (!shaderstage_infos) {
-		std::string const msg = std::format("{} could not load vertex/fragment sources {} / {}",
+	if (!shaderstage_info) {
+		std::string const msg = std::format("{} could not load vertex source {}",
 											pipeline_name,
-											vertex_path.get().string(),
-											fragment_path.get().string());
+											vertex_path.get().string());
 		logger.fatal(std::source_location::current(), msg);
 		throw std::runtime_error(msg);
 	}
@@ -403,8 +321,8 @@ GenericShadowPass::GenericShadowPass(Logger& logger,
 		.setFlags(vk::PipelineDynamicStateCreateFlags())
 		.setDynamicStates(dynamic_states);
 	
-	const auto bindingDescriptions = binding_descriptions(VertexPosNormColorUV{});
-	const auto attributeDescriptions = attribute_descriptions(VertexPosNormColorUV{});
+	const auto bindingDescriptions = instanced_binding_descriptions(VertexPosNormColorUV{});
+	const auto attributeDescriptions = instanced_attribute_descriptions(VertexPosNormColorUV{});
 	
 	auto pipelineVertexInputStateCreateInfo = vk::PipelineVertexInputStateCreateInfo{}
 		.setFlags(vk::PipelineVertexInputStateCreateFlags())
@@ -454,40 +372,19 @@ GenericShadowPass::GenericShadowPass(Logger& logger,
 		.setSampleShadingEnable(false)
 		.setRasterizationSamples(vk::SampleCountFlagBits::e1);
 
-	auto pipelineColorBlendAttachmentState = vk::PipelineColorBlendAttachmentState{}
-		.setBlendEnable(false)
-		.setSrcColorBlendFactor(vk::BlendFactor::eOne)
-		.setDstColorBlendFactor(vk::BlendFactor::eZero)
-		.setColorBlendOp(vk::BlendOp::eAdd)
-		.setSrcAlphaBlendFactor(vk::BlendFactor::eOne)
-		.setDstAlphaBlendFactor(vk::BlendFactor::eZero)
-		.setAlphaBlendOp(vk::BlendOp::eAdd)
-		.setColorWriteMask(colorComponentFlags);
-	
+	// NOTE there are no color attachments to blend into
 	auto pipelineColorBlendStateCreateInfo = vk::PipelineColorBlendStateCreateInfo{}
 		.setFlags(vk::PipelineColorBlendStateCreateFlags())
 		.setLogicOpEnable(false)
 		.setLogicOp(vk::LogicOp::eNoOp)
-		.setAttachments(pipelineColorBlendAttachmentState)
+		.setAttachments({})
 		.setBlendConstants({ 1.0f, 1.0f, 1.0f, 1.0f });
 
-	const auto push_constant_range = vk::PushConstantRange{}
-		.setOffset(0)
-		.setSize(sizeof(RenderPipeline::PushConstants))
-		.setStageFlags(vk::ShaderStageFlagBits::eVertex);
-	
-	if (sizeof(RenderPipeline::PushConstants) > 128) {
-		logger.warn(std::source_location::current(), 
-					std::format("PushConstant size={} is larger than minimum supported (128)"
-								"This can cause compatability issues on some devices",
-								sizeof(RenderPipeline::PushConstants)));
-	}
-
 	const auto layout_binding = vk::DescriptorSetLayoutBinding{}
 		.setStageFlags(vk::ShaderStageFlagBits::eVertex)
 		.setBinding(0)
 		.setDescriptorCount(1)
-		.setDescriptorType(vk::DescriptorType::eUniformBuffer);
+		.setDescriptorType(vk::DescriptorType::eUniformBufferDynamic);
 	
 	const auto set_info = vk::DescriptorSetLayoutCreateInfo{}
 		.setFlags(vk::DescriptorSetLayoutCreateFlags())
@@ -499,8 +396,7 @@ GenericShadowPass::GenericShadowPass(Logger& logger,
 	
     auto pipelineLayoutCreateInfo = vk::PipelineLayoutCreateInfo{}
 		.setFlags(vk::PipelineLayoutCreateFlags())
-		.setSetLayouts(m_pipeline.descriptor_layout.get())
-		.setPushConstantRanges(push_constant_range);
+		.setSetLayouts(m_pipeline.descriptor_layout.get());
 
 	m_pipeline.layout = 
 		context->device.get().createPipelineLayoutUnique(pipelineLayoutCreateInfo);
@@ -518,7 +414,7 @@ GenericShadowPass::GenericShadowPass(Logger& logger,
 	
 	auto graphicsPipelineCreateInfo = vk::GraphicsPipelineCreateInfo{}
 		.setFlags(vk::PipelineCreateFlags())
-		.setStages(shaderstage_infos.value().create_info)
+		.setStages(shaderstage_info.value().create_info)
 		.setPVertexInputState(&pipelineVertexInputStateCreateInfo)
 		.setPInputAssemblyState(&pipelineInputAssemblyStateCreateInfo)
 		.setPTessellationState(nullptr)
@@ -532,8 +428,8 @@ GenericShadowPass::GenericShadowPass(Logger& logger,
 		.setRenderPass(m_renderpass.get());
 
 	vk::ResultValue<vk::UniquePipeline> result =
-		context->device.get().createGraphicsPipelineUnique(nullptr,
-											graphicsPipelineCreateInfo);
+		pipeline_cache->create_graphics_pipeline(pipeline_name,
+												 graphicsPipelineCreateInfo);
 	
     switch (result.result) {
 	case vk::Result::eSuccess:
@@ -552,7 +448,7 @@ GenericShadowPass::GenericShadowPass(Logger& logger,
 	
 	std::array<vk::DescriptorPoolSize, 1> sizes {
 		vk::DescriptorPoolSize{}
-		.setType(vk::DescriptorType::eUniformBuffer)
+		.setType(vk::DescriptorType::eUniformBufferDynamic)
 		.setDescriptorCount(10),
 	};
 	
@@ -565,131 +461,215 @@ GenericShadowPass::GenericShadowPass(Logger& logger,
 	logger.info(std::source_location::current(),
 				"Created Descriptor Pool");
 
-	for (uint32_t i = 0; i < frames_in_flight.get(); i++) {
-		m_pipeline.descriptor_memories
-			.push_back(allocate_memory(context->physical_device,
-									   context->device.get(),
-									   sizeof(CameraUniformData),
-									   vk::BufferUsageFlagBits::eTransferSrc
-									   | vk::BufferUsageFlagBits::eUniformBuffer,
-									   // Host Visible and Coherent allows direct
-									   // writes into the buffers without sync issues.
-									   vk::MemoryPropertyFlagBits::eHostVisible
-									   | vk::MemoryPropertyFlagBits::eHostCoherent));
-
-		const auto allocate_info = vk::DescriptorSetAllocateInfo{}
-			.setDescriptorPool(m_pipeline.descriptor_pool.get())
-			.setDescriptorSetCount(1)
-			.setSetLayouts(m_pipeline.descriptor_layout.get());
-		
-		auto sets = context->device.get().allocateDescriptorSetsUnique(allocate_info);
-		if (sets.size() != 1) {
-			logger.error(std::source_location::current(),
-						 "This system only allows handling 1 set per frame in flight"
-						 "\n if you want more sets find another way to store them..");
-		}
-		
-		m_pipeline.descriptor_sets.push_back(std::move(sets[0]));
+	m_pipeline.uniforms = presenter->uniform_ring.get();
+	m_pipeline.instances = presenter->instance_ring.get();
 
-		const auto buffer_info = vk::DescriptorBufferInfo{}
-			.setBuffer(m_pipeline.descriptor_memories[i].buffer.get())
-			.setOffset(0)
-			.setRange(sizeof(CameraUniformData));
-		
-		const auto write_descriptor = vk::WriteDescriptorSet{}
-			.setDstBinding(0)
-			.setDstSet(m_pipeline.descriptor_sets[i].get())
-			.setDstArrayElement(0)
-			.setDescriptorCount(1)
-			.setDescriptorType(vk::DescriptorType::eUniformBuffer)
-			// here images can be set aswell
-			.setBufferInfo(buffer_info);
-		
-		const uint32_t write_count = 1;
-		const uint32_t copy_count = 0;
-		context->device.get().updateDescriptorSets(write_count,
-												   &write_descriptor,
-												   copy_count,
-												   nullptr);
-	}
+	const auto allocate_info = vk::DescriptorSetAllocateInfo{}
+		.setDescriptorPool(m_pipeline.descriptor_pool.get())
+		.setDescriptorSetCount(1)
+		.setSetLayouts(m_pipeline.descriptor_layout.get());
+	
+	auto sets = context->device.get().allocateDescriptorSetsUnique(allocate_info);
+	m_pipeline.descriptor_set = std::move(sets[0]);
+
+	const auto buffer_info = m_pipeline.uniforms->descriptor_info<CameraUniformData>();
+	
+	const auto write_descriptor = vk::WriteDescriptorSet{}
+		.setDstBinding(0)
+		.setDstSet(m_pipeline.descriptor_set.get())
+		.setDstArrayElement(0)
+		.setDescriptorCount(1)
+		.setDescriptorType(vk::DescriptorType::eUniformBufferDynamic)
+		.setBufferInfo(buffer_info);
+	
+	const uint32_t write_count = 1;
+	const uint32_t copy_count = 0;
+	context->device.get().updateDescriptorSets(write_count,
+											   &write_descriptor,
+											   copy_count,
+											   nullptr);
 
 	logger.info(std::source_location::current(),
-				std::format("Allocated {} descriptor sets for {} frames in flight",
-							 m_pipeline.descriptor_sets.size(),
-							 frames_in_flight.get()));
+				"Allocated shadowpass camera descriptor set");
 
 	logger.info(std::source_location::current(),
 				"Created Shadowpass RenderPipeline!");
 }
 
-void GenericShadowPass::record(Logger* logger,
-							   vk::Device& device,
-							   CurrentFlightFrame current_flightframe,
-							   vk::CommandBuffer& commandbuffer,
-							   std::optional<CameraUniformData> camera_data,
-							   std::vector<MaterialRenderable>& renderables)
+void ShadowAtlasPass::begin_renderpass(vk::CommandBuffer& commandbuffer,
+										 CurrentFlightFrame current_flightframe,
+										 vk::SubpassContents contents)
 {
  	const auto render_area = vk::Rect2D{}
 		.setOffset(vk::Offset2D{}.setX(0.0f).setY(0.0f))
 		.setExtent(vk::Extent2D{m_extent.width(), m_extent.height()});
 
-	std::array<vk::ClearValue, 2> clearvalues{
-		vk::ClearValue{}.setColor({1.0f, 1.0f, 1.0f, 1.0f}),
-		vk::ClearValue{}.setDepthStencil({1.0f, 0}),
-	};
-	
+	// NOTE nothing is cleared, the renderpass loads the copied static tiles
 	const auto renderPassInfo = vk::RenderPassBeginInfo{}
 		.setRenderPass(m_renderpass.get())
 		.setFramebuffer(m_framestextures[current_flightframe.get()].framebuffer.get())
-		.setRenderArea(render_area)
-		.setClearValues(clearvalues);
+		.setRenderArea(render_area);
 	
-	commandbuffer.beginRenderPass(renderPassInfo, vk::SubpassContents::eInline);
+	commandbuffer.beginRenderPass(renderPassInfo, contents);
+}
+
+auto ShadowAtlasPass::inheritance_info(CurrentFlightFrame current_flightframe) const
+	-> vk::CommandBufferInheritanceInfo
+{
+	return vk::CommandBufferInheritanceInfo{}
+		.setRenderPass(m_renderpass.get())
+		.setSubpass(0)
+		.setFramebuffer(m_framestextures[current_flightframe.get()].framebuffer.get());
+}
+
+void ShadowAtlasPass::begin_static_renderpass(vk::CommandBuffer& commandbuffer,
+											  vk::SubpassContents contents)
+{
+ 	const auto render_area = vk::Rect2D{}
+		.setOffset(vk::Offset2D{}.setX(0.0f).setY(0.0f))
+		.setExtent(vk::Extent2D{m_extent.width(), m_extent.height()});
+
+	const auto renderPassInfo = vk::RenderPassBeginInfo{}
+		.setRenderPass(m_static_renderpass.get())
+		.setFramebuffer(m_static.framebuffer.get())
+		.setRenderArea(render_area);
 	
+	commandbuffer.beginRenderPass(renderPassInfo, contents);
+}
+
+auto ShadowAtlasPass::static_inheritance_info() const
+	-> vk::CommandBufferInheritanceInfo
+{
+	return vk::CommandBufferInheritanceInfo{}
+		.setRenderPass(m_static_renderpass.get())
+		.setSubpass(0)
+		.setFramebuffer(m_static.framebuffer.get());
+}
+
+void ShadowAtlasPass::clear_tile(vk::CommandBuffer& commandbuffer,
+								 ShadowAtlasRect rect)
+{
+	const auto attachment = vk::ClearAttachment{}
+		.setAspectMask(vk::ImageAspectFlagBits::eDepth)
+		.setClearValue(vk::ClearValue{}.setDepthStencil({1.0f, 0}));
+
+	const auto clear_rect = vk::ClearRect{}
+		.setRect(vk::Rect2D{}
+				 .setOffset(vk::Offset2D{}
+							.setX(static_cast<int32_t>(rect.x))
+							.setY(static_cast<int32_t>(rect.y)))
+				 .setExtent(vk::Extent2D{rect.size, rect.size}))
+		.setBaseArrayLayer(0)
+		.setLayerCount(1);
+
+	commandbuffer.clearAttachments(attachment, clear_rect);
+}
+
+void ShadowAtlasPass::copy_static_tiles(vk::CommandBuffer& commandbuffer,
+										CurrentFlightFrame current_flightframe,
+										std::vector<ShadowAtlasRect> const& rects)
+{
+	vk::Image depth = m_framestextures[current_flightframe.get()].depthbuffer.texture.impl->image();
 
-	// if there is no shadow camera we end the renderpass immediately
-	// we still need to begin/end it so that the implicit shadow texture
-	// commands are applied.
-	// commands are applied.
-	if (!camera_data.has_value()) {
-		commandbuffer.endRenderPass();
+	if (rects.empty())
 		return;
+
+	const auto layers = vk::ImageSubresourceLayers{}
+		.setAspectMask(vk::ImageAspectFlagBits::eDepth)
+		.setMipLevel(0)
+		.setBaseArrayLayer(0)
+		.setLayerCount(1);
+
+	std::vector<vk::ImageCopy> regions{};
+	regions.reserve(rects.size());
+	for (ShadowAtlasRect const& rect: rects) {
+		const auto offset = vk::Offset3D{}
+			.setX(static_cast<int32_t>(rect.x))
+			.setY(static_cast<int32_t>(rect.y))
+			.setZ(0);
+		regions.push_back(vk::ImageCopy{}
+						  .setSrcSubresource(layers)
+						  .setSrcOffset(offset)
+						  .setDstSubresource(layers)
+						  .setDstOffset(offset)
+						  .setExtent(vk::Extent3D{rect.size, rect.size, 1}));
 	}
-	
+
+	commandbuffer.copyImage(m_static.depthbuffer.impl->image(),
+							vk::ImageLayout::eTransferSrcOptimal,
+							depth,
+							vk::ImageLayout::eTransferDstOptimal,
+							regions);
+}
+
+auto ShadowAtlasPass::refresh_static_tile(size_t tile, StaticTileKey const& key)
+	-> bool
+{
+	if (tile >= m_static_tiles.size())
+		m_static_tiles.resize(tile + 1);
+
+	std::optional<StaticTileKey>& drawn = m_static_tiles[tile];
+	const bool unchanged = drawn.has_value()
+		&& drawn->rect == key.rect
+		&& drawn->view == key.view
+		&& drawn->proj == key.proj
+		&& drawn->static_version == key.static_version;
+	drawn = key;
+	return !unchanged;
+}
+
+void ShadowAtlasPass::forget_static_tile(size_t tile)
+{
+	if (tile < m_static_tiles.size())
+		m_static_tiles[tile] = std::nullopt;
+}
+
+void ShadowAtlasPass::resize_static_tiles(size_t count)
+{
+	m_static_tiles.resize(count);
+}
+
+void ShadowAtlasPass::record(Logger* logger,
+							 vk::Device& device,
+							 CurrentFlightFrame current_flightframe,
+							 vk::CommandBuffer& commandbuffer,
+							 ShadowAtlasRect rect,
+							 CameraUniformData const& camera_data,
+							 std::vector<MaterialRenderable> const& renderables,
+							 GpuCullPass* gpu_cull)
+{
 	std::array<vk::Viewport, 1> const viewports{
 		vk::Viewport{}
-		.setX(0.0f)
-		.setY(0.0f)
-		.setWidth(m_extent.width())
-		.setHeight(m_extent.height())
+		.setX(static_cast<float>(rect.x))
+		.setY(static_cast<float>(rect.y))
+		.setWidth(static_cast<float>(rect.size))
+		.setHeight(static_cast<float>(rect.size))
 		.setMinDepth(0.0f)
 		.setMaxDepth(1.0f)
 	};
 	uint32_t const viewport_start = 0;
 	commandbuffer.setViewport(viewport_start, viewports);
 	
+	// NOTE the scissor keeps the draws of a caster inside its own tile
 	std::array<vk::Rect2D, 1> const scissors{
 		vk::Rect2D{}
-		.setOffset(vk::Offset2D{}.setX(0.0f).setY(0.0f))
-		.setExtent(vk::Extent2D{m_extent.width(), m_extent.height()}),
+		.setOffset(vk::Offset2D{}
+				   .setX(static_cast<int32_t>(rect.x))
+				   .setY(static_cast<int32_t>(rect.y)))
+		.setExtent(vk::Extent2D{rect.size, rect.size}),
 	};
 	const uint32_t scissor_start = 0;
 	commandbuffer.setScissor(scissor_start, scissors);
 	
-	
 	commandbuffer.bindPipeline(vk::PipelineBindPoint::eGraphics,
 							   m_pipeline.pipeline.get());
 	
-	CameraUniformData camera_uniform_data = camera_data.value();
-	copy_to_allocated_memory(device,
-							 m_pipeline.descriptor_memories[current_flightframe.get()],
-							 reinterpret_cast<void*>(&camera_uniform_data),
-							 sizeof(camera_uniform_data));
+	const uint32_t camera_offset = m_pipeline.uniforms->push(camera_data);
 	const uint32_t first_set = 0;
 	const uint32_t descriptor_set_count = 1;
-	auto descriptor_sets = &(m_pipeline.descriptor_sets[current_flightframe.get()].get());
-	const uint32_t dynamic_offset_count = 0;
-	const uint32_t* dynamic_offsets = nullptr;
+	auto descriptor_sets = &(m_pipeline.descriptor_set.get());
+	const uint32_t dynamic_offset_count = 1;
+	const uint32_t* dynamic_offsets = &camera_offset;
 	commandbuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
 									 m_pipeline.layout.get(),
 									 first_set,
@@ -698,46 +678,49 @@ void GenericShadowPass::record(Logger* logger,
 									 dynamic_offset_count,
 									 dynamic_offsets);
 	
+	// NOTE with gpu culling the renderables are the casters the cull pass was prepared with
+	if (gpu_cull != nullptr) {
+		record_depth_draws(commandbuffer, *m_pipeline.instances, renderables, gpu_cull);
+		return;
+	}
 	
-	for (auto renderable: renderables) {
-		if (!renderable.has_shadow) 
-			continue;
-		
-		RenderPipeline::PushConstants push{};
-		push.model = renderable.model;
-		const uint32_t push_offset = 0;
-		commandbuffer.pushConstants(m_pipeline.layout.get(),
-									vk::ShaderStageFlagBits::eVertex,
-									push_offset,
-									sizeof(push),
-									&push);
-		
-		const uint32_t firstBinding = 0;
-		const uint32_t bindingCount = 1;
-		std::array<vk::DeviceSize, bindingCount> offsets = {0};
-		std::array<vk::Buffer, bindingCount> buffers {
-			renderable.mesh->vertexbuffer.impl->buffer.get(),
-		};
-		commandbuffer.bindVertexBuffers(firstBinding,
-										bindingCount,
-										buffers.data(),
-										offsets.data());
-		
-		
-		const uint32_t instanceCount = 1;
-		const uint32_t firstVertex = 0;
-		const uint32_t firstInstance = 0;
-		commandbuffer.draw(renderable.mesh->vertexbuffer.impl->length,
-						   instanceCount,
-						   firstVertex,
-						   firstInstance);
+	std::vector<MaterialRenderable> casters{};
+	casters.reserve(renderables.size());
+	for (MaterialRenderable const& renderable: renderables) {
+		if (renderable.has_shadow) 
+			casters.push_back(renderable);
 	}
-
-	commandbuffer.endRenderPass();
+	record_depth_draws(commandbuffer, *m_pipeline.instances, casters, nullptr);
 }
 
-auto GenericShadowPass::get_shadowtexture(CurrentFlightFrame current_flightframe)
+auto ShadowAtlasPass::get_shadowtexture(CurrentFlightFrame current_flightframe)
 	-> ShadowPassTexture&
 {
-	return m_framestextures[current_flightframe.get()].colorbuffer;
+	return m_framestextures[current_flightframe.get()].depthbuffer;
+}
+
+auto ShadowAtlasPass::import_atlas(RenderGraph& graph, CurrentFlightFrame current_flightframe)
+	-> RenderGraphImage
+{
+	return graph.import_image(RenderGraphImport{
+			"ShadowAtlas",
+			m_framestextures[current_flightframe.get()].depthbuffer.texture.impl->image(),
+			vk::ImageAspectFlagBits::eDepth});
+}
+
+auto ShadowAtlasPass::import_static_layer(RenderGraph& graph)
+	-> RenderGraphImage
+{
+	return graph.import_image(RenderGraphImport{"ShadowAtlas static layer",
+												m_static.depthbuffer.impl->image(),
+												vk::ImageAspectFlagBits::eDepth,
+												RenderGraphAccess::TransferSrc,
+												{},
+												RenderGraphAccess::TransferSrc});
+}
+
+auto ShadowAtlasPass::extent() const noexcept
+	-> U32Extent
+{
+	return m_extent;
 }
@@ -5,6 +5,7 @@
 #include "FlightFrames.hpp"
 #include "VertexImpl.hpp"
 #include "VertexBufferImpl.hpp"
+#include "IndexBufferImpl.hpp"
 #include "Mesh.hpp"
 #include "Texture.hpp"
 #include "ShaderTexture.hpp"
@@ -14,9 +15,16 @@
 #include "TextureImpl.hpp"
 #include "ShaderTextureImpl.hpp"
 #include "PipelineUtils.hpp"
-
-enum class ShadowPassTextureState { Readable, Writeable };
-
+#include "PipelineCache.hpp"
+#include "InstanceBatch.hpp"
+#include "GpuCulling.hpp"
+#include "ShadowAtlas.hpp"
+#include "RenderGraph.hpp"
+
+/**
+ * The depths of a shadow atlas, rendered into as a depth attachment and sampled
+ * with a depth compare sampler.
+ */
 class ShadowPassTexture
 {
 public:
@@ -38,31 +46,35 @@ public:
 	vk::UniqueImageView view;
 	vk::UniqueDescriptorSet descriptorset;
 	vk::UniqueDescriptorSetLayout descriptorset_layout;
-	ShadowPassTextureState state = ShadowPassTextureState::Writeable;
-
-
-	static const vk::ImageLayout readable_layout = vk::ImageLayout::eShaderReadOnlyOptimal;
-	static const vk::ImageLayout writeable_layout = vk::ImageLayout::eTransferDstOptimal;
 };
 
 
-class GenericShadowPass
+/**
+ * Renders every shadow caster into its tile of a shared atlas, a single renderpass
+ * per frame draws all of them, each with its own viewport.
+ *
+ * The static casters are drawn into a static layer kept between frames, a tile of it
+ * is only drawn again when its rect, camera or static casters changed. Every frame the
+ * tiles of the static layer are copied into the atlas, and only the dynamic casters
+ * are drawn over them.
+ */
+class ShadowAtlasPass
 {
 public:
-	~GenericShadowPass() = default;
+	~ShadowAtlasPass() = default;
 
-	GenericShadowPass() = default;
-	GenericShadowPass(GenericShadowPass&& rhs);
-	GenericShadowPass(Logger& logger,
-					  Render::Context::Impl* context,
-					  Presenter::Impl* presenter,
-					  DescriptorPool::Impl* descriptor_pool,
-					  U32Extent extent,
-					  VertexPath vertex_path,
-					  FragmentPath fragment_path,
-					  const bool debug_print);
+	ShadowAtlasPass() = default;
+	ShadowAtlasPass(ShadowAtlasPass&& rhs);
+	ShadowAtlasPass(Logger& logger,
+					Render::Context::Impl* context,
+					Presenter::Impl* presenter,
+					DescriptorPool::Impl* descriptor_pool,
+					PipelineCache* pipeline_cache,
+					U32Extent extent,
+					std::filesystem::path shader_root_path,
+					const bool debug_print);
 
-	GenericShadowPass& operator=(GenericShadowPass&& rhs);
+	ShadowAtlasPass& operator=(ShadowAtlasPass&& rhs);
 
 	struct CameraUniformData
 	{
@@ -70,30 +82,127 @@ public:
 		glm::mat4 proj;
 	};
 	
+	/**
+	 * Begin the shadow renderpass of the flight frame, only when a dynamic caster is drawn.
+	 * It loads and keeps the atlas, the frame graph places it in the depth attachment layout.
+	 */
+	void begin_renderpass(vk::CommandBuffer& commandbuffer,
+						  CurrentFlightFrame current_flightframe,
+						  vk::SubpassContents contents);
+
+	[[nodiscard]]
+	auto inheritance_info(CurrentFlightFrame current_flightframe) const
+		-> vk::CommandBufferInheritanceInfo;
+
+	/**
+	 * Begin the renderpass of the static layer, only when a static tile is drawn again.
+	 * It loads and keeps the static layer, so every tile drawn into it is cleared first.
+	 */
+	void begin_static_renderpass(vk::CommandBuffer& commandbuffer,
+								 vk::SubpassContents contents);
+
+	[[nodiscard]]
+	auto static_inheritance_info() const
+		-> vk::CommandBufferInheritanceInfo;
+
+	/**
+	 * Clear rect of the attachments of the begun renderpass.
+	 */
+	void clear_tile(vk::CommandBuffer& commandbuffer,
+					ShadowAtlasRect rect);
+
+	/**
+	 * Copy rects of the static layer into the atlas of the flight frame, recorded
+	 * outside of any renderpass with the static layer as transfer source and the
+	 * atlas as transfer destination.
+	 */
+	void copy_static_tiles(vk::CommandBuffer& commandbuffer,
+						   CurrentFlightFrame current_flightframe,
+						   std::vector<ShadowAtlasRect> const& rects);
+
+	/**
+	 * What a tile of the static layer was drawn with.
+	 */
+	struct StaticTileKey
+	{
+		ShadowAtlasRect rect;
+		glm::mat4 view;
+		glm::mat4 proj;
+		uint64_t static_version;
+	};
+
+	/**
+	 * True when the static layer of tile was not drawn with key and has to be drawn again,
+	 * from then on the tile is expected to be drawn with key.
+	 */
+	[[nodiscard]]
+	auto refresh_static_tile(size_t tile, StaticTileKey const& key)
+		-> bool;
+
+	/**
+	 * Forget the static layer of tile, as other tiles may be drawn over it
+	 * while it has no rect. Tiles from count on are forgotten by resize_static_tiles.
+	 */
+	void forget_static_tile(size_t tile);
+	void resize_static_tiles(size_t count);
+
+	/**
+	 * Record the draws of one caster into its rect of the atlas,
+	 * inside the renderpass begun by begin_renderpass.
+	 */
 	void record(Logger* logger,
 				vk::Device& device,
 				CurrentFlightFrame current_flightframe,
 				vk::CommandBuffer& commandbuffer,
-				std::optional<CameraUniformData> camera_data,
-				std::vector<MaterialRenderable>& renderables);
+				ShadowAtlasRect rect,
+				CameraUniformData const& camera_data,
+				std::vector<MaterialRenderable> const& renderables,
+				GpuCullPass* gpu_cull = nullptr);
 	
 	auto get_shadowtexture(CurrentFlightFrame current_flightframe)
 		-> ShadowPassTexture&;
 
+	/**
+	 * Import the atlas of the flight frame into the frame graph, its contents are
+	 * not kept between frames.
+	 */
+	[[nodiscard]]
+	auto import_atlas(RenderGraph& graph, CurrentFlightFrame current_flightframe)
+		-> RenderGraphImage;
+
+	/**
+	 * Import the static layer into the frame graph, it is an output of every frame
+	 * and is kept ready to be copied from in between them.
+	 */
+	[[nodiscard]]
+	auto import_static_layer(RenderGraph& graph)
+		-> RenderGraphImage;
+
+	[[nodiscard]]
+	auto extent() const noexcept
+		-> U32Extent;
+
 private:
 	U32Extent m_extent;
 	vk::UniqueRenderPass m_renderpass;
 
+	// NOTE depth only, the depth attachment is sampled as the shadow atlas
 	struct FrameTextures {
-		//Texture2D colorbuffer;
-		ShadowPassTexture colorbuffer;
-		vk::UniqueImageView colorbuffer_view;
-		Texture2D depthbuffer;
-		vk::UniqueImageView depthbuffer_view;
+		ShadowPassTexture depthbuffer;
 		vk::UniqueFramebuffer framebuffer;
 	};
 
 	FlightFramesArray<FrameTextures> m_framestextures;
+
+	// NOTE a single static layer, its tiles are only written by the frame that redraws them
+	vk::UniqueRenderPass m_static_renderpass;
+	struct StaticTextures {
+		Texture2D depthbuffer;
+		vk::UniqueImageView depthbuffer_view;
+		vk::UniqueFramebuffer framebuffer;
+	};
+	StaticTextures m_static;
+	std::vector<std::optional<StaticTileKey>> m_static_tiles;
 	
 	struct RenderPipeline 
 	{
@@ -103,71 +212,13 @@ private:
 		vk::UniqueDescriptorSetLayout descriptor_layout;
 		vk::UniqueDescriptorPool descriptor_pool;
 		
-		struct PushConstants
-		{
-			glm::mat4 model;
-		};
-		
-		std::vector<AllocatedMemory> descriptor_memories;
-		std::vector<vk::UniqueDescriptorSet> descriptor_sets;
+		// NOTE the camera of every caster is pushed to the presenters uniform ring,
+		//      so a single set with a dynamic offset serves all of them.
+		vk::UniqueDescriptorSet descriptor_set;
+		UniformRing* uniforms{nullptr};
+		// NOTE the models of shadow casters are pushed to the presenters instance ring
+		InstanceRing* instances{nullptr};
 	};
 	
 	RenderPipeline m_pipeline;
 };
-
-
-class OrthographicShadowPass 
-	: public GenericShadowPass
-{
-public:
-	OrthographicShadowPass() = default;
-	OrthographicShadowPass(OrthographicShadowPass&& rhs) = default;
-
-	OrthographicShadowPass(Logger& logger,
-						   Render::Context::Impl* context,
-						   Presenter::Impl* presenter,
-						   DescriptorPool::Impl* descriptor_pool,
-						   U32Extent extent,
-						   std::filesystem::path shader_root_path,
-						   const bool debug_print);
-
-	OrthographicShadowPass& operator=(OrthographicShadowPass&& rhs) = default;
-	
-	void record(Logger* logger,
-				vk::Device& device,
-				CurrentFlightFrame current_flightframe,
-				vk::CommandBuffer& commandbuffer,
-				std::optional<CameraUniformData> camera_data,
-				std::vector<MaterialRenderable>& renderables);
-	
-	auto get_shadowtexture(CurrentFlightFrame current_flightframe)
-		-> ShadowPassTexture&;
-};
-
-class PerspectiveShadowPass 
-	: public GenericShadowPass
-{
-public:
-	PerspectiveShadowPass() = default;
-	PerspectiveShadowPass(PerspectiveShadowPass&& rhs) = default;
-	PerspectiveShadowPass(Logger& logger,
-						  Render::Context::Impl* context,
-						  Presenter::Impl* presenter,
-						  DescriptorPool::Impl* descriptor_pool,
-						  U32Extent extent,
-						  std::filesystem::path shader_root_path,
-						  const bool debug_print);
-	
-	PerspectiveShadowPass& operator=(PerspectiveShadowPass&& rhs) = default;
-
-	void record(Logger* logger,
-				vk::Device& device,
-				CurrentFlightFrame current_flightframe,
-				vk::CommandBuffer& commandbuffer,
-				std::optional<CameraUniformData> camera_data,
-				std::vector<MaterialRenderable>& renderables);
-
-	auto get_shadowtexture(CurrentFlightFrame current_flightframe)
-		-> ShadowPassTexture&;
-};
-
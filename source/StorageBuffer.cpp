@@ -0,0 +1,29 @@
+#include "StorageBuffer.hpp"
+
+#include <algorithm>
+
+bool GrowableStorageBuffer::reserve(DeviceAllocator& allocator,
+									uint32_t count,
+									vk::DeviceSize element_size,
+									vk::BufferUsageFlags usage)
+{
+	if (static_cast<bool>(memory.buffer) && count <= capacity)
+		return false;
+
+	// NOTE never empty, a zero sized buffer can not be created or bound
+	capacity = std::max({count, capacity * 2, 64u});
+	memory = allocate_memory(allocator,
+							 capacity * element_size,
+							 vk::BufferUsageFlagBits::eStorageBuffer | usage,
+							 vk::MemoryPropertyFlagBits::eHostVisible
+							 | vk::MemoryPropertyFlagBits::eHostCoherent);
+	return true;
+}
+
+vk::DescriptorBufferInfo GrowableStorageBuffer::descriptor_info() const
+{
+	return vk::DescriptorBufferInfo{}
+		.setBuffer(memory.buffer.get())
+		.setOffset(0)
+		.setRange(VK_WHOLE_SIZE);
+}
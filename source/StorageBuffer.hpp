@@ -0,0 +1,39 @@
+#pragma once
+
+#include "Utils.hpp"
+
+#include <vulkan/vulkan.hpp>
+
+/**
+ * A host visible storage buffer for data whose size is only known when it is written.
+ *
+ * The capacity grows geometrically, so a buffer that is written every frame
+ * settles at a size after a few frames. Growing replaces the buffer,
+ * the descriptor sets referring to it then have to be rewritten.
+ */
+struct GrowableStorageBuffer
+{
+	AllocatedMemory memory;
+	uint32_t capacity{0};
+
+	/**
+	 * Make room for count elements of element_size bytes,
+	 * returns true when the buffer was replaced.
+	 * usage is added to the storage buffer usage, like indirect for draw commands.
+	 */
+	[[nodiscard]]
+	bool reserve(DeviceAllocator& allocator,
+				 uint32_t count,
+				 vk::DeviceSize element_size,
+				 vk::BufferUsageFlags usage = {});
+
+	[[nodiscard]]
+	vk::DescriptorBufferInfo descriptor_info() const;
+
+	template <typename T>
+	[[nodiscard]]
+	T* mapped()
+	{
+		return static_cast<T*>(memory.allocation.mapped());
+	}
+};
@@ -109,11 +109,6 @@ auto copy_bitmap_to_gpu(Render::Context::Impl* context,
 						const LoadedBitmap2D& bitmap)
 	-> Texture2D
 {
-	AllocatedMemory staging = create_staging_buffer(context->physical_device,
-													context->device.get(),
-													get_pixels(bitmap),
-													bitmap.memory_size());
-
 	const auto format = BitmapPixelFormatToVulkanFormat(bitmap.format);
 	auto texture_impl = 
 		std::make_unique<Texture2D::Impl>(GeneralTexture,
@@ -123,21 +118,11 @@ auto copy_bitmap_to_gpu(Render::Context::Impl* context,
 											  static_cast<uint32_t>(bitmap.height)},
 										  vkformat_to_textureformat(format));
 
-	with_buffer_submit(context->device.get(),
-					   context->commandpool.get(),
-					   context->graphics_queue(),
-					   [&] (vk::CommandBuffer& commandbuffer)
-					   {
-						   texture_impl->layout =
-							   transition_image_for_color_override(texture_impl->image(),
-																   commandbuffer);
-
-						   copy_buffer_to_image(staging.buffer.get(),
-												texture_impl->image(),
-												texture_impl->extent.width,
-												texture_impl->extent.height,
-												commandbuffer);
-					   });
+	texture_impl->upload = context->upload_queue->upload_to_image(texture_impl->image(),
+																  texture_impl->extent,
+																  get_pixels(bitmap),
+																  bitmap.memory_size());
+	texture_impl->layout = vk::ImageLayout::eTransferDstOptimal;
 	
 	return Texture2D(std::move(texture_impl));
 }
@@ -146,32 +131,17 @@ auto copy_canvas_to_gpu(Render::Context::Impl* context,
 						Canvas8bitRGBA& canvas)
 	-> Texture2D
 {
-	AllocatedMemory staging = create_staging_buffer(context->physical_device,
-													context->device.get(),
-													get_pixels(canvas),
-													canvas.memory_size());
-
 	auto texture_impl = 
 		std::make_unique<Texture2D::Impl>(GeneralTexture,
 										  context,
 										  U32Extent{canvas.extent.width, canvas.extent.height},
 										  TextureFormat::R8G8B8A8Srgb);
 
-	with_buffer_submit(context->device.get(),
-					   context->commandpool.get(),
-					   context->graphics_queue(),
-					   [&] (vk::CommandBuffer& commandbuffer)
-					   {
-						   texture_impl->layout =
-							   transition_image_for_color_override(texture_impl->image(),
-																   commandbuffer);
-
-						   copy_buffer_to_image(staging.buffer.get(),
-												texture_impl->image(),
-												texture_impl->extent.width,
-												texture_impl->extent.height,
-												commandbuffer);
-					   });
+	texture_impl->upload = context->upload_queue->upload_to_image(texture_impl->image(),
+																  texture_impl->extent,
+																  get_pixels(canvas),
+																  canvas.memory_size());
+	texture_impl->layout = vk::ImageLayout::eTransferDstOptimal;
 
 	return Texture2D(std::move(texture_impl));
 }
@@ -268,14 +238,16 @@ auto Texture2D::Impl::create_view(Render::Context::Impl* context,
 
 Texture2D::Impl::Impl(DepthBufferTextureType,
 					  Render::Context::Impl* context,
-					  const U32Extent extent_)
+					  const U32Extent extent_,
+					  const vk::ImageUsageFlags extra_usage)
 	: extent(vk::Extent3D(extent_.w, extent_.h, 1))
 	, format(vk::Format::eD32Sfloat)
 	, layout(vk::ImageLayout::eUndefined)
 {
-	const auto usage = vk::ImageUsageFlagBits::eDepthStencilAttachment;
-	allocated = allocate_image(context->physical_device,
-							   context->device.get(),
+	const vk::ImageUsageFlags usage =
+		vk::ImageUsageFlagBits::eDepthStencilAttachment
+		| extra_usage;
+	allocated = allocate_image(*context->allocator,
 							   extent,
 							   format,
 							   vk::ImageTiling::eOptimal,
@@ -297,8 +269,7 @@ Texture2D::Impl::Impl(RenderTargetTextureType,
 		| vk::ImageUsageFlagBits::eSampled
 		| vk::ImageUsageFlagBits::eColorAttachment;
 
-	allocated = allocate_image(context->physical_device,
-							   context->device.get(),
+	allocated = allocate_image(*context->allocator,
 							   extent,
 							   textureformat_to_vkformat(format),
 							   vk::ImageTiling::eOptimal,
@@ -312,6 +283,7 @@ Texture2D::Impl::Impl(Impl&& rhs) noexcept
 	std::swap(format, rhs.format);
 	std::swap(layout, rhs.layout);
 	std::swap(allocated, rhs.allocated);
+	std::swap(upload, rhs.upload);
 }
 
 auto Texture2D::Impl::operator=(Impl&& rhs) 
@@ -321,6 +293,7 @@ auto Texture2D::Impl::operator=(Impl&& rhs)
 	std::swap(format, rhs.format);
 	std::swap(layout, rhs.layout);
 	std::swap(allocated, rhs.allocated);
+	std::swap(upload, rhs.upload);
 	return *this;
 }
 
@@ -337,8 +310,7 @@ Texture2D::Impl::Impl(GeneralTextureType,
 		| vk::ImageUsageFlagBits::eTransferSrc
 		| vk::ImageUsageFlagBits::eSampled;
 
-	allocated = allocate_image(context->physical_device,
-							   context->device.get(),
+	allocated = allocate_image(*context->allocator,
 							   extent,
 							   textureformat_to_vkformat(format),
 							   vk::ImageTiling::eOptimal,
@@ -393,6 +365,12 @@ auto Texture2D::format()
 	return vkformat_to_textureformat(impl->format);
 }
 
+auto Texture2D::upload_ticket()
+		const noexcept -> UploadTicket
+{
+	return impl->upload;
+}
+
 Texture2D::Texture2D(Texture2D&& rhs) noexcept
 {
 	std::swap(impl, rhs.impl);
@@ -11,9 +11,11 @@ struct Texture2D::Impl
 				  const U32Extent extent,
 				  const TextureFormat format);
 
+	// NOTE extra_usage is added to the depth attachment usage, e.g. to copy the depths
 	explicit Impl(DepthBufferTextureType, 
 				  Render::Context::Impl* context,
-				  const U32Extent extent);
+				  const U32Extent extent,
+				  const vk::ImageUsageFlags extra_usage = {});
 
 	explicit Impl(RenderTargetTextureType, 
 				  Render::Context::Impl* context,
@@ -38,6 +40,8 @@ struct Texture2D::Impl
 	vk::Extent3D extent;
 	vk::Format format;
 	vk::ImageLayout layout;
+	// NOTE the layout is the one the image will have once the upload has executed.
+	UploadTicket upload{};
 };
 
 auto move_canvas_to_gpu(Render::Context::Impl* context,
@@ -0,0 +1,64 @@
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+
+namespace
+{
+
+// NOTE only set on worker threads, and only for the pool that owns them
+thread_local ThreadPool const* t_pool{nullptr};
+thread_local uint32_t t_worker_index{0};
+
+}
+
+ThreadPool::ThreadPool(uint32_t worker_count)
+{
+	worker_count = std::max<uint32_t>(worker_count, 1);
+	m_workers.reserve(worker_count);
+	for (uint32_t i = 0; i < worker_count; i++)
+		m_workers.emplace_back(&ThreadPool::work, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::scoped_lock lock(m_mutex);
+		m_stopping = true;
+	}
+	m_condition.notify_all();
+	for (std::thread& worker: m_workers)
+		worker.join();
+}
+
+uint32_t ThreadPool::worker_count() const noexcept
+{
+	return static_cast<uint32_t>(m_workers.size());
+}
+
+uint32_t ThreadPool::thread_index() const noexcept
+{
+	if (t_pool == this)
+		return t_worker_index;
+	return worker_count();
+}
+
+void ThreadPool::work(uint32_t index)
+{
+	t_pool = this;
+	t_worker_index = index;
+
+	while (true) {
+		std::function<void()> task;
+		{
+			std::unique_lock lock(m_mutex);
+			m_condition.wait(lock, [this] { return m_stopping || !m_tasks.empty(); });
+			// NOTE queued tasks are still finished when stopping,
+			//      someone may be waiting on their futures.
+			if (m_tasks.empty())
+				return;
+			task = std::move(m_tasks.front());
+			m_tasks.pop_front();
+		}
+		task();
+	}
+}
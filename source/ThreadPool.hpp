@@ -0,0 +1,62 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * A fixed set of worker threads executing submitted tasks in submission order.
+ * Exceptions thrown by a task are rethrown from the future it was submitted with.
+ */
+class ThreadPool
+{
+public:
+	explicit ThreadPool(uint32_t worker_count);
+	~ThreadPool();
+
+	ThreadPool(ThreadPool&) = delete;
+	ThreadPool& operator=(ThreadPool&) = delete;
+
+	template<typename Task>
+	[[nodiscard]]
+	auto submit(Task&& task)
+		-> std::future<std::invoke_result_t<Task>>
+	{
+		using Result = std::invoke_result_t<Task>;
+		// NOTE std::function has to be copyable, the packaged task is not.
+		auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<Task>(task));
+		std::future<Result> future = packaged->get_future();
+		{
+			std::scoped_lock lock(m_mutex);
+			m_tasks.emplace_back([packaged] () { (*packaged)(); });
+		}
+		m_condition.notify_one();
+		return future;
+	}
+
+	[[nodiscard]]
+	uint32_t worker_count() const noexcept;
+
+	/**
+	 * Index of the worker the calling thread is, in [0, worker_count),
+	 * threads that are not workers get worker_count.
+	 * Used to pick per-thread resources, such as command pools.
+	 */
+	[[nodiscard]]
+	uint32_t thread_index() const noexcept;
+
+private:
+	void work(uint32_t index);
+
+	std::vector<std::thread> m_workers;
+	std::deque<std::function<void()>> m_tasks;
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	bool m_stopping{false};
+};
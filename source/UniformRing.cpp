@@ -0,0 +1,65 @@
+#include "UniformRing.hpp"
+
+#include <cstring>
+#include <format>
+
+UniformRing::UniformRing(Logger logger,
+						 DeviceAllocator& allocator,
+						 vk::PhysicalDevice physical_device,
+						 vk::DeviceSize frame_size,
+						 uint32_t frames_in_flight,
+						 vk::BufferUsageFlags usage)
+	: m_logger(logger)
+	, m_frame_size(frame_size)
+{
+	const auto limits = physical_device.getProperties().limits;
+	// NOTE vertex buffer offsets only need to be aligned to the attributes
+	m_alignment = 16;
+	if (usage & vk::BufferUsageFlagBits::eUniformBuffer)
+		m_alignment = std::max<vk::DeviceSize>(m_alignment, limits.minUniformBufferOffsetAlignment);
+	m_frame_size = (frame_size + m_alignment - 1) / m_alignment * m_alignment;
+
+	m_memory = allocate_memory(allocator,
+							   m_frame_size * frames_in_flight,
+							   usage,
+							   // Host Visible and Coherent allows direct
+							   // writes into the buffers without sync issues.
+							   vk::MemoryPropertyFlagBits::eHostVisible
+							   | vk::MemoryPropertyFlagBits::eHostCoherent);
+	m_mapped = static_cast<std::byte*>(m_memory.allocation.mapped());
+
+	m_logger.info(std::source_location::current(),
+				  std::format("Created UniformRing with {} frames of {} bytes, {} byte alignment",
+							  frames_in_flight,
+							  m_frame_size,
+							  m_alignment));
+}
+
+vk::Buffer UniformRing::buffer() const noexcept
+{
+	return m_memory.buffer.get();
+}
+
+void UniformRing::begin_frame(CurrentFlightFrame current_flightframe)
+{
+	m_frame_begin = m_frame_size * current_flightframe.get();
+	m_head.store(0);
+}
+
+auto UniformRing::push(void const* data, vk::DeviceSize size, vk::DeviceSize range)
+	-> uint32_t
+{
+	const vk::DeviceSize reserved = (range + m_alignment - 1) / m_alignment * m_alignment;
+	const vk::DeviceSize offset = m_head.fetch_add(reserved);
+	if (offset + reserved > m_frame_size) {
+		m_logger.fatal(std::source_location::current(),
+					   std::format("UniformRing frame of {} bytes is exhausted",
+								   m_frame_size));
+		throw std::runtime_error("UniformRing frame is exhausted");
+	}
+
+	const vk::DeviceSize absolute = m_frame_begin + offset;
+	if (size > 0)
+		memcpy(m_mapped + absolute, data, size);
+	return static_cast<uint32_t>(absolute);
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "Utils.hpp"
+#include "FlightFrames.hpp"
+
+#include <algorithm>
+#include <atomic>
+
+/**
+ * Linear allocator for per-frame uniform data.
+ *
+ * One persistently mapped buffer is split into a region per frame in flight.
+ * Every push copies the data into the region of the current frame and returns
+ * the offset to bind it with, through a eUniformBufferDynamic descriptor that
+ * points at the start of the ring buffer.
+ * A region is rewound once the presenter knows the gpu is done with its frame.
+ *
+ * Per-instance data is pushed to an InstanceRing instead, which grows when a frame runs out.
+ */
+class UniformRing
+{
+public:
+	UniformRing(Logger logger,
+				DeviceAllocator& allocator,
+				vk::PhysicalDevice physical_device,
+				vk::DeviceSize frame_size,
+				uint32_t frames_in_flight,
+				vk::BufferUsageFlags usage = vk::BufferUsageFlagBits::eUniformBuffer);
+
+	UniformRing(UniformRing&) = delete;
+	UniformRing& operator=(UniformRing&) = delete;
+
+	void begin_frame(CurrentFlightFrame current_flightframe);
+
+	/**
+	 * Copy size bytes into the current frame, reserving range bytes for the binding.
+	 * The returned dynamic offset is valid until the frame is rewound.
+	 */
+	[[nodiscard]]
+	auto push(void const* data, vk::DeviceSize size, vk::DeviceSize range)
+		-> uint32_t;
+
+	template<typename T>
+	[[nodiscard]]
+	auto push(T const& data)
+		-> uint32_t
+	{
+		return push(&data, sizeof(T), sizeof(T));
+	}
+
+	// NOTE copies length elements, but reserves count to match the descriptor range
+	template<typename T>
+	[[nodiscard]]
+	auto push(T const* data, size_t length, size_t count)
+		-> uint32_t
+	{
+		return push(data, sizeof(T) * std::min(length, count), sizeof(T) * count);
+	}
+
+	/**
+	 * The buffer info a eUniformBufferDynamic descriptor of count elements of T
+	 * has to be written with.
+	 */
+	template<typename T>
+	[[nodiscard]]
+	auto descriptor_info(size_t count = 1) const
+		-> vk::DescriptorBufferInfo
+	{
+		return vk::DescriptorBufferInfo{}
+			.setBuffer(m_memory.buffer.get())
+			.setOffset(0)
+			.setRange(sizeof(T) * count);
+	}
+
+	[[nodiscard]]
+	vk::Buffer buffer() const noexcept;
+
+private:
+	Logger m_logger;
+	AllocatedMemory m_memory;
+	std::byte* m_mapped{nullptr};
+	vk::DeviceSize m_alignment{256};
+	vk::DeviceSize m_frame_size{0};
+	vk::DeviceSize m_frame_begin{0};
+	// NOTE relative to m_frame_begin, atomic so recording threads can push concurrently
+	std::atomic<vk::DeviceSize> m_head{0};
+};
@@ -0,0 +1,457 @@
+#include "UploadQueue.hpp"
+
+#include <cstring>
+#include <format>
+
+[[nodiscard]]
+constexpr vk::DeviceSize
+align_up(const vk::DeviceSize value, const vk::DeviceSize alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+[[nodiscard]]
+vk::ImageSubresourceRange
+color_subresource_range()
+{
+	return vk::ImageSubresourceRange{}
+		.setAspectMask(vk::ImageAspectFlagBits::eColor)
+		.setBaseMipLevel(0)
+		.setLevelCount(1)
+		.setBaseArrayLayer(0)
+		.setLayerCount(1);
+}
+
+UploadQueue::UploadQueue(Logger logger,
+						 vk::PhysicalDevice physical_device,
+						 vk::Device device,
+						 DeviceAllocator* allocator,
+						 uint32_t graphics_family_index,
+						 vk::Queue graphics_queue,
+						 std::optional<TransferQueue> transfer_queue,
+						 std::mutex* queue_mutex,
+						 vk::DeviceSize staging_size)
+	: m_logger(logger)
+	, m_physical_device(physical_device)
+	, m_device(device)
+	, m_allocator(allocator)
+	, m_graphics_family_index(graphics_family_index)
+	, m_graphics_queue(graphics_queue)
+	, m_transfer_queue(transfer_queue)
+	, m_queue_mutex(queue_mutex)
+	, m_staging_size(staging_size)
+{
+	auto graphics_pool_info = vk::CommandPoolCreateInfo{}
+		.setFlags(vk::CommandPoolCreateFlagBits::eResetCommandBuffer)
+		.setQueueFamilyIndex(m_graphics_family_index);
+	m_graphics_pool = m_device.createCommandPoolUnique(graphics_pool_info, nullptr);
+
+	if (m_transfer_queue.has_value()) {
+		auto transfer_pool_info = vk::CommandPoolCreateInfo{}
+			.setFlags(vk::CommandPoolCreateFlagBits::eResetCommandBuffer)
+			.setQueueFamilyIndex(m_transfer_queue.value().family_index);
+		m_transfer_pool = m_device.createCommandPoolUnique(transfer_pool_info, nullptr);
+	}
+
+	const auto limits = m_physical_device.getProperties().limits;
+	m_staging_alignment = std::max<vk::DeviceSize>(16, limits.optimalBufferCopyOffsetAlignment);
+
+	m_staging = allocate_memory(*m_allocator,
+								m_staging_size,
+								vk::BufferUsageFlagBits::eTransferSrc,
+								vk::MemoryPropertyFlagBits::eHostVisible
+								| vk::MemoryPropertyFlagBits::eHostCoherent);
+
+	// NOTE the allocator keeps host visible memory mapped,
+	//      host coherent memory needs no explicit flushes.
+	m_staging_mapped = static_cast<std::byte*>(m_staging.allocation.mapped());
+
+	m_logger.info(std::source_location::current(),
+				  std::format("Created UploadQueue with {} bytes staging ring, {}",
+							  m_staging_size,
+							  m_transfer_queue.has_value()
+							  ? std::format("using dedicated transfer family {}",
+											m_transfer_queue.value().family_index)
+							  : std::string("using the graphics queue")));
+}
+
+UploadQueue::~UploadQueue()
+{
+	std::scoped_lock lock(m_mutex);
+	flush_locked();
+	while (!m_in_flight.empty())
+		wait_for_oldest();
+}
+
+bool UploadQueue::has_dedicated_transfer_queue() const noexcept
+{
+	return m_transfer_queue.has_value();
+}
+
+auto UploadQueue::current_batch()
+	-> Batch&
+{
+	if (m_recording.has_value())
+		return m_recording.value();
+
+	if (!m_free.empty()) {
+		m_recording.emplace(std::move(m_free.back()));
+		m_free.pop_back();
+	}
+	else {
+		m_recording.emplace();
+		Batch& batch = m_recording.value();
+
+		const auto graphics_allocate_info = vk::CommandBufferAllocateInfo{}
+			.setCommandPool(m_graphics_pool.get())
+			.setLevel(vk::CommandBufferLevel::ePrimary)
+			.setCommandBufferCount(1);
+		batch.graphics_commands =
+			std::move(m_device.allocateCommandBuffersUnique(graphics_allocate_info).front());
+
+		if (m_transfer_queue.has_value()) {
+			const auto transfer_allocate_info = vk::CommandBufferAllocateInfo{}
+				.setCommandPool(m_transfer_pool.get())
+				.setLevel(vk::CommandBufferLevel::ePrimary)
+				.setCommandBufferCount(1);
+			batch.transfer_commands =
+				std::move(m_device.allocateCommandBuffersUnique(transfer_allocate_info).front());
+			batch.ownership_semaphore = m_device.createSemaphoreUnique(vk::SemaphoreCreateInfo{});
+		}
+
+		batch.fence = m_device.createFenceUnique(vk::FenceCreateInfo{});
+	}
+
+	Batch& batch = m_recording.value();
+	batch.ticket = m_next_ticket++;
+	batch.has_transfer_work = false;
+	batch.has_graphics_work = false;
+	batch.ring_end = 0;
+	batch.dedicated_staging.clear();
+	return batch;
+}
+
+auto UploadQueue::transfer_commands()
+	-> vk::CommandBuffer&
+{
+	Batch& batch = current_batch();
+	if (!batch.has_transfer_work) {
+		const auto begin_info = vk::CommandBufferBeginInfo{}
+			.setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
+		batch.transfer_commands->begin(begin_info);
+		batch.has_transfer_work = true;
+	}
+	return batch.transfer_commands.get();
+}
+
+auto UploadQueue::graphics_commands()
+	-> vk::CommandBuffer&
+{
+	Batch& batch = current_batch();
+	if (!batch.has_graphics_work) {
+		const auto begin_info = vk::CommandBufferBeginInfo{}
+			.setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
+		batch.graphics_commands->begin(begin_info);
+		batch.has_graphics_work = true;
+	}
+	return batch.graphics_commands.get();
+}
+
+auto UploadQueue::stage(void const* data, vk::DeviceSize size)
+	-> std::pair<vk::Buffer, vk::DeviceSize>
+{
+	if (size > m_staging_size) {
+		m_logger.warn(std::source_location::current(),
+					  std::format("Upload of {} bytes does not fit in the staging ring,"
+								  " using a dedicated staging buffer",
+								  size));
+		Batch& batch = current_batch();
+		batch.dedicated_staging.push_back(create_staging_buffer(*m_allocator,
+																data,
+																size));
+		return {batch.dedicated_staging.back().buffer.get(), 0};
+	}
+
+	while (true) {
+		vk::DeviceSize offset = align_up(m_staging_head, m_staging_alignment);
+		const vk::DeviceSize wrapped = offset % m_staging_size;
+		if (wrapped + size > m_staging_size)
+			offset += m_staging_size - wrapped;
+
+		if (offset + size - m_staging_tail <= m_staging_size) {
+			std::memcpy(m_staging_mapped + (offset % m_staging_size), data, size);
+			m_staging_head = offset + size;
+			current_batch().ring_end = m_staging_head;
+			return {m_staging.buffer.get(), offset % m_staging_size};
+		}
+
+		// NOTE the ring is full, free up the oldest batch. If only the batch that is
+		//      currently recorded holds the ring, it has to be submitted first.
+		retire_completed();
+		if (offset + size - m_staging_tail <= m_staging_size)
+			continue;
+		if (m_in_flight.empty())
+			flush_locked();
+		wait_for_oldest();
+	}
+}
+
+auto UploadQueue::upload_to_image(vk::Image image,
+								  vk::Extent3D extent,
+								  void const* data,
+								  vk::DeviceSize size)
+	-> UploadTicket
+{
+	std::scoped_lock lock(m_mutex);
+	const auto [staging_buffer, staging_offset] = stage(data, size);
+
+	const auto range = color_subresource_range();
+	const auto to_transfer_dst = vk::ImageMemoryBarrier{}
+		.setOldLayout(vk::ImageLayout::eUndefined)
+		.setNewLayout(vk::ImageLayout::eTransferDstOptimal)
+		.setSrcQueueFamilyIndex(vk::QueueFamilyIgnored)
+		.setDstQueueFamilyIndex(vk::QueueFamilyIgnored)
+		.setImage(image)
+		.setSubresourceRange(range)
+		.setSrcAccessMask(vk::AccessFlags())
+		.setDstAccessMask(vk::AccessFlagBits::eTransferWrite);
+
+	const auto subresource = vk::ImageSubresourceLayers{}
+		.setAspectMask(vk::ImageAspectFlagBits::eColor)
+		.setMipLevel(0)
+		.setBaseArrayLayer(0)
+		.setLayerCount(1);
+
+	const auto region = vk::BufferImageCopy{}
+		.setBufferOffset(staging_offset)
+		.setBufferRowLength(0)
+		.setBufferImageHeight(0)
+		.setImageSubresource(subresource)
+		.setImageOffset(vk::Offset3D{0, 0, 0})
+		.setImageExtent(extent);
+
+	auto record_copy = [&] (vk::CommandBuffer& commandbuffer)
+	{
+		commandbuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe,
+									  vk::PipelineStageFlagBits::eTransfer,
+									  vk::DependencyFlags(),
+									  nullptr,
+									  nullptr,
+									  to_transfer_dst);
+		commandbuffer.copyBufferToImage(staging_buffer,
+										image,
+										vk::ImageLayout::eTransferDstOptimal,
+										region);
+	};
+
+	if (!m_transfer_queue.has_value()) {
+		record_copy(graphics_commands());
+		return UploadTicket{current_batch().ticket};
+	}
+
+	/* Copy on the transfer queue, then hand the image over to the graphics queue
+	 */
+	const auto ownership_barrier = vk::ImageMemoryBarrier{}
+		.setOldLayout(vk::ImageLayout::eTransferDstOptimal)
+		.setNewLayout(vk::ImageLayout::eTransferDstOptimal)
+		.setSrcQueueFamilyIndex(m_transfer_queue.value().family_index)
+		.setDstQueueFamilyIndex(m_graphics_family_index)
+		.setImage(image)
+		.setSubresourceRange(range);
+
+	vk::CommandBuffer& transfer = transfer_commands();
+	record_copy(transfer);
+	transfer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+							 vk::PipelineStageFlagBits::eBottomOfPipe,
+							 vk::DependencyFlags(),
+							 nullptr,
+							 nullptr,
+							 vk::ImageMemoryBarrier(ownership_barrier)
+							 .setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+							 .setDstAccessMask(vk::AccessFlags()));
+
+	graphics_commands().pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+										vk::PipelineStageFlagBits::eTransfer,
+										vk::DependencyFlags(),
+										nullptr,
+										nullptr,
+										vk::ImageMemoryBarrier(ownership_barrier)
+										.setSrcAccessMask(vk::AccessFlags())
+										.setDstAccessMask(vk::AccessFlagBits::eTransferWrite
+														  | vk::AccessFlagBits::eTransferRead));
+
+	return UploadTicket{current_batch().ticket};
+}
+
+auto UploadQueue::upload_to_buffer(vk::Buffer buffer,
+								   vk::DeviceSize offset,
+								   void const* data,
+								   vk::DeviceSize size,
+								   vk::PipelineStageFlags dst_stage,
+								   vk::AccessFlags dst_access)
+	-> UploadTicket
+{
+	std::scoped_lock lock(m_mutex);
+	const auto [staging_buffer, staging_offset] = stage(data, size);
+
+	const auto region = vk::BufferCopy{}
+		.setSrcOffset(staging_offset)
+		.setDstOffset(offset)
+		.setSize(size);
+
+	const auto written = vk::BufferMemoryBarrier{}
+		.setBuffer(buffer)
+		.setOffset(offset)
+		.setSize(size);
+
+	if (!m_transfer_queue.has_value()) {
+		vk::CommandBuffer& commandbuffer = graphics_commands();
+		commandbuffer.copyBuffer(staging_buffer, buffer, region);
+		commandbuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+									  dst_stage,
+									  vk::DependencyFlags(),
+									  nullptr,
+									  vk::BufferMemoryBarrier(written)
+									  .setSrcQueueFamilyIndex(vk::QueueFamilyIgnored)
+									  .setDstQueueFamilyIndex(vk::QueueFamilyIgnored)
+									  .setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+									  .setDstAccessMask(dst_access),
+									  nullptr);
+		return UploadTicket{current_batch().ticket};
+	}
+
+	/* Copy on the transfer queue, then hand the buffer over to the graphics queue
+	 */
+	const auto ownership_barrier = vk::BufferMemoryBarrier(written)
+		.setSrcQueueFamilyIndex(m_transfer_queue.value().family_index)
+		.setDstQueueFamilyIndex(m_graphics_family_index);
+
+	vk::CommandBuffer& transfer = transfer_commands();
+	transfer.copyBuffer(staging_buffer, buffer, region);
+	transfer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+							 vk::PipelineStageFlagBits::eBottomOfPipe,
+							 vk::DependencyFlags(),
+							 nullptr,
+							 vk::BufferMemoryBarrier(ownership_barrier)
+							 .setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+							 .setDstAccessMask(vk::AccessFlags()),
+							 nullptr);
+
+	graphics_commands().pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+										dst_stage,
+										vk::DependencyFlags(),
+										nullptr,
+										vk::BufferMemoryBarrier(ownership_barrier)
+										.setSrcAccessMask(vk::AccessFlags())
+										.setDstAccessMask(dst_access),
+										nullptr);
+
+	return UploadTicket{current_batch().ticket};
+}
+
+auto UploadQueue::record(std::function<void(vk::CommandBuffer&)>&& f)
+	-> UploadTicket
+{
+	std::scoped_lock lock(m_mutex);
+	f(graphics_commands());
+	return UploadTicket{current_batch().ticket};
+}
+
+auto UploadQueue::flush()
+	-> UploadTicket
+{
+	std::scoped_lock lock(m_mutex);
+	return flush_locked();
+}
+
+auto UploadQueue::flush_locked()
+	-> UploadTicket
+{
+	if (!m_recording.has_value())
+		return UploadTicket{m_submitted_ticket};
+
+	Batch batch = std::move(m_recording.value());
+	m_recording.reset();
+
+	std::scoped_lock queue_lock(*m_queue_mutex);
+
+	if (batch.has_transfer_work) {
+		batch.transfer_commands->end();
+		const auto transfer_submit = vk::SubmitInfo{}
+			.setCommandBuffers(batch.transfer_commands.get())
+			.setSignalSemaphores(batch.ownership_semaphore.get());
+		m_transfer_queue.value().queue.submit(transfer_submit);
+	}
+
+	// NOTE the graphics submit always happens, its fence is what retires the batch.
+	if (!batch.has_graphics_work) {
+		const auto begin_info = vk::CommandBufferBeginInfo{}
+			.setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
+		batch.graphics_commands->begin(begin_info);
+	}
+	batch.graphics_commands->end();
+
+	const vk::PipelineStageFlags ownership_wait_stage = vk::PipelineStageFlagBits::eTransfer;
+	auto graphics_submit = vk::SubmitInfo{}
+		.setCommandBuffers(batch.graphics_commands.get());
+	if (batch.has_transfer_work) {
+		graphics_submit
+			.setWaitSemaphores(batch.ownership_semaphore.get())
+			.setWaitDstStageMask(ownership_wait_stage);
+	}
+	m_graphics_queue.submit(graphics_submit, batch.fence.get());
+
+	m_submitted_ticket = batch.ticket;
+	m_in_flight.push_back(std::move(batch));
+	return UploadTicket{m_submitted_ticket};
+}
+
+void UploadQueue::retire_completed()
+{
+	while (!m_in_flight.empty()) {
+		Batch& oldest = m_in_flight.front();
+		if (m_device.getFenceStatus(oldest.fence.get()) != vk::Result::eSuccess)
+			return;
+
+		m_completed_ticket = oldest.ticket;
+		m_staging_tail = std::max(m_staging_tail, oldest.ring_end);
+		m_device.resetFences(oldest.fence.get());
+		oldest.dedicated_staging.clear();
+		m_free.push_back(std::move(oldest));
+		m_in_flight.pop_front();
+	}
+}
+
+void UploadQueue::wait_for_oldest()
+{
+	if (m_in_flight.empty())
+		return;
+
+	const auto max_timeout = std::numeric_limits<uint64_t>::max();
+	const auto result = m_device.waitForFences(m_in_flight.front().fence.get(),
+											   true,
+											   max_timeout);
+	if (result != vk::Result::eSuccess) {
+		const auto msg = "UploadQueue could not wait for upload fence";
+		m_logger.error(std::source_location::current(), msg);
+		throw std::runtime_error(msg);
+	}
+	retire_completed();
+}
+
+bool UploadQueue::is_complete(UploadTicket ticket)
+{
+	std::scoped_lock lock(m_mutex);
+	retire_completed();
+	return ticket.value <= m_completed_ticket;
+}
+
+void UploadQueue::wait(UploadTicket ticket)
+{
+	std::scoped_lock lock(m_mutex);
+	if (ticket.value > m_submitted_ticket)
+		flush_locked();
+
+	while (m_completed_ticket < ticket.value && !m_in_flight.empty())
+		wait_for_oldest();
+}
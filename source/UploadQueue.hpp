@@ -0,0 +1,151 @@
+#pragma once
+
+#include <VulkanRenderer/Context.hpp>
+#include "Utils.hpp"
+
+#include <deque>
+#include <mutex>
+
+/**
+ * UploadQueue batches staging copies and layout transitions into a single submit,
+ * instead of blocking on a queue.waitIdle for every texture that is uploaded.
+ *
+ * Staging data is written into a persistently mapped ring buffer that is reused
+ * once the batch that referenced it has retired. Uploads that do not fit in the
+ * ring get a dedicated staging buffer that lives as long as their batch.
+ *
+ * When the device exposes a transfer-only queue family, copies are recorded for
+ * that queue and ownership is released to the graphics family, where the matching
+ * acquire and any recorded layout transitions are executed.
+ */
+class UploadQueue
+{
+public:
+	struct TransferQueue
+	{
+		uint32_t family_index;
+		vk::Queue queue;
+	};
+
+	UploadQueue(Logger logger,
+				vk::PhysicalDevice physical_device,
+				vk::Device device,
+				DeviceAllocator* allocator,
+				uint32_t graphics_family_index,
+				vk::Queue graphics_queue,
+				std::optional<TransferQueue> transfer_queue,
+				std::mutex* queue_mutex,
+				vk::DeviceSize staging_size);
+	~UploadQueue();
+
+	UploadQueue(UploadQueue&) = delete;
+	UploadQueue& operator=(UploadQueue&) = delete;
+
+	/**
+	 * Copy tightly packed pixels into the first mip/layer of a color image.
+	 * The image is expected to be in the Undefined layout, and is left in
+	 * TransferDstOptimal owned by the graphics queue family.
+	 */
+	auto upload_to_image(vk::Image image,
+						 vk::Extent3D extent,
+						 void const* data,
+						 vk::DeviceSize size)
+		-> UploadTicket;
+
+	/**
+	 * Copy data into a buffer, and make the write visible to the given stage/access
+	 * of the graphics queue.
+	 */
+	auto upload_to_buffer(vk::Buffer buffer,
+						  vk::DeviceSize offset,
+						  void const* data,
+						  vk::DeviceSize size,
+						  vk::PipelineStageFlags dst_stage,
+						  vk::AccessFlags dst_access)
+		-> UploadTicket;
+
+	/**
+	 * Record arbitrary graphics queue commands (typically layout transitions) into the
+	 * current batch. They execute after every upload recorded before them.
+	 */
+	auto record(std::function<void(vk::CommandBuffer&)>&& f)
+		-> UploadTicket;
+
+	/**
+	 * Submit the current batch, if it has any work.
+	 * The returned ticket covers every upload recorded so far.
+	 */
+	auto flush()
+		-> UploadTicket;
+
+	[[nodiscard]]
+	bool is_complete(UploadTicket ticket);
+	void wait(UploadTicket ticket);
+
+	[[nodiscard]]
+	bool has_dedicated_transfer_queue() const noexcept;
+
+private:
+	struct Batch
+	{
+		uint64_t ticket{0};
+		vk::UniqueCommandBuffer transfer_commands;
+		vk::UniqueCommandBuffer graphics_commands;
+		vk::UniqueSemaphore ownership_semaphore;
+		vk::UniqueFence fence;
+		bool has_transfer_work{false};
+		bool has_graphics_work{false};
+		vk::DeviceSize ring_end{0};
+		std::vector<AllocatedMemory> dedicated_staging;
+	};
+
+	auto current_batch()
+		-> Batch&;
+
+	auto transfer_commands()
+		-> vk::CommandBuffer&;
+
+	auto graphics_commands()
+		-> vk::CommandBuffer&;
+
+	auto stage(void const* data, vk::DeviceSize size)
+		-> std::pair<vk::Buffer, vk::DeviceSize>;
+
+	auto flush_locked()
+		-> UploadTicket;
+
+	void retire_completed();
+	void wait_for_oldest();
+
+	Logger m_logger;
+	vk::PhysicalDevice m_physical_device;
+	vk::Device m_device;
+	DeviceAllocator* m_allocator{nullptr};
+	uint32_t m_graphics_family_index{0};
+	vk::Queue m_graphics_queue;
+	std::optional<TransferQueue> m_transfer_queue;
+	// NOTE the graphics queue is shared with the presenter, queue access has to be
+	//      externally synchronized.
+	std::mutex* m_queue_mutex{nullptr};
+
+	vk::UniqueCommandPool m_graphics_pool;
+	vk::UniqueCommandPool m_transfer_pool;
+
+	AllocatedMemory m_staging;
+	std::byte* m_staging_mapped{nullptr};
+	vk::DeviceSize m_staging_size{0};
+	vk::DeviceSize m_staging_alignment{16};
+	// NOTE head and tail are monotonic offsets, the physical offset is head % size.
+	vk::DeviceSize m_staging_head{0};
+	vk::DeviceSize m_staging_tail{0};
+
+	std::optional<Batch> m_recording;
+	std::deque<Batch> m_in_flight;
+	std::vector<Batch> m_free;
+
+	uint64_t m_next_ticket{1};
+	uint64_t m_submitted_ticket{0};
+	uint64_t m_completed_ticket{0};
+
+	std::mutex m_mutex;
+};
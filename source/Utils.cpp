@@ -191,6 +191,31 @@ get_graphics_present_indices(vk::PhysicalDevice physical_device, vk::SurfaceKHR
 	return SplitGraphicsPresentIndices{graphics_indices[0], present_indices[0]};
 }
 
+[[nodiscard]]
+std::optional<uint32_t>
+find_dedicated_transfer_queue_family_index(const vk::PhysicalDevice& device)
+{
+	const auto properties = device.getQueueFamilyProperties();
+	for (uint32_t i = 0; i < properties.size(); i++) {
+		const auto flags = properties[i].queueFlags;
+		const bool is_transfer = static_cast<bool>(flags & vk::QueueFlagBits::eTransfer);
+		const bool is_graphics = static_cast<bool>(flags & vk::QueueFlagBits::eGraphics);
+		const bool is_compute = static_cast<bool>(flags & vk::QueueFlagBits::eCompute);
+		if (is_transfer && !is_graphics && !is_compute)
+			return i;
+	}
+
+	for (uint32_t i = 0; i < properties.size(); i++) {
+		const auto flags = properties[i].queueFlags;
+		const bool is_transfer = static_cast<bool>(flags & vk::QueueFlagBits::eTransfer);
+		const bool is_graphics = static_cast<bool>(flags & vk::QueueFlagBits::eGraphics);
+		if (is_transfer && !is_graphics)
+			return i;
+	}
+
+	return std::nullopt;
+}
+
 [[nodiscard]]
 IndexQueues
 get_index_queues(const vk::Device& device, const GraphicsPresentIndices& indices)
@@ -320,12 +345,12 @@ findMemoryType(vk::PhysicalDeviceMemoryProperties const & memoryProperties,
 }
 
 AllocatedMemory
-allocate_memory(vk::PhysicalDevice& physical_device,
-				vk::Device& device,
+allocate_memory(DeviceAllocator& allocator,
 				const vk::DeviceSize size,
 				const vk::BufferUsageFlags usage,
 				const vk::MemoryPropertyFlags properties)
 {
+	vk::Device device = allocator.device();
 	const auto bufferInfo = vk::BufferCreateInfo{}
 		.setSize(size)
 		.setUsage(usage)
@@ -334,57 +359,43 @@ allocate_memory(vk::PhysicalDevice& physical_device,
 	AllocatedMemory buffer_and_memory{};
 	buffer_and_memory.buffer = device.createBufferUnique(bufferInfo, nullptr);
 
-	vk::PhysicalDeviceMemoryProperties memProperties = physical_device.getMemoryProperties();
     vk::MemoryRequirements memRequirements =
 		device.getBufferMemoryRequirements(*(buffer_and_memory.buffer));
 
-	const auto memoryTypeIndex = findMemoryType(memProperties,
-												memRequirements.memoryTypeBits,
-												properties);
-
-    auto allocInfo = vk::MemoryAllocateInfo{}
-		.setAllocationSize(memRequirements.size)
-		.setMemoryTypeIndex(memoryTypeIndex);
-
-	buffer_and_memory.memory = device.allocateMemoryUnique(allocInfo, nullptr);
+	buffer_and_memory.allocation = allocator.allocate(memRequirements,
+													  properties,
+													  AllocationKind::Linear);
 	device.bindBufferMemory(*(buffer_and_memory.buffer),
-							*(buffer_and_memory.memory),
-							0);
+							buffer_and_memory.allocation.memory(),
+							buffer_and_memory.allocation.offset());
 
 	return buffer_and_memory;
 }
 
 void
-copy_to_allocated_memory(vk::Device& device,
-						 AllocatedMemory& allocated_memory,
+copy_to_allocated_memory(AllocatedMemory& allocated_memory,
 						 void const* data,
 						 const size_t size)
 {
-	void* staging_ptr = device.mapMemory(allocated_memory.memory.get(),
-										 0,
-										 size,
-										 vk::MemoryMapFlags());
-	memcpy(staging_ptr, data, size);
-	device.unmapMemory(allocated_memory.memory.get());
+	void* mapped = allocated_memory.allocation.mapped();
+	assert(mapped != nullptr);
+	memcpy(mapped, data, size);
 }
 
 
 AllocatedMemory
-create_staging_buffer(vk::PhysicalDevice& physical_device,
-					  vk::Device& device,
+create_staging_buffer(DeviceAllocator& allocator,
 					  void const* data,
 					  const vk::DeviceSize size)
 {
 	AllocatedMemory staging =
-		allocate_memory(physical_device,
-							  device, 
-							  size,
-							  vk::BufferUsageFlagBits::eTransferSrc,
-							  vk::MemoryPropertyFlagBits::eHostVisible
-							  | vk::MemoryPropertyFlagBits::eHostCoherent);
-
-	copy_to_allocated_memory(device,
-							 staging,
+		allocate_memory(allocator,
+						size,
+						vk::BufferUsageFlagBits::eTransferSrc,
+						vk::MemoryPropertyFlagBits::eHostVisible
+						| vk::MemoryPropertyFlagBits::eHostCoherent);
+
+	copy_to_allocated_memory(staging,
 							 data,
 							 size);
 	return staging;
@@ -397,14 +408,14 @@ get_image(AllocatedImage& allocatedImage)
 }
 
 AllocatedImage
-allocate_image(vk::PhysicalDevice physical_device,
-			   vk::Device device,
+allocate_image(DeviceAllocator& allocator,
 			   const vk::Extent3D extent,
 			   const vk::Format format,
 			   const vk::ImageTiling tiling,
 			   const vk::MemoryPropertyFlags propertyFlags,
 			   const vk::ImageUsageFlags usage) noexcept
 {
+	vk::Device device = allocator.device();
 	const auto imageCreateInfo = vk::ImageCreateInfo{}
 		.setImageType(vk::ImageType::e2D)
 		.setFormat(format)
@@ -420,20 +431,22 @@ allocate_image(vk::PhysicalDevice physical_device,
 	AllocatedImage out{};
 	out.image = device.createImageUnique(imageCreateInfo);
 	
-	vk::PhysicalDeviceMemoryProperties memProperties = physical_device.getMemoryProperties();
     vk::MemoryRequirements memRequirements =
 		device.getImageMemoryRequirements(out.image.get());
 
-	const auto memoryTypeIndex = findMemoryType(memProperties,
-												memRequirements.memoryTypeBits,
-												propertyFlags);
-
-    auto allocInfo = vk::MemoryAllocateInfo{}
-		.setAllocationSize(memRequirements.size)
-		.setMemoryTypeIndex(memoryTypeIndex);
-	out.memory = device.allocateMemoryUnique(allocInfo, nullptr);
-
-	device.bindImageMemory(out.image.get(), out.memory.get(), 0);
+	const bool is_attachment = static_cast<bool>(
+		usage & (vk::ImageUsageFlagBits::eColorAttachment
+				 | vk::ImageUsageFlagBits::eDepthStencilAttachment));
+	const AllocationKind kind = is_attachment
+		? AllocationKind::Dedicated
+		: (tiling == vk::ImageTiling::eLinear)
+		? AllocationKind::Linear
+		: AllocationKind::Optimal;
+
+	out.allocation = allocator.allocate(memRequirements, propertyFlags, kind);
+	device.bindImageMemory(out.image.get(),
+						   out.allocation.memory(),
+						   out.allocation.offset());
 	return out;
 }
 
@@ -559,38 +572,6 @@ image_subresource_range(const vk::ImageAspectFlags aspect_mask)
 		.setLayerCount(VK_REMAINING_ARRAY_LAYERS);
 }
 
-/**
-* https://vkguide.dev/docs/chapter-5/loading_images/
-*/
-vk::ImageLayout 
-transition_image_for_color_override(vk::Image& image,
-									vk::CommandBuffer& commandbuffer)
-{
-    auto range = vk::ImageSubresourceRange{}
-		.setAspectMask(vk::ImageAspectFlagBits::eColor)
-		.setBaseMipLevel(0)
-		.setLevelCount(1)
-		.setBaseArrayLayer(0)
-		.setLayerCount(1);
-
-	auto barrier = vk::ImageMemoryBarrier{}
-		.setOldLayout(vk::ImageLayout::eUndefined)
-		.setNewLayout(vk::ImageLayout::eTransferDstOptimal)
-		.setImage(image)
-		.setSubresourceRange(range)
-		.setSrcAccessMask(vk::AccessFlags())
-		.setDstAccessMask(vk::AccessFlagBits::eTransferWrite);
-
-    commandbuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe,
-								  vk::PipelineStageFlagBits::eTransfer,
-								  vk::DependencyFlags(),
-								  nullptr,
-								  nullptr,
-								  barrier);
-
-	return vk::ImageLayout::eTransferDstOptimal;
-}
-
 void
 copy_buffer_to_image(vk::Buffer& buffer,
 					 vk::Image& image,
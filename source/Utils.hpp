@@ -7,6 +7,8 @@
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_vulkan.h>
 
+#include "DeviceAllocator.hpp"
+
 #include <filesystem>
 #include <functional>
 #include <fstream>
@@ -69,6 +71,14 @@ find_matching_queue_family_indices(const std::vector<uint32_t> a,
 std::optional<GraphicsPresentIndices>
 get_graphics_present_indices(vk::PhysicalDevice physical_device, vk::SurfaceKHR surface);
 
+/**
+* Find a queue family that supports transfers but not graphics,
+* these usually map to the dma engines of discrete gpus.
+*/
+[[nodiscard]]
+std::optional<uint32_t>
+find_dedicated_transfer_queue_family_index(const vk::PhysicalDevice& device);
+
 struct SharedIndexQueue {
 	vk::Queue shared;
 };
@@ -148,41 +158,47 @@ findMemoryType(vk::PhysicalDeviceMemoryProperties const & memoryProperties,
 
 struct AllocatedMemory
 {
+	// NOTE declared before the buffer so the buffer is destroyed first.
+	DeviceAllocation allocation;
 	vk::UniqueBuffer buffer; 
-	vk::UniqueDeviceMemory memory;
 };
 
 AllocatedMemory
-allocate_memory(vk::PhysicalDevice& physical_device,
-				vk::Device& device,
+allocate_memory(DeviceAllocator& allocator,
 				const vk::DeviceSize size,
 				const vk::BufferUsageFlags usage,
 				const vk::MemoryPropertyFlags properties);
 
+/**
+* Write directly into the persistently mapped allocation,
+* the memory has to be host visible and coherent.
+*/
 void
-copy_to_allocated_memory(vk::Device& device,
-						 AllocatedMemory& allocated_memory,
+copy_to_allocated_memory(AllocatedMemory& allocated_memory,
 						 void const* data,
 						 const size_t size);
 
 AllocatedMemory
-create_staging_buffer(vk::PhysicalDevice& physical_device,
-					  vk::Device& device,
+create_staging_buffer(DeviceAllocator& allocator,
 					  void const* data,
 					  const vk::DeviceSize size);
 
 struct AllocatedImage
 {
+	// NOTE declared before the image so the image is destroyed first.
+	DeviceAllocation allocation;
 	vk::UniqueImage image;
-	vk::UniqueDeviceMemory memory;
 };
 
 vk::Image&
 get_image(AllocatedImage& allocatedImage);
 
+/**
+* Attachments get a dedicated allocation, as they are large
+* and recreated together with the swapchain.
+*/
 AllocatedImage
-allocate_image(vk::PhysicalDevice physical_device,
-			   vk::Device device,
+allocate_image(DeviceAllocator& allocator,
 			   const vk::Extent3D extent,
 			   const vk::Format format,
 			   const vk::ImageTiling tiling,
@@ -220,13 +236,6 @@ transition_image_layout(vk::Image& image,
 vk::ImageSubresourceRange 
 image_subresource_range(const vk::ImageAspectFlags aspect_mask);
 
-/**
-* https://vkguide.dev/docs/chapter-5/loading_images/
-*/
-vk::ImageLayout 
-transition_image_for_color_override(vk::Image& image,
-									vk::CommandBuffer& commandbuffer);
-
 void
 copy_buffer_to_image(vk::Buffer& buffer,
 					 vk::Image& image,
@@ -54,48 +54,34 @@ create_vertex_buffer(vk::PhysicalDevice& physical_device,
 VertexBuffer::Impl::Impl(Render::Context::Impl* context,
 						 const void* vertices,
 						 size_t vertices_length,
-						 size_t vertex_memory_size)
+						 size_t vertex_memory_size,
+						 VertexBufferMemory placement_)
+	: placement(placement_)
 {
-	auto physical_device = context->physical_device;
-	auto device = context->device.get();
-
 	length = vertices_length;
-
-	const auto buffer_info = vk::BufferCreateInfo{}
-		.setSize(vertices_length * vertex_memory_size)
-		.setUsage(vk::BufferUsageFlagBits::eVertexBuffer)
-		.setSharingMode(vk::SharingMode::eExclusive);
-	buffer = device.createBufferUnique(buffer_info);
-	
-	const auto memory_requirements =
-		device.getBufferMemoryRequirements(buffer.get());
-	const auto memory_properties = physical_device.getMemoryProperties();
-	
-	auto memorytype = findMemoryType(memory_properties,
-									 memory_requirements.memoryTypeBits,
-									 vk::MemoryPropertyFlagBits::eHostVisible
-									 | vk::MemoryPropertyFlagBits::eHostCoherent);
-
-	const auto allocate_info = vk::MemoryAllocateInfo{}
-		.setAllocationSize(memory_requirements.size)
-		.setMemoryTypeIndex(memorytype);
-	
-	memory = device.allocateMemoryUnique(allocate_info, nullptr);
-	device.bindBufferMemory(buffer.get(), memory.get(), 0);
-	
-	void* data{nullptr};
-	vk::Result result = device.mapMemory(memory.get(),
-										 0,
-										 memory_requirements.size,
-										 vk::MemoryMapFlags(),
-										 &data);
-
-	//TODO: return a invalid vertex buffer type!
-	if (result != vk::Result::eSuccess)
-		throw std::runtime_error("could not map memory!");
-
-	memcpy(data, vertices, static_cast<size_t>(memory_requirements.size));
-	device.unmapMemory(memory.get());
+	capacity = vertices_length * vertex_memory_size;
+
+	if (placement == VertexBufferMemory::HostVisible) {
+		memory = allocate_memory(*context->allocator,
+								 capacity,
+								 vk::BufferUsageFlagBits::eVertexBuffer,
+								 vk::MemoryPropertyFlagBits::eHostVisible
+								 | vk::MemoryPropertyFlagBits::eHostCoherent);
+		copy_to_allocated_memory(memory, vertices, capacity);
+		return;
+	}
+
+	memory = allocate_memory(*context->allocator,
+							 capacity,
+							 vk::BufferUsageFlagBits::eVertexBuffer
+							 | vk::BufferUsageFlagBits::eTransferDst,
+							 vk::MemoryPropertyFlagBits::eDeviceLocal);
+	upload = context->upload_queue->upload_to_buffer(memory.buffer.get(),
+													 0,
+													 vertices,
+													 capacity,
+													 vk::PipelineStageFlagBits::eVertexInput,
+													 vk::AccessFlagBits::eVertexAttributeRead);
 }
 
 
@@ -104,17 +90,41 @@ VertexBuffer::VertexBuffer() {}
 VertexBuffer::VertexBuffer(Render::Context& context,
 						   const void* vertices,
 						   size_t vertices_length,
-						   size_t vertex_memory_size)
+						   size_t vertex_memory_size,
+						   VertexBufferMemory memory)
 	: impl(std::make_unique<Impl>(context.impl.get(),
 								  vertices,
 								  vertices_length,
-								  vertex_memory_size))
+								  vertex_memory_size,
+								  memory))
+{
+}
+
+void VertexBuffer::update(const void* vertices,
+						  size_t vertices_length,
+						  size_t vertex_memory_size)
+{
+	if (impl->placement != VertexBufferMemory::HostVisible)
+		throw std::runtime_error("Only HostVisible VertexBuffers can be updated");
+
+	const vk::DeviceSize size = vertices_length * vertex_memory_size;
+	if (size > impl->capacity)
+		throw std::runtime_error("VertexBuffer update is larger than the buffer");
+
+	copy_to_allocated_memory(impl->memory, vertices, size);
+	impl->length = vertices_length;
+}
+
+auto VertexBuffer::upload_ticket()
+	const noexcept -> UploadTicket
 {
+	return impl->upload;
 }
 	
 VertexBuffer::VertexBuffer(VertexBuffer&& rhs)
 {
 	std::swap(impl, rhs.impl);
+	std::swap(bounds, rhs.bounds);
 }
 
 VertexBuffer::~VertexBuffer() 
@@ -124,5 +134,6 @@ VertexBuffer::~VertexBuffer()
 VertexBuffer& VertexBuffer::operator=(VertexBuffer&& rhs)
 {
 	std::swap(impl, rhs.impl);
+	std::swap(bounds, rhs.bounds);
 	return *this;
 }
@@ -9,9 +9,12 @@ struct VertexBuffer::Impl
 	Impl(Render::Context::Impl* context,
 		 const void* vertices,
 		 size_t vertices_length,
-		 size_t vertex_memory_size);
+		 size_t vertex_memory_size,
+		 VertexBufferMemory placement);
 	
-	vk::UniqueBuffer buffer;
-	vk::UniqueDeviceMemory memory;
+	AllocatedMemory memory;
 	size_t length;
+	vk::DeviceSize capacity{0};
+	VertexBufferMemory placement{VertexBufferMemory::DeviceLocal};
+	UploadTicket upload{};
 };
@@ -76,3 +76,27 @@ auto attribute_descriptions(const VertexPosNormColorUV&)
 		.setOffset(offsetof(VertexPosNormColorUV, uv)),
 	};
 }
+
+auto instance_binding_description()
+	-> vk::VertexInputBindingDescription
+{
+	return vk::VertexInputBindingDescription{}
+		.setBinding(instance_binding)
+		.setStride(sizeof(InstanceData))
+		.setInputRate(vk::VertexInputRate::eInstance);
+}
+
+auto instance_attribute_descriptions()
+	-> std::array<vk::VertexInputAttributeDescription, 4>
+{
+	// NOTE a mat4 attribute is read as one vec4 column per location
+	std::array<vk::VertexInputAttributeDescription, 4> attributes{};
+	for (uint32_t column = 0; column < attributes.size(); column++) {
+		attributes[column] = vk::VertexInputAttributeDescription{}
+			.setBinding(instance_binding)
+			.setLocation(instance_first_location + column)
+			.setFormat(vk::Format::eR32G32B32A32Sfloat)
+			.setOffset(offsetof(InstanceData, model) + column * sizeof(glm::vec4));
+	}
+	return attributes;
+}
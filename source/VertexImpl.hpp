@@ -4,6 +4,9 @@
 
 #include <vulkan/vulkan.hpp>
 
+#include <algorithm>
+#include <array>
+
 auto binding_descriptions(const VertexPosNormColor&)
 	-> std::array<vk::VertexInputBindingDescription, 1>;
 
@@ -16,3 +19,48 @@ auto binding_descriptions(const VertexPosNormColorUV&)
 auto attribute_descriptions(const VertexPosNormColorUV&)
 	-> std::array<vk::VertexInputAttributeDescription, 4>;
 
+/**
+ * Per instance data of instanced draws, read from vertex binding 1.
+ * The model matrix takes the four locations from 4 to 7.
+ */
+struct InstanceData
+{
+	glm::mat4 model;
+};
+
+uint32_t constexpr instance_binding = 1;
+uint32_t constexpr instance_first_location = 4;
+
+auto instance_binding_description()
+	-> vk::VertexInputBindingDescription;
+
+auto instance_attribute_descriptions()
+	-> std::array<vk::VertexInputAttributeDescription, 4>;
+
+/**
+ * Vertex and instance bindings of Vertex, for pipelines drawn instanced.
+ */
+template<typename Vertex>
+auto instanced_binding_descriptions(const Vertex& vertex)
+	-> std::array<vk::VertexInputBindingDescription, 2>
+{
+	return std::array<vk::VertexInputBindingDescription, 2>{
+		binding_descriptions(vertex)[0],
+		instance_binding_description(),
+	};
+}
+
+template<typename Vertex>
+auto instanced_attribute_descriptions(const Vertex& vertex)
+{
+	const auto vertex_attributes = attribute_descriptions(vertex);
+	const auto instance_attributes = instance_attribute_descriptions();
+
+	size_t constexpr vertex_count = std::tuple_size_v<decltype(vertex_attributes)>;
+	size_t constexpr instance_count = std::tuple_size_v<decltype(instance_attributes)>;
+
+	std::array<vk::VertexInputAttributeDescription, vertex_count + instance_count> attributes{};
+	std::ranges::copy(vertex_attributes, attributes.begin());
+	std::ranges::copy(instance_attributes, attributes.begin() + vertex_count);
+	return attributes;
+}
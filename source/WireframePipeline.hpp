@@ -3,6 +3,8 @@
 #include <format>
 
 #include "VertexImpl.hpp"
+#include "IndexBufferImpl.hpp"
+#include "PipelineCache.hpp"
 
 struct WireframePipeline
 {
@@ -24,6 +26,7 @@ struct WireframeRenderInfo
 WireframePipeline
 create_wireframe_render_pipeline(Logger& logger,
 								 vk::Device& device,
+								 PipelineCache* pipeline_cache,
 								 vk::RenderPass& renderpass,
 								 const vk::Extent2D render_extent,
 								 const std::filesystem::path shader_root_path,
@@ -216,8 +219,8 @@ create_wireframe_render_pipeline(Logger& logger,
 		.setRenderPass(renderpass);
 
 	vk::ResultValue<vk::UniquePipeline> result =
-		device.createGraphicsPipelineUnique(nullptr,
-											graphicsPipelineCreateInfo);
+		pipeline_cache->create_graphics_pipeline(pipeline_name,
+												 graphicsPipelineCreateInfo);
 	
     switch (result.result) {
 	case vk::Result::eSuccess:
@@ -246,6 +249,8 @@ void draw_wireframes(WireframePipeline& pipeline,
 	commandbuffer.bindPipeline(vk::PipelineBindPoint::eGraphics,
 							   pipeline.pipeline.get());
 
+	Mesh* last_mesh = nullptr;
+
 	for (auto renderable: renderables) {
 		WireframePipeline::PushConstants push{};
 		push.color = renderable.basecolor;	
@@ -257,23 +262,19 @@ void draw_wireframes(WireframePipeline& pipeline,
 									sizeof(push),
 									&push);
 		
-		const uint32_t firstBinding = 0;
-		const uint32_t bindingCount = 1;
-		std::array<vk::DeviceSize, bindingCount> offsets = {0};
-		std::array<vk::Buffer, bindingCount> buffers {
-			renderable.mesh->vertexbuffer.impl->buffer.get(),
-		};
-		commandbuffer.bindVertexBuffers(firstBinding,
-										bindingCount,
-										buffers.data(),
-										offsets.data());
+		if (renderable.mesh != last_mesh) {
+			bind_mesh_buffers(commandbuffer,
+							  renderable.mesh->vertexbuffer,
+							  renderable.mesh->indexbuffer);
+			last_mesh = renderable.mesh;
+		}
 
 		const uint32_t instanceCount = 1;
-		const uint32_t firstVertex = 0;
 		const uint32_t firstInstance = 0;
-		commandbuffer.draw(renderable.mesh->vertexbuffer.impl->length,
-						   instanceCount,
-						   firstVertex,
-						   firstInstance);
+		record_draw(commandbuffer,
+					renderable.mesh->vertexbuffer,
+					renderable.mesh->indexbuffer,
+					instanceCount,
+					firstInstance);
 	}
 }
@@ -9,6 +9,7 @@
 #include <thread>
 #include <fstream>
 #include <streambuf>
+#include <mutex>
 
 #include <VulkanRenderer/Context.hpp>
 #include <VulkanRenderer/Presenter.hpp>
@@ -81,7 +82,7 @@ std::vector<VertexPosNormColor> triangle_vertices = {
 };
 
 
-struct Scene
+struct LoadedScene
 {
 	std::vector<Renderable> renderables;
 	std::vector<Light> lights;
@@ -111,7 +112,7 @@ auto parse_transform(json j)
 
 auto load_scene_from_path(std::filesystem::path const path,
 						  Resources& resources)
-	-> Scene
+	-> LoadedScene
 {
 	std::ifstream fs(path.string());
 	std::string content;
@@ -123,7 +124,7 @@ auto load_scene_from_path(std::filesystem::path const path,
 				   std::istreambuf_iterator<char>());
 
 	json j = json::parse(content);
-	Scene scene;
+	LoadedScene scene;
 
 	json prefabs = j["prefabs"];
 	for (auto& prefab: prefabs) {
@@ -261,8 +262,14 @@ auto load_scene_from_path(std::filesystem::path const path,
 				PositionVector{position},
 				UpVector{world_up}};
 
-			if (obj["casts-shadow"] == "yes") {
-				scene.shadowcasters.directional_caster = caster;
+			if (obj["casts-shadow"] == "yes" && obj.contains("shadow-cascades")) {
+				ShadowCascades cascades{};
+				cascades.count = obj["shadow-cascades"];
+				scene.shadowcasters.directional_casters.push_back(
+					DirectionalShadowCaster{p, cascades, UpVector{world_up}});
+			}
+			else if (obj["casts-shadow"] == "yes") {
+				scene.shadowcasters.directional_casters.push_back(caster);
 			}
 			else {
 				scene.lights.push_back(p);
@@ -308,7 +315,7 @@ auto load_scene_from_path(std::filesystem::path const path,
 
 
 			if (obj["casts-shadow"] == "yes") {
-				scene.shadowcasters.spot_caster = caster;
+				scene.shadowcasters.spot_casters.push_back(caster);
 			}
 			else {
 				scene.lights.push_back(p);
@@ -372,8 +379,11 @@ int main()
 	
 	std::ofstream logfile;
 	logfile.open("./Engine.log");
+	// NOTE the renderer logs from its worker threads as well
+	std::mutex log_mutex;
 
 	logger.log = [&] (std::source_location loc, Logger::Type type, std::string msg) {
+		std::scoped_lock lock(log_mutex);
 		
 		std::string typestr = "?";
 		switch (type) {
@@ -444,15 +454,23 @@ int main()
 
 	DescriptorPoolCreateInfo descriptor_pool_info;
 	descriptor_pool_info.uniform_buffer_count = 5000;
+	descriptor_pool_info.uniform_buffer_dynamic_count = 5000;
 	descriptor_pool_info.combined_image_sampler_count = 5000;
 
 	DescriptorPool descriptor_pool(descriptor_pool_info, context);
 
+	RendererCreateInfo renderer_info;
+	renderer_info.pipeline_cache_directory = "./cache/";
+
 	Renderer renderer(context,
 					  presenter,
 					  logger,
 					  descriptor_pool,
-					  shaders_root);
+					  shaders_root,
+					  renderer_info);
+
+	for (RendererTiming const& timing: renderer.startup_timings())
+		std::cout << std::format("{}: {:.3f} ms", timing.name, timing.milliseconds) << std::endl;
 	
 	Resources resources{context, assets_root};
 
@@ -466,6 +484,7 @@ int main()
 	bool exit = false;
 	uint64_t framecount = 0;
 	std::size_t scene_index = 0;
+	std::optional<std::size_t> loaded_scene_index{};
 
 	while (!exit) {
 		/** ************************************************************************
@@ -587,15 +606,23 @@ int main()
 				if (scene_index > scenes.size() - 1)
 					scene_index = 0;
 				
-				Scene scene	= load_scene_from_path(scenes.at(scene_index),
-												   resources);
+				// NOTE the scene is retained by the renderer, so it is only loaded when switched
+				if (loaded_scene_index != scene_index) {
+					LoadedScene const loaded = load_scene_from_path(scenes.at(scene_index),
+																	resources);
+					Scene& scene = renderer.scene();
+					scene.clear();
+					for (Renderable const& renderable: loaded.renderables)
+						scene.add(renderable);
+					for (Light const& light: loaded.lights)
+						scene.add(light);
+					scene.set_shadowcasters(loaded.shadowcasters);
+					loaded_scene_index = scene_index;
+				}
 
 				auto* textureptr = renderer.render(frameInfo.current_flight_frame_index,
 												   frameInfo.total_frame_count,
-												   world_info,
-												   scene.renderables,
-												   scene.lights,
-												   scene.shadowcasters);
+												   world_info);
 			
 				if (textureptr == nullptr)
 					return std::nullopt;
@@ -615,8 +642,26 @@ int main()
 					std::chrono::duration_cast<std::chrono::milliseconds>(render_time);
 				
 				std::cout << "Frame Time [ms]: " << frame_time_ms.count() << "\n"
-						  << "Frame Count:     " << framecount << "\n"
-						  << "====================================="
+						  << "Frame Count:     " << framecount << "\n";
+				for (RendererTiming const& timing: renderer.gpu_timings())
+					std::cout << std::format("{} gpu: {:.3f} ms\n", timing.name, timing.milliseconds);
+				for (RendererDrawStatistics const& statistics: renderer.draw_statistics()) {
+					const std::string unsorted_binds = statistics.unsorted_binds.has_value()
+						? std::to_string(statistics.unsorted_binds.value())
+						: std::string("unknown");
+					std::cout << std::format("{}: {} draws, {} binds unsorted, {} binds sorted\n",
+											 statistics.name,
+											 statistics.draws,
+											 unsorted_binds,
+											 statistics.sorted_binds);
+				}
+				for (RendererCullStatistics const& statistics: renderer.cull_statistics()) {
+					std::cout << std::format("{}: {} visible, {} culled\n",
+											 statistics.name,
+											 statistics.visible,
+											 statistics.culled);
+				}
+				std::cout << "====================================="
 						  << std::endl;
 			}
 		}